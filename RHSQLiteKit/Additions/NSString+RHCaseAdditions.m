@@ -70,20 +70,44 @@
 }
 
 -(NSString*)sk_stringByDeletingComments{
-    NSRange range;
-    NSMutableString *result = [NSMutableString stringWithString:self];
-
-    //remove: /* comment */
-    while ((range = [result rangeOfString:@"/\\*.*?\\*/" options:NSRegularExpressionSearch]).location != NSNotFound){
-        [result replaceCharactersInRange:range withString:@""];
-    }
+    //single pass over the string, comment markers inside '' or "" quoted literals are left alone.
+    NSUInteger length = self.length;
+    if (length < 2) return self;
+    
+    unichar *characters = malloc(sizeof(unichar) * length);
+    if (!characters) return self;
+    [self getCharacters:characters range:NSMakeRange(0, length)];
     
-    //remove: //comment
-    while ((range = [result rangeOfString:@"//.*?\\n" options:NSRegularExpressionSearch]).location != NSNotFound){
-        [result replaceCharactersInRange:range withString:@""];
+    NSUInteger writeIndex = 0;
+    unichar quote = 0;
+    for (NSUInteger i = 0; i < length; i++) {
+        unichar c = characters[i];
+        unichar next = (i + 1 < length) ? characters[i + 1] : 0;
+        
+        if (quote){
+            if (c == quote) quote = 0;  //doubled quotes just re-enter the literal on the next character
+        } else if (c == '\'' || c == '"'){
+            quote = c;
+        } else if (c == '/' && next == '*'){
+            //remove: /* comment */
+            NSUInteger j = i + 2;
+            while (j + 1 < length && !(characters[j] == '*' && characters[j + 1] == '/')) j++;
+            i = MIN(j + 1, length - 1);
+            continue;
+        } else if (c == '/' && next == '/'){
+            //remove: //comment (including its newline)
+            NSUInteger j = i + 2;
+            while (j < length && characters[j] != '\n') j++;
+            i = j;
+            continue;
+        }
+        
+        characters[writeIndex++] = c;
     }
-
-    return [NSString stringWithString:result];
+    
+    NSString *result = [NSString stringWithCharacters:characters length:writeIndex];
+    free(characters);
+    return result;
 }
 
 -(NSString*)sk_stringByTrimmingWhitespaceAndNewlineCharacters{
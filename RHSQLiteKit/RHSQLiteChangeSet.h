@@ -0,0 +1,75 @@
+//
+//  RHSQLiteChangeSet.h
+//  RHSQLiteKit
+//
+//  Created by agent on 18/10/2026.
+//  Copyright (c) 2026 Richard Heard. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions
+//  are met:
+//  1. Redistributions of source code must retain the above copyright
+//  notice, this list of conditions and the following disclaimer.
+//  2. Redistributions in binary form must reproduce the above copyright
+//  notice, this list of conditions and the following disclaimer in the
+//  documentation and/or other materials provided with the distribution.
+//  3. The name of the author may not be used to endorse or promote products
+//  derived from this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+//  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+//  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+//  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+//  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+//  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#import <Foundation/Foundation.h>
+
+#import "RHSQLiteObject.h"
+
+typedef enum {
+    RHSQLiteChangeTypeNone = 0,
+    RHSQLiteChangeTypeInsert,
+    RHSQLiteChangeTypeUpdate,
+    RHSQLiteChangeTypeDelete,
+} RHSQLiteChangeType;
+
+//folds a later change to the same row into an earlier one. ie insert + update => insert, insert + delete => none, delete + insert => update
+extern RHSQLiteChangeType RHSQLiteChangeTypeCoalesce(RHSQLiteChangeType earlier, RHSQLiteChangeType later);
+
+/*!
+ @class RHSQLiteChangeSet
+ @abstract RHSQLiteChangeSet describes the rows changed by one or more committed transactions, with changes to the same row coalesced into one.
+ @discussion Delivered to change observers, see -[RHSQLiteDataStore addObserverForTable:queue:usingBlock:].
+    Rows are identified by their rowid, which is the objectID of any object whose primaryKeyName is _ROWID_ or an INTEGER PRIMARY KEY column.
+    External change sets are created when another connection or process is found to have written to the file. 
+    sqlite can't tell us what they changed, so they contain no rows and report every table as changed.
+ */
+@interface RHSQLiteChangeSet : NSObject {
+    NSDictionary *_changesByTable; //table name -> dictionary of NSNumber rowid -> NSNumber RHSQLiteChangeType
+    BOOL _external;
+}
+
+-(id)initWithChangesByTable:(NSDictionary*)changesByTable;
++(id)externalChangeSet;
+
+@property (nonatomic, readonly, getter=isExternal) BOOL external;
+@property (nonatomic, readonly) NSArray *tableNames; //tables with at least one changed row. empty for external change sets
+
+-(BOOL)containsChangesToTable:(NSString*)tableName; //always YES for external change sets
+-(NSUInteger)numberOfChanges;
+
+//arrays of NSNumber rowids, in ascending order
+-(NSArray*)insertedObjectIDsInTable:(NSString*)tableName;
+-(NSArray*)updatedObjectIDsInTable:(NSString*)tableName;
+-(NSArray*)deletedObjectIDsInTable:(NSString*)tableName;
+-(NSArray*)changedObjectIDsInTable:(NSString*)tableName; //all of the above
+
+-(RHSQLiteChangeType)changeTypeForObjectID:(RHSQLiteObjectID)objectID inTable:(NSString*)tableName;
+
+@end
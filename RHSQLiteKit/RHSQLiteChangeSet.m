@@ -0,0 +1,137 @@
+//
+//  RHSQLiteChangeSet.m
+//  RHSQLiteKit
+//
+//  Created by agent on 18/10/2026.
+//  Copyright (c) 2026 Richard Heard. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions
+//  are met:
+//  1. Redistributions of source code must retain the above copyright
+//  notice, this list of conditions and the following disclaimer.
+//  2. Redistributions in binary form must reproduce the above copyright
+//  notice, this list of conditions and the following disclaimer in the
+//  documentation and/or other materials provided with the distribution.
+//  3. The name of the author may not be used to endorse or promote products
+//  derived from this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+//  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+//  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+//  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+//  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+//  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#import "RHSQLiteChangeSet.h"
+
+RHSQLiteChangeType RHSQLiteChangeTypeCoalesce(RHSQLiteChangeType earlier, RHSQLiteChangeType later){
+    switch (earlier) {
+        case RHSQLiteChangeTypeInsert:
+            //the row didn't exist before, so it is still an insert, or never happened at all
+            if (later == RHSQLiteChangeTypeUpdate) return RHSQLiteChangeTypeInsert;
+            if (later == RHSQLiteChangeTypeDelete) return RHSQLiteChangeTypeNone;
+            return later;
+        case RHSQLiteChangeTypeDelete:
+            //the rowid was reused, anyone holding it will see different values
+            if (later == RHSQLiteChangeTypeInsert) return RHSQLiteChangeTypeUpdate;
+            return later;
+        default:
+            return later;
+    }
+}
+
+
+@interface RHSQLiteChangeSet ()
+//private
+-(NSArray*)_objectIDsInTable:(NSString*)tableName ofType:(RHSQLiteChangeType)type;
+@end
+
+@implementation RHSQLiteChangeSet
+
+@synthesize external=_external;
+
+-(id)initWithChangesByTable:(NSDictionary*)changesByTable{
+    self = [super init];
+    if (self){
+        _changesByTable = changesByTable ? [changesByTable copy] : [NSDictionary dictionary];
+        _external = NO;
+    }
+    return self;
+}
+
++(id)externalChangeSet{
+    RHSQLiteChangeSet *changeSet = [[self alloc] initWithChangesByTable:nil];
+    changeSet->_external = YES;
+    return changeSet;
+}
+
+#pragma mark - tables
+-(NSArray*)tableNames{
+    return [[_changesByTable allKeys] sortedArrayUsingSelector:@selector(compare:)];
+}
+
+-(BOOL)containsChangesToTable:(NSString*)tableName{
+    if (_external) return YES;
+    return [[_changesByTable objectForKey:tableName] count] > 0;
+}
+
+-(NSUInteger)numberOfChanges{
+    NSUInteger count = 0;
+    for (NSDictionary *changes in [_changesByTable allValues]) {
+        count += [changes count];
+    }
+    return count;
+}
+
+#pragma mark - rows
+-(NSArray*)insertedObjectIDsInTable:(NSString*)tableName{
+    return [self _objectIDsInTable:tableName ofType:RHSQLiteChangeTypeInsert];
+}
+
+-(NSArray*)updatedObjectIDsInTable:(NSString*)tableName{
+    return [self _objectIDsInTable:tableName ofType:RHSQLiteChangeTypeUpdate];
+}
+
+-(NSArray*)deletedObjectIDsInTable:(NSString*)tableName{
+    return [self _objectIDsInTable:tableName ofType:RHSQLiteChangeTypeDelete];
+}
+
+-(NSArray*)changedObjectIDsInTable:(NSString*)tableName{
+    return [self _objectIDsInTable:tableName ofType:RHSQLiteChangeTypeNone];
+}
+
+-(NSArray*)_objectIDsInTable:(NSString*)tableName ofType:(RHSQLiteChangeType)type{
+    NSDictionary *changes = [_changesByTable objectForKey:tableName];
+    if (!changes) return [NSArray array];
+    
+    //RHSQLiteChangeTypeNone matches everything
+    NSMutableArray *objectIDs = [NSMutableArray array];
+    [changes enumerateKeysAndObjectsUsingBlock:^(NSNumber *objectID, NSNumber *change, BOOL *stop) {
+        if (type == RHSQLiteChangeTypeNone || [change intValue] == type) [objectIDs addObject:objectID];
+    }];
+    [objectIDs sortUsingSelector:@selector(compare:)];
+    return [NSArray arrayWithArray:objectIDs];
+}
+
+-(RHSQLiteChangeType)changeTypeForObjectID:(RHSQLiteObjectID)objectID inTable:(NSString*)tableName{
+    return (RHSQLiteChangeType)[[[_changesByTable objectForKey:tableName] objectForKey:[NSNumber numberWithLongLong:objectID]] intValue];
+}
+
+#pragma mark - description
+-(NSString*)description{
+    if (_external) return [NSString stringWithFormat:@"<%@: %p, external>", NSStringFromClass([self class]), self];
+    
+    NSMutableArray *tables = [NSMutableArray array];
+    for (NSString *tableName in [self tableNames]) {
+        [tables addObject:[NSString stringWithFormat:@"%@: +%lu ~%lu -%lu", tableName, (unsigned long)[[self insertedObjectIDsInTable:tableName] count], (unsigned long)[[self updatedObjectIDsInTable:tableName] count], (unsigned long)[[self deletedObjectIDsInTable:tableName] count]]];
+    }
+    return [NSString stringWithFormat:@"<%@: %p, changes: {%@}>", NSStringFromClass([self class]), self, [tables componentsJoinedByString:@", "]];
+}
+
+@end
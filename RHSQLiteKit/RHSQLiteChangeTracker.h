@@ -0,0 +1,94 @@
+//
+//  RHSQLiteChangeTracker.h
+//  RHSQLiteKit
+//
+//  Created by agent on 18/10/2026.
+//  Copyright (c) 2026 Richard Heard. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions
+//  are met:
+//  1. Redistributions of source code must retain the above copyright
+//  notice, this list of conditions and the following disclaimer.
+//  2. Redistributions in binary form must reproduce the above copyright
+//  notice, this list of conditions and the following disclaimer in the
+//  documentation and/or other materials provided with the distribution.
+//  3. The name of the author may not be used to endorse or promote products
+//  derived from this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+//  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+//  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+//  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+//  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+//  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// INTERNAL CLASS: DO NOT USE UNLESS YOU KNOW WHAT YOU ARE DOING
+
+#import <Foundation/Foundation.h>
+
+#import "RHSQLiteChangeSet.h"
+
+@class FMDatabase;
+@class RHSQLiteDataStore;
+@class RHSQLiteObjectQuery;
+
+/*!
+ @class RHSQLiteChangeTracker
+ @abstract RHSQLiteChangeTracker records the rows changed on the connections it is attached to, using sqlite3_update_hook().
+ @discussion Changes are coalesced per row while their transaction is open. The commit hook moves them to the committed set, the rollback hook throws them away.
+    The hooks run on the connection while it is busy, so nothing is delivered from them. Instead the data store takes the committed changes 
+    once its database block has finished, see takeCommittedChanges.
+    DELETE FROM without a WHERE clause would normally skip the update hook (the truncate optimisation), so an authorizer turns the optimisation off
+    for statements prepared while we are attached. Those deletes remove rows one at a time instead, and are reported like any other.
+    Caveats, all inherited from sqlite: WITHOUT ROWID tables are not reported, nor are rows restored by ROLLBACK TO a savepoint removed. 
+    Connections can only have one authorizer, so we replace any other while attached.
+ */
+@interface RHSQLiteChangeTracker : NSObject {
+    NSSet *_ignoredTableNames;
+    NSMutableArray *_connections;           //RHSQLiteChangeTrackerConnection, one per attached connection
+    NSMutableDictionary *_committedChanges; //table name -> NSMutableDictionary of NSNumber rowid -> NSNumber RHSQLiteChangeType, coalesced across transactions
+}
+
+-(id)initWithIgnoredTableNames:(NSSet*)ignoredTableNames; //ie our metadata table
+
+//installs our update, commit and rollback hooks, and our authorizer. must be called on the thread that owns db. The tracker must outlive the connection, or be detached first.
+-(void)attachToDatabase:(FMDatabase*)db;
+-(void)detachFromDatabase:(FMDatabase*)db;
+
+//everything committed since the last call, or nil if nothing was. safe to call from any thread.
+-(RHSQLiteChangeSet*)takeCommittedChanges;
+
+//cross process change detection, using PRAGMA data_version. returns YES if another connection has committed to the file since the last call. 
+//the first call for each connection just records the current version.
+-(BOOL)hasExternalChangesInDatabase:(FMDatabase*)db;
+
+@end
+
+
+/*!
+ @class RHSQLiteChangeObserver
+ @abstract A single observer registered with -[RHSQLiteDataStore addObserverForTable:queue:usingBlock:] or addObserverForQuery:queue:usingBlock:.
+ @discussion Table observers (a nil table observes every table) are called for every change set that touches their table. 
+    Query observers re-run their query and are only called when its objectIDs have changed, or one of the matching rows was updated.
+ */
+@interface RHSQLiteChangeObserver : NSObject {
+    NSString *_tableName;
+    RHSQLiteObjectQuery *_query;
+    NSArray *_lastObjectIDs; //query observers only
+    NSOperationQueue *_queue;
+    void (^_tableBlock)(RHSQLiteChangeSet *changes);
+    void (^_queryBlock)(RHSQLiteChangeSet *changes, NSArray *objectIDs);
+}
+
+-(id)initWithTableName:(NSString*)tableName queue:(NSOperationQueue*)queue block:(void (^)(RHSQLiteChangeSet *changes))block;
+-(id)initWithQuery:(RHSQLiteObjectQuery*)query objectIDs:(NSArray*)objectIDs queue:(NSOperationQueue*)queue block:(void (^)(RHSQLiteChangeSet *changes, NSArray *objectIDs))block;
+
+//calls the block on our queue (or the current thread if we have none), if the changes are of interest
+-(void)dataStore:(RHSQLiteDataStore*)dataStore didCommitChanges:(RHSQLiteChangeSet*)changeSet;
+
+@end
@@ -0,0 +1,315 @@
+//
+//  RHSQLiteChangeTracker.m
+//  RHSQLiteKit
+//
+//  Created by agent on 18/10/2026.
+//  Copyright (c) 2026 Richard Heard. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions
+//  are met:
+//  1. Redistributions of source code must retain the above copyright
+//  notice, this list of conditions and the following disclaimer.
+//  2. Redistributions in binary form must reproduce the above copyright
+//  notice, this list of conditions and the following disclaimer in the
+//  documentation and/or other materials provided with the distribution.
+//  3. The name of the author may not be used to endorse or promote products
+//  derived from this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+//  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+//  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+//  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+//  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+//  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#import "RHSQLiteChangeTracker.h"
+#import "RHSQLiteDataStore.h"
+#import "RHSQLiteObjectQuery.h"
+
+#import "FMDatabase.h"
+#import "FMResultSet.h"
+
+static void RHSQLiteChangeTrackerUpdateHook(void *context, int operation, const char *databaseName, const char *tableName, sqlite3_int64 rowID);
+static int RHSQLiteChangeTrackerCommitHook(void *context);
+static void RHSQLiteChangeTrackerRollbackHook(void *context);
+static int RHSQLiteChangeTrackerAuthorizer(void *context, int action, const char *argument1, const char *argument2, const char *databaseName, const char *triggerName);
+
+
+//one per attached connection, only ever touched from the connections own thread (except for its handle)
+@interface RHSQLiteChangeTrackerConnection : NSObject {
+@public
+    __unsafe_unretained RHSQLiteChangeTracker *_tracker;
+    sqlite3 *_handle;
+    NSMutableDictionary *_pendingChanges; //the open transactions changes, same layout as _committedChanges
+    
+    //the update hook is called once per row, so save a string allocation when consecutive rows are in the same table (they almost always are)
+    char *_lastTableName;
+    NSString *_lastTableNameString;
+    
+    int64_t _dataVersion; //-1 until first checked
+}
+@end
+
+@implementation RHSQLiteChangeTrackerConnection
+
+-(void)dealloc{
+    free(_lastTableName);
+}
+
+@end
+
+
+@interface RHSQLiteChangeTracker ()
+//private
+-(RHSQLiteChangeTrackerConnection*)_connectionForHandle:(sqlite3*)handle;
+-(void)_commitPendingChangesOfConnection:(RHSQLiteChangeTrackerConnection*)connection;
+@end
+
+
+@implementation RHSQLiteChangeTracker
+
+-(id)initWithIgnoredTableNames:(NSSet*)ignoredTableNames{
+    self = [super init];
+    if (self){
+        _ignoredTableNames = ignoredTableNames ? [ignoredTableNames copy] : [NSSet set];
+        _connections = [[NSMutableArray alloc] init];
+        _committedChanges = [[NSMutableDictionary alloc] init];
+    }
+    return self;
+}
+
+#pragma mark - connections
+-(void)attachToDatabase:(FMDatabase*)db{
+    sqlite3 *handle = [db sqliteHandle];
+    if (!handle) return;
+    
+    RHSQLiteChangeTrackerConnection *connection = nil;
+    @synchronized(self){
+        if ([self _connectionForHandle:handle]) return;
+        
+        connection = [[RHSQLiteChangeTrackerConnection alloc] init];
+        connection->_tracker = self;
+        connection->_handle = handle;
+        connection->_pendingChanges = [[NSMutableDictionary alloc] init];
+        connection->_dataVersion = -1;
+        [_connections addObject:connection];
+    }
+    
+    void *context = (__bridge void*)connection;
+    sqlite3_update_hook(handle, RHSQLiteChangeTrackerUpdateHook, context);
+    sqlite3_commit_hook(handle, RHSQLiteChangeTrackerCommitHook, context);
+    sqlite3_rollback_hook(handle, RHSQLiteChangeTrackerRollbackHook, context);
+    sqlite3_set_authorizer(handle, RHSQLiteChangeTrackerAuthorizer, NULL);
+}
+
+-(void)detachFromDatabase:(FMDatabase*)db{
+    sqlite3 *handle = [db sqliteHandle];
+    if (!handle) return;
+    
+    @synchronized(self){
+        RHSQLiteChangeTrackerConnection *connection = [self _connectionForHandle:handle];
+        if (!connection) return;
+        
+        sqlite3_update_hook(handle, NULL, NULL);
+        sqlite3_commit_hook(handle, NULL, NULL);
+        sqlite3_rollback_hook(handle, NULL, NULL);
+        sqlite3_set_authorizer(handle, NULL, NULL);
+        [_connections removeObject:connection];
+    }
+}
+
+-(RHSQLiteChangeTrackerConnection*)_connectionForHandle:(sqlite3*)handle{
+    @synchronized(self){
+        for (RHSQLiteChangeTrackerConnection *connection in _connections) {
+            if (connection->_handle == handle) return connection;
+        }
+    }
+    return nil;
+}
+
+#pragma mark - hooks
+static void RHSQLiteChangeTrackerUpdateHook(void *context, int operation, const char *databaseName, const char *tableName, sqlite3_int64 rowID){
+    RHSQLiteChangeTrackerConnection *connection = (__bridge RHSQLiteChangeTrackerConnection*)context;
+    if (!tableName || (databaseName && strcmp(databaseName, "temp") == 0)) return;
+    
+    if (!connection->_lastTableName || strcmp(connection->_lastTableName, tableName) != 0){
+        free(connection->_lastTableName);
+        connection->_lastTableName = strdup(tableName);
+        connection->_lastTableNameString = [NSString stringWithUTF8String:tableName];
+    }
+    NSString *table = connection->_lastTableNameString;
+    if (!table || [connection->_tracker->_ignoredTableNames containsObject:table]) return;
+    
+    RHSQLiteChangeType change = operation == SQLITE_INSERT ? RHSQLiteChangeTypeInsert : operation == SQLITE_DELETE ? RHSQLiteChangeTypeDelete : RHSQLiteChangeTypeUpdate;
+    
+    NSMutableDictionary *changes = [connection->_pendingChanges objectForKey:table];
+    if (!changes){
+        changes = [NSMutableDictionary dictionary];
+        [connection->_pendingChanges setObject:changes forKey:table];
+    }
+    
+    NSNumber *key = [NSNumber numberWithLongLong:rowID];
+    NSNumber *existing = [changes objectForKey:key];
+    if (existing) change = RHSQLiteChangeTypeCoalesce((RHSQLiteChangeType)[existing intValue], change);
+    
+    if (change == RHSQLiteChangeTypeNone) [changes removeObjectForKey:key];
+    else [changes setObject:[NSNumber numberWithInt:change] forKey:key];
+}
+
+//returning SQLITE_IGNORE for a DELETE still deletes the rows, but one at a time rather than with the truncate optimisation, 
+//so DELETE FROM without a WHERE clause reaches our update hook. (see: https://www.sqlite.org/lang_delete.html#truncateopt)
+static int RHSQLiteChangeTrackerAuthorizer(void *context, int action, const char *argument1, const char *argument2, const char *databaseName, const char *triggerName){
+    if (action == SQLITE_DELETE && argument1 && strncmp(argument1, "sqlite_", 7) != 0) return SQLITE_IGNORE;
+    return SQLITE_OK;
+}
+
+static int RHSQLiteChangeTrackerCommitHook(void *context){
+    RHSQLiteChangeTrackerConnection *connection = (__bridge RHSQLiteChangeTrackerConnection*)context;
+    [connection->_tracker _commitPendingChangesOfConnection:connection];
+    return 0; //non zero would turn the commit into a rollback
+}
+
+static void RHSQLiteChangeTrackerRollbackHook(void *context){
+    RHSQLiteChangeTrackerConnection *connection = (__bridge RHSQLiteChangeTrackerConnection*)context;
+    [connection->_pendingChanges removeAllObjects];
+}
+
+-(void)_commitPendingChangesOfConnection:(RHSQLiteChangeTrackerConnection*)connection{
+    //called before the commit is actually on disk. if it then fails we report changes that didn't happen, which at worst costs a reload.
+    if ([connection->_pendingChanges count] < 1) return;
+    
+    @synchronized(_committedChanges){
+        [connection->_pendingChanges enumerateKeysAndObjectsUsingBlock:^(NSString *table, NSDictionary *pending, BOOL *stop) {
+            NSMutableDictionary *committed = [_committedChanges objectForKey:table];
+            if (!committed){
+                [_committedChanges setObject:[pending mutableCopy] forKey:table];
+                return;
+            }
+            
+            [pending enumerateKeysAndObjectsUsingBlock:^(NSNumber *rowID, NSNumber *later, BOOL *stopRows) {
+                NSNumber *earlier = [committed objectForKey:rowID];
+                RHSQLiteChangeType change = earlier ? RHSQLiteChangeTypeCoalesce((RHSQLiteChangeType)[earlier intValue], (RHSQLiteChangeType)[later intValue]) : (RHSQLiteChangeType)[later intValue];
+                if (change == RHSQLiteChangeTypeNone) [committed removeObjectForKey:rowID];
+                else [committed setObject:[NSNumber numberWithInt:change] forKey:rowID];
+            }];
+        }];
+    }
+    [connection->_pendingChanges removeAllObjects];
+}
+
+#pragma mark - delivery
+-(RHSQLiteChangeSet*)takeCommittedChanges{
+    NSMutableDictionary *changes = nil;
+    @synchronized(_committedChanges){
+        if ([_committedChanges count] < 1) return nil;
+        changes = _committedChanges;
+        _committedChanges = [[NSMutableDictionary alloc] init];
+    }
+    
+    //tables whose changes cancelled each other out
+    for (NSString *table in [changes allKeys]) {
+        if ([[changes objectForKey:table] count] < 1) [changes removeObjectForKey:table];
+    }
+    if ([changes count] < 1) return nil;
+    
+    return [[RHSQLiteChangeSet alloc] initWithChangesByTable:changes];
+}
+
+#pragma mark - external changes
+-(BOOL)hasExternalChangesInDatabase:(FMDatabase*)db{
+    RHSQLiteChangeTrackerConnection *connection = [self _connectionForHandle:[db sqliteHandle]];
+    if (!connection) return NO;
+    
+    //data_version changes whenever a different connection commits, in any process. our own commits leave it alone.
+    int64_t dataVersion = -1;
+    FMResultSet *resultSet = [db executeQuery:@"PRAGMA data_version;"];
+    if ([resultSet next]) dataVersion = [resultSet longLongIntForColumnIndex:0];
+    [resultSet close];
+    if (dataVersion < 0) return NO;
+    
+    BOOL changed = connection->_dataVersion >= 0 && connection->_dataVersion != dataVersion;
+    connection->_dataVersion = dataVersion;
+    return changed;
+}
+
+#pragma mark - description
+-(NSString*)description{
+    return [NSString stringWithFormat:@"<%@: %p, connections: %lu, ignoring: %@>", NSStringFromClass([self class]), self, (unsigned long)[_connections count], [_ignoredTableNames allObjects]];
+}
+
+@end
+
+
+#pragma mark - observers
+@implementation RHSQLiteChangeObserver
+
+-(id)initWithTableName:(NSString*)tableName queue:(NSOperationQueue*)queue block:(void (^)(RHSQLiteChangeSet *changes))block{
+    self = [super init];
+    if (self){
+        _tableName = [tableName copy];
+        _queue = queue;
+        _tableBlock = [block copy];
+    }
+    return self;
+}
+
+-(id)initWithQuery:(RHSQLiteObjectQuery*)query objectIDs:(NSArray*)objectIDs queue:(NSOperationQueue*)queue block:(void (^)(RHSQLiteChangeSet *changes, NSArray *objectIDs))block{
+    self = [super init];
+    if (self){
+        _tableName = [[query.objectClass tableName] copy];
+        _query = query;
+        _lastObjectIDs = objectIDs ? [objectIDs copy] : [NSArray array];
+        _queue = queue;
+        _queryBlock = [block copy];
+    }
+    return self;
+}
+
+-(void)dataStore:(RHSQLiteDataStore*)dataStore didCommitChanges:(RHSQLiteChangeSet*)changeSet{
+    if (_tableName && ![changeSet containsChangesToTable:_tableName]) return;
+    
+    void (^notify)(void) = nil;
+    if (_tableBlock){
+        void (^block)(RHSQLiteChangeSet *changes) = _tableBlock;
+        notify = ^{
+            block(changeSet);
+        };
+    } else {
+        //re-run the query on the observers queue, rather than holding up the thread that committed
+        notify = ^{
+            NSArray *objectIDs = [dataStore objectIDsMatchingQuery:_query];
+            BOOL changed = NO;
+            @synchronized(self){
+                changed = [changeSet isExternal] || ![objectIDs isEqualToArray:_lastObjectIDs];
+                if (!changed){
+                    //same rows, but have any of them been modified?
+                    NSSet *matching = [NSSet setWithArray:objectIDs];
+                    for (NSNumber *objectID in [changeSet updatedObjectIDsInTable:_tableName]) {
+                        if ([matching containsObject:objectID]){
+                            changed = YES;
+                            break;
+                        }
+                    }
+                }
+                _lastObjectIDs = objectIDs;
+            }
+            if (changed) _queryBlock(changeSet, objectIDs);
+        };
+    }
+    
+    if (_queue) [_queue addOperationWithBlock:notify];
+    else notify();
+}
+
+#pragma mark - description
+-(NSString*)description{
+    return [NSString stringWithFormat:@"<%@: %p, table: %@, query: %@, queue: %@>", NSStringFromClass([self class]), self, _tableName ? _tableName : @"(all)", _query, _queue];
+}
+
+@end
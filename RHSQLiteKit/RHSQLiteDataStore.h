@@ -37,11 +37,42 @@
 #import <Foundation/Foundation.h>
 
 #import "RHSQLiteObject.h"
+#import "RHSQLiteDataStoreOptions.h"
+#import "RHSQLiteDataStoreMetrics.h"
+#import "RHSQLiteChangeSet.h"
 #import "FMDatabase.h"
 
 @class RHSQLiteObjectQuery;
+@class RHSQLiteSlowQueryLog;
+@class RHSQLiteChangeTracker;
+@class RHSQLiteWriteBehindQueue;
+@class RHSQLiteReaderPool;
+@class RHSQLiteMaintenanceScheduler;
+@class RHSQLiteDataStore;
 @class FMDatabaseQueue;
 
+//migration blocks are run inside the migrations transaction, use only the passed in db. return NO to roll back the migration.
+typedef BOOL (^RHSQLiteDataStoreMigrationBlock)(RHSQLiteDataStore *dataStore, FMDatabase *db);
+
+//posted on the thread that committed, after the changes have been applied to any live objects. object is the data store.
+extern NSString * const RHSQLiteDataStoreDidChangeNotification;
+extern NSString * const RHSQLiteDataStoreChangeSetKey; //userInfo key, the RHSQLiteChangeSet
+
+//userInfo key of the NSErrors returned by saveAllChangesWithErrors:, the RHSQLiteObject that failed to save
+extern NSString * const RHSQLiteDataStoreFailedObjectKey;
+
+//userInfo key of the NSError returned by flushPendingWritesWithError: once write behind has dropped rows, NSDictionary of table name -> NSArray of NSNumber rowids
+extern NSString * const RHSQLiteDataStoreDroppedRowsKey;
+
+typedef enum {
+    RHSQLiteCheckpointModeNone = 0, //leaves checkpointing to sqlite's own wal_autocheckpoint
+    RHSQLiteCheckpointModePassive,  //checkpoints as much of the WAL as it can without waiting for readers or writers
+    RHSQLiteCheckpointModeTruncate, //waits (up to the busyTimeout) for readers to finish, checkpoints everything and truncates the WAL to zero bytes
+} RHSQLiteCheckpointMode;
+
+//called after each step of a migration. progress is the fraction (0.0 - 1.0) of the current migration that has been completed.
+typedef void (^RHSQLiteDataStoreMigrationProgressHandler)(NSUInteger schemaVersion, NSString *stepDescription, NSTimeInterval stepDuration, double progress);
+
 /*!
  @class RHSQLiteDataStore
  @abstract RHSQLiteDataStore wraps an instance of an SQLite.db file and provides an object based wrapper around the db's tables.
@@ -50,18 +81,67 @@
  */
 @interface RHSQLiteDataStore : NSObject {
     NSString *_path;
-    FMDatabaseQueue *_databaseQueue;
+    RHSQLiteDataStoreOptions *_options;
+    FMDatabaseQueue *_databaseQueue; //nil for read only data stores
+    
+    //read only data stores lend each access a connection from a bounded pool. while a thread has one checked out, it is
+    //stored in the threads dictionary under _readerThreadKey, so nested access reuses it rather than checking out another
+    NSString *_readerThreadKey;
+    RHSQLiteReaderPool *_readerPool;
     
     BOOL _loaded;
     
-    NSMutableArray *_knownTableNames;
+    NSArray *_knownTableNames; //immutable, replaced whole under @synchronized(_associatedClassNamesByTableName)
     NSMutableDictionary *_associatedClassNamesByTableName;
     
-    NSMutableArray *_registeredMigrationPaths;
+    NSMutableArray *_registeredMigrations; //NSString paths and RHSQLiteDataStoreMigrationBlock blocks, in order.
+    RHSQLiteDataStoreMigrationProgressHandler _migrationProgressHandler;
+    NSUInteger _migratingToSchemaVersion; //0 when no migration is in progress
+    
+    //sharding
+    NSMutableDictionary *_shards; //shard name -> RHSQLiteShard
+    NSMutableDictionary *_shardNamesByTableName; //assigned before load, plus any tables found in a shards file
+    BOOL _shardsAttached; //set once loading has attached every shard to our main connection
 
     //cache
     NSMutableDictionary *_perTableWeakObjectCaches; //each table has an entry in the top level dictionary. Caution: Each sub dictionary's values are RHWeakValue objects, weakly wrapping underlying RHSQLiteObject subclasses
     NSMutableDictionary *_cachedTableColumnNames; //for speed
+    NSMutableDictionary *_cachedRowLayouts; //RHSQLiteRowLayout per table, shared by every object loaded from that table. invalidated with the column names
+    NSMutableDictionary *_cachedMetadataValues; //populated on load, kept in sync by _metadataSetValue:
+    int64_t _schemaCookie; //PRAGMA schema_version as of the last schema read
+
+    NSDictionary *_loadPhaseDurations;
+
+    //instrumentation
+    RHSQLiteDataStoreMetrics *_metrics; //nil unless metrics are enabled, so the disabled cost is a single nil check
+    __weak id <RHSQLiteDataStoreMetricsSink> _metricsSink;
+    RHSQLiteSlowQueryLog *_slowQueryLog; //created the first time slowQueryThreshold is set and then kept, as our connections point at it
+    
+    //change tracking
+    RHSQLiteChangeTracker *_changeTracker; //nil unless change tracking is enabled
+    NSMutableArray *_changeObservers;
+    NSTimeInterval _externalChangeCheckInterval;
+    dispatch_source_t _externalChangeTimer;
+    
+    //unit of work
+    NSMutableArray *_dirtyObjects; //RHWeakValue wrapped objects that have had unsaved changes since the last saveAllChanges, in the order they were first changed
+    NSUInteger _dirtyObjectsPruneCount; //dead entries are pruned once the list reaches this size
+    NSString *_unitOfWorkThreadKey; //thread dictionary key for the current threads performUnitOfWork: nesting depth
+    
+    //write behind
+    RHSQLiteWriteBehindQueue *_writeBehindQueue; //nil unless write behind is enabled
+    NSTimeInterval _writeBehindInterval;
+    NSUInteger _writeBehindBatchSize;
+    NSUInteger _writeBehindCapacity;
+    __unsafe_unretained NSThread *_writableConnectionThread; //the thread running a block on our main writable connection, if any. saves made from inside one can't wait on the writer
+    
+    //parallel scans
+    RHSQLiteReaderPool *_scanReaderPool; //created by the first scan, read only connections that live as long as we do
+    NSUInteger _maximumScanConcurrency;
+    int64_t _minimumScanPartitionSize;
+    
+    //maintenance
+    RHSQLiteMaintenanceScheduler *_maintenanceScheduler; //nil for read only data stores
 
 }
 
@@ -75,21 +155,56 @@
  */
 -(id)initWithPath:(NSString*)path;
 
+/*!
+ @method initWithPath:options:
+ @abstract Init with a specified path and connection tuning options.
+ @discussion The options are applied to every connection the data store opens. See RHSQLiteDataStoreOptions for the available presets.
+ @param path The fully qualified path to the SQLite file that you wish to open.
+ @param options The options to apply, or nil for sqlite's defaults.
+ @returns The newly in initialised instance, or nil on error.
+ */
+-(id)initWithPath:(NSString*)path options:(RHSQLiteDataStoreOptions*)options;
+
 /*!
  @property path
  @abstract The path that this data store was initialised with.
  */
 @property (nonatomic, copy, readonly) NSString *path;
 
+/*!
+ @property options
+ @abstract The connection tuning options that this data store was initialised with.
+ */
+@property (nonatomic, copy, readonly) RHSQLiteDataStoreOptions *options;
+
+/*!
+ @property readOnly
+ @abstract YES if the data store was opened with immutable options.
+ @discussion Read only data stores skip migrations and metadata writes, and raise if any of the creation, insertion, deletion or transaction methods are called.
+    Objects vended from them raise if modified.
+ */
+@property (nonatomic, readonly, getter=isReadOnly) BOOL readOnly;
+
 /*!
  @method loadAndPerformAnyRequiredMigrations
  @abstract Load the data store, performing any required migrations.
  @discussion All object classes should be associated, and all migrations should be registered before calling this method.
     Calling this method is required before accessing any objects from the data store.
- @returns NO if a migration fails etc.
+    When migrations are registered, or the metadata table already exists, the table and column names found are cached in the metadata table 
+    alongside sqlite's schema cookie (PRAGMA schema_version), so later loads of an unchanged schema skip re-introspecting the file.
+    Otherwise the file is left untouched.
+    Associated classes that return a +schemaHash (ie. those generated by rhsqlitegen) are checked against their tables once migrations have run.
+ @returns NO if a migration fails, or a generated class no longer matches its table etc.
  */
 -(BOOL)loadAndPerformAnyRequiredMigrations;
 
+/*!
+ @property loadPhaseDurations
+ @abstract How long each phase of the last call to loadAndPerformAnyRequiredMigrations took.
+ @discussion Dictionary of phase names (snapshot, migrations, introspection, total) to NSNumber durations in seconds.
+ */
+@property (nonatomic, readonly) NSDictionary *loadPhaseDurations;
+
 
 #pragma mark - access the underlying database
 -(void)accessDatabase:(void (^)(FMDatabase *db))block;
@@ -131,6 +246,10 @@
 -(NSArray*)objectIDsMatchingQuery:(RHSQLiteObjectQuery*)query; //array of NSNumbers
 -(NSArray*)objectIDsFromTable:(NSString*)tableName where:(NSString*)where orderedBy:(NSString*)columnName ascending:(BOOL)ascending;
 
+//where clauses with ? placeholders, bound from arguments rather than formatted into the sql. ordered by primary key
+-(NSArray*)objectsFromTable:(NSString*)tableName where:(NSString*)where arguments:(NSArray*)arguments;
+-(NSArray*)objectIDsFromTable:(NSString*)tableName where:(NSString*)where arguments:(NSArray*)arguments;
+
 
 //textual search
 -(NSArray*)objectsFromTable:(NSString*)tableName containingString:(NSString*)string inColumn:(NSString*)columnName;
@@ -150,22 +269,367 @@
 -(NSArray*)deleteObjects:(NSArray*)objects; //array of NSNumber / BOOLs
 
 
+#pragma mark - unit of work
+
+/*!
+ @method objectsWithUnsavedChanges
+ @abstract Every live object from this data store that has unsaved changes, or has not yet been created, in the order they were first changed.
+ @discussion Objects are tracked weakly, unsaved changes to objects that are released are discarded, just as they always have been.
+ */
+-(NSArray*)objectsWithUnsavedChanges;
+-(BOOL)hasUnsavedChanges;
+
+/*!
+ @method saveAllChangesWithErrors:
+ @abstract Writes every object with unsaved changes in a single transaction.
+ @discussion New objects are inserted first, then updates are run grouped by table and column set, reusing one prepared statement per group.
+    Saved objects are not re-read, except for new objects which load their default values on next access.
+    If any object fails, the transaction is rolled back and every object keeps its unsaved changes.
+    The same happens if sqlite fails to begin or commit the transaction (ie SQLITE_BUSY or SQLITE_FULL), errorsOut then holds that single error, without a RHSQLiteDataStoreFailedObjectKey.
+    Touches every tracked object, so don't modify objects on other threads while it runs.
+ @param errorsOut If not NULL, set to an array with one NSError per object that failed, the object is under RHSQLiteDataStoreFailedObjectKey in its userInfo.
+ @returns YES if everything was saved.
+ */
+-(BOOL)saveAllChangesWithErrors:(NSArray**)errorsOut;
+-(BOOL)saveAllChanges;
+
+/*!
+ @method performUnitOfWork:errors:
+ @abstract Runs block, then saves all changes in a single transaction as if by saveAllChangesWithErrors:.
+ @discussion While the block runs, -[RHSQLiteObject save] on this thread only marks the object, so existing code that saves as it goes is batched too.
+    create and insertObject: still write immediately, as callers expect an objectID back. Nested units are saved when the outermost one ends.
+    A new object stored in another objects column is only encoded by reference, so must already be created (ie with insertObject:) before it is set inside a unit of work. That create is not undone if the unit later fails.
+ @param block Return NO to skip the save, leaving the changes unsaved. (use -[RHSQLiteObject revert] to discard them)
+ @returns YES if the block returned YES and everything was saved.
+ */
+-(BOOL)performUnitOfWork:(BOOL (^)(void))block errors:(NSArray**)errorsOut;
+
+
 //object class to table association. (tell the data store about your custom RHSQLiteObject subclasses here and have them automatically vended from all appropriate methods.)
-@property (nonatomic, readonly) NSArray *objectClassNames; //array of NSStrings
+@property (nonatomic, readonly) NSArray *objectClassNames; //array of NSStrings. (includes the names automatically generated classes will have, before they are first used)
 -(void)associateObjectClass:(Class)objectClass; //we use the classes +tableName method internally to work out the table that the class should represent
--(Class)objectClassForTable:(NSString*)tableName; //defaults to an automatically generated RHSQLiteObject subclass unless a specific class has been associated using the above method.
+-(Class)objectClassForTable:(NSString*)tableName; //defaults to an automatically generated RHSQLiteObject subclass unless a specific class has been associated using the above method. (generated on first use)
 
 
 //migrations (you can register multiple migration files with the data store, in order. ie oldest to newest and the data store will take care of executing the migration scripts, as required, in order)
+//each migration, along with its schema_version bump, is performed inside a single transaction. if any statement fails, the whole migration is rolled back.
+//so scripts must not contain BEGIN, COMMIT/END, ROLLBACK (other than ROLLBACK TO a savepoint), VACUUM or PRAGMA foreign_keys, the migration fails with an error if they do. (SAVEPOINT and RELEASE are fine)
 -(void)registerMigrationsFile:(NSString*)migrationPath;
--(BOOL)migrationsEnabled; //true if any migrations have been registered
--(BOOL)requiresMigration;
+-(void)registerMigrationBlock:(RHSQLiteDataStoreMigrationBlock)migrationBlock; //for migrations that can't be expressed as a plain script. (see rebuildTable: below)
+-(BOOL)migrationsEnabled; //true if any migrations have been registered, for our file or any shard
+-(BOOL)requiresMigration; //including any shards
+
+/*!
+ @property migrationProgressHandler
+ @abstract Optional block, called after each statement (or batch) of a migration with its duration and the migrations overall progress.
+ @discussion Called on the database queue, so must not access the data store. Should be set before calling loadAndPerformAnyRequiredMigrations.
+ */
+@property (nonatomic, copy) RHSQLiteDataStoreMigrationProgressHandler migrationProgressHandler;
+
+/*!
+ @method rebuildTable:withColumnDefinitions:columnMapping:batchSize:inDatabase:
+ @abstract Rebuilds a table with a new definition, for changes that ALTER TABLE can not perform in place. (ie dropping or retyping a column)
+ @discussion Intended for use from inside a RHSQLiteDataStoreMigrationBlock. Creates the new table, copies rows across in _ROWID_ ordered batches, 
+    drops the old table, renames the new table into place and then recreates the old tables indexes and triggers.
+    Tables declared WITHOUT ROWID are not supported.
+ @param tableName The name of an existing table.
+ @param columnDefinitions The column and constraint definitions for the new table. ie @"id INTEGER PRIMARY KEY, name TEXT NOT NULL"
+ @param columnMapping Dictionary of new column names to SQL expressions evaluated against the old table. If nil, columns that exist in both tables are copied as is.
+ @param batchSize Number of rows copied per INSERT, progress is reported after each batch. 0 uses a sensible default.
+ @param db The db passed into the migration block.
+ @returns NO if any step of the rebuild fails.
+ */
+-(BOOL)rebuildTable:(NSString*)tableName withColumnDefinitions:(NSString*)columnDefinitions columnMapping:(NSDictionary*)columnMapping batchSize:(NSUInteger)batchSize inDatabase:(FMDatabase*)db;
 
 //generic db type info
 -(NSArray*)tableNames;
 -(NSArray*)columnNamesForTable:(NSString*)tableName;
 -(NSString*)columnTypeForTable:(NSString*)tableName andColumn:(NSString*)columnName; // these return INTEGER, TEXT, REAL, or BLOB or nil for unknown table/column pair
 -(NSString*)requiredColumnTypeForObject:(id)object;
+-(NSString*)schemaHashForTable:(NSString*)tableName; //16 hex digits, derived from each columns name, declared type, not null and primary key flags, in order. nil for unknown tables
+
+
+#pragma mark - sharding
+
+/*!
+ @method assignTable:toShard:
+ @abstract Moves a table into its own database file, with its own connection, write lock and WAL, so that writes to it don't wait on writes to any other file.
+ @discussion Must be called before the data store is loaded. Shard files live next to path, ie data.sqlite -> data-log.sqlite, see pathForShard:.
+    Object loads and saves for the table go through the shards own connection. Every shard is also ATTACHed to the main connection, 
+    so queries, raw SQL from accessDatabase: and joins across files keep working with unqualified table names. (unless the same name exists in more than one file)
+    Sharded tables should be created by the shards own migrations, see registerMigrationsFile:forShard:. Any table found in a shards file is routed to it, assigned or not.
+    Transactions spanning files, ie saveAllChanges and accessDatabaseWithTransaction:, run on the main connection and are only atomic per file in WAL mode. 
+    Write behind batches are also committed through the main connection. sqlite attaches at most 10 files by default.
+ @param tableName The table to move.
+ @param shardName Letters, digits and underscores only. Shards are created on first use.
+ */
+-(void)assignTable:(NSString*)tableName toShard:(NSString*)shardName;
+-(void)assignObjectClass:(Class)objectClass toShard:(NSString*)shardName; //associates the class, then assigns its +tableName
+
+/*!
+ @method registerMigrationsFile:forShard:
+ @abstract Registers a migration for a single shard. Each shard is versioned independently, in the metadata table of its own file.
+ @discussion Shard migrations run in order on the shards own connection, before the main files migrations. Blocks are passed the shards connection as db.
+ */
+-(void)registerMigrationsFile:(NSString*)migrationPath forShard:(NSString*)shardName;
+-(void)registerMigrationBlock:(RHSQLiteDataStoreMigrationBlock)migrationBlock forShard:(NSString*)shardName;
+
+-(NSArray*)shardNames;
+-(NSString*)shardForTable:(NSString*)tableName; //nil for tables in the main file
+-(NSString*)pathForShard:(NSString*)shardName;
+-(NSUInteger)schemaVersionForShard:(NSString*)shardName;
+
+
+#pragma mark - metrics
+
+/*!
+ @property metricsEnabled
+ @abstract Enables the collection of per statement kind counters and latency histograms, queue wait times, identity cache hits, codec byte counts and rows hydrated.
+ @discussion Off by default. Disabling discards everything collected so far. Should be set before the data store is shared between threads.
+ */
+@property (nonatomic, assign, getter=isMetricsEnabled) BOOL metricsEnabled;
+
+/*!
+ @property metricsSink
+ @abstract Optional sink, told about each timed statement as it completes and handed snapshots by exportMetrics. Not retained.
+ */
+@property (nonatomic, weak) id <RHSQLiteDataStoreMetricsSink> metricsSink;
+
+/*!
+ @method metricsSnapshot
+ @abstract Everything recorded since metrics were enabled or last reset, see -[RHSQLiteDataStoreMetrics snapshot] for the keys.
+ @discussion The identity_cache entry also includes the current number of cached objects as size. 
+ @returns The snapshot, or nil if metrics are not enabled.
+ */
+-(NSDictionary*)metricsSnapshot;
+-(void)resetMetrics;
+-(void)exportMetrics; //hands the current snapshot to the metricsSink
+
+
+#pragma mark - slow query log
+
+/*!
+ @property slowQueryThreshold
+ @abstract Statements that take at least this long (in seconds) have their EXPLAIN QUERY PLAN captured and are aggregated by query shape.
+ @discussion 0, the default, disables the log. Every statement on every connection is timed by sqlite while enabled.
+    Full table scans of large tables and temporary b-trees used for sorting are flagged, and candidate indexes are suggested from the WHERE and ORDER BY columns.
+    The first slow instance of each shape is also logged with RHErrorLog. Should be set before the data store is shared between threads.
+ */
+@property (nonatomic, assign) NSTimeInterval slowQueryThreshold;
+
+/*!
+ @method slowQueryReport
+ @abstract One dictionary per slow query shape, slowest total time first.
+ @discussion Keys: shape, sql, count, total, max, plan, full_scans, temp_btree and suggested_indexes. See RHSQLiteSlowQueryLog.h for details.
+ */
+-(NSArray*)slowQueryReport;
+-(void)resetSlowQueryLog;
+
+
+#pragma mark - change tracking
+
+/*!
+ @property changeTrackingEnabled
+ @abstract Records every row inserted, updated or deleted through this data store, including raw SQL run from accessDatabase: blocks.
+ @discussion Off by default, turned on by adding an observer. Changes are coalesced per row, per transaction, and handled once the database block that committed them returns:
+    live objects for updated rows reload on their next access (keeping any unsaved changes), objects for deleted rows are marked as deleted,
+    then observers are called and RHSQLiteDataStoreDidChangeNotification is posted. 
+    Writes from other connections or processes are only picked up by checkForExternalChanges. Has no effect on read only data stores, whose file can't change.
+    While enabled, DELETE FROM without a WHERE clause removes rows one at a time (bypassing sqlite's truncate optimisation) so that every deleted row is reported.
+    Should be set before the data store is shared between threads. See RHSQLiteChangeTracker.h for the cases sqlite does not report.
+ */
+@property (nonatomic, assign, getter=isChangeTrackingEnabled) BOOL changeTrackingEnabled;
+
+/*!
+ @method addObserverForTable:queue:usingBlock:
+ @abstract Calls block with each change set that touches tableName, or every change set if tableName is nil.
+ @param queue The queue to call block on. If nil, block is called synchronously on the thread that committed the changes (outside of the database queue).
+ @returns An opaque observer, pass it to removeChangeObserver: when you are done. The data store retains it until then.
+ */
+-(id)addObserverForTable:(NSString*)tableName queue:(NSOperationQueue*)queue usingBlock:(void (^)(RHSQLiteChangeSet *changes))block;
+
+/*!
+ @method addObserverForQuery:queue:usingBlock:
+ @abstract Calls block with the querys current objectIDs whenever they change, or one of the matching rows is updated.
+ @discussion The query is run when the observer is added, and re-run on queue after each change to its table. The data store must be loaded.
+ @returns An opaque observer, pass it to removeChangeObserver: when you are done.
+ */
+-(id)addObserverForQuery:(RHSQLiteObjectQuery*)query queue:(NSOperationQueue*)queue usingBlock:(void (^)(RHSQLiteChangeSet *changes, NSArray *objectIDs))block;
+-(void)removeChangeObserver:(id)observer;
+
+/*!
+ @method checkForExternalChanges
+ @abstract Checks whether another connection or process has written to the file since the last check, using sqlite's PRAGMA data_version counter.
+ @discussion A single, cheap pragma. If there were writes, every live object reloads on next access and observers are handed an external change set, 
+    as sqlite can't tell us which rows changed. Cached column names are also dropped if the schema changed.
+ @returns YES if there were external changes. Always NO unless change tracking is enabled.
+ */
+-(BOOL)checkForExternalChanges;
+
+/*!
+ @property externalChangeCheckInterval
+ @abstract Calls checkForExternalChanges on a background queue every interval seconds. Setting a non zero interval enables change tracking.
+ @discussion 0, the default, disables the timer. A replacement for app level polling loops that reload everything.
+ */
+@property (nonatomic, assign) NSTimeInterval externalChangeCheckInterval;
+
+
+#pragma mark - write behind
+
+/*!
+ @property writeBehindInterval
+ @abstract Enables write behind. -[RHSQLiteObject save] queues the objects changes and returns, and a background writer commits everything queued every interval seconds.
+ @discussion 0, the default, disables write behind, committing anything still queued. Repeated saves of the same column are coalesced, only the latest value is written.
+    Only updates are queued, new objects are still created immediately, as callers expect an objectID back.
+    Objects that reload see their queued values, but queries, raw SQL and other connections don't until they have been committed. Use flushPendingWrites first if that matters.
+    saveAllChanges flushes before it writes, and anything still queued when the data store is deallocated is flushed then. 
+    Queued changes are lost if the process dies before they are committed, that is the trade off. Should be set before the data store is shared between threads.
+ */
+@property (nonatomic, assign) NSTimeInterval writeBehindInterval;
+@property (nonatomic, readonly, getter=isWriteBehindEnabled) BOOL writeBehindEnabled;
+
+/*!
+ @property writeBehindBatchSize
+ @abstract The writer commits as soon as this many column values are queued, rather than waiting for the interval. Defaults to 1000.
+ */
+@property (nonatomic, assign) NSUInteger writeBehindBatchSize;
+
+/*!
+ @property writeBehindCapacity
+ @abstract The most column values that can be queued. Once full, save blocks until the writer has taken the queued batch. Defaults to 10000.
+ @discussion Bounds both the memory used and how much can be lost. If the writer keeps failing (ie a full disk), save gives up after 10 seconds, returning NO and the writers error with the changes still unsaved.
+    Saves made from inside a database block (ie accessDatabase:) can't wait on the writer, which needs that connection, so they are queued over capacity instead.
+ */
+@property (nonatomic, assign) NSUInteger writeBehindCapacity;
+
+-(NSUInteger)numberOfPendingWrites; //queued and in flight column values
+-(NSError*)lastWriteBehindError; //most recent failed commit or dropped row, if any
+
+/*!
+ @method flushPendingWritesWithError:
+ @abstract Durability barrier. Commits everything queued so far and returns once it is on disk.
+ @discussion Rows that fail with a constraint, type mismatch or readonly error are dropped and logged, as retrying can't help. Any other failure leaves the batch queued to be retried.
+    Rows dropped since the last flush are reported here, the error carries them under RHSQLiteDataStoreDroppedRowsKey.
+ @returns YES if everything queued before the call was committed and nothing has been dropped since the last flush. Always YES when write behind is disabled.
+ */
+-(BOOL)flushPendingWritesWithError:(NSError**)errorOut;
+-(BOOL)flushPendingWrites;
+
+/*!
+ @method waitForPendingWritesToCommit
+ @abstract Waits for the writer to commit everything queued before the call, on its usual schedule.
+ @returns NO if a commit failed or a row was dropped while waiting.
+ */
+-(BOOL)waitForPendingWritesToCommit;
+
+
+#pragma mark - parallel scans
+
+/*!
+ @method objectsMatchingQueryInParallel:
+ @abstract Like objectsMatchingQuery:, but splits the query into primary key ranges that are read concurrently, each on its own read only connection.
+ @discussion Intended for large read only scans, ie reporting over a whole table. Returns the same objects as objectsMatchingQuery:, and those that weren't already live come back loaded.
+    Only single table queries with an INTEGER primary key, no custom SQL, and either no ORDER BY or an ORDER BY of the primary key are split, as only their ranges can be joined back together without re-sorting.
+    Anything else, including a WHERE that can't be wrapped in parentheses (ie one carrying its own LIMIT or ORDER BY), or a table that spans fewer than twice minimumScanPartitionSize keys, falls back to objectsMatchingQuery:.
+    Only read only data stores are split. Each range reads its own snapshot on its own connection, so on a writable store, rows written during the scan could be seen by some ranges and not others.
+    Writable stores always fall back to objectsMatchingQuery:, which reads a single snapshot. Don't call from inside a database block.
+ @param query The query to run.
+ @returns An array of RHSQLiteObject subclasses, in the same order as objectsMatchingQuery:.
+ */
+-(NSArray*)objectsMatchingQueryInParallel:(RHSQLiteObjectQuery*)query;
+
+/*!
+ @method enumerateObjectsMatchingQuery:inParallelUsingBlock:
+ @abstract The building block of objectsMatchingQueryInParallel:, for aggregates that don't need every matching object in memory at once.
+ @discussion block is called concurrently, once per range, with that ranges objects in the queries order. Ranges are numbered in ascending primary key order, whatever the queries order, so per range results can be combined in order.
+    Queries that can't be split are passed to block whole, as range 0 of 1, on the calling thread.
+ @returns NO if a range failed to read, in which case block will have been called for some ranges but not others.
+ */
+-(BOOL)enumerateObjectsMatchingQuery:(RHSQLiteObjectQuery*)query inParallelUsingBlock:(void (^)(NSArray *objects, NSUInteger range, NSUInteger rangeCount))block;
+
+/*!
+ @property maximumScanConcurrency
+ @abstract The most ranges read at once, and so the most read only connections kept open for scans. Defaults to the number of active processors.
+ */
+@property (nonatomic, assign) NSUInteger maximumScanConcurrency;
+
+/*!
+ @property minimumScanPartitionSize
+ @abstract The fewest primary keys a range spans. Defaults to 50000.
+ @discussion Tables are split into at most 4 ranges per concurrent reader, so that a range that happens to match more rows doesn't hold up the rest. Below this size a range costs more to set up than it saves.
+ */
+@property (nonatomic, assign) int64_t minimumScanPartitionSize;
+
+
+#pragma mark - maintenance
+
+/*!
+ @property maintenanceInterval
+ @abstract Enables background maintenance. Every interval seconds the data store checks whether it has been used since the last check, and if it has been idle spends up to maintenanceTimeBudget on housekeeping.
+ @discussion Each run covers the main file and every shard, in order:
+    a WAL checkpoint, see maintenanceCheckpointMode.
+    PRAGMA optimize, every maintenanceOptimizeInterval. Files that have never been analyzed get a full ANALYZE first. Both are bounded by maintenanceAnalysisLimit.
+    PRAGMA incremental_vacuum, in steps of maintenanceVacuumPageBudget pages, until the free list is empty. Only files in auto_vacuum=INCREMENTAL mode are vacuumed, see -[RHSQLiteDataStoreOptions autoVacuum], the rest just report their free pages.
+    Maintenance shares our connections, so foreground work waits for at most one step. 0, the default, disables it. Has no effect on read only data stores.
+ */
+@property (nonatomic, assign) NSTimeInterval maintenanceInterval;
+
+/*!
+ @property maintenanceTimeBudget
+ @abstract How long a single run may spend before leaving the rest for the next idle window. Defaults to 0.1 seconds.
+ @discussion Checked before each files checkpoint, optimize and vacuum step, so a single one of them can overrun the budget. Size maintenanceVacuumPageBudget and maintenanceAnalysisLimit to suit.
+    Files that miss their optimize are optimized by the next run. performMaintenance always optimizes every file.
+ */
+@property (nonatomic, assign) NSTimeInterval maintenanceTimeBudget;
+
+/*!
+ @property maintenanceVacuumPageBudget
+ @abstract The most free pages reclaimed by each incremental_vacuum step. Defaults to 256.
+ */
+@property (nonatomic, assign) NSUInteger maintenanceVacuumPageBudget;
+
+/*!
+ @property maintenanceCheckpointMode
+ @abstract How each run checkpoints the WAL. Defaults to RHSQLiteCheckpointModePassive.
+ @discussion Use RHSQLiteCheckpointModeTruncate if steady reads keep the WAL from ever being reset, it waits for readers (up to the busyTimeout) so is best left to idle windows.
+ */
+@property (nonatomic, assign) RHSQLiteCheckpointMode maintenanceCheckpointMode;
+
+/*!
+ @property maintenanceOptimizeInterval
+ @abstract How often runs include PRAGMA optimize. Defaults to an hour.
+ */
+@property (nonatomic, assign) NSTimeInterval maintenanceOptimizeInterval;
+
+/*!
+ @property maintenanceAnalysisLimit
+ @abstract The PRAGMA analysis_limit used by optimize and ANALYZE, roughly the rows of each index sampled. Defaults to 1000, 0 analyzes everything.
+ @discussion Only applies while maintenance runs, the connections own analysis_limit is put back afterwards.
+ */
+@property (nonatomic, assign) NSUInteger maintenanceAnalysisLimit;
+
+/*!
+ @method performMaintenance
+ @abstract Runs maintenance now, busy or not, with optimize included. A replacement for taking the data store down to maintain it.
+ @discussion Still bounded by maintenanceTimeBudget, call repeatedly until no free_pages remain to fully vacuum. Don't call from inside a database block.
+ @returns The run, as in maintenanceReport's last_run.
+ */
+-(NSDictionary*)performMaintenance;
+
+/*!
+ @method maintenanceReport
+ @abstract What maintenance has done so far. nil for read only data stores.
+ @discussion Keys:
+    runs            - completed runs
+    skipped         - timer ticks skipped as the data store had been used since the last one
+    pages_vacuumed  - total over every run
+    last_optimize   - NSDate optimize last ran
+    last_run        - date, duration and files, a dictionary of file name (main, or the shards schema name ie shard_log) to:
+                        checkpoint  - mode, busy, wal_frames, checkpointed_frames (frames are -1 when the file isn't in WAL mode)
+                        optimize    - optimized, analyzed (whether a first full ANALYZE was needed), duration
+                        vacuum      - auto_vacuum, free_pages (still free afterwards), pages_vacuumed, steps
+ */
+-(NSDictionary*)maintenanceReport;
 
 
 @end
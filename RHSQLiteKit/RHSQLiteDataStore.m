@@ -31,9 +31,17 @@
 #import "RHSQLiteDataStore.h"
 #import "RHSQLiteDataStore_Private.h"
 #import "RHSQLiteObject.h"
+#import "RHSQLiteObject_Private.h"
+#import "RHSQLiteChangeTracker.h"
 #import "RHSQLiteDynamicObjectParent.h"
+#import "RHSQLiteMaintenanceScheduler.h"
 #import "RHSQLiteObjectPlaceholder.h"
 #import "RHSQLiteObjectQuery.h"
+#import "RHSQLiteReaderPool.h"
+#import "RHSQLiteRowLayout.h"
+#import "RHSQLiteShard.h"
+#import "RHSQLiteSlowQueryLog.h"
+#import "RHSQLiteWriteBehindQueue.h"
 #import "RHWeakValue.h"
 
 #import "FMDatabaseQueue.h"
@@ -44,22 +52,55 @@
 #import "NSString+RHNumberAdditions.h"
 
 #define RHSQLiteDataStoreMetadataTableName @"metadata"
+#define RHSQLiteDataStoreDefaultRebuildBatchSize 10000
+
+//metadata keys used to cache schema introspection between loads
+#define RHSQLiteDataStoreSchemaFingerprintKey @"schema_fingerprint"
+#define RHSQLiteDataStoreSchemaCacheKey @"schema_cache"
+
+NSString * const RHSQLiteDataStoreDidChangeNotification = @"RHSQLiteDataStoreDidChangeNotification";
+NSString * const RHSQLiteDataStoreChangeSetKey = @"RHSQLiteDataStoreChangeSetKey";
+NSString * const RHSQLiteDataStoreFailedObjectKey = @"RHSQLiteDataStoreFailedObjectKey";
+NSString * const RHSQLiteDataStoreDroppedRowsKey = @"RHSQLiteDataStoreDroppedRowsKey";
+
+#define RHSQLiteDataStoreMinimumDirtyObjectsPruneCount 1024
+
+#define RHSQLiteDataStoreDefaultWriteBehindBatchSize 1000
+#define RHSQLiteDataStoreDefaultWriteBehindCapacity 10000
+
+#define RHSQLiteDataStoreDefaultMinimumScanPartitionSize 50000
+#define RHSQLiteDataStoreScanRangesPerReader 4
+#define RHSQLiteDataStoreMinimumReaderCount ((NSUInteger)4) //read only data stores, see -_readerPool
+#define RHSQLiteDataStoreImmutableMinimumVersion 3008000 //sqlite 3.8.0 added the immutable=1 URI parameter
 
 #define REQUIRE_LOADED() do {if (!_loaded)[NSException raise:NSInvalidArgumentException format:@"Error: %@ can only be called after the data store is loaded.", NSStringFromSelector(_cmd)]; } while (0)
 #define REQUIRE_NOT_LOADED() do {if (_loaded)[NSException raise:NSInvalidArgumentException format:@"Error: %@ must be called before the data store is loaded.", NSStringFromSelector(_cmd)]; } while (0)
 
-#define ENSURE_KNOWN_TABLE(table) do {if (![_knownTableNames containsObject:table])[NSException raise:NSInvalidArgumentException format:@"Error: %@ is not a known table name.", table]; } while (0)
+#define REQUIRE_WRITABLE() do {if ([self isReadOnly])[NSException raise:NSInvalidArgumentException format:@"Error: %@ can not be called on a read only data store.", NSStringFromSelector(_cmd)]; } while (0)
+
+#define ENSURE_KNOWN_TABLE(table) do {if (![[self _knownTableNames] containsObject:table])[NSException raise:NSInvalidArgumentException format:@"Error: %@ is not a known table name.", table]; } while (0)
 #define ENSURE_NOT_INVALID_ID(objectID) do {if (objectID == RHSQLiteObjectIDInvalid)[NSException raise:NSInvalidArgumentException format:@"Error: Unable to load an object with an Invalid ID."]; } while (0)
 
 
 @interface RHSQLiteDataStore ()
 
 @property (nonatomic, copy) NSString *path;
+@property (nonatomic, copy) RHSQLiteDataStoreOptions *options;
 @property (nonatomic, retain) FMDatabaseQueue *databaseQueue;
 
 //private stuff
+-(FMDatabaseQueue*)_newDatabaseQueueWithPath:(NSString*)path NS_RETURNS_RETAINED; //opens a new connection to the file, with our options applied
+-(RHSQLiteReaderPool*)_newReaderPoolWithMaximumCount:(NSUInteger)maximumCount NS_RETURNS_RETAINED; //opens read only connections, instrumented by our current slow query log
+-(void)_detachSlowQueryLogFromDatabaseQueue:(FMDatabaseQueue*)databaseQueue; //before closing it
+-(BOOL)_loadSchemaSnapshot; //returns YES if the cached schema fingerprint was still valid
+-(void)_storeSchemaFingerprint;
+-(int64_t)_schemaCookieInDatabase:(FMDatabase*)db;
 -(void)_populateKnownTableNames;
--(void)_loadDefaultTableClassAssociations;
+-(void)_populateKnownTableNamesInDatabase:(FMDatabase*)db;
+-(NSArray*)_knownTableNames; //safe from any thread, the array is never mutated, only replaced
+-(void)_setKnownTableNames:(NSArray*)tableNames;
+-(NSDictionary*)_classNamesByTableName; //associated class names, plus the default names of every known table still without one
+-(void)_associateObjectClass:(Class)objectClass;
 +(NSString*)_defaultClassNameForTable:(NSString*)tableName;
 
 //migrations
@@ -67,127 +108,599 @@
 -(NSUInteger)_maxSchemaVersion;
 -(BOOL)_performRequiredMigrations;
 -(BOOL)_performMigrationToSchemaVersion:(NSUInteger)version;
+-(BOOL)_performMigration:(id)migration toSchemaVersion:(NSUInteger)version shard:(RHSQLiteShard*)shard; //nil for our main file
+-(BOOL)_executeMigrationScript:(NSData*)script forSchemaVersion:(NSUInteger)version inDatabase:(FMDatabase*)db;
+-(void)_reportMigrationStep:(NSString*)stepDescription duration:(NSTimeInterval)duration progress:(double)progress;
+
+//metrics
+-(void)_recordStatementOfKind:(RHSQLiteStatementKind)kind enqueued:(NSTimeInterval)enqueued started:(NSTimeInterval)started metrics:(RHSQLiteDataStoreMetrics*)metrics;
+
+//change tracking
+-(void)_deliverCommittedChangesExcludingObjects:(NSArray*)objects;
+-(void)_processChangeSet:(RHSQLiteChangeSet*)changeSet excludingObjects:(NSArray*)objects;
+-(void)_cancelExternalChangeTimer;
+-(void)_setChangeTrackingEnabled:(BOOL)changeTrackingEnabled; //call with _changeObservers locked
+
+//unit of work
+-(NSArray*)_takeDirtyObjects; //live objects only, each once. clears their tracking
+
+//parallel scans
+-(RHSQLiteReaderPool*)_scanReaderPool; //created on first use
+-(NSArray*)_scanRangesForQuery:(RHSQLiteObjectQuery*)query; //NSArrays of NSNumber first and last primary key, ascending. nil if the query can't or shouldn't be split
+-(NSString*)_scanSQLForQuery:(RHSQLiteObjectQuery*)query; //SELECT * of one range, bound to its first and last primary key
+-(BOOL)_scanQuery:(RHSQLiteObjectQuery*)query ranges:(NSArray*)ranges usingBlock:(void (^)(NSArray *objects, NSUInteger range, NSUInteger rangeCount))block;
+
+//maintenance
+-(void)_accessEveryFileForMaintenance:(void (^)(FMDatabase *db, NSString *fileName))block; //main file first, then each shard
+
+//sharding
+-(RHSQLiteShard*)_shardNamed:(NSString*)shardName; //created on first use
+-(BOOL)_openShard:(RHSQLiteShard*)shard; //writable data stores only
+-(BOOL)_loadShards; //opens, migrates and attaches every shard
+-(NSUInteger)_schemaVersionForShard:(RHSQLiteShard*)shard;
+-(NSArray*)_shardDatabaseQueues; //every open shards queue
 
 //cached
+-(NSArray*)_columnNamesForTable:(NSString*)tableName inDatabase:(FMDatabase*)db;
 -(void)_invalidateCachedColumnNamesForTable:(NSString*)tableName;
 
-//metadata
+//metadata (the inDatabase: variants are for use when already on the database queue, ie inside a migration transaction)
 -(BOOL)_metadataTableExists;
+-(BOOL)_metadataTableExistsInDatabase:(FMDatabase*)db;
 -(BOOL)_metadataCreateTable;
+-(BOOL)_metadataCreateTableInDatabase:(FMDatabase*)db;
 -(BOOL)_metadataColumnExists:(NSString*)columnName;
--(BOOL)_metadataCreateColumn:(NSString*)columnName forStorageOfValue:(id)value;
+-(BOOL)_metadataCreateColumn:(NSString*)columnName forStorageOfValue:(id)value inDatabase:(FMDatabase*)db;
+-(BOOL)_metadataSetValue:(id)object forKey:(NSString*)columnName inDatabase:(FMDatabase*)db;
 
 @end
 
 @implementation RHSQLiteDataStore
 @synthesize path=_path;
+@synthesize options=_options;
 @synthesize databaseQueue=_databaseQueue;
+@synthesize migrationProgressHandler=_migrationProgressHandler;
+@synthesize loadPhaseDurations=_loadPhaseDurations;
+@synthesize metricsSink=_metricsSink;
 
 
 #pragma mark - init
 -(id)initWithPath:(NSString*)path{
+    return [self initWithPath:path options:nil];
+}
+
+-(id)initWithPath:(NSString*)path options:(RHSQLiteDataStoreOptions*)options{
     self = [super init];
     if (self){
         _path = [path copy];
-        _databaseQueue = [[FMDatabaseQueue alloc] initWithPath:_path];
+        _options = options ? [options copy] : [RHSQLiteDataStoreOptions defaultOptions];
         
-        if (!_databaseQueue){
-            RHErrorLog(@"Error: Failed to open database with path %@.", _path);
-            self = nil;
-            return nil;
+        if ([self isReadOnly]){
+            //no shared queue, connections are lent out by our reader pool. open one now to make sure we can.
+            _readerThreadKey = [NSString stringWithFormat:@"RHSQLiteDataStoreReader-%@", [[NSProcessInfo processInfo] globallyUniqueString]];
+            RHSQLiteReaderPool *readerPool = [self _readerPool];
+            FMDatabase *db = [readerPool checkOutDatabase];
+            if (!db){
+                RHErrorLog(@"Error: Failed to open read only database with path %@.", _path);
+                self = nil;
+                return nil;
+            }
+            [readerPool checkInDatabase:db];
+        } else {
+            _databaseQueue = [self _newDatabaseQueueWithPath:_path];
+            
+            if (!_databaseQueue){
+                RHErrorLog(@"Error: Failed to open database with path %@.", _path);
+                self = nil;
+                return nil;
+            }
         }
         
         //setup our structures
-        _knownTableNames = [[NSMutableArray alloc] init];
+        _knownTableNames = [NSArray array];
         _associatedClassNamesByTableName = [[NSMutableDictionary alloc] init];
-        _registeredMigrationPaths = [[NSMutableArray alloc] init];
+        _registeredMigrations = [[NSMutableArray alloc] init];
+        _shards = [[NSMutableDictionary alloc] init];
+        _shardNamesByTableName = [[NSMutableDictionary alloc] init];
         _perTableWeakObjectCaches = [[NSMutableDictionary alloc] init];
         _cachedTableColumnNames = [[NSMutableDictionary alloc] init];
+        _cachedRowLayouts = [[NSMutableDictionary alloc] init];
+        _cachedMetadataValues = nil;
+        _changeObservers = [[NSMutableArray alloc] init];
+        _dirtyObjects = [[NSMutableArray alloc] init];
+        _dirtyObjectsPruneCount = RHSQLiteDataStoreMinimumDirtyObjectsPruneCount;
+        _unitOfWorkThreadKey = [NSString stringWithFormat:@"RHSQLiteDataStoreUnitOfWork-%@", [[NSProcessInfo processInfo] globallyUniqueString]];
         //some defaults
         _loaded = NO;
+        _writeBehindBatchSize = RHSQLiteDataStoreDefaultWriteBehindBatchSize;
+        _writeBehindCapacity = RHSQLiteDataStoreDefaultWriteBehindCapacity;
+        _maximumScanConcurrency = MAX([[NSProcessInfo processInfo] activeProcessorCount], (NSUInteger)1);
+        _minimumScanPartitionSize = RHSQLiteDataStoreDefaultMinimumScanPartitionSize;
+        
+        if (![self isReadOnly]){
+            //idle until maintenanceInterval is set. the scheduler must not keep us alive
+            __weak RHSQLiteDataStore *weakSelf = self;
+            _maintenanceScheduler = [[RHSQLiteMaintenanceScheduler alloc] initWithAccessor:^(void (^block)(FMDatabase *db, NSString *fileName)) {
+                [weakSelf _accessEveryFileForMaintenance:block];
+            }];
+        }
         
     }
     return self;
 }
 
+-(FMDatabaseQueue*)_newDatabaseQueueWithPath:(NSString*)path{
+    FMDatabaseQueue *queue = [[FMDatabaseQueue alloc] initWithPath:path];
+    if (!queue) return nil;
+    
+    //every connection we open gets the same tuning
+    RHSQLiteDataStoreOptions *options = _options;
+    [queue inDatabase:^(FMDatabase *db) {
+        if (![options applyToDatabase:db]){
+            RHErrorLog(@"Warning: Not all options could be applied to the database at path %@. Options: %@.", path, options);
+        }
+    }];
+    
+    return queue;
+}
+
+-(FMDatabase*)_newReaderDatabase{
+    //immutable=1 tells sqlite the file can't change, so it skips locking and change detection entirely. only true when we aren't writing to it ourselves
+    //older sqlite (ie the system one on iOS 5 / OS X 10.7) would quietly ignore it, so ask for a plain read only connection instead
+    BOOL immutable = [self isReadOnly] && sqlite3_libversion_number() >= RHSQLiteDataStoreImmutableMinimumVersion;
+    NSString *uri = [[[NSURL fileURLWithPath:_path] absoluteString] stringByAppendingString:immutable ? @"?immutable=1" : @"?mode=ro"];
+    FMDatabase *db = [[FMDatabase alloc] initWithPath:uri];
+    
+    //each reader is only ever used by one thread at a time, so sqlite's own mutexes aren't needed either
+    if (![db openWithFlags:SQLITE_OPEN_READONLY | SQLITE_OPEN_URI | SQLITE_OPEN_NOMUTEX]){
+        RHErrorLog(@"Error: Failed to open read only connection to %@. Error: %@.", uri, [db lastError]);
+        return nil;
+    }
+    
+    if (![_options applyToDatabase:db]){
+        RHErrorLog(@"Warning: Not all options could be applied to the database at path %@. Options: %@.", _path, _options);
+    }
+    
+    if (_shardsAttached){
+        for (RHSQLiteShard *shard in [_shards allValues]) {
+            [shard attachToDatabase:db immutable:immutable];
+        }
+    }
+    
+    return db;
+}
+
+-(RHSQLiteReaderPool*)_newReaderPoolWithMaximumCount:(NSUInteger)maximumCount{
+    //the pool lives as long as we do, so only weakly reference us. the slow query log is captured up front, 
+    //so every connection the pool opens is detached from the same log before it is closed. (enabling the log resets our pools)
+    __weak RHSQLiteDataStore *weakSelf = self;
+    RHSQLiteSlowQueryLog *slowQueryLog = _slowQueryLog;
+    RHSQLiteReaderPool *pool = [[RHSQLiteReaderPool alloc] initWithFactory:^FMDatabase *{
+        FMDatabase *db = [weakSelf _newReaderDatabase];
+        [slowQueryLog attachToDatabase:db];
+        return db;
+    } maximumCount:maximumCount];
+    if (slowQueryLog){
+        [pool setCloseHandler:^(FMDatabase *db) {
+            [slowQueryLog detachFromDatabase:db];
+        }];
+    }
+    return pool;
+}
+
+-(RHSQLiteReaderPool*)_readerPool{
+    @synchronized(self){
+        if (!_readerPool){
+            _readerPool = [self _newReaderPoolWithMaximumCount:MAX([[NSProcessInfo processInfo] activeProcessorCount], RHSQLiteDataStoreMinimumReaderCount)];
+        }
+        return _readerPool;
+    }
+}
+
+-(void)_resetReaderPools{
+    RHSQLiteReaderPool *readerPool = nil;
+    RHSQLiteReaderPool *scanReaderPool = nil;
+    @synchronized(self){
+        readerPool = _readerPool;
+        _readerPool = nil;
+        scanReaderPool = _scanReaderPool;
+        _scanReaderPool = nil;
+    }
+    [readerPool close];
+    [scanReaderPool close];
+}
+
+-(BOOL)isReadOnly{
+    return [_options isImmutable];
+}
+
 -(void)dealloc{
+    [self _cancelExternalChangeTimer];
+    [_maintenanceScheduler cancel];
+    _maintenanceScheduler = nil;
+    
+    //anything still queued is written through our queue directly, see setWriteBehindInterval:
+    [_writeBehindQueue flushWithError:NULL];
+    _writeBehindQueue = nil;
+    
+    [_scanReaderPool close];
+    _scanReaderPool = nil;
+    
+    [_readerPool close];
+    _readerPool = nil;
+    
     _path = nil;
+    [self _detachSlowQueryLogFromDatabaseQueue:_databaseQueue];
     [_databaseQueue close];
     _databaseQueue = nil;
+    
+    for (RHSQLiteShard *shard in [_shards allValues]) {
+        [self _detachSlowQueryLogFromDatabaseQueue:[shard databaseQueue]];
+        [[shard databaseQueue] close];
+        [shard setDatabaseQueue:nil];
+    }
 }
 
 
 #pragma mark - load the data store
 -(BOOL)loadAndPerformAnyRequiredMigrations{
-    //first, perform any required migrations
-    if (![self _performRequiredMigrations]){
+    NSTimeInterval loadStart = [NSDate timeIntervalSinceReferenceDate];
+    NSMutableDictionary *durations = [NSMutableDictionary dictionary];
+    
+    //shards first, our own migrations and introspection see their tables through ATTACH
+    NSTimeInterval phaseStart = [NSDate timeIntervalSinceReferenceDate];
+    if (![self _loadShards]){
+        RHErrorLog(@"Error: Failed to load shards.");
+        return NO;
+    }
+    if ([_shards count] > 0) [durations setObject:[NSNumber numberWithDouble:[NSDate timeIntervalSinceReferenceDate] - phaseStart] forKey:@"shards"];
+    
+    //read the schema cookie, metadata and table names in a single trip to the database
+    phaseStart = [NSDate timeIntervalSinceReferenceDate];
+    BOOL fingerprintValid = [self _loadSchemaSnapshot];
+    [durations setObject:[NSNumber numberWithDouble:[NSDate timeIntervalSinceReferenceDate] - phaseStart] forKey:@"snapshot"];
+    
+    //perform any required migrations
+    phaseStart = [NSDate timeIntervalSinceReferenceDate];
+    NSUInteger previousSchemaVersion = [self _currentSchemaVersion];
+    if ([self isReadOnly]){
+        if ([self requiresMigration]) RHErrorLog(@"Warning: Skipping required migrations for read only data store %@.", _path);
+    } else if (![self _performRequiredMigrations]){
         RHErrorLog(@"Error: Migration reported an error.");
         return NO;
     }
+    [durations setObject:[NSNumber numberWithDouble:[NSDate timeIntervalSinceReferenceDate] - phaseStart] forKey:@"migrations"];
     
-    //populate our known table names
-    [self _populateKnownTableNames];
+    //re-introspect only if the schema has changed since we last cached it
+    phaseStart = [NSDate timeIntervalSinceReferenceDate];
+    if ([self _currentSchemaVersion] != previousSchemaVersion){
+        fingerprintValid = NO;
+        [self _populateKnownTableNames];
+    }
+    if (!fingerprintValid && ![self isReadOnly]) [self _storeSchemaFingerprint];
+    [durations setObject:[NSNumber numberWithDouble:[NSDate timeIntervalSinceReferenceDate] - phaseStart] forKey:@"introspection"];
     
-    //now we dynamically generate classes for any tables that have no specifically associated SQLiteObject subclasses
-    [self _loadDefaultTableClassAssociations];
+    //classes for tables that have no specifically associated SQLiteObject subclass are generated lazily by objectClassForTable:
     
     //check for and log any associated table classes that dont have an actual table
+    NSArray *knownTableNames = [self _knownTableNames];
     for (NSString *tableName in _associatedClassNamesByTableName.allKeys) {
-        if (![_knownTableNames containsObject:tableName]){
+        if (![knownTableNames containsObject:tableName]){
             RHErrorLog(@"Warning: We were unable to find an actual sql table for the associated RHSQLiteObject subclass '%@'.", [_associatedClassNamesByTableName objectForKey:tableName]);
         }
     }
     
+    //generated subclasses bind their accessors to the columns they were generated from, refuse to load if those have since changed
+    for (NSString *tableName in _associatedClassNamesByTableName.allKeys) {
+        if (![knownTableNames containsObject:tableName]) continue;
+        Class objectClass = NSClassFromString([_associatedClassNamesByTableName objectForKey:tableName]);
+        NSString *expectedHash = [objectClass schemaHash];
+        if (!expectedHash) continue;
+        
+        NSString *schemaHash = [self schemaHashForTable:tableName];
+        if (![schemaHash isEqualToString:expectedHash]){
+            RHErrorLog(@"Error: The schema of table '%@' (%@) no longer matches the one %@ was generated from (%@). Regenerate it using rhsqlitegen.", tableName, schemaHash, NSStringFromClass(objectClass), expectedHash);
+            return NO;
+        }
+    }
+    
     //finally set our loaded flag
     _loaded = YES;
 
-    RHLog(@"%@", self);
+    [durations setObject:[NSNumber numberWithDouble:[NSDate timeIntervalSinceReferenceDate] - loadStart] forKey:@"total"];
+    _loadPhaseDurations = [durations copy];
+    RHLog(@"Loaded data store %@ (%lu tables) %@.", _path, (unsigned long)knownTableNames.count, _loadPhaseDurations);
+    
     //success
     return YES;
 }
 
+-(BOOL)_loadSchemaSnapshot{
+    __block BOOL fingerprintValid = NO;
+    
+    [self accessDatabase:^(FMDatabase *db) {
+        _schemaCookie = [self _schemaCookieInDatabase:db];
+        _cachedMetadataValues = [[NSMutableDictionary alloc] init];
+        
+        //metadata, along with its column names
+        if ([self _metadataTableExistsInDatabase:db]){
+            NSString *sql = [NSString stringWithFormat:@"SELECT * FROM `%@` WHERE `id` = 1;", RHSQLiteDataStoreMetadataTableName];
+            FMResultSet *resultSet = [db executeQuery:sql];
+            NSMutableArray *columnNames = [NSMutableArray array];
+            for (int i = 0; i < [resultSet columnCount]; i++) {
+                [columnNames addObject:[resultSet columnNameForIndex:i]];
+            }
+            if ([resultSet next]){
+                for (NSString *columnName in columnNames) {
+                    id value = [resultSet objectForColumnName:columnName];
+                    if (value && value != [NSNull null]) [_cachedMetadataValues setObject:value forKey:columnName];
+                }
+            }
+            [resultSet close];
+            [_cachedTableColumnNames setObject:[NSArray arrayWithArray:columnNames] forKey:RHSQLiteDataStoreMetadataTableName];
+        }
+        
+        //if the schema cookie matches the one we cached last time, trust the cached table and column names
+        NSNumber *fingerprint = [_cachedMetadataValues objectForKey:RHSQLiteDataStoreSchemaFingerprintKey];
+        NSString *cacheJSON = [_cachedMetadataValues objectForKey:RHSQLiteDataStoreSchemaCacheKey];
+        if (fingerprint && [fingerprint longLongValue] == _schemaCookie && [cacheJSON isKindOfClass:[NSString class]]){
+            NSDictionary *cache = [NSJSONSerialization JSONObjectWithData:[cacheJSON dataUsingEncoding:NSUTF8StringEncoding] options:0 error:nil];
+            NSArray *tableNames = [cache isKindOfClass:[NSDictionary class]] ? [cache objectForKey:@"tables"] : nil;
+            NSDictionary *columnNames = [cache isKindOfClass:[NSDictionary class]] ? [cache objectForKey:@"columns"] : nil;
+            if ([tableNames isKindOfClass:[NSArray class]] && [columnNames isKindOfClass:[NSDictionary class]]){
+                [self _setKnownTableNames:tableNames];
+                [_cachedTableColumnNames addEntriesFromDictionary:columnNames];
+                fingerprintValid = YES;
+            }
+        }
+        
+        if (!fingerprintValid) [self _populateKnownTableNamesInDatabase:db];
+    }];
+    
+    RHLog(@"Schema snapshot for %@: cookie %lld, fingerprint %@.", _path, _schemaCookie, fingerprintValid ? @"valid" : @"stale");
+    return fingerprintValid;
+}
+
+-(void)_storeSchemaFingerprint{
+    BOOL migrationsEnabled = [self migrationsEnabled];
+    [self accessDatabase:^(FMDatabase *db) {
+        //stores that have no use for our metadata table are left exactly as we found them
+        if (!migrationsEnabled && ![self _metadataTableExistsInDatabase:db]) return;
+        
+        //make sure our columns exist first, adding them changes the schema cookie
+        if (![self _metadataCreateTableInDatabase:db]) return;
+        if (![self _metadataCreateColumn:RHSQLiteDataStoreSchemaFingerprintKey forStorageOfValue:[NSNumber numberWithLongLong:0] inDatabase:db]) return;
+        if (![self _metadataCreateColumn:RHSQLiteDataStoreSchemaCacheKey forStorageOfValue:@"" inDatabase:db]) return;
+        
+        [self _populateKnownTableNamesInDatabase:db];
+        NSArray *knownTableNames = [self _knownTableNames];
+        NSMutableDictionary *columnNames = [NSMutableDictionary dictionary];
+        for (NSString *tableName in knownTableNames) {
+            [self _invalidateCachedColumnNamesForTable:tableName];
+            [columnNames setObject:[self _columnNamesForTable:tableName inDatabase:db] forKey:tableName];
+        }
+        
+        NSDictionary *cache = [NSDictionary dictionaryWithObjectsAndKeys:knownTableNames, @"tables", columnNames, @"columns", nil];
+        NSData *cacheData = [NSJSONSerialization dataWithJSONObject:cache options:0 error:nil];
+        if (!cacheData) return;
+        
+        _schemaCookie = [self _schemaCookieInDatabase:db];
+        [self _metadataSetValue:[NSNumber numberWithLongLong:_schemaCookie] forKey:RHSQLiteDataStoreSchemaFingerprintKey inDatabase:db];
+        [self _metadataSetValue:[[NSString alloc] initWithData:cacheData encoding:NSUTF8StringEncoding] forKey:RHSQLiteDataStoreSchemaCacheKey inDatabase:db];
+    }];
+}
+
+-(int64_t)_schemaCookieInDatabase:(FMDatabase*)db{
+    int64_t result = 0;
+    FMResultSet *resultSet = [db executeQuery:@"PRAGMA schema_version;"];
+    if ([resultSet next]){
+        result = [resultSet longLongIntForColumnIndex:0];
+    }
+    [resultSet close];
+    
+    //every cookie only ever goes up, so the sum changes whenever any of our files schemas do
+    if (_shardsAttached){
+        for (RHSQLiteShard *shard in [_shards allValues]) {
+            result += [shard schemaCookieInAttachedDatabase:db];
+        }
+    }
+    return result;
+}
+
 
 #pragma mark - access db
 -(void)accessDatabase:(void (^)(FMDatabase *db))block{
-    [_databaseQueue inDatabase:^(FMDatabase *db) {
-        block(db);
-        if ([db hadError]){
-            //log db errors
-            NSError *newError = [db lastError];
-            RHErrorLog(@"Error: %@", newError);
-        }
-    }];
+    [self _accessDatabaseForStatementKind:RHSQLiteStatementKindOther block:block];
 }
 
 -(void)accessDatabaseWithTransaction:(void (^)(FMDatabase *db, BOOL *rollback))block{
-    [_databaseQueue inTransaction:block];
+    REQUIRE_WRITABLE();
+    [self _accessDatabaseWithTransactionForStatementKind:RHSQLiteStatementKindOther deferred:NO block:block];
 }
 
 -(void)accessDatabaseWithDeferredTransaction:(void (^)(FMDatabase *db, BOOL *rollback))block{
-    [_databaseQueue inDeferredTransaction:block];
+    REQUIRE_WRITABLE();
+    [self _accessDatabaseWithTransactionForStatementKind:RHSQLiteStatementKindOther deferred:YES block:block];
+}
+
+-(void)_accessDatabaseForStatementKind:(RHSQLiteStatementKind)kind block:(void (^)(FMDatabase *db))block{
+    [self _accessDatabaseForStatementKind:kind object:nil block:block];
+}
+
+-(void)_accessDatabaseForStatementKind:(RHSQLiteStatementKind)kind object:(RHSQLiteObject*)object block:(void (^)(FMDatabase *db))block{
+    [self _accessDatabaseForStatementKind:kind queue:(object ? [self _databaseQueueForTable:[object tableName]] : nil) object:object block:block];
+}
+
+-(void)_accessDatabaseForStatementKind:(RHSQLiteStatementKind)kind queue:(FMDatabaseQueue*)databaseQueue object:(RHSQLiteObject*)object block:(void (^)(FMDatabase *db))block{
+    if (!databaseQueue) databaseQueue = _databaseQueue;
+    RHSQLiteDataStoreMetrics *metrics = _metrics;
+    NSTimeInterval enqueued = metrics ? [NSDate timeIntervalSinceReferenceDate] : 0.0;
+    __block NSTimeInterval started = enqueued;
+    
+    RHSQLiteSlowQueryLog *slowQueryLog = _slowQueryLog;
+    if ([self isReadOnly]){
+        //no queue hop, the connection is ours alone until we return it. nested access reuses the one we already have
+        NSMutableDictionary *threadDictionary = [[NSThread currentThread] threadDictionary];
+        FMDatabase *db = [threadDictionary objectForKey:_readerThreadKey];
+        RHSQLiteReaderPool *readerPool = db ? nil : [self _readerPool];
+        if (readerPool){
+            db = [readerPool checkOutDatabase];
+            if (!db){
+                RHErrorLog(@"Error: Unable to check out a read only connection to %@.", _path);
+                return;
+            }
+            [threadDictionary setObject:db forKey:_readerThreadKey];
+        }
+        if (metrics) started = [NSDate timeIntervalSinceReferenceDate]; //time spent waiting on the pool is our queue wait
+        
+        @try {
+            block(db);
+            if ([db hadError]){
+                RHErrorLog(@"Error: %@", [db lastError]);
+            }
+            [slowQueryLog explainPendingStatementsInDatabase:db];
+        }
+        @finally {
+            //return it to the pool it came from, even if that pool has since been reset
+            if (readerPool){
+                [threadDictionary removeObjectForKey:_readerThreadKey];
+                [readerPool checkInDatabase:db];
+            }
+        }
+    } else {
+        [_maintenanceScheduler noteActivity];
+        BOOL writableConnection = (databaseQueue == _databaseQueue);
+        [databaseQueue inDatabase:^(FMDatabase *db) {
+            if (metrics) started = [NSDate timeIntervalSinceReferenceDate];
+            if (writableConnection) _writableConnectionThread = [NSThread currentThread];
+            block(db);
+            if (writableConnection) _writableConnectionThread = nil;
+            if ([db hadError]){
+                //log db errors
+                NSError *newError = [db lastError];
+                RHErrorLog(@"Error: %@", newError);
+            }
+            [slowQueryLog explainPendingStatementsInDatabase:db];
+        }];
+    }
+    
+    if (metrics) [self _recordStatementOfKind:kind enqueued:enqueued started:started metrics:metrics];
+    if (_changeTracker) [self _deliverCommittedChangesExcludingObjects:object ? [NSArray arrayWithObject:object] : nil];
+}
+
+-(void)_accessDatabaseWithTransactionForStatementKind:(RHSQLiteStatementKind)kind deferred:(BOOL)deferred block:(void (^)(FMDatabase *db, BOOL *rollback))block{
+    [self _accessDatabaseWithTransactionForStatementKind:kind deferred:deferred queue:nil objects:nil error:NULL block:block];
+}
+
+-(BOOL)_accessDatabaseWithTransactionForStatementKind:(RHSQLiteStatementKind)kind deferred:(BOOL)deferred queue:(FMDatabaseQueue*)databaseQueue objects:(NSArray*)objects error:(NSError**)errorOut block:(void (^)(FMDatabase *db, BOOL *rollback))block{
+    if (!databaseQueue) databaseQueue = _databaseQueue;
+    [_maintenanceScheduler noteActivity];
+    RHSQLiteDataStoreMetrics *metrics = _metrics;
+    RHSQLiteSlowQueryLog *slowQueryLog = _slowQueryLog;
+    NSTimeInterval enqueued = metrics ? [NSDate timeIntervalSinceReferenceDate] : 0.0;
+    __block NSTimeInterval started = enqueued;
+    __block BOOL committed = NO;
+    __block NSError *transactionError = nil;
+    BOOL writableConnection = (databaseQueue == _databaseQueue);
+    
+    //we manage the transaction ourselves, FMDatabaseQueue ignores the results of both its BEGIN and COMMIT and we need to know
+    [databaseQueue inDatabase:^(FMDatabase *db) {
+        if (metrics) started = [NSDate timeIntervalSinceReferenceDate];
+        
+        //a failed BEGIN runs nothing, rather than running everything in autocommit
+        if (!(deferred ? [db beginDeferredTransaction] : [db beginTransaction])){
+            transactionError = [db lastError];
+            RHErrorLog(@"Error: Failed to begin a transaction. Error: %@.", transactionError);
+            return;
+        }
+        
+        BOOL rollback = NO;
+        if (writableConnection) _writableConnectionThread = [NSThread currentThread];
+        block(db, &rollback);
+        if (writableConnection) _writableConnectionThread = nil;
+        
+        if (!rollback){
+            committed = [db commit];
+            if (!committed){
+                transactionError = [db lastError];
+                RHErrorLog(@"Error: Failed to commit a transaction. Error: %@.", transactionError);
+            }
+        }
+        
+        //a failed COMMIT (ie SQLITE_BUSY) can leave the transaction open. others (ie SQLITE_FULL) have already rolled it back
+        if (!committed && !sqlite3_get_autocommit([db sqliteHandle])) [db rollback];
+        
+        [slowQueryLog explainPendingStatementsInDatabase:db];
+    }];
+    
+    if (metrics) [self _recordStatementOfKind:kind enqueued:enqueued started:started metrics:metrics];
+    if (_changeTracker) [self _deliverCommittedChangesExcludingObjects:objects];
+    
+    if (errorOut) *errorOut = transactionError;
+    return committed;
+}
+
+-(void)_recordStatementOfKind:(RHSQLiteStatementKind)kind enqueued:(NSTimeInterval)enqueued started:(NSTimeInterval)started metrics:(RHSQLiteDataStoreMetrics*)metrics{
+    NSTimeInterval finished = [NSDate timeIntervalSinceReferenceDate];
+    [metrics recordStatementOfKind:kind queueWait:started - enqueued duration:finished - started];
+    
+    id <RHSQLiteDataStoreMetricsSink> sink = _metricsSink;
+    if ([sink respondsToSelector:@selector(dataStore:didRecordStatementOfKind:queueWait:duration:)]){
+        [sink dataStore:self didRecordStatementOfKind:kind queueWait:started - enqueued duration:finished - started];
+    }
 }
 
 
 #pragma mark - generic lookup methods
 -(NSArray*)tableNames{
     REQUIRE_LOADED();
-    return [NSArray arrayWithArray:_knownTableNames];
+    return [self _knownTableNames];
 }
 
 -(void)_populateKnownTableNames{
-    [_knownTableNames removeAllObjects];
     [self accessDatabase:^(FMDatabase *db) {
-        NSString *sql = @"SELECT `name` FROM `sqlite_master` WHERE `type` = 'table' AND `name` NOT LIKE 'sqlite_%';";
-        FMResultSet *resultSet = [db executeQuery:sql];
-        while ([resultSet next]) {
-            NSString *name = [resultSet stringForColumn:@"name"];
-            //TODO: skip list
-            RHLog(@"Found table name: %@.", name);
-            [_knownTableNames addObject:name];
-        }
-        [resultSet close];
+        [self _populateKnownTableNamesInDatabase:db];
     }];
+}
+
+-(void)_populateKnownTableNamesInDatabase:(FMDatabase*)db{
+    NSMutableArray *tableNames = [NSMutableArray array];
+    NSString *sql = @"SELECT `name` FROM `sqlite_master` WHERE `type` = 'table' AND `name` NOT LIKE 'sqlite_%';";
+    FMResultSet *resultSet = [db executeQuery:sql];
+    while ([resultSet next]) {
+        NSString *name = [resultSet stringForColumn:@"name"];
+        //TODO: skip list
+        RHLog(@"Found table name: %@.", name);
+        [tableNames addObject:name];
+    }
+    [resultSet close];
+    
+    //and every shards tables, through their ATTACH
+    if (_shardsAttached){
+        for (RHSQLiteShard *shard in [_shards allValues]) {
+            for (NSString *name in [shard tableNamesInAttachedDatabase:db]) {
+                if ([tableNames containsObject:name]) continue;
+                RHLog(@"Found table name: %@ in shard %@.", name, [shard name]);
+                [tableNames addObject:name];
+            }
+        }
+    }
     
+    //swapped in whole, other threads may be reading the current one
+    [self _setKnownTableNames:tableNames];
+}
+
+-(NSArray*)_knownTableNames{
+    @synchronized(_associatedClassNamesByTableName){
+        return _knownTableNames;
+    }
+}
+
+-(void)_setKnownTableNames:(NSArray*)tableNames{
+    //the same lock objectClassForTable: already holds while it checks a table is known
+    @synchronized(_associatedClassNamesByTableName){
+        _knownTableNames = [tableNames copy];
+    }
 }
 
 -(int64_t)numberOfObjectsInTable:(NSString*)tableName{
@@ -242,7 +755,7 @@
     NSString *primaryKeyName = [query.objectClass primaryKeyName];
     REQUIRE_LOADED(); ENSURE_KNOWN_TABLE(tableName);
     NSMutableArray *objectIDs = [NSMutableArray array];
-    [self accessDatabase:^(FMDatabase *db) {
+    [self _accessDatabaseForStatementKind:RHSQLiteStatementKindQuery block:^(FMDatabase *db) {
         FMResultSet *resultSet = [db executeQuery:query.sql];
         while ([resultSet next]) {
             NSNumber *objectID = [NSNumber numberWithUnsignedLongLong:[resultSet unsignedLongLongIntForColumn:primaryKeyName]];
@@ -260,6 +773,29 @@
     return [self objectIDsMatchingQuery:query];
 }
 
+-(NSArray*)objectsFromTable:(NSString*)tableName where:(NSString*)where arguments:(NSArray*)arguments{
+    REQUIRE_LOADED(); ENSURE_KNOWN_TABLE(tableName);
+    return [self objectsFromTable:tableName withIDs:[self objectIDsFromTable:tableName where:where arguments:arguments]];
+}
+
+-(NSArray*)objectIDsFromTable:(NSString*)tableName where:(NSString*)where arguments:(NSArray*)arguments{
+    REQUIRE_LOADED(); ENSURE_KNOWN_TABLE(tableName);
+    NSString *primaryKeyName = [[self objectClassForTable:tableName] primaryKeyName];
+    NSString *sql = [NSString stringWithFormat:@"SELECT `%@` FROM `%@` WHERE %@ ORDER BY `%@` ASC;", primaryKeyName, tableName, where, primaryKeyName];
+    
+    NSMutableArray *objectIDs = [NSMutableArray array];
+    [self _accessDatabaseForStatementKind:RHSQLiteStatementKindQuery block:^(FMDatabase *db) {
+        FMResultSet *resultSet = [db executeQuery:sql withArgumentsInArray:arguments];
+        if (!resultSet) RHErrorLog(@"Error: Query on table %@ failed with error: %@.", tableName, [db lastError]);
+        while ([resultSet next]) {
+            [objectIDs addObject:[NSNumber numberWithUnsignedLongLong:[resultSet unsignedLongLongIntForColumnIndex:0]]];
+        }
+        [resultSet close];
+    }];
+    
+    return [NSArray arrayWithArray:objectIDs];
+}
+
 
 #pragma mark - textual search
 -(NSArray*)objectsFromTable:(NSString*)tableName containingString:(NSString*)string inColumn:(NSString*)columnName{
@@ -272,19 +808,21 @@
 
 #pragma mark - creation
 -(RHSQLiteObject*)newObjectInTable:(NSString*)tableName{
-    REQUIRE_LOADED(); ENSURE_KNOWN_TABLE(tableName);
+    REQUIRE_LOADED(); REQUIRE_WRITABLE(); ENSURE_KNOWN_TABLE(tableName);
     return [[[self objectClassForTable:tableName] alloc] initWithDataStore:self];
 }
 
 
 #pragma mark - insertion
 -(RHSQLiteObjectID)insertObject:(RHSQLiteObject*)object{
+    REQUIRE_WRITABLE();
     [object associateWithDataStore:self];
-    [object save];
+    [object create]; //not save, which a unit of work would defer. we need the new id now.
     return object.objectID;
 }
 
 -(NSArray*)insertObjects:(NSArray*)objects{
+    REQUIRE_WRITABLE();
     NSMutableArray *objectIDs = [NSMutableArray array];
     for (RHSQLiteObject *object in objects) {
         RHSQLiteObjectID objectID = [self insertObject:object];
@@ -297,10 +835,12 @@
 
 #pragma mark - deletion
 -(BOOL)deleteObject:(RHSQLiteObject*)object{
+    REQUIRE_WRITABLE();
     return [object delete];
 }
 
 -(NSArray*)deleteObjects:(NSArray*)objects{
+    REQUIRE_WRITABLE();
     NSMutableArray *results = [NSMutableArray array];
     for (RHSQLiteObject *object in objects) {
         BOOL result = [self insertObject:object];
@@ -311,21 +851,233 @@
 }
 
 
+#pragma mark - unit of work
+-(void)_objectDidBecomeDirty:(RHSQLiteObject*)object{
+    @synchronized(_dirtyObjects){
+        [_dirtyObjects addObject:[RHWeakValue weakValueWithObject:object]];
+        
+        //objects that were released with unsaved changes leave empty entries behind
+        if ([_dirtyObjects count] >= _dirtyObjectsPruneCount){
+            NSIndexSet *dead = [_dirtyObjects indexesOfObjectsPassingTest:^BOOL(RHWeakValue *value, NSUInteger idx, BOOL *stop) {
+                return [value weakValue] == nil;
+            }];
+            [_dirtyObjects removeObjectsAtIndexes:dead];
+            _dirtyObjectsPruneCount = MAX([_dirtyObjects count] * 2, (NSUInteger)RHSQLiteDataStoreMinimumDirtyObjectsPruneCount);
+        }
+    }
+}
+
+-(NSArray*)_takeDirtyObjects{
+    NSArray *values = nil;
+    @synchronized(_dirtyObjects){
+        values = [NSArray arrayWithArray:_dirtyObjects];
+        [_dirtyObjects removeAllObjects];
+        _dirtyObjectsPruneCount = RHSQLiteDataStoreMinimumDirtyObjectsPruneCount;
+    }
+    
+    NSMutableArray *objects = [NSMutableArray arrayWithCapacity:[values count]];
+    for (RHWeakValue *value in values) {
+        RHSQLiteObject *object = [value weakValue];
+        if (!object) continue;
+        [object _clearDirtyTracking];
+        [objects addObject:object];
+    }
+    return objects;
+}
+
+-(NSArray*)objectsWithUnsavedChanges{
+    NSArray *values = nil;
+    @synchronized(_dirtyObjects){
+        values = [NSArray arrayWithArray:_dirtyObjects];
+    }
+    
+    NSMutableArray *objects = [NSMutableArray array];
+    for (RHWeakValue *value in values) {
+        RHSQLiteObject *object = [value weakValue];
+        if (!object || [object hasBeenDeleted]) continue;
+        if ([object hasUnsavedChanges] || ![object hasBeenCreated]) [objects addObject:object];
+    }
+    return [NSArray arrayWithArray:objects];
+}
+
+-(BOOL)hasUnsavedChanges{
+    return [[self objectsWithUnsavedChanges] count] > 0;
+}
+
+-(BOOL)saveAllChanges{
+    return [self saveAllChangesWithErrors:NULL];
+}
+
+-(BOOL)saveAllChangesWithErrors:(NSArray**)errorsOut{
+    REQUIRE_LOADED(); REQUIRE_WRITABLE();
+    if (errorsOut) *errorsOut = [NSArray array];
+    
+    //queued write behind values are older than anything we are about to write
+    NSError *flushError = nil;
+    if (_writeBehindQueue && ![_writeBehindQueue flushWithError:&flushError]){
+        if (errorsOut && flushError) *errorsOut = [NSArray arrayWithObject:flushError];
+        return NO;
+    }
+    
+    NSArray *dirtyObjects = [self _takeDirtyObjects];
+    if ([dirtyObjects count] < 1) return YES;
+    
+    //build every statement up front, layouts and encoding may need the database themselves
+    NSMutableArray *inserts = [NSMutableArray array];
+    NSMutableArray *insertSQL = [NSMutableArray array];
+    NSMutableArray *insertArguments = [NSMutableArray array];
+    NSMutableArray *updates = [NSMutableArray array];
+    NSMutableArray *updateGroupSQL = [NSMutableArray array];   //first seen order
+    NSMutableDictionary *updateGroups = [NSMutableDictionary dictionary]; //sql -> array of indexes into updates
+    NSMutableArray *updateArguments = [NSMutableArray array];
+    
+    for (RHSQLiteObject *object in dirtyObjects) {
+        if ([object hasBeenDeleted]) continue;
+        [object _prepareSlots];
+        
+        NSArray *arguments = nil;
+        if (![object hasBeenCreated]){
+            NSString *sql = [object createSQLWithArguments:&arguments];
+            if (!sql) continue;
+            [inserts addObject:object];
+            [insertSQL addObject:sql];
+            [insertArguments addObject:arguments ? arguments : [NSArray array]];
+        } else if ([object hasUnsavedChanges]){
+            NSString *sql = [object saveSQLWithArguments:&arguments];
+            if (!sql) continue;
+            
+            //the UPDATE for a given table and set of columns is the same for every object, so group them to share its prepared statement
+            NSMutableArray *group = [updateGroups objectForKey:sql];
+            if (!group){
+                group = [NSMutableArray array];
+                [updateGroups setObject:group forKey:sql];
+                [updateGroupSQL addObject:sql];
+            }
+            [group addObject:[NSNumber numberWithUnsignedInteger:[updates count]]];
+            [updates addObject:object];
+            [updateArguments addObject:arguments ? arguments : [NSArray array]];
+        }
+    }
+    
+    NSMutableArray *savedObjects = [NSMutableArray arrayWithArray:inserts];
+    [savedObjects addObjectsFromArray:updates];
+    if ([savedObjects count] < 1) return YES;
+    
+    RHLog(@"Saving %lu new and %lu changed objects in %lu statement groups.", (unsigned long)[inserts count], (unsigned long)[updates count], (unsigned long)[updateGroupSQL count]);
+    
+    NSMutableArray *errors = [NSMutableArray array];
+    NSMutableArray *insertedIDs = [NSMutableArray arrayWithCapacity:[inserts count]];
+    NSError *transactionError = nil;
+    BOOL committed = [self _accessDatabaseWithTransactionForStatementKind:RHSQLiteStatementKindSave deferred:NO queue:nil objects:savedObjects error:&transactionError block:^(FMDatabase *db, BOOL *rollback) {
+        BOOL shouldCacheStatements = [db shouldCacheStatements];
+        [db setShouldCacheStatements:YES];
+        
+        void (^recordError)(RHSQLiteObject *object) = ^(RHSQLiteObject *object) {
+            NSError *error = [db lastError];
+            NSMutableDictionary *userInfo = [NSMutableDictionary dictionaryWithDictionary:[error userInfo]];
+            [userInfo setObject:object forKey:RHSQLiteDataStoreFailedObjectKey];
+            [errors addObject:[NSError errorWithDomain:[error domain] code:[error code] userInfo:userInfo]];
+            RHErrorLog(@"Error: Failed to save object %@ %lld. Error: %@.", [object tableName], [object objectID], error);
+        };
+        
+        //inserts first, so that the rows exist before anything that refers to them is updated
+        [inserts enumerateObjectsUsingBlock:^(RHSQLiteObject *object, NSUInteger idx, BOOL *stop) {
+            if ([db executeUpdate:[insertSQL objectAtIndex:idx] withArgumentsInArray:[insertArguments objectAtIndex:idx]]){
+                [insertedIDs addObject:[NSNumber numberWithLongLong:[db lastInsertRowId]]];
+            } else {
+                [insertedIDs addObject:[NSNumber numberWithLongLong:RHSQLiteObjectIDNotYetAvailable]];
+                recordError(object);
+            }
+        }];
+        
+        //keep going after a failure, so that every failing object is reported
+        for (NSString *sql in updateGroupSQL) {
+            for (NSNumber *index in [updateGroups objectForKey:sql]) {
+                NSUInteger i = [index unsignedIntegerValue];
+                if (![db executeUpdate:sql withArgumentsInArray:[updateArguments objectAtIndex:i]]) recordError([updates objectAtIndex:i]);
+            }
+        }
+        
+        [db setShouldCacheStatements:shouldCacheStatements];
+        if ([errors count] > 0) *rollback = YES;
+    }];
+    
+    //a BEGIN or COMMIT that failed (ie SQLITE_FULL, SQLITE_BUSY) loses every statement, not just one objects
+    if (!committed && [errors count] < 1 && transactionError) [errors addObject:transactionError];
+    
+    if (!committed){
+        //nothing was written, everyone keeps their changes and stays tracked
+        for (RHSQLiteObject *object in savedObjects) {
+            [object _markDirty];
+        }
+        if (errorsOut) *errorsOut = [NSArray arrayWithArray:errors];
+        return NO;
+    }
+    
+    [inserts enumerateObjectsUsingBlock:^(RHSQLiteObject *object, NSUInteger idx, BOOL *stop) {
+        [object _didSaveWithObjectID:[[insertedIDs objectAtIndex:idx] longLongValue]];
+    }];
+    for (RHSQLiteObject *object in updates) {
+        [object _didSaveWithObjectID:[object objectID]];
+    }
+    return YES;
+}
+
+-(BOOL)_isAccessingWritableDatabase{
+    //only ever equal to the current thread when it was set by this thread
+    return _writableConnectionThread == [NSThread currentThread];
+}
+
+-(BOOL)_isPerformingUnitOfWork{
+    return [[[[NSThread currentThread] threadDictionary] objectForKey:_unitOfWorkThreadKey] unsignedIntegerValue] > 0;
+}
+
+-(BOOL)performUnitOfWork:(BOOL (^)(void))block errors:(NSArray**)errorsOut{
+    REQUIRE_LOADED(); REQUIRE_WRITABLE();
+    if (errorsOut) *errorsOut = [NSArray array];
+    if (!block) return NO;
+    
+    NSMutableDictionary *threadDictionary = [[NSThread currentThread] threadDictionary];
+    NSUInteger depth = [[threadDictionary objectForKey:_unitOfWorkThreadKey] unsignedIntegerValue];
+    [threadDictionary setObject:[NSNumber numberWithUnsignedInteger:depth + 1] forKey:_unitOfWorkThreadKey];
+    
+    BOOL result = NO;
+    @try {
+        result = block();
+    }
+    @finally {
+        if (depth > 0) [threadDictionary setObject:[NSNumber numberWithUnsignedInteger:depth] forKey:_unitOfWorkThreadKey];
+        else [threadDictionary removeObjectForKey:_unitOfWorkThreadKey];
+    }
+    
+    //nested units are saved by the outermost one
+    if (!result || depth > 0) return result;
+    return [self saveAllChangesWithErrors:errorsOut];
+}
+
+
 #pragma mark - table name to class associations
 -(NSArray*)objectClassNames{
-    return [NSArray arrayWithArray:[_associatedClassNamesByTableName allValues]];
+    return [[self _classNamesByTableName] allValues];
 }
 
--(void)_loadDefaultTableClassAssociations{
-    //if a custom class has already been registered for a given table name, this process continues to use that class.
-    for (NSString *rawTableName in _knownTableNames) {
-        [self objectClassForTable:rawTableName];
+-(NSDictionary*)_classNamesByTableName{
+    @synchronized(_associatedClassNamesByTableName){
+        //tables whose classes have not been generated yet still report the name they will be generated with
+        NSMutableDictionary *classNames = [NSMutableDictionary dictionaryWithDictionary:_associatedClassNamesByTableName];
+        for (NSString *tableName in _knownTableNames) {
+            if (![classNames objectForKey:tableName]) [classNames setObject:[self.class _defaultClassNameForTable:tableName] forKey:tableName];
+        }
+        return classNames;
     }
 }
 
 -(void)associateObjectClass:(Class)objectClass{
     REQUIRE_NOT_LOADED();
-    
+    [self _associateObjectClass:objectClass];
+}
+
+-(void)_associateObjectClass:(Class)objectClass{
     if(![objectClass isSubclassOfClass:[RHSQLiteObject class]]){
         [NSException raise:NSInvalidArgumentException format:@"-[RHSQLiteDataStore associateObjectClass:] must be a subclass of RHSQLiteObject."];
         return;
@@ -335,21 +1087,29 @@
     NSString *tableName = [NSClassFromString(className) tableName];
     
     //add to the associations dictionary
-    [_associatedClassNamesByTableName setObject:className forKey:tableName];
+    @synchronized(_associatedClassNamesByTableName){
+        [_associatedClassNamesByTableName setObject:className forKey:tableName];
+    }
 }
 
 -(Class)objectClassForTable:(NSString*)tableName{
-    NSString *tableClassName = [_associatedClassNamesByTableName objectForKey:tableName];
-    Class tableClass = NSClassFromString(tableClassName);
+    Class tableClass = Nil;
     
-    if (!tableClassName && [_knownTableNames containsObject:tableName]){
-        //load a new one and associate it
-        NSString *newClassName = [self.class _defaultClassNameForTable:tableName];
-        tableClass = RHSQLiteDynamicObjectParentCreateNewSubclassWithNameAndTableName(newClassName, tableName);
+    //classes for tables without an associated subclass are generated on first use, which may happen on any thread
+    @synchronized(_associatedClassNamesByTableName){
+        NSString *tableClassName = [_associatedClassNamesByTableName objectForKey:tableName];
+        tableClass = NSClassFromString(tableClassName);
         
-        if (tableClass) [self associateObjectClass:tableClass];
+        if (!tableClassName && [_knownTableNames containsObject:tableName]){
+            //load a new one and associate it
+            NSString *newClassName = [self.class _defaultClassNameForTable:tableName];
+            tableClass = RHSQLiteDynamicObjectParentCreateNewSubclassWithNameAndTableName(newClassName, tableName);
+            
+            if (tableClass) [self _associateObjectClass:tableClass];
+        }
     }
-        
+    
+
     if (!tableClass){
         RHErrorLog(@"Error: unable to get class for unknown table '%@'.", tableName);
         return nil;
@@ -367,15 +1127,30 @@
 #pragma mark - migrations
 -(void)registerMigrationsFile:(NSString*)migrationPath{
     REQUIRE_NOT_LOADED();
-    [_registeredMigrationPaths addObject:migrationPath];
+    [_registeredMigrations addObject:migrationPath];
+}
+
+-(void)registerMigrationBlock:(RHSQLiteDataStoreMigrationBlock)migrationBlock{
+    REQUIRE_NOT_LOADED();
+    [_registeredMigrations addObject:[migrationBlock copy]];
 }
 
 -(BOOL)migrationsEnabled{
-    return _registeredMigrationPaths.count > 0;
+    if (_registeredMigrations.count > 0) return YES;
+    
+    for (RHSQLiteShard *shard in [_shards allValues]) {
+        if ([[shard registeredMigrations] count] > 0) return YES;
+    }
+    return NO;
 }
 
 -(BOOL)requiresMigration{
-    return [self _currentSchemaVersion] < [self _maxSchemaVersion];
+    if ([self _currentSchemaVersion] < [self _maxSchemaVersion]) return YES;
+    
+    for (RHSQLiteShard *shard in [_shards allValues]) {
+        if ([self _schemaVersionForShard:shard] < [[shard registeredMigrations] count]) return YES;
+    }
+    return NO;
 }
 
 #pragma mark - internal migrations support
@@ -384,92 +1159,570 @@
 }
 
 -(NSUInteger)_maxSchemaVersion{
-    return _registeredMigrationPaths.count;
+    return _registeredMigrations.count;
 }
 
 
 -(BOOL)_performRequiredMigrations{
-    while ([self requiresMigration]){
-        //perform migration
-        BOOL result = NO;
-        NSUInteger nextRequiredMigration = [self _currentSchemaVersion] + 1;
-        result = [self _performMigrationToSchemaVersion:nextRequiredMigration];
+    NSUInteger currentVersion = [self _currentSchemaVersion];
+    NSUInteger maxVersion = [self _maxSchemaVersion];
+    
+    while (currentVersion < maxVersion){
+        //perform migration (the schema_version bump happens inside the migrations transaction)
+        NSUInteger nextRequiredMigration = currentVersion + 1;
+        BOOL result = [self _performMigrationToSchemaVersion:nextRequiredMigration];
 
         //bail if we failed our current migration
         if (!result){
-            RHErrorLog(@"Error: failed to perform migration from schema %lu to %lu.", (unsigned long)[self _currentSchemaVersion], (unsigned long)nextRequiredMigration);
+            RHErrorLog(@"Error: failed to perform migration from schema %lu to %lu.", (unsigned long)currentVersion, (unsigned long)nextRequiredMigration);
             return NO;
         }
-        //bump our schema version
-        [self _metadataSetValue:[NSNumber numberWithUnsignedInteger:nextRequiredMigration] forKey:@"schema_version"];
+        currentVersion = nextRequiredMigration;
     }
 
     return YES;
 }
 
 -(BOOL)_performMigrationToSchemaVersion:(NSUInteger)version{
-    if (version > _registeredMigrationPaths.count){
+    if (version < 1 || version > _registeredMigrations.count){
         [NSException raise:NSInvalidArgumentException format:@"Error: Failed to perform schema migration. Unknown schema version %lu.", (unsigned long)version];
         return NO;
     }
     
-    //this is a hack, but rmdb does not currently support running commands from files directly.
-    NSString *schemaPath = [_registeredMigrationPaths objectAtIndex:version - 1];
-    NSString *sql = [[NSString alloc] initWithContentsOfFile:schemaPath encoding:NSUTF8StringEncoding error:nil];
-    if (!sql){
-        RHErrorLog(@"Error: Failed to perform Migration %lu. Unable to find file with path '%@'.", (unsigned long)version, schemaPath);
-        return NO;
+    return [self _performMigration:[_registeredMigrations objectAtIndex:version - 1] toSchemaVersion:version shard:nil];
+}
+
+-(BOOL)_performMigration:(id)migration toSchemaVersion:(NSUInteger)version shard:(RHSQLiteShard*)shard{
+    if (shard && ![shard databaseQueue]) return NO; //a nil queue would be our main file
+    NSString *path = shard ? [shard path] : _path;
+    NSData *script = nil;
+    if ([migration isKindOfClass:[NSString class]]){
+        //scripts are handed to sqlite as raw UTF-8, no need to decode them into an NSString first.
+        script = [NSData dataWithContentsOfFile:migration options:NSDataReadingMappedIfSafe error:nil];
+        if (!script){
+            RHErrorLog(@"Error: Failed to perform Migration %lu. Unable to find file with path '%@'.", (unsigned long)version, migration);
+            return NO;
+        }
     }
     
-    RHLog(@"Performing schema migration (%lu)->(%lu) for db %@.", (unsigned long)[self _currentSchemaVersion], (unsigned long)version, _path);
+    RHLog(@"Performing schema migration (%lu)->(%lu) for db %@.", (unsigned long)version - 1, (unsigned long)version, path);
     
-    __block BOOL result = YES;
-    [_databaseQueue inDatabase:^(FMDatabase *db) {
-        //run each query individually.
-        NSArray *queries = [sql componentsSeparatedByString:@";"];
-        
-        for(NSString *query in queries){
-            NSString *stripped = [[query sk_stringByDeletingComments] sk_stringByTrimmingWhitespaceAndNewlineCharacters];
-            
-            if ([stripped length] > 0){
-                if(![db executeUpdate:query]){
-                    RHErrorLog(@"Error: Failed to perform part of migration:%ld. Failing query: {\n%@\n}.", (unsigned long)version, stripped);
-                    result = NO;
-                    break;
-                }
+    NSTimeInterval start = [NSDate timeIntervalSinceReferenceDate];
+    _migratingToSchemaVersion = version;
+    
+    __block BOOL result = NO;
+    BOOL committed = [self _accessDatabaseWithTransactionForStatementKind:RHSQLiteStatementKindMigration deferred:NO queue:[shard databaseQueue] objects:nil error:NULL block:^(FMDatabase *db, BOOL *rollback) {
+        if (script){
+            result = [self _executeMigrationScript:script forSchemaVersion:version inDatabase:db];
+        } else {
+            result = ((RHSQLiteDataStoreMigrationBlock)migration)(self, db);
+            if (!result) RHErrorLog(@"Error: Migration block for schema version %lu returned NO.", (unsigned long)version);
+            if (result && sqlite3_get_autocommit([db sqliteHandle])){
+                RHErrorLog(@"Error: Migration block for schema version %lu ended the migrations transaction.", (unsigned long)version);
+                result = NO;
             }
         }
         
+        //bump our schema version as part of the same transaction. shards keep their own, in their own files metadata table
+        if (result && shard) result = [shard setSchemaVersion:version inDatabase:db];
+        else if (result) result = [self _metadataSetValue:[NSNumber numberWithUnsignedInteger:version] forKey:@"schema_version" inDatabase:db];
+        if (!result) *rollback = YES;
     }];
+    result = result && committed; //the helper has already logged a failed COMMIT
+    
+    _migratingToSchemaVersion = 0;
+    
+    //migrations (or their rollback) may have changed any table, so don't trust any cached column names
+    @synchronized(_cachedTableColumnNames){
+        [_cachedTableColumnNames removeAllObjects];
+    }
+    @synchronized(_cachedRowLayouts){
+        [_cachedRowLayouts removeAllObjects];
+    }
+    
+    //a rolled back migration may also have left values in the metadata cache that never made it to disk
+    if (!result) _cachedMetadataValues = nil;
+    
+    RHLog(@"Schema migration (%lu)->(%lu) of %@ %@ in %.3fs.", (unsigned long)version - 1, (unsigned long)version, path, result ? @"completed" : @"failed", [NSDate timeIntervalSinceReferenceDate] - start);
     
     //return our result
     return result;
 }
 
+//skips whitespace and comments, then returns the length of the keyword at *sql, advancing past it
+static size_t RHSQLiteMigrationNextKeyword(const char **sql){
+    const char *p = *sql;
+    for (;;){
+        while (*p && isspace((unsigned char)*p)) p++;
+        if (p[0] == '-' && p[1] == '-'){
+            while (*p && *p != '\n') p++;
+        } else if (p[0] == '/' && p[1] == '*'){
+            const char *close = strstr(p + 2, "*/");
+            p = close ? close + 2 : p + strlen(p);
+        } else break;
+    }
+    const char *keyword = p;
+    while (*p && (isalnum((unsigned char)*p) || *p == '_')) p++;
+    *sql = keyword;
+    return (size_t)(p - keyword);
+}
+
+static int RHSQLiteMigrationKeywordIs(const char *keyword, size_t length, const char *expected){
+    return length == strlen(expected) && strncasecmp(keyword, expected, length) == 0;
+}
+
+//statements that would end, or can't run inside, the transaction each migration is wrapped in
+static const char *RHSQLiteMigrationDisallowedStatement(const char *sql){
+    const char *keyword = sql;
+    size_t length = RHSQLiteMigrationNextKeyword(&keyword);
+    const char *next = keyword + length;
+    
+    if (RHSQLiteMigrationKeywordIs(keyword, length, "BEGIN")) return "BEGIN";
+    if (RHSQLiteMigrationKeywordIs(keyword, length, "COMMIT") || RHSQLiteMigrationKeywordIs(keyword, length, "END")) return "COMMIT";
+    if (RHSQLiteMigrationKeywordIs(keyword, length, "VACUUM")) return "VACUUM";
+    if (RHSQLiteMigrationKeywordIs(keyword, length, "ROLLBACK")){
+        //ROLLBACK [TRANSACTION] TO [SAVEPOINT] name only unwinds a savepoint, which is fine
+        length = RHSQLiteMigrationNextKeyword(&next);
+        if (RHSQLiteMigrationKeywordIs(next, length, "TRANSACTION")){
+            next += length;
+            length = RHSQLiteMigrationNextKeyword(&next);
+        }
+        return RHSQLiteMigrationKeywordIs(next, length, "TO") ? NULL : "ROLLBACK";
+    }
+    if (RHSQLiteMigrationKeywordIs(keyword, length, "PRAGMA")){
+        //foreign_keys is silently ignored inside a transaction. (also catches schema.foreign_keys)
+        length = RHSQLiteMigrationNextKeyword(&next);
+        if (next[length] == '.'){
+            next += length + 1;
+            length = RHSQLiteMigrationNextKeyword(&next);
+        }
+        if (RHSQLiteMigrationKeywordIs(next, length, "foreign_keys")) return "PRAGMA foreign_keys";
+    }
+    return NULL;
+}
+
+-(BOOL)_executeMigrationScript:(NSData*)script forSchemaVersion:(NSUInteger)version inDatabase:(FMDatabase*)db{
+    sqlite3 *handle = [db sqliteHandle];
+    const char *start = [script bytes];
+    const char *end = start + [script length];
+    const char *sql = start;
+    
+    //skip any UTF-8 BOM
+    if (end - start >= 3 && memcmp(start, "\xEF\xBB\xBF", 3) == 0) sql += 3;
+    
+    //let sqlite split the script, one statement at a time, using the prepare tail. This correctly handles comments, string literals and trigger bodies.
+    while (sql < end){
+        NSTimeInterval stepStart = [NSDate timeIntervalSinceReferenceDate];
+        sqlite3_stmt *statement = NULL;
+        const char *tail = NULL;
+        
+        int rc = sqlite3_prepare_v2(handle, sql, (int)(end - sql), &statement, &tail);
+        if (rc != SQLITE_OK){
+            RHErrorLog(@"Error: Failed to prepare part of migration:%lu. Error: %s. Failing query: {\n%@\n}.", (unsigned long)version, sqlite3_errmsg(handle), [[NSString alloc] initWithBytes:sql length:(end - sql) encoding:NSUTF8StringEncoding]);
+            sqlite3_finalize(statement);
+            return NO;
+        }
+        
+        if (!statement){
+            //only whitespace and/or comments remained
+            if (!tail || tail <= sql) break;
+            sql = tail;
+            continue;
+        }
+        
+        const char *disallowed = RHSQLiteMigrationDisallowedStatement(sqlite3_sql(statement));
+        if (disallowed){
+            RHErrorLog(@"Error: Migration:%lu uses %s, which can't be run inside the transaction each migration is performed in. Failing query: {\n%s\n}.", (unsigned long)version, disallowed, sqlite3_sql(statement));
+            sqlite3_finalize(statement);
+            return NO;
+        }
+        
+        do {
+            rc = sqlite3_step(statement);
+        } while (rc == SQLITE_ROW);
+        
+        if (rc != SQLITE_DONE){
+            RHErrorLog(@"Error: Failed to perform part of migration:%lu. Error: %s. Failing query: {\n%s\n}.", (unsigned long)version, sqlite3_errmsg(handle), sqlite3_sql(statement));
+            sqlite3_finalize(statement);
+            return NO;
+        }
+        
+        //anything that got past the check above and still ended our transaction
+        if (sqlite3_get_autocommit(handle)){
+            RHErrorLog(@"Error: Part of migration:%lu ended the migrations transaction. Failing query: {\n%s\n}.", (unsigned long)version, sqlite3_sql(statement));
+            sqlite3_finalize(statement);
+            return NO;
+        }
+        
+        NSTimeInterval duration = [NSDate timeIntervalSinceReferenceDate] - stepStart;
+        NSString *stepDescription = _migrationProgressHandler ? [NSString stringWithUTF8String:sqlite3_sql(statement)] : nil;
+        RHLog(@"Migration:%lu step took %.3fs: %s", (unsigned long)version, duration, sqlite3_sql(statement));
+        sqlite3_finalize(statement);
+        
+        sql = tail;
+        [self _reportMigrationStep:stepDescription duration:duration progress:(double)(sql - start) / (double)(end - start)];
+    }
+    
+    return YES;
+}
+
+-(void)_reportMigrationStep:(NSString*)stepDescription duration:(NSTimeInterval)duration progress:(double)progress{
+    if (_migrationProgressHandler) _migrationProgressHandler(_migratingToSchemaVersion, stepDescription, duration, MIN(1.0, progress));
+}
+
+-(BOOL)rebuildTable:(NSString*)tableName withColumnDefinitions:(NSString*)columnDefinitions columnMapping:(NSDictionary*)columnMapping batchSize:(NSUInteger)batchSize inDatabase:(FMDatabase*)db{
+    if (!tableName || !columnDefinitions || !db){
+        [NSException raise:NSInvalidArgumentException format:@"Error: tableName, columnDefinitions and db are required by %@.", NSStringFromSelector(_cmd)];
+        return NO;
+    }
+    if (batchSize == 0) batchSize = RHSQLiteDataStoreDefaultRebuildBatchSize;
+    
+    //see: http://www.sqlite.org/lang_altertable.html "Making Other Kinds Of Table Schema Changes"
+    NSString *newTableName = [NSString stringWithFormat:@"_rh_rebuild_%@", tableName];
+    NSTimeInterval stepStart = [NSDate timeIntervalSinceReferenceDate];
+    
+    //remember the indexes and triggers, dropping the table drops them too
+    NSMutableArray *dependentSQL = [NSMutableArray array];
+    FMResultSet *resultSet = [db executeQuery:@"SELECT `sql` FROM `sqlite_master` WHERE `tbl_name` = ? AND `type` IN ('index', 'trigger') AND `sql` IS NOT NULL;", tableName];
+    while ([resultSet next]) {
+        NSString *sql = [resultSet stringForColumn:@"sql"];
+        if (sql) [dependentSQL addObject:sql];
+    }
+    [resultSet close];
+    
+    //create the new table
+    NSString *createSQL = [NSString stringWithFormat:@"CREATE TABLE `%@` (%@);", newTableName, columnDefinitions];
+    if (![db executeUpdate:createSQL]){
+        RHErrorLog(@"Error: Failed to create replacement table for %@. Error: %@.", tableName, [db lastError]);
+        return NO;
+    }
+    
+    //work out which columns to copy
+    NSMutableArray *newColumns = [NSMutableArray array];
+    NSMutableArray *oldExpressions = [NSMutableArray array];
+    if (columnMapping){
+        for (NSString *columnName in columnMapping) {
+            [newColumns addObject:[NSString stringWithFormat:@"`%@`", columnName]];
+            [oldExpressions addObject:[columnMapping objectForKey:columnName]];
+        }
+    } else {
+        NSArray *oldColumnNames = [self _columnNamesForTable:tableName inDatabase:db];
+        for (NSString *columnName in [self _columnNamesForTable:newTableName inDatabase:db]) {
+            if (![oldColumnNames containsObject:columnName]) continue;
+            [newColumns addObject:[NSString stringWithFormat:@"`%@`", columnName]];
+            [oldExpressions addObject:[NSString stringWithFormat:@"`%@`", columnName]];
+        }
+    }
+    [self _invalidateCachedColumnNamesForTable:newTableName];
+    [self _reportMigrationStep:[NSString stringWithFormat:@"Created replacement table for %@.", tableName] duration:[NSDate timeIntervalSinceReferenceDate] - stepStart progress:0.0];
+    
+    //copy rows across in _ROWID_ ordered batches, so progress can be reported along the way.
+    //each batch starts just after the last rowid copied, so sparse rowids cost nothing extra
+    if (newColumns.count > 0){
+        int64_t minRowID = 0, maxRowID = -1, rowCount = 0;
+        resultSet = [db executeQuery:[NSString stringWithFormat:@"SELECT min(_ROWID_) AS `min`, max(_ROWID_) AS `max`, count(*) AS `count` FROM `%@`;", tableName]];
+        if ([resultSet next] && ![resultSet columnIsNull:@"min"]){
+            minRowID = [resultSet longLongIntForColumn:@"min"];
+            maxRowID = [resultSet longLongIntForColumn:@"max"];
+            rowCount = [resultSet longLongIntForColumn:@"count"];
+        }
+        [resultSet close];
+        
+        NSString *batchSQL = [NSString stringWithFormat:@"SELECT max(`rowid`) AS `upper`, count(*) AS `count` FROM (SELECT _ROWID_ AS `rowid` FROM `%@` WHERE _ROWID_ >= ? ORDER BY _ROWID_ LIMIT ?);", tableName];
+        NSString *copySQL = [NSString stringWithFormat:@"INSERT INTO `%@` (%@) SELECT %@ FROM `%@` WHERE _ROWID_ >= ? AND _ROWID_ <= ? ORDER BY _ROWID_;", newTableName, [newColumns componentsJoinedByString:@", "], [oldExpressions componentsJoinedByString:@", "], tableName];
+        
+        int64_t lower = minRowID;
+        int64_t copiedCount = 0;
+        while (rowCount > 0) {
+            stepStart = [NSDate timeIntervalSinceReferenceDate];
+            
+            //the rowid that ends this batch
+            int64_t upper = 0, batchCount = 0;
+            resultSet = [db executeQuery:batchSQL, [NSNumber numberWithLongLong:lower], [NSNumber numberWithUnsignedInteger:batchSize]];
+            if ([resultSet next] && ![resultSet columnIsNull:@"upper"]){
+                upper = [resultSet longLongIntForColumn:@"upper"];
+                batchCount = [resultSet longLongIntForColumn:@"count"];
+            }
+            [resultSet close];
+            if (batchCount == 0) break;
+            
+            if (![db executeUpdate:copySQL, [NSNumber numberWithLongLong:lower], [NSNumber numberWithLongLong:upper]]){
+                RHErrorLog(@"Error: Failed to copy rows %lld-%lld of %@ into its replacement table. Error: %@.", lower, upper, tableName, [db lastError]);
+                return NO;
+            }
+            copiedCount += batchCount;
+            
+            double progress = MIN(1.0, (double)copiedCount / (double)rowCount);
+            [self _reportMigrationStep:[NSString stringWithFormat:@"Copied rows %lld-%lld of %@.", lower, upper, tableName] duration:[NSDate timeIntervalSinceReferenceDate] - stepStart progress:progress];
+            
+            if (upper >= maxRowID) break;
+            lower = upper + 1;
+        }
+    }
+    
+    //swap the tables over
+    stepStart = [NSDate timeIntervalSinceReferenceDate];
+    if (![db executeUpdate:[NSString stringWithFormat:@"DROP TABLE `%@`;", tableName]] ||
+        ![db executeUpdate:[NSString stringWithFormat:@"ALTER TABLE `%@` RENAME TO `%@`;", newTableName, tableName]]){
+        RHErrorLog(@"Error: Failed to replace table %@ with its rebuilt version. Error: %@.", tableName, [db lastError]);
+        return NO;
+    }
+    
+    //recreate indexes and triggers
+    for (NSString *sql in dependentSQL) {
+        if (![db executeUpdate:sql]){
+            RHErrorLog(@"Error: Failed to recreate index or trigger for rebuilt table %@. Failing query: {\n%@\n}. Error: %@.", tableName, sql, [db lastError]);
+            return NO;
+        }
+    }
+    
+    [self _invalidateCachedColumnNamesForTable:tableName];
+    [self _reportMigrationStep:[NSString stringWithFormat:@"Rebuilt table %@.", tableName] duration:[NSDate timeIntervalSinceReferenceDate] - stepStart progress:1.0];
+    return YES;
+}
+
+
+#pragma mark - sharding
+-(void)assignTable:(NSString*)tableName toShard:(NSString*)shardName{
+    REQUIRE_NOT_LOADED();
+    if (!tableName)[NSException raise:NSInvalidArgumentException format:@"Error: tableName is required by %@.", NSStringFromSelector(_cmd)];
+    RHSQLiteShard *shard = [self _shardNamed:shardName];
+    [_shardNamesByTableName setObject:[shard name] forKey:tableName];
+}
+
+-(void)assignObjectClass:(Class)objectClass toShard:(NSString*)shardName{
+    [self associateObjectClass:objectClass];
+    [self assignTable:[objectClass tableName] toShard:shardName];
+}
+
+-(void)registerMigrationsFile:(NSString*)migrationPath forShard:(NSString*)shardName{
+    REQUIRE_NOT_LOADED();
+    [[[self _shardNamed:shardName] registeredMigrations] addObject:migrationPath];
+}
+
+-(void)registerMigrationBlock:(RHSQLiteDataStoreMigrationBlock)migrationBlock forShard:(NSString*)shardName{
+    REQUIRE_NOT_LOADED();
+    [[[self _shardNamed:shardName] registeredMigrations] addObject:[migrationBlock copy]];
+}
+
+-(NSArray*)shardNames{
+    return [[_shards allKeys] sortedArrayUsingSelector:@selector(compare:)];
+}
+
+-(NSString*)shardForTable:(NSString*)tableName{
+    return [_shardNamesByTableName objectForKey:tableName];
+}
+
+-(NSString*)pathForShard:(NSString*)shardName{
+    //next to our own file, ie data.sqlite -> data-log.sqlite
+    NSString *extension = [_path pathExtension];
+    NSString *path = [[_path stringByDeletingPathExtension] stringByAppendingFormat:@"-%@", shardName];
+    return [extension length] > 0 ? [path stringByAppendingPathExtension:extension] : path;
+}
+
+-(NSUInteger)schemaVersionForShard:(NSString*)shardName{
+    RHSQLiteShard *shard = [_shards objectForKey:shardName];
+    return shard ? [self _schemaVersionForShard:shard] : 0;
+}
+
+-(FMDatabaseQueue*)_databaseQueueForTable:(NSString*)tableName{
+    NSString *shardName = tableName ? [_shardNamesByTableName objectForKey:tableName] : nil;
+    if (!shardName) return _databaseQueue;
+    
+    FMDatabaseQueue *databaseQueue = [[_shards objectForKey:shardName] databaseQueue];
+    return databaseQueue ? databaseQueue : _databaseQueue;
+}
+
+-(NSArray*)_shardDatabaseQueues{
+    NSMutableArray *databaseQueues = [NSMutableArray array];
+    for (RHSQLiteShard *shard in [_shards allValues]) {
+        if ([shard databaseQueue]) [databaseQueues addObject:[shard databaseQueue]];
+    }
+    return databaseQueues;
+}
+
+-(RHSQLiteShard*)_shardNamed:(NSString*)shardName{
+    if (![RHSQLiteShard isValidShardName:shardName]){
+        [NSException raise:NSInvalidArgumentException format:@"Error: '%@' is not a valid shard name. Shard names can only contain letters, digits and underscores.", shardName];
+    }
+    
+    RHSQLiteShard *shard = [_shards objectForKey:shardName];
+    if (!shard){
+        shard = [[RHSQLiteShard alloc] initWithName:shardName path:[self pathForShard:shardName]];
+        [_shards setObject:shard forKey:shardName];
+    }
+    return shard;
+}
+
+-(BOOL)_openShard:(RHSQLiteShard*)shard{
+    if ([shard databaseQueue]) return YES;
+    if ([self isReadOnly]) return NO;
+    
+    FMDatabaseQueue *databaseQueue = [self _newDatabaseQueueWithPath:[shard path]];
+    if (!databaseQueue){
+        RHErrorLog(@"Error: Failed to open shard %@ with path %@.", [shard name], [shard path]);
+        return NO;
+    }
+    
+    //our instrumentation covers every connection
+    RHSQLiteChangeTracker *changeTracker = _changeTracker;
+    RHSQLiteSlowQueryLog *slowQueryLog = _slowQueryLog;
+    [databaseQueue inDatabase:^(FMDatabase *db) {
+        [changeTracker attachToDatabase:db];
+        [changeTracker hasExternalChangesInDatabase:db];
+        [slowQueryLog attachToDatabase:db];
+    }];
+    
+    [shard setDatabaseQueue:databaseQueue];
+    return YES;
+}
+
+-(NSUInteger)_schemaVersionForShard:(RHSQLiteShard*)shard{
+    __block NSUInteger version = 0;
+    
+    if ([self isReadOnly]){
+        //a short lived connection of our own, our readers may not have it attached yet
+        FMDatabase *db = [FMDatabase databaseWithPath:[shard path]];
+        if (![db openWithFlags:SQLITE_OPEN_READONLY]) return version;
+        version = [shard schemaVersionInDatabase:db];
+        [db close];
+        return version;
+    }
+    
+    if (![self _openShard:shard]) return version;
+    [[shard databaseQueue] inDatabase:^(FMDatabase *db) {
+        version = [shard schemaVersionInDatabase:db];
+    }];
+    return version;
+}
+
+-(BOOL)_loadShards{
+    if ([_shards count] < 1 || _shardsAttached) return YES;
+    
+    //each shard migrates on its own connection, against its own schema_version
+    for (RHSQLiteShard *shard in [_shards allValues]) {
+        NSUInteger currentVersion = [self _schemaVersionForShard:shard];
+        NSUInteger maxVersion = [[shard registeredMigrations] count];
+        
+        if ([self isReadOnly]){
+            if (currentVersion < maxVersion) RHErrorLog(@"Warning: Skipping required migrations for shard %@ of read only data store %@.", [shard name], _path);
+            continue;
+        }
+        if (![self _openShard:shard]) return NO;
+        
+        while (currentVersion < maxVersion){
+            NSUInteger nextRequiredMigration = currentVersion + 1;
+            if (![self _performMigration:[[shard registeredMigrations] objectAtIndex:currentVersion] toSchemaVersion:nextRequiredMigration shard:shard]){
+                RHErrorLog(@"Error: failed to perform migration of shard %@ from schema %lu to %lu.", [shard name], (unsigned long)currentVersion, (unsigned long)nextRequiredMigration);
+                return NO;
+            }
+            currentVersion = nextRequiredMigration;
+        }
+    }
+    
+    //attach every shard to our main connection, so queries and raw sql see every table by name
+    if ([self isReadOnly]){
+        //connections opened before now don't have the shards attached. idle ones are closed now, checked out ones as they are returned
+        _shardsAttached = YES;
+        [self _resetReaderPools];
+    } else {
+        __block BOOL result = YES;
+        [_databaseQueue inDatabase:^(FMDatabase *db) {
+            for (RHSQLiteShard *shard in [_shards allValues]) {
+                if (![shard attachToDatabase:db immutable:NO]) result = NO;
+            }
+        }];
+        if (!result) return NO;
+        _shardsAttached = YES;
+    }
+    
+    //tables found in a shards file belong to it, assigned or not
+    NSMutableDictionary *foundShardNamesByTableName = [NSMutableDictionary dictionary];
+    [self accessDatabase:^(FMDatabase *db) {
+        for (RHSQLiteShard *shard in [_shards allValues]) {
+            for (NSString *tableName in [shard tableNamesInAttachedDatabase:db]) {
+                [foundShardNamesByTableName setObject:[shard name] forKey:tableName];
+            }
+        }
+    }];
+    
+    for (NSString *tableName in [_shardNamesByTableName allKeys]) {
+        if ([[foundShardNamesByTableName objectForKey:tableName] isEqualToString:[_shardNamesByTableName objectForKey:tableName]]) continue;
+        RHErrorLog(@"Warning: Table '%@' is assigned to shard %@ but was not found in its file. Sharded tables should be created by their shards migrations.", tableName, [_shardNamesByTableName objectForKey:tableName]);
+    }
+    [_shardNamesByTableName addEntriesFromDictionary:foundShardNamesByTableName];
+    
+    return YES;
+}
+
 
 #pragma mark - generic db type info
 -(NSArray*)columnNamesForTable:(NSString*)tableName{
-    NSArray* columnNames = [_cachedTableColumnNames objectForKey:tableName];
+    NSArray* columnNames = nil;
+    @synchronized(_cachedTableColumnNames){
+        columnNames = [_cachedTableColumnNames objectForKey:tableName];
+    }
     if (columnNames) return columnNames;
     
-    NSMutableArray *mutableResults = [NSMutableArray array];
+    __block NSArray *results = nil;
     [self accessDatabase:^(FMDatabase *db) {
-        NSString *sql = [NSString stringWithFormat:@"PRAGMA table_info(`%@`)", tableName];
-        FMResultSet *resultSet = [db executeQuery:sql];
-        while ([resultSet next]) {
-            NSString *name = [resultSet stringForColumn:@"name"];
-            if (name) [mutableResults addObject:name];
-        }
-        [resultSet close];
+        results = [self _columnNamesForTable:tableName inDatabase:db];
     }];
     
+    return results;
+}
+
+-(NSArray*)_columnNamesForTable:(NSString*)tableName inDatabase:(FMDatabase*)db{
+    NSArray* columnNames = nil;
+    @synchronized(_cachedTableColumnNames){
+        columnNames = [_cachedTableColumnNames objectForKey:tableName];
+    }
+    if (columnNames) return columnNames;
+
+    NSMutableArray *mutableResults = [NSMutableArray array];
+    NSString *sql = [NSString stringWithFormat:@"PRAGMA table_info(`%@`)", tableName];
+    FMResultSet *resultSet = [db executeQuery:sql];
+    while ([resultSet next]) {
+        NSString *name = [resultSet stringForColumn:@"name"];
+        if (name) [mutableResults addObject:name];
+    }
+    [resultSet close];
+    
     NSArray *results = [NSArray arrayWithArray:mutableResults];
-    [_cachedTableColumnNames setObject:results forKey:tableName];
+    @synchronized(_cachedTableColumnNames){
+        [_cachedTableColumnNames setObject:results forKey:tableName];
+    }
     return results;
 }
 
 -(void)_invalidateCachedColumnNamesForTable:(NSString*)tableName{
-    [_cachedTableColumnNames removeObjectForKey:tableName];
+    @synchronized(_cachedTableColumnNames){
+        [_cachedTableColumnNames removeObjectForKey:tableName];
+    }
+    @synchronized(_cachedRowLayouts){
+        [_cachedRowLayouts removeObjectForKey:tableName];
+    }
+}
+
+-(RHSQLiteRowLayout*)_rowLayoutForTable:(NSString*)tableName{
+    if (!tableName) return nil;
+    RHSQLiteRowLayout *layout = nil;
+    @synchronized(_cachedRowLayouts){
+        layout = [_cachedRowLayouts objectForKey:tableName];
+    }
+    if (layout) return layout;
+    
+    NSArray *columnNames = [self columnNamesForTable:tableName];
+    if ([columnNames count] < 1) return nil;
+    
+    layout = [[RHSQLiteRowLayout alloc] initWithColumnNames:columnNames];
+    @synchronized(_cachedRowLayouts){
+        //if another thread beat us to it, use theirs so that everyone shares the same layout
+        RHSQLiteRowLayout *existing = [_cachedRowLayouts objectForKey:tableName];
+        if (existing) return existing;
+        [_cachedRowLayouts setObject:layout forKey:tableName];
+    }
+    return layout;
 }
 
 -(NSString*)columnTypeForTable:(NSString*)tableName andColumn:(NSString*)columnName{
@@ -503,29 +1756,65 @@
 
 }
 
+-(NSString*)schemaHashForTable:(NSString*)tableName{
+    __block NSMutableString *description = nil;
+    [self accessDatabase:^(FMDatabase *db) {
+        NSString *sql = [NSString stringWithFormat:@"PRAGMA table_info(`%@`)", tableName];
+        FMResultSet *resultSet = [db executeQuery:sql];
+        while ([resultSet next]) {
+            if (!description) description = [NSMutableString string];
+            NSString *type = [[resultSet stringForColumn:@"type"] uppercaseString];
+            [description appendFormat:@"%@|%@|%i|%i\n", [resultSet stringForColumn:@"name"], type ? type : @"", [resultSet intForColumn:@"notnull"], [resultSet intForColumn:@"pk"]];
+        }
+        [resultSet close];
+    }];
+    if (!description) return nil;
+    
+    //64 bit FNV-1a, stable across runs and platforms, unlike -hash
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    const unsigned char *bytes = (const unsigned char *)[description UTF8String];
+    while (*bytes) {
+        hash ^= *bytes++;
+        hash *= 0x100000001b3ULL;
+    }
+    return [NSString stringWithFormat:@"%016llx", (unsigned long long)hash];
+}
+
 
 #pragma mark - metadata
 -(BOOL)_metadataTableExists{
     __block BOOL result = NO;
     [self accessDatabase:^(FMDatabase *db) {
-        NSString *sql = [NSString stringWithFormat:@"SELECT count(name) as `count` FROM `sqlite_master` WHERE `type` = 'table' AND `name` = '%@';", RHSQLiteDataStoreMetadataTableName];
-        FMResultSet *resultSet = [db executeQuery:sql];
-        while ([resultSet next]){
-            result = [resultSet longForColumn:@"count"] > 0;
-        }
-        [resultSet close];
+        result = [self _metadataTableExistsInDatabase:db];
     }];
     return result;
 }
 
+-(BOOL)_metadataTableExistsInDatabase:(FMDatabase*)db{
+    BOOL result = NO;
+    NSString *sql = [NSString stringWithFormat:@"SELECT count(name) as `count` FROM `sqlite_master` WHERE `type` = 'table' AND `name` = '%@';", RHSQLiteDataStoreMetadataTableName];
+    FMResultSet *resultSet = [db executeQuery:sql];
+    while ([resultSet next]){
+        result = [resultSet longForColumn:@"count"] > 0;
+    }
+    [resultSet close];
+    return result;
+}
+
 -(BOOL)_metadataCreateTable{
-    if ([self _metadataTableExists]) return YES;
     __block BOOL result = NO;
     [self accessDatabase:^(FMDatabase *db) {
-        NSString *sql = [NSString stringWithFormat:@"CREATE TABLE '%@' ( 'id' INTEGER PRIMARY KEY ON CONFLICT REPLACE AUTOINCREMENT);", RHSQLiteDataStoreMetadataTableName];
-        result = [db executeUpdate:sql];
-        if (result) result = [db executeUpdate:[NSString stringWithFormat:@"INSERT INTO `%@` VALUES(1);", RHSQLiteDataStoreMetadataTableName]];
+        result = [self _metadataCreateTableInDatabase:db];
     }];
+    return result;
+}
+
+-(BOOL)_metadataCreateTableInDatabase:(FMDatabase*)db{
+    if ([self _metadataTableExistsInDatabase:db]) return YES;
+    NSString *sql = [NSString stringWithFormat:@"CREATE TABLE '%@' ( 'id' INTEGER PRIMARY KEY ON CONFLICT REPLACE AUTOINCREMENT);", RHSQLiteDataStoreMetadataTableName];
+    BOOL result = [db executeUpdate:sql];
+    if (result) result = [db executeUpdate:[NSString stringWithFormat:@"INSERT INTO `%@` VALUES(1);", RHSQLiteDataStoreMetadataTableName]];
+    [self _invalidateCachedColumnNamesForTable:RHSQLiteDataStoreMetadataTableName];
     RHLog(@"Creating metadata table. Result:%i.", result);
     return result;
 }
@@ -534,19 +1823,19 @@
     return [[self columnNamesForTable:RHSQLiteDataStoreMetadataTableName] containsObject:columnName];
 }
 
--(BOOL)_metadataCreateColumn:(NSString*)columnName forStorageOfValue:(id)value{
-    if ([self _metadataColumnExists:columnName]) return YES;
-    __block BOOL result = NO;
-    [self accessDatabase:^(FMDatabase *db) {
-        NSString *sql = [NSString stringWithFormat:@"ALTER TABLE `%@` ADD COLUMN '%@' %@;", RHSQLiteDataStoreMetadataTableName, columnName, [self requiredColumnTypeForObject:value]];
-        result = [db executeUpdate:sql];
-    }];
+-(BOOL)_metadataCreateColumn:(NSString*)columnName forStorageOfValue:(id)value inDatabase:(FMDatabase*)db{
+    if ([[self _columnNamesForTable:RHSQLiteDataStoreMetadataTableName inDatabase:db] containsObject:columnName]) return YES;
+    NSString *sql = [NSString stringWithFormat:@"ALTER TABLE `%@` ADD COLUMN '%@' %@;", RHSQLiteDataStoreMetadataTableName, columnName, [self requiredColumnTypeForObject:value]];
+    BOOL result = [db executeUpdate:sql];
     RHLog(@"Creating metadata column %@. Result:%i.", columnName, result);
     [self _invalidateCachedColumnNamesForTable:RHSQLiteDataStoreMetadataTableName];
     return result;
 }
 
 -(id)_metadataValueForKey:(NSString*)columnName{
+    //once loaded, the metadata row is cached and kept up to date by _metadataSetValue:
+    if (_cachedMetadataValues) return [_cachedMetadataValues objectForKey:columnName];
+    
     if (![self _metadataColumnExists:columnName]) return nil;
     __block id result = nil;
     [self accessDatabase:^(FMDatabase *db) {
@@ -561,15 +1850,21 @@
 }
 
 -(void)_metadataSetValue:(id)object forKey:(NSString*)columnName{
-    if (![self _metadataTableExists]) [self _metadataCreateTable];
-    if (![self _metadataColumnExists:columnName]) [self _metadataCreateColumn:columnName forStorageOfValue:object];
-    __block BOOL result = NO;
+    REQUIRE_WRITABLE();
     [self accessDatabase:^(FMDatabase *db) {
-        NSString *sql = [NSString stringWithFormat:@"UPDATE `%@` SET `%@` = ? where `id` = 1;", RHSQLiteDataStoreMetadataTableName, columnName];
-        result = [db executeUpdate:sql, object];
+        [self _metadataSetValue:object forKey:columnName inDatabase:db];
     }];
+}
+
+-(BOOL)_metadataSetValue:(id)object forKey:(NSString*)columnName inDatabase:(FMDatabase*)db{
+    if (![self _metadataCreateTableInDatabase:db]) return NO;
+    if (![self _metadataCreateColumn:columnName forStorageOfValue:object inDatabase:db]) return NO;
+    NSString *sql = [NSString stringWithFormat:@"UPDATE `%@` SET `%@` = ? where `id` = 1;", RHSQLiteDataStoreMetadataTableName, columnName];
+    BOOL result = [db executeUpdate:sql, object];
     RHLog(@"Setting metadata column %@ to value %@. Result:%i.", columnName, object, result);
-    
+    if (result && object) [_cachedMetadataValues setObject:object forKey:columnName];
+    if (result && !object) [_cachedMetadataValues removeObjectForKey:columnName];
+    return result;
 }
 
 
@@ -578,7 +1873,7 @@
 -(NSMutableDictionary*)_weakObjectCacheForTable:(NSString*)tableName{
     REQUIRE_LOADED(); ENSURE_KNOWN_TABLE(tableName);
 
-    //TODO: MAKE THREAD SAFE
+    //callers must hold the @synchronized(_perTableWeakObjectCaches) lock while using the returned cache
     NSMutableDictionary *cache = [_perTableWeakObjectCaches objectForKey:tableName];
     
     if (!cache){
@@ -597,11 +1892,15 @@
     if (objectID == RHSQLiteObjectIDInvalid) return nil;
     if (objectID == RHSQLiteObjectIDNotYetAvailable) return nil;
     
-    NSMutableDictionary *cache = [self _weakObjectCacheForTable:tableName];
-    RHWeakValue *value = [cache objectForKey:[NSNumber numberWithLongLong:objectID]];
-    RHSQLiteObject *sqLiteObject = [value weakValue];
-    if (sqLiteObject.objectID != objectID) return nil;
+    RHSQLiteObject *sqLiteObject = nil;
+    @synchronized(_perTableWeakObjectCaches){
+        NSMutableDictionary *cache = [self _weakObjectCacheForTable:tableName];
+        RHWeakValue *value = [cache objectForKey:[NSNumber numberWithLongLong:objectID]];
+        sqLiteObject = [value weakValue];
+    }
+    if (sqLiteObject.objectID != objectID) sqLiteObject = nil;
     
+    [_metrics recordIdentityCacheHit:sqLiteObject != nil];
     return sqLiteObject;
 }
 
@@ -615,13 +1914,27 @@
 
     RHSQLiteObject *strongObject = object; //keep it around for a while
     
-    //TODO: this is not currently thread safe. likely a good idea to make this thread safe at some point
-    
     if (strongObject.objectID != RHSQLiteObjectIDInvalid && strongObject.objectID != RHSQLiteObjectIDNotYetAvailable){
         NSString *table = [strongObject tableName];
-        NSMutableDictionary *cache = [self _weakObjectCacheForTable:table];
-        [cache setObject:[RHWeakValue weakValueWithObject:strongObject] forKey:[NSNumber numberWithLongLong:strongObject.objectID]];
+        @synchronized(_perTableWeakObjectCaches){
+            NSMutableDictionary *cache = [self _weakObjectCacheForTable:table];
+            [cache setObject:[RHWeakValue weakValueWithObject:strongObject] forKey:[NSNumber numberWithLongLong:strongObject.objectID]];
+        }
+    }
+}
+
+-(RHSQLiteObject*)_objectCheckInUnlessCached:(RHSQLiteObject*)object{
+    if (!object) return nil;
+    
+    NSNumber *key = [NSNumber numberWithLongLong:object.objectID];
+    @synchronized(_perTableWeakObjectCaches){
+        NSMutableDictionary *cache = [self _weakObjectCacheForTable:[object tableName]];
+        RHSQLiteObject *cachedObject = [(RHWeakValue*)[cache objectForKey:key] weakValue];
+        if (cachedObject && cachedObject.objectID == object.objectID) return cachedObject;
+        
+        [cache setObject:[RHWeakValue weakValueWithObject:object] forKey:key];
     }
+    return object;
 }
 
 -(void)_objectCheckOut:(RHSQLiteObject*)object{
@@ -633,9 +1946,665 @@
     __unsafe_unretained __block RHSQLiteObject *safeObject = object;
     
     NSString *table = [safeObject tableName];
-    NSMutableDictionary *cache = [self _weakObjectCacheForTable:table];
-    [cache removeObjectForKey:[NSNumber numberWithLongLong:safeObject.objectID]];
+    NSNumber *key = [NSNumber numberWithLongLong:safeObject.objectID];
+    @synchronized(_perTableWeakObjectCaches){
+        NSMutableDictionary *cache = [self _weakObjectCacheForTable:table];
+        //another thread may already have checked in a replacement object for this ID, only remove our own (now nil) entry
+        if (![(RHWeakValue*)[cache objectForKey:key] weakValue]) [cache removeObjectForKey:key];
+    }
+    
+}
+
+
+#pragma mark - metrics
+-(BOOL)isMetricsEnabled{
+    return _metrics != nil;
+}
+
+-(void)setMetricsEnabled:(BOOL)metricsEnabled{
+    if (metricsEnabled == [self isMetricsEnabled]) return;
+    _metrics = metricsEnabled ? [[RHSQLiteDataStoreMetrics alloc] init] : nil;
+}
+
+-(RHSQLiteDataStoreMetrics*)_metrics{
+    return _metrics;
+}
+
+-(NSDictionary*)metricsSnapshot{
+    RHSQLiteDataStoreMetrics *metrics = _metrics;
+    if (!metrics) return nil;
+    
+    NSUInteger cachedObjects = 0;
+    @synchronized(_perTableWeakObjectCaches){
+        for (NSDictionary *cache in [_perTableWeakObjectCaches allValues]) {
+            cachedObjects += [cache count];
+        }
+    }
+    
+    NSMutableDictionary *snapshot = [[metrics snapshot] mutableCopy];
+    NSMutableDictionary *identityCache = [[snapshot objectForKey:@"identity_cache"] mutableCopy];
+    [identityCache setObject:[NSNumber numberWithUnsignedInteger:cachedObjects] forKey:@"size"];
+    [snapshot setObject:identityCache forKey:@"identity_cache"];
+    return [NSDictionary dictionaryWithDictionary:snapshot];
+}
+
+-(void)resetMetrics{
+    [_metrics reset];
+}
+
+-(void)exportMetrics{
+    NSDictionary *snapshot = [self metricsSnapshot];
+    id <RHSQLiteDataStoreMetricsSink> sink = _metricsSink;
+    if (snapshot && [sink respondsToSelector:@selector(dataStore:didExportMetricsSnapshot:)]){
+        [sink dataStore:self didExportMetricsSnapshot:snapshot];
+    }
+}
+
+
+#pragma mark - slow query log
+-(NSTimeInterval)slowQueryThreshold{
+    return [_slowQueryLog threshold];
+}
+
+-(void)setSlowQueryThreshold:(NSTimeInterval)slowQueryThreshold{
+    if (!_slowQueryLog){
+        if (slowQueryThreshold <= 0.0) return;
+        
+        RHSQLiteSlowQueryLog *slowQueryLog = [[RHSQLiteSlowQueryLog alloc] init];
+        [_databaseQueue inDatabase:^(FMDatabase *db) {
+            [slowQueryLog attachToDatabase:db];
+        }];
+        for (FMDatabaseQueue *databaseQueue in [self _shardDatabaseQueues]) {
+            [databaseQueue inDatabase:^(FMDatabase *db) {
+                [slowQueryLog attachToDatabase:db];
+            }];
+        }
+        _slowQueryLog = slowQueryLog;
+        
+        //readers attach as they are opened, so start afresh
+        [self _resetReaderPools];
+    }
+    
+    [_slowQueryLog setThreshold:MAX(slowQueryThreshold, 0.0)];
+}
+
+-(void)_detachSlowQueryLogFromDatabaseQueue:(FMDatabaseQueue*)databaseQueue{
+    RHSQLiteSlowQueryLog *slowQueryLog = _slowQueryLog;
+    if (!slowQueryLog || !databaseQueue) return;
+    [databaseQueue inDatabase:^(FMDatabase *db) {
+        [slowQueryLog detachFromDatabase:db];
+    }];
+}
+
+-(NSArray*)slowQueryReport{
+    return _slowQueryLog ? [_slowQueryLog report] : [NSArray array];
+}
+
+-(void)resetSlowQueryLog{
+    [_slowQueryLog reset];
+}
+
+
+#pragma mark - change tracking
+-(BOOL)isChangeTrackingEnabled{
+    return _changeTracker != nil;
+}
+
+-(void)setChangeTrackingEnabled:(BOOL)changeTrackingEnabled{
+    if ([self isReadOnly]) return; //immutable files never change
+    
+    //the same lock as our observer list, adding observers from several threads at once enables us lazily
+    @synchronized(_changeObservers){
+        [self _setChangeTrackingEnabled:changeTrackingEnabled];
+    }
+}
+
+-(void)_setChangeTrackingEnabled:(BOOL)changeTrackingEnabled{
+    if (changeTrackingEnabled == [self isChangeTrackingEnabled]) return;
+    
+    if (changeTrackingEnabled){
+        RHSQLiteChangeTracker *changeTracker = [[RHSQLiteChangeTracker alloc] initWithIgnoredTableNames:[NSSet setWithObject:RHSQLiteDataStoreMetadataTableName]];
+        NSMutableArray *databaseQueues = [NSMutableArray arrayWithObject:_databaseQueue];
+        [databaseQueues addObjectsFromArray:[self _shardDatabaseQueues]];
+        for (FMDatabaseQueue *databaseQueue in databaseQueues) {
+            [databaseQueue inDatabase:^(FMDatabase *db) {
+                [changeTracker attachToDatabase:db];
+                [changeTracker hasExternalChangesInDatabase:db]; //records the current data_version
+            }];
+        }
+        _changeTracker = changeTracker;
+    } else {
+        RHSQLiteChangeTracker *changeTracker = _changeTracker;
+        _changeTracker = nil;
+        NSMutableArray *databaseQueues = [NSMutableArray arrayWithObject:_databaseQueue];
+        [databaseQueues addObjectsFromArray:[self _shardDatabaseQueues]];
+        for (FMDatabaseQueue *databaseQueue in databaseQueues) {
+            [databaseQueue inDatabase:^(FMDatabase *db) {
+                [changeTracker detachFromDatabase:db];
+            }];
+        }
+    }
+}
+
+-(id)addObserverForTable:(NSString*)tableName queue:(NSOperationQueue*)queue usingBlock:(void (^)(RHSQLiteChangeSet *changes))block{
+    if (!block)[NSException raise:NSInvalidArgumentException format:@"Error: block is required by %@.", NSStringFromSelector(_cmd)];
+    [self setChangeTrackingEnabled:YES];
+    
+    RHSQLiteChangeObserver *observer = [[RHSQLiteChangeObserver alloc] initWithTableName:tableName queue:queue block:block];
+    @synchronized(_changeObservers){
+        [_changeObservers addObject:observer];
+    }
+    return observer;
+}
+
+-(id)addObserverForQuery:(RHSQLiteObjectQuery*)query queue:(NSOperationQueue*)queue usingBlock:(void (^)(RHSQLiteChangeSet *changes, NSArray *objectIDs))block{
+    if (!block || !query)[NSException raise:NSInvalidArgumentException format:@"Error: query and block are required by %@.", NSStringFromSelector(_cmd)];
+    REQUIRE_LOADED();
+    [self setChangeTrackingEnabled:YES];
+    
+    RHSQLiteChangeObserver *observer = [[RHSQLiteChangeObserver alloc] initWithQuery:query objectIDs:[self objectIDsMatchingQuery:query] queue:queue block:block];
+    @synchronized(_changeObservers){
+        [_changeObservers addObject:observer];
+    }
+    return observer;
+}
+
+-(void)removeChangeObserver:(id)observer{
+    if (!observer) return;
+    @synchronized(_changeObservers){
+        [_changeObservers removeObjectIdenticalTo:observer];
+    }
+}
+
+-(void)_deliverCommittedChangesExcludingObjects:(NSArray*)objects{
+    RHSQLiteChangeSet *changeSet = [_changeTracker takeCommittedChanges];
+    if (changeSet) [self _processChangeSet:changeSet excludingObjects:objects];
+}
+
+-(void)_processChangeSet:(RHSQLiteChangeSet*)changeSet excludingObjects:(NSArray*)excludedObjects{
+    //flag any live objects for the changed rows. the objects that made the changes have already dealt with them.
+    if (_loaded){
+        NSMutableArray *updatedObjects = [NSMutableArray array];
+        NSMutableArray *deletedObjects = [NSMutableArray array];
+        BOOL external = [changeSet isExternal];
+        
+        @synchronized(_perTableWeakObjectCaches){
+            NSArray *tableNames = external ? [_perTableWeakObjectCaches allKeys] : [changeSet tableNames];
+            for (NSString *tableName in tableNames) {
+                NSDictionary *cache = [_perTableWeakObjectCaches objectForKey:tableName];
+                if ([cache count] < 1) continue;
+                
+                //walk whichever of the cache and the changes is smaller
+                NSArray *changedObjectIDs = external ? nil : [changeSet changedObjectIDsInTable:tableName];
+                NSArray *objectIDs = (external || [cache count] < [changedObjectIDs count]) ? [cache allKeys] : changedObjectIDs;
+                
+                for (NSNumber *objectID in objectIDs) {
+                    RHSQLiteChangeType change = external ? RHSQLiteChangeTypeUpdate : [changeSet changeTypeForObjectID:[objectID longLongValue] inTable:tableName];
+                    if (change == RHSQLiteChangeTypeNone) continue;
+                    
+                    RHSQLiteObject *object = [(RHWeakValue*)[cache objectForKey:objectID] weakValue];
+                    if (!object || [excludedObjects indexOfObjectIdenticalTo:object] != NSNotFound) continue;
+                    [(change == RHSQLiteChangeTypeDelete ? deletedObjects : updatedObjects) addObject:object];
+                }
+            }
+        }
+        
+        [updatedObjects makeObjectsPerformSelector:@selector(_rowWasUpdated)];
+        [deletedObjects makeObjectsPerformSelector:@selector(_rowWasDeleted)];
+    }
+    
+    NSArray *observers = nil;
+    @synchronized(_changeObservers){
+        observers = [NSArray arrayWithArray:_changeObservers];
+    }
+    for (RHSQLiteChangeObserver *observer in observers) {
+        [observer dataStore:self didCommitChanges:changeSet];
+    }
+    
+    [[NSNotificationCenter defaultCenter] postNotificationName:RHSQLiteDataStoreDidChangeNotification object:self userInfo:[NSDictionary dictionaryWithObject:changeSet forKey:RHSQLiteDataStoreChangeSetKey]];
+}
+
+-(BOOL)checkForExternalChanges{
+    RHSQLiteChangeTracker *changeTracker = _changeTracker;
+    if (!changeTracker) return NO;
+    
+    //each shard on its own connection, writes from our other connections would look external through an ATTACH
+    __block BOOL changed = NO;
+    for (FMDatabaseQueue *databaseQueue in [self _shardDatabaseQueues]) {
+        [databaseQueue inDatabase:^(FMDatabase *db) {
+            if ([changeTracker hasExternalChangesInDatabase:db]) changed = YES;
+        }];
+    }
+    
+    __block int64_t schemaCookie = 0;
+    int64_t knownSchemaCookie = _schemaCookie;
+    [self accessDatabase:^(FMDatabase *db) {
+        if ([changeTracker hasExternalChangesInDatabase:db]) changed = YES;
+        if (changed) schemaCookie = [self _schemaCookieInDatabase:db];
+        
+        //tables may have come or gone, read them on this same connection while we are here
+        if (changed && schemaCookie != knownSchemaCookie) [self _populateKnownTableNamesInDatabase:db];
+    }];
+    if (!changed) return NO;
+    
+    RHLog(@"Detected external changes to %@.", _path);
+    
+    //someone else changed the schema, so our column names and layouts may be stale too
+    if (schemaCookie != knownSchemaCookie){
+        @synchronized(_cachedTableColumnNames){
+            [_cachedTableColumnNames removeAllObjects];
+        }
+        @synchronized(_cachedRowLayouts){
+            [_cachedRowLayouts removeAllObjects];
+        }
+        _schemaCookie = schemaCookie;
+    }
+    
+    [self _processChangeSet:[RHSQLiteChangeSet externalChangeSet] excludingObjects:nil];
+    return YES;
+}
+
+-(NSTimeInterval)externalChangeCheckInterval{
+    return _externalChangeCheckInterval;
+}
+
+-(void)setExternalChangeCheckInterval:(NSTimeInterval)externalChangeCheckInterval{
+    @synchronized(self){
+        [self _cancelExternalChangeTimer];
+        _externalChangeCheckInterval = MAX(externalChangeCheckInterval, 0.0);
+        if (_externalChangeCheckInterval <= 0.0 || [self isReadOnly]) return;
+        
+        [self setChangeTrackingEnabled:YES];
+        
+        //the timer must not keep us alive
+        __weak RHSQLiteDataStore *weakSelf = self;
+        uint64_t interval = (uint64_t)(_externalChangeCheckInterval * NSEC_PER_SEC);
+        dispatch_source_t timer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_LOW, 0));
+        dispatch_source_set_timer(timer, dispatch_time(DISPATCH_TIME_NOW, (int64_t)interval), interval, interval / 10);
+        dispatch_source_set_event_handler(timer, ^{
+            [weakSelf checkForExternalChanges];
+        });
+        dispatch_resume(timer);
+        _externalChangeTimer = timer;
+    }
+}
+
+-(void)_cancelExternalChangeTimer{
+    if (!_externalChangeTimer) return;
+    dispatch_source_cancel(_externalChangeTimer);
+#if !OS_OBJECT_USE_OBJC
+    dispatch_release(_externalChangeTimer);
+#endif
+    _externalChangeTimer = NULL;
+}
+
+
+#pragma mark - write behind
+-(RHSQLiteWriteBehindQueue*)_writeBehindQueue{
+    return _writeBehindQueue;
+}
+
+-(BOOL)isWriteBehindEnabled{
+    return _writeBehindQueue != nil;
+}
+
+-(NSTimeInterval)writeBehindInterval{
+    return _writeBehindInterval;
+}
+
+-(void)setWriteBehindInterval:(NSTimeInterval)writeBehindInterval{
+    @synchronized(self){
+        _writeBehindInterval = MAX(writeBehindInterval, 0.0);
+        if ([self isReadOnly]) return;
+        
+        if (_writeBehindInterval <= 0.0){
+            //disabling, everything queued goes now
+            RHSQLiteWriteBehindQueue *writeBehindQueue = _writeBehindQueue;
+            _writeBehindQueue = nil;
+            [writeBehindQueue flushWithError:NULL];
+            return;
+        }
+        
+        if (_writeBehindQueue){
+            [_writeBehindQueue setInterval:_writeBehindInterval];
+            return;
+        }
+        
+        //the writer must not keep us alive. once we are gone (ie our final flush from dealloc) it writes through the queue directly
+        __weak RHSQLiteDataStore *weakSelf = self;
+        FMDatabaseQueue *databaseQueue = _databaseQueue;
+        RHSQLiteWriteBehindWriter writer = ^(void (^block)(FMDatabase *db)) {
+            RHSQLiteDataStore *strongSelf = weakSelf;
+            if (strongSelf) [strongSelf _accessDatabaseForStatementKind:RHSQLiteStatementKindSave block:block];
+            else [databaseQueue inDatabase:block];
+        };
+        _writeBehindQueue = [[RHSQLiteWriteBehindQueue alloc] initWithWriter:writer interval:_writeBehindInterval batchSize:_writeBehindBatchSize capacity:_writeBehindCapacity];
+    }
+}
+
+-(NSUInteger)writeBehindBatchSize{
+    return _writeBehindBatchSize;
+}
+
+-(void)setWriteBehindBatchSize:(NSUInteger)writeBehindBatchSize{
+    _writeBehindBatchSize = writeBehindBatchSize > 0 ? writeBehindBatchSize : RHSQLiteDataStoreDefaultWriteBehindBatchSize;
+    [_writeBehindQueue setBatchSize:_writeBehindBatchSize];
+}
+
+-(NSUInteger)writeBehindCapacity{
+    return _writeBehindCapacity;
+}
+
+-(void)setWriteBehindCapacity:(NSUInteger)writeBehindCapacity{
+    _writeBehindCapacity = writeBehindCapacity > 0 ? writeBehindCapacity : RHSQLiteDataStoreDefaultWriteBehindCapacity;
+    [_writeBehindQueue setCapacity:_writeBehindCapacity];
+}
+
+-(NSUInteger)numberOfPendingWrites{
+    return [_writeBehindQueue numberOfPendingValues];
+}
+
+-(NSError*)lastWriteBehindError{
+    return [_writeBehindQueue lastError];
+}
+
+-(BOOL)flushPendingWrites{
+    return [self flushPendingWritesWithError:NULL];
+}
+
+-(BOOL)flushPendingWritesWithError:(NSError**)errorOut{
+    if (!_writeBehindQueue) return YES;
+    return [_writeBehindQueue flushWithError:errorOut];
+}
+
+-(BOOL)waitForPendingWritesToCommit{
+    if (!_writeBehindQueue) return YES;
+    return [_writeBehindQueue waitUntilCommitted];
+}
+
+
+#pragma mark - parallel scans
+-(NSArray*)objectsMatchingQueryInParallel:(RHSQLiteObjectQuery*)query{
+    NSString *tableName = [query.objectClass tableName];
+    REQUIRE_LOADED(); ENSURE_KNOWN_TABLE(tableName);
+    
+    NSArray *ranges = [self _scanRangesForQuery:query];
+    if (!ranges) return [self objectsMatchingQuery:query];
+    
+    NSMutableArray *objectsByRange = [NSMutableArray arrayWithCapacity:[ranges count]];
+    for (NSUInteger i = 0; i < [ranges count]; i++) {
+        [objectsByRange addObject:[NSNull null]];
+    }
+    
+    BOOL result = [self _scanQuery:query ranges:ranges usingBlock:^(NSArray *objects, NSUInteger range, NSUInteger rangeCount) {
+        @synchronized(objectsByRange){
+            [objectsByRange replaceObjectAtIndex:range withObject:objects];
+        }
+    }];
+    
+    if (!result){
+        RHErrorLog(@"Warning: Parallel scan of table: %@ failed, falling back to a serial query.", tableName);
+        return [self objectsMatchingQuery:query];
+    }
+    
+    //each range is already in the queries order, so descending queries just take the ranges last first
+    BOOL descending = [query orderedByColumnName] && ![query isAscending];
+    NSMutableArray *objects = [NSMutableArray array];
+    for (NSArray *rangeObjects in (descending ? [objectsByRange reverseObjectEnumerator] : [objectsByRange objectEnumerator])) {
+        [objects addObjectsFromArray:rangeObjects];
+    }
+    return [NSArray arrayWithArray:objects];
+}
+
+-(BOOL)enumerateObjectsMatchingQuery:(RHSQLiteObjectQuery*)query inParallelUsingBlock:(void (^)(NSArray *objects, NSUInteger range, NSUInteger rangeCount))block{
+    NSString *tableName = [query.objectClass tableName];
+    REQUIRE_LOADED(); ENSURE_KNOWN_TABLE(tableName);
+    if (!block)[NSException raise:NSInvalidArgumentException format:@"Error: block is required by %@.", NSStringFromSelector(_cmd)];
+    
+    NSArray *ranges = [self _scanRangesForQuery:query];
+    if (!ranges){
+        block([self objectsMatchingQuery:query], 0, 1);
+        return YES;
+    }
+    
+    return [self _scanQuery:query ranges:ranges usingBlock:block];
+}
+
+-(NSUInteger)maximumScanConcurrency{
+    @synchronized(self){
+        return _maximumScanConcurrency;
+    }
+}
+
+-(void)setMaximumScanConcurrency:(NSUInteger)maximumScanConcurrency{
+    @synchronized(self){
+        _maximumScanConcurrency = MAX(maximumScanConcurrency, (NSUInteger)1);
+        [_scanReaderPool setMaximumCount:_maximumScanConcurrency];
+    }
+}
+
+-(int64_t)minimumScanPartitionSize{
+    return _minimumScanPartitionSize;
+}
+
+-(void)setMinimumScanPartitionSize:(int64_t)minimumScanPartitionSize{
+    _minimumScanPartitionSize = MAX(minimumScanPartitionSize, (int64_t)1);
+}
+
+-(RHSQLiteReaderPool*)_scanReaderPool{
+    @synchronized(self){
+        if (!_scanReaderPool){
+            _scanReaderPool = [self _newReaderPoolWithMaximumCount:_maximumScanConcurrency];
+        }
+        return _scanReaderPool;
+    }
+}
+
+-(NSArray*)_scanRangesForQuery:(RHSQLiteObjectQuery*)query{
+    NSString *tableName = [query.objectClass tableName];
+    NSString *primaryKeyName = [query.objectClass primaryKeyName];
+    
+    //each range reads on its own connection, so its own snapshot. only a file nobody writes to gives them all the same one.
+    //(sqlite3_snapshot_open could pin one, but needs SQLITE_ENABLE_SNAPSHOT, which neither the system sqlite nor ours can be relied on for)
+    if (![self isReadOnly]) return nil;
+    
+    //only queries whose ranges can be joined straight back together, decided by how the query was built rather than by reading its sql
+    if ([query customSQL]) return nil;
+    NSString *orderedBy = [query orderedByColumnName];
+    if (orderedBy && ![orderedBy isEqualToString:primaryKeyName]) return nil;
+    
+    //ranges need an integer key, which for our tables is the rowid
+    NSString *primaryKeyType = [self columnTypeForTable:tableName andColumn:primaryKeyName];
+    if (!primaryKeyType || [primaryKeyType caseInsensitiveCompare:@"INTEGER"] != NSOrderedSame) return nil;
+    
+    //min and max of the rowid are a single b-tree seek each, so this is cheap however large the table
+    RHSQLiteReaderPool *pool = [self _scanReaderPool];
+    FMDatabase *db = [pool checkOutDatabase];
+    if (!db) return nil;
+    
+    //the where is parenthesised into each ranges statement, so one that carries its own LIMIT, ORDER BY etc fails to prepare here and the query isn't split
+    FMResultSet *resultSet = [db executeQuery:[self _scanSQLForQuery:query], [NSNumber numberWithLongLong:1], [NSNumber numberWithLongLong:0]];
+    if (!resultSet){
+        RHLog(@"Not splitting query: %@, its where can't be scanned by range. Error: %@.", query, [db lastError]);
+        [pool checkInDatabase:db];
+        return nil;
+    }
+    [resultSet close];
+    
+    BOOL found = NO;
+    int64_t first = 0, last = 0;
+    resultSet = [db executeQuery:[NSString stringWithFormat:@"SELECT min(`%@`) AS `first`, max(`%@`) AS `last` FROM `%@`;", primaryKeyName, primaryKeyName, tableName]];
+    if ([resultSet next] && ![resultSet columnIsNull:@"first"]){
+        first = [resultSet longLongIntForColumn:@"first"];
+        last = [resultSet longLongIntForColumn:@"last"];
+        found = YES;
+    }
+    [resultSet close];
+    [pool checkInDatabase:db];
+    if (!found) return nil;
+    
+    //the key span stands in for the row count, so larger tables get more (up to RHSQLiteDataStoreScanRangesPerReader per reader) ranges
+    uint64_t span = (uint64_t)(last - first) + 1;
+    uint64_t rangeCount = MIN(span / (uint64_t)MAX(_minimumScanPartitionSize, (int64_t)1), (uint64_t)[self maximumScanConcurrency] * RHSQLiteDataStoreScanRangesPerReader);
+    if (rangeCount < 2) return nil;
+    
+    uint64_t rangeSize = span / rangeCount;
+    NSMutableArray *ranges = [NSMutableArray arrayWithCapacity:(NSUInteger)rangeCount];
+    for (uint64_t i = 0; i < rangeCount; i++) {
+        int64_t rangeFirst = first + (int64_t)(i * rangeSize);
+        int64_t rangeLast = (i == rangeCount - 1) ? last : rangeFirst + (int64_t)rangeSize - 1; //the last range takes the remainder
+        [ranges addObject:[NSArray arrayWithObjects:[NSNumber numberWithLongLong:rangeFirst], [NSNumber numberWithLongLong:rangeLast], nil]];
+    }
     
+    return ranges;
+}
+
+-(NSString*)_scanSQLForQuery:(RHSQLiteObjectQuery*)query{
+    NSString *tableName = [query.objectClass tableName];
+    NSString *primaryKeyName = [query.objectClass primaryKeyName];
+    NSString *where = [[query where] length] ? [NSString stringWithFormat:@" AND (%@)", [query where]] : @"";
+    BOOL descending = [query orderedByColumnName] && ![query isAscending];
+    return [NSString stringWithFormat:@"SELECT * FROM `%@` WHERE `%@` BETWEEN ? AND ?%@ ORDER BY `%@` %@;", tableName, primaryKeyName, where, primaryKeyName, descending ? @"DESC" : @"ASC"];
+}
+
+-(BOOL)_scanQuery:(RHSQLiteObjectQuery*)query ranges:(NSArray*)ranges usingBlock:(void (^)(NSArray *objects, NSUInteger range, NSUInteger rangeCount))block{
+    NSString *tableName = [query.objectClass tableName];
+    NSString *primaryKeyName = [query.objectClass primaryKeyName];
+    Class objectClass = [self objectClassForTable:tableName];
+    
+    //objects hydrate using the shared row layout, have it read (through our main connection) before the readers need it
+    if (![self _rowLayoutForTable:tableName]) return NO;
+    
+    NSString *sql = [self _scanSQLForQuery:query];
+    
+    RHSQLiteReaderPool *pool = [self _scanReaderPool];
+    RHSQLiteDataStoreMetrics *metrics = _metrics;
+    RHSQLiteSlowQueryLog *slowQueryLog = _slowQueryLog;
+    NSUInteger rangeCount = [ranges count];
+    NSObject *failedLock = [[NSObject alloc] init];
+    __block BOOL failed = NO;
+    
+    //the pool bounds how many ranges actually read at once, the rest wait for a connection
+    dispatch_apply(rangeCount, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t index) {
+        NSTimeInterval enqueued = metrics ? [NSDate timeIntervalSinceReferenceDate] : 0.0;
+        FMDatabase *db = [pool checkOutDatabase];
+        if (!db){
+            @synchronized(failedLock){ failed = YES; }
+            return;
+        }
+        NSTimeInterval started = metrics ? [NSDate timeIntervalSinceReferenceDate] : 0.0;
+        
+        NSArray *range = [ranges objectAtIndex:index];
+        NSMutableArray *objects = [NSMutableArray array];
+        BOOL result = YES;
+        @autoreleasepool {
+            FMResultSet *resultSet = [db executeQuery:sql, [range objectAtIndex:0], [range objectAtIndex:1]];
+            while ([resultSet next]) {
+                RHSQLiteObjectID objectID = [resultSet longLongIntForColumn:primaryKeyName];
+                //live objects belong to whichever thread is using them, so they are returned as is, just as objectsMatchingQuery: would
+                RHSQLiteObject *object = [self _cachedObjectForTable:tableName objectID:objectID];
+                if (!object){
+                    //new ones are loaded while only we can see them, then checked in. unless another thread got there first, in which case theirs wins
+                    RHSQLiteObject *newObject = [[objectClass alloc] _initUncachedWithDataStore:self objectID:objectID];
+                    [newObject _loadFromResultSet:resultSet];
+                    object = [self _objectCheckInUnlessCached:newObject];
+                }
+                [objects addObject:object];
+            }
+            if (!resultSet || [db hadError]){
+                RHErrorLog(@"Error: Parallel scan of table: %@ failed for range: %@ - %@. Error: %@.", tableName, [range objectAtIndex:0], [range objectAtIndex:1], [db lastError]);
+                result = NO;
+            }
+            [resultSet close];
+        }
+        
+        [slowQueryLog explainPendingStatementsInDatabase:db];
+        [pool checkInDatabase:db];
+        if (metrics) [self _recordStatementOfKind:RHSQLiteStatementKindQuery enqueued:enqueued started:started metrics:metrics];
+        
+        if (!result){
+            @synchronized(failedLock){ failed = YES; }
+            return;
+        }
+        block(objects, index, rangeCount);
+    });
+    
+    return !failed;
+}
+
+
+#pragma mark - maintenance
+-(NSTimeInterval)maintenanceInterval{
+    return [_maintenanceScheduler interval];
+}
+
+-(void)setMaintenanceInterval:(NSTimeInterval)maintenanceInterval{
+    [_maintenanceScheduler setInterval:maintenanceInterval];
+}
+
+-(NSTimeInterval)maintenanceTimeBudget{
+    return [_maintenanceScheduler timeBudget];
+}
+
+-(void)setMaintenanceTimeBudget:(NSTimeInterval)maintenanceTimeBudget{
+    [_maintenanceScheduler setTimeBudget:MAX(maintenanceTimeBudget, 0.0)];
+}
+
+-(NSUInteger)maintenanceVacuumPageBudget{
+    return [_maintenanceScheduler vacuumPageBudget];
+}
+
+-(void)setMaintenanceVacuumPageBudget:(NSUInteger)maintenanceVacuumPageBudget{
+    [_maintenanceScheduler setVacuumPageBudget:MAX(maintenanceVacuumPageBudget, (NSUInteger)1)];
+}
+
+-(RHSQLiteCheckpointMode)maintenanceCheckpointMode{
+    return [_maintenanceScheduler checkpointMode];
+}
+
+-(void)setMaintenanceCheckpointMode:(RHSQLiteCheckpointMode)maintenanceCheckpointMode{
+    [_maintenanceScheduler setCheckpointMode:maintenanceCheckpointMode];
+}
+
+-(NSTimeInterval)maintenanceOptimizeInterval{
+    return [_maintenanceScheduler optimizeInterval];
+}
+
+-(void)setMaintenanceOptimizeInterval:(NSTimeInterval)maintenanceOptimizeInterval{
+    [_maintenanceScheduler setOptimizeInterval:MAX(maintenanceOptimizeInterval, 0.0)];
+}
+
+-(NSUInteger)maintenanceAnalysisLimit{
+    return [_maintenanceScheduler analysisLimit];
+}
+
+-(void)setMaintenanceAnalysisLimit:(NSUInteger)maintenanceAnalysisLimit{
+    [_maintenanceScheduler setAnalysisLimit:maintenanceAnalysisLimit];
+}
+
+-(NSDictionary*)performMaintenance{
+    REQUIRE_LOADED(); REQUIRE_WRITABLE();
+    return [_maintenanceScheduler performMaintenance];
+}
+
+-(NSDictionary*)maintenanceReport{
+    return [_maintenanceScheduler report];
+}
+
+-(void)_accessEveryFileForMaintenance:(void (^)(FMDatabase *db, NSString *fileName))block{
+    //nothing until we have loaded, migrations may still be running
+    if (!_loaded) return;
+    
+    //housekeeping, so recorded as other. each file on its own connection, they are only ever maintained through those
+    [self _accessDatabaseForStatementKind:RHSQLiteStatementKindOther block:^(FMDatabase *db) {
+        block(db, @"main");
+    }];
+    for (RHSQLiteShard *shard in [_shards allValues]) {
+        if (![shard databaseQueue]) continue;
+        [self _accessDatabaseForStatementKind:RHSQLiteStatementKindOther queue:[shard databaseQueue] object:nil block:^(FMDatabase *db) {
+            block(db, [shard schemaName]);
+        }];
+    }
 }
 
 
@@ -645,6 +2614,8 @@
     if ([object isKindOfClass:[RHSQLiteObject class]]){
         [object associateWithDataStore:self];
         [object save];
+        //inside a unit of work save only marks the object, so a new one has no id for its placeholder yet
+        if ([object objectID] == RHSQLiteObjectIDNotYetAvailable) RHErrorLog(@"Error: Encoding %@ before it has been created, it will not be found when decoded. Create it with insertObject: first.", object);
         return [RHSQLiteObjectPlaceholder placeholderWithObject:object];
     }
     
@@ -664,7 +2635,7 @@
 
 #pragma mark - description
 -(NSString*)description{
-    return [NSString stringWithFormat:@"<%@: %p, path: %@, loaded: %i, tables: %@>", NSStringFromClass([self class]), self, _path, _loaded, _associatedClassNamesByTableName];
+    return [NSString stringWithFormat:@"<%@: %p, path: %@, loaded: %i, options: %@, tables: %@>", NSStringFromClass([self class]), self, _path, _loaded, _options, [self _classNamesByTableName]];
 }
 
 
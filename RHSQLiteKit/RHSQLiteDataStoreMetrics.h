@@ -0,0 +1,117 @@
+//
+//  RHSQLiteDataStoreMetrics.h
+//  RHSQLiteKit
+//
+//  Created by agent on 18/10/2026.
+//  Copyright (c) 2026 Richard Heard. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions
+//  are met:
+//  1. Redistributions of source code must retain the above copyright
+//  notice, this list of conditions and the following disclaimer.
+//  2. Redistributions in binary form must reproduce the above copyright
+//  notice, this list of conditions and the following disclaimer in the
+//  documentation and/or other materials provided with the distribution.
+//  3. The name of the author may not be used to endorse or promote products
+//  derived from this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+//  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+//  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+//  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+//  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+//  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#import <Foundation/Foundation.h>
+
+@class RHSQLiteDataStore;
+
+typedef enum {
+    RHSQLiteStatementKindLoad = 0,  //RHSQLiteObject -load
+    RHSQLiteStatementKindSave,      //RHSQLiteObject -save
+    RHSQLiteStatementKindCreate,    //RHSQLiteObject -create
+    RHSQLiteStatementKindDelete,    //RHSQLiteObject -delete
+    RHSQLiteStatementKindQuery,     //objectIDsMatchingQuery: and friends
+    RHSQLiteStatementKindMigration, //each schema migration, as a whole
+    RHSQLiteStatementKindOther,     //accessDatabase: blocks from outside the data store and internal housekeeping
+    RHSQLiteStatementKindCount
+} RHSQLiteStatementKind;
+
+extern NSString *RHSQLiteStatementKindName(RHSQLiteStatementKind kind); //"load", "save" etc.
+
+/*!
+ @protocol RHSQLiteDataStoreMetricsSink
+ @abstract Receives metrics from a data store, for export to whatever monitoring you already have.
+ @discussion Both methods are called synchronously on the thread that did the work, so keep them quick.
+ */
+@protocol RHSQLiteDataStoreMetricsSink <NSObject>
+@optional
+//called after every timed block, outside of the database queue. Useful for tracing.
+-(void)dataStore:(RHSQLiteDataStore*)dataStore didRecordStatementOfKind:(RHSQLiteStatementKind)kind queueWait:(NSTimeInterval)queueWait duration:(NSTimeInterval)duration;
+
+//called by -[RHSQLiteDataStore exportMetrics] with the current snapshot.
+-(void)dataStore:(RHSQLiteDataStore*)dataStore didExportMetricsSnapshot:(NSDictionary*)snapshot;
+@end
+
+
+#define RHSQLiteMetricsHistogramBucketCount 32 //log2 microseconds, so the last bucket starts at ~36 minutes
+
+typedef struct {
+    uint64_t count;
+    NSTimeInterval total;
+    NSTimeInterval max;
+    uint64_t buckets[RHSQLiteMetricsHistogramBucketCount];
+} RHSQLiteMetricsHistogram;
+
+/*!
+ @class RHSQLiteDataStoreMetrics
+ @abstract RHSQLiteDataStoreMetrics accumulates counters and latency histograms for a single data store.
+ @discussion You don't usually create these yourself, see -[RHSQLiteDataStore setMetricsEnabled:].
+    Latencies are kept in fixed log2 buckets, so percentiles are approximate (reported as the upper bound of their bucket) but recording is allocation free.
+ */
+@interface RHSQLiteDataStoreMetrics : NSObject {
+    NSTimeInterval _startTime;
+    
+    RHSQLiteMetricsHistogram _durations[RHSQLiteStatementKindCount];
+    RHSQLiteMetricsHistogram _queueWaits[RHSQLiteStatementKindCount];
+    
+    uint64_t _identityCacheHits;
+    uint64_t _identityCacheMisses;
+    
+    uint64_t _objectsEncoded;
+    uint64_t _bytesEncoded;
+    uint64_t _objectsDecoded;
+    uint64_t _bytesDecoded;
+    
+    uint64_t _rowsHydrated;
+}
+
+//recording
+-(void)recordStatementOfKind:(RHSQLiteStatementKind)kind queueWait:(NSTimeInterval)queueWait duration:(NSTimeInterval)duration;
+-(void)recordIdentityCacheHit:(BOOL)hit;
+-(void)recordEncodedBytes:(NSUInteger)length; //archived values only, strings, numbers and data are passed through untouched
+-(void)recordDecodedBytes:(NSUInteger)length;
+-(void)recordRowsHydrated:(NSUInteger)rows;
+
+/*!
+ @method snapshot
+ @abstract A property list copy of everything recorded since the last reset. Safe to call from any thread.
+ @discussion Keys:
+    interval            - seconds since the metrics were created or last reset
+    statements          - dictionary of kind name (see RHSQLiteStatementKindName()) to:
+                            count, total, max, p50, p90, p99 (execution time, seconds)
+                            queue_wait_total, queue_wait_max, queue_wait_p99 (time spent waiting for the database queue, seconds)
+    identity_cache      - hits, misses
+    codec               - objects_encoded, bytes_encoded, objects_decoded, bytes_decoded
+    rows_hydrated       - rows read into objects by -load
+ */
+-(NSDictionary*)snapshot;
+-(void)reset;
+
+@end
@@ -0,0 +1,192 @@
+//
+//  RHSQLiteDataStoreMetrics.m
+//  RHSQLiteKit
+//
+//  Created by agent on 18/10/2026.
+//  Copyright (c) 2026 Richard Heard. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions
+//  are met:
+//  1. Redistributions of source code must retain the above copyright
+//  notice, this list of conditions and the following disclaimer.
+//  2. Redistributions in binary form must reproduce the above copyright
+//  notice, this list of conditions and the following disclaimer in the
+//  documentation and/or other materials provided with the distribution.
+//  3. The name of the author may not be used to endorse or promote products
+//  derived from this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+//  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+//  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+//  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+//  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+//  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#import "RHSQLiteDataStoreMetrics.h"
+
+static inline NSUInteger RHSQLiteMetricsBucketForInterval(NSTimeInterval interval){
+    uint64_t micros = interval > 0 ? (uint64_t)(interval * 1000000.0) : 0;
+    NSUInteger bucket = 0;
+    while (micros > 0 && bucket < RHSQLiteMetricsHistogramBucketCount - 1){
+        micros >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+static inline void RHSQLiteMetricsHistogramRecord(RHSQLiteMetricsHistogram *histogram, NSTimeInterval interval){
+    histogram->count++;
+    histogram->total += interval;
+    if (interval > histogram->max) histogram->max = interval;
+    histogram->buckets[RHSQLiteMetricsBucketForInterval(interval)]++;
+}
+
+static NSTimeInterval RHSQLiteMetricsHistogramPercentile(const RHSQLiteMetricsHistogram *histogram, double percentile){
+    if (histogram->count == 0) return 0.0;
+    
+    uint64_t target = (uint64_t)ceil(histogram->count * percentile);
+    uint64_t seen = 0;
+    for (NSUInteger i = 0; i < RHSQLiteMetricsHistogramBucketCount; i++) {
+        seen += histogram->buckets[i];
+        if (seen >= target){
+            //upper bound of the bucket, never more than the largest value we actually saw
+            NSTimeInterval bound = (double)((uint64_t)1 << i) / 1000000.0;
+            return MIN(bound, histogram->max);
+        }
+    }
+    return histogram->max;
+}
+
+NSString *RHSQLiteStatementKindName(RHSQLiteStatementKind kind){
+    switch (kind) {
+        case RHSQLiteStatementKindLoad: return @"load";
+        case RHSQLiteStatementKindSave: return @"save";
+        case RHSQLiteStatementKindCreate: return @"create";
+        case RHSQLiteStatementKindDelete: return @"delete";
+        case RHSQLiteStatementKindQuery: return @"query";
+        case RHSQLiteStatementKindMigration: return @"migration";
+        case RHSQLiteStatementKindOther: return @"other";
+        default: return @"unknown";
+    }
+}
+
+
+@implementation RHSQLiteDataStoreMetrics
+
+-(id)init{
+    self = [super init];
+    if (self){
+        [self reset];
+    }
+    return self;
+}
+
+#pragma mark - recording
+-(void)recordStatementOfKind:(RHSQLiteStatementKind)kind queueWait:(NSTimeInterval)queueWait duration:(NSTimeInterval)duration{
+    if (kind >= RHSQLiteStatementKindCount) kind = RHSQLiteStatementKindOther;
+    @synchronized(self){
+        RHSQLiteMetricsHistogramRecord(&_durations[kind], duration);
+        RHSQLiteMetricsHistogramRecord(&_queueWaits[kind], queueWait);
+    }
+}
+
+-(void)recordIdentityCacheHit:(BOOL)hit{
+    @synchronized(self){
+        if (hit) _identityCacheHits++; else _identityCacheMisses++;
+    }
+}
+
+-(void)recordEncodedBytes:(NSUInteger)length{
+    @synchronized(self){
+        _objectsEncoded++;
+        _bytesEncoded += length;
+    }
+}
+
+-(void)recordDecodedBytes:(NSUInteger)length{
+    @synchronized(self){
+        _objectsDecoded++;
+        _bytesDecoded += length;
+    }
+}
+
+-(void)recordRowsHydrated:(NSUInteger)rows{
+    @synchronized(self){
+        _rowsHydrated += rows;
+    }
+}
+
+#pragma mark - snapshot
+#define NUMBER(value) [NSNumber numberWithDouble:(double)(value)]
+#define COUNT(value) [NSNumber numberWithUnsignedLongLong:(value)]
+
+-(NSDictionary*)snapshot{
+    @synchronized(self){
+        NSMutableDictionary *statements = [NSMutableDictionary dictionary];
+        for (NSUInteger kind = 0; kind < RHSQLiteStatementKindCount; kind++) {
+            const RHSQLiteMetricsHistogram *duration = &_durations[kind];
+            const RHSQLiteMetricsHistogram *queueWait = &_queueWaits[kind];
+            if (duration->count == 0) continue;
+            
+            NSDictionary *statement = [NSDictionary dictionaryWithObjectsAndKeys:
+                                       COUNT(duration->count), @"count",
+                                       NUMBER(duration->total), @"total",
+                                       NUMBER(duration->max), @"max",
+                                       NUMBER(RHSQLiteMetricsHistogramPercentile(duration, 0.50)), @"p50",
+                                       NUMBER(RHSQLiteMetricsHistogramPercentile(duration, 0.90)), @"p90",
+                                       NUMBER(RHSQLiteMetricsHistogramPercentile(duration, 0.99)), @"p99",
+                                       NUMBER(queueWait->total), @"queue_wait_total",
+                                       NUMBER(queueWait->max), @"queue_wait_max",
+                                       NUMBER(RHSQLiteMetricsHistogramPercentile(queueWait, 0.99)), @"queue_wait_p99",
+                                       nil];
+            [statements setObject:statement forKey:RHSQLiteStatementKindName((RHSQLiteStatementKind)kind)];
+        }
+        
+        NSDictionary *identityCache = [NSDictionary dictionaryWithObjectsAndKeys:
+                                       COUNT(_identityCacheHits), @"hits",
+                                       COUNT(_identityCacheMisses), @"misses",
+                                       nil];
+        
+        NSDictionary *codec = [NSDictionary dictionaryWithObjectsAndKeys:
+                               COUNT(_objectsEncoded), @"objects_encoded",
+                               COUNT(_bytesEncoded), @"bytes_encoded",
+                               COUNT(_objectsDecoded), @"objects_decoded",
+                               COUNT(_bytesDecoded), @"bytes_decoded",
+                               nil];
+        
+        return [NSDictionary dictionaryWithObjectsAndKeys:
+                NUMBER([NSDate timeIntervalSinceReferenceDate] - _startTime), @"interval",
+                statements, @"statements",
+                identityCache, @"identity_cache",
+                codec, @"codec",
+                COUNT(_rowsHydrated), @"rows_hydrated",
+                nil];
+    }
+}
+
+#undef NUMBER
+#undef COUNT
+
+-(void)reset{
+    @synchronized(self){
+        _startTime = [NSDate timeIntervalSinceReferenceDate];
+        memset(_durations, 0, sizeof(_durations));
+        memset(_queueWaits, 0, sizeof(_queueWaits));
+        _identityCacheHits = _identityCacheMisses = 0;
+        _objectsEncoded = _bytesEncoded = _objectsDecoded = _bytesDecoded = 0;
+        _rowsHydrated = 0;
+    }
+}
+
+#pragma mark - description
+-(NSString*)description{
+    return [NSString stringWithFormat:@"<%@: %p, %@>", NSStringFromClass([self class]), self, [self snapshot]];
+}
+
+@end
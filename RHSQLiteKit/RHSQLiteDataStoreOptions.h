@@ -0,0 +1,143 @@
+//
+//  RHSQLiteDataStoreOptions.h
+//  RHSQLiteKit
+//
+//  Created by agent on 18/10/2026.
+//  Copyright (c) 2026 Richard Heard. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions
+//  are met:
+//  1. Redistributions of source code must retain the above copyright
+//  notice, this list of conditions and the following disclaimer.
+//  2. Redistributions in binary form must reproduce the above copyright
+//  notice, this list of conditions and the following disclaimer in the
+//  documentation and/or other materials provided with the distribution.
+//  3. The name of the author may not be used to endorse or promote products
+//  derived from this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+//  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+//  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+//  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+//  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+//  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#import <Foundation/Foundation.h>
+
+@class FMDatabase;
+
+typedef enum {
+    RHSQLiteDataStoreProfileDefault = 0,  //sqlite defaults, nothing is changed
+    RHSQLiteDataStoreProfileReadHeavy,    //WAL, large page cache and mmap, for stores that are mostly queried
+    RHSQLiteDataStoreProfileWriteHeavy,   //WAL with synchronous=NORMAL and less frequent checkpoints, for stores with frequent small writes
+    RHSQLiteDataStoreProfileBulkLoad,     //no fsyncs and an in memory journal, for building stores from scratch. NOT crash safe.
+    RHSQLiteDataStoreProfileDurable,      //WAL with synchronous=FULL, every commit is on disk before it returns
+    RHSQLiteDataStoreProfileImmutable,    //read only, immutable and fully memory mapped, for static reference datasets. (see immutable below)
+} RHSQLiteDataStoreProfile;
+
+typedef enum {
+    RHSQLiteJournalModeDefault = 0, //unchanged
+    RHSQLiteJournalModeDelete,
+    RHSQLiteJournalModeTruncate,
+    RHSQLiteJournalModePersist,
+    RHSQLiteJournalModeMemory,
+    RHSQLiteJournalModeWAL,
+    RHSQLiteJournalModeOff,
+} RHSQLiteJournalMode;
+
+typedef enum {
+    RHSQLiteSynchronousDefault = 0, //unchanged
+    RHSQLiteSynchronousOff,
+    RHSQLiteSynchronousNormal,
+    RHSQLiteSynchronousFull,
+    RHSQLiteSynchronousExtra,
+} RHSQLiteSynchronous;
+
+typedef enum {
+    RHSQLiteAutoVacuumDefault = 0, //unchanged
+    RHSQLiteAutoVacuumNone,
+    RHSQLiteAutoVacuumFull,
+    RHSQLiteAutoVacuumIncremental, //free pages are kept until reclaimed by PRAGMA incremental_vacuum, see -[RHSQLiteDataStore maintenanceInterval]
+} RHSQLiteAutoVacuum;
+
+typedef enum {
+    RHSQLiteTempStoreDefault = 0, //unchanged
+    RHSQLiteTempStoreFile,
+    RHSQLiteTempStoreMemory,
+} RHSQLiteTempStore;
+
+/*!
+ @class RHSQLiteDataStoreOptions
+ @abstract RHSQLiteDataStoreOptions describes how a data store tunes each sqlite connection it opens.
+ @discussion Any option left at its default (or nil) value is not touched, leaving sqlite's own default in place.
+    Options are applied once, as each connection is opened. See: http://www.sqlite.org/pragma.html
+ */
+@interface RHSQLiteDataStoreOptions : NSObject <NSCopying> {
+    RHSQLiteDataStoreProfile _profile;
+    RHSQLiteJournalMode _journalMode;
+    RHSQLiteSynchronous _synchronous;
+    RHSQLiteTempStore _tempStore;
+    RHSQLiteAutoVacuum _autoVacuum;
+    
+    NSNumber *_cacheSize;
+    NSNumber *_mmapSize;
+    NSNumber *_pageSize;
+    NSNumber *_walAutocheckpoint;
+    NSTimeInterval _busyTimeout;
+    
+    BOOL _immutable;
+}
+
+//presets
++(id)defaultOptions;
++(id)optionsWithProfile:(RHSQLiteDataStoreProfile)profile;
+
+/*!
+ @property profile
+ @abstract The preset these options were created from. Individual options can still be modified afterwards.
+ */
+@property (nonatomic, readonly) RHSQLiteDataStoreProfile profile;
+
+@property (nonatomic, assign) RHSQLiteJournalMode journalMode;  //PRAGMA journal_mode
+@property (nonatomic, assign) RHSQLiteSynchronous synchronous;  //PRAGMA synchronous
+@property (nonatomic, assign) RHSQLiteTempStore tempStore;      //PRAGMA temp_store
+@property (nonatomic, assign) RHSQLiteAutoVacuum autoVacuum;    //PRAGMA auto_vacuum. Takes effect immediately for new files, existing files are only converted by their next VACUUM.
+
+@property (nonatomic, copy) NSNumber *cacheSize;         //PRAGMA cache_size. positive values are pages, negative values are KiB
+@property (nonatomic, copy) NSNumber *mmapSize;          //PRAGMA mmap_size, in bytes
+@property (nonatomic, copy) NSNumber *pageSize;          //PRAGMA page_size, in bytes. Only applied when creating a new file.
+@property (nonatomic, copy) NSNumber *walAutocheckpoint; //PRAGMA wal_autocheckpoint, in pages
+
+@property (nonatomic, assign) NSTimeInterval busyTimeout; //sqlite3_busy_timeout(), 0 leaves the default in place
+
+/*!
+ @property immutable
+ @abstract Open the file read only, as an immutable sqlite database. (SQLITE_OPEN_READONLY with the immutable=1 URI parameter)
+ @discussion sqlite skips all locking and change detection for immutable files, so the file must not be modified by anyone while it is open.
+    The data store skips migrations and metadata writes, lends each access a lock free connection from a small pool (one per core, at least 4) and raises if any mutating API is used.
+    immutable=1 needs sqlite 3.8.0 or later, older versions open the file with mode=ro and keep their usual locking.
+    Journal, synchronous, page size and checkpoint options are ignored. If mmapSize is nil the whole file is memory mapped.
+ */
+@property (nonatomic, assign, getter=isImmutable) BOOL immutable;
+
+/*!
+ @method pragmaStatements
+ @abstract The PRAGMA statements that will be run against each new connection, in order.
+ */
+-(NSArray*)pragmaStatements;
+
+/*!
+ @method applyToDatabase:
+ @abstract Applies these options to an open connection.
+ @discussion This is called by the data store for every connection it opens, you should not usually need to call it yourself.
+ @returns NO if any of the options could not be applied.
+ */
+-(BOOL)applyToDatabase:(FMDatabase*)db;
+
+@end
@@ -0,0 +1,262 @@
+//
+//  RHSQLiteDataStoreOptions.m
+//  RHSQLiteKit
+//
+//  Created by agent on 18/10/2026.
+//  Copyright (c) 2026 Richard Heard. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions
+//  are met:
+//  1. Redistributions of source code must retain the above copyright
+//  notice, this list of conditions and the following disclaimer.
+//  2. Redistributions in binary form must reproduce the above copyright
+//  notice, this list of conditions and the following disclaimer in the
+//  documentation and/or other materials provided with the distribution.
+//  3. The name of the author may not be used to endorse or promote products
+//  derived from this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+//  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+//  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+//  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+//  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+//  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#import "RHSQLiteDataStoreOptions.h"
+
+#import "FMDatabase.h"
+#import "FMResultSet.h"
+
+@interface RHSQLiteDataStoreOptions ()
+
+@property (nonatomic, assign) RHSQLiteDataStoreProfile profile;
+
+//private
+-(BOOL)_executePragma:(NSString*)pragma inDatabase:(FMDatabase*)db;
+
+@end
+
+@implementation RHSQLiteDataStoreOptions
+
+@synthesize profile=_profile;
+@synthesize journalMode=_journalMode;
+@synthesize synchronous=_synchronous;
+@synthesize tempStore=_tempStore;
+@synthesize autoVacuum=_autoVacuum;
+@synthesize cacheSize=_cacheSize;
+@synthesize mmapSize=_mmapSize;
+@synthesize pageSize=_pageSize;
+@synthesize walAutocheckpoint=_walAutocheckpoint;
+@synthesize busyTimeout=_busyTimeout;
+@synthesize immutable=_immutable;
+
+#pragma mark - presets
++(id)defaultOptions{
+    return [self optionsWithProfile:RHSQLiteDataStoreProfileDefault];
+}
+
++(id)optionsWithProfile:(RHSQLiteDataStoreProfile)profile{
+    RHSQLiteDataStoreOptions *options = [[self alloc] init];
+    options.profile = profile;
+    
+    switch (profile) {
+        case RHSQLiteDataStoreProfileDefault:
+            break;
+            
+        case RHSQLiteDataStoreProfileReadHeavy:
+            options.journalMode = RHSQLiteJournalModeWAL;
+            options.synchronous = RHSQLiteSynchronousNormal;
+            options.tempStore = RHSQLiteTempStoreMemory;
+            options.cacheSize = [NSNumber numberWithInt:-64 * 1024];                 // 64MB
+            options.mmapSize = [NSNumber numberWithLongLong:256LL * 1024 * 1024];     // 256MB
+            options.busyTimeout = 5.0;
+            break;
+            
+        case RHSQLiteDataStoreProfileWriteHeavy:
+            options.journalMode = RHSQLiteJournalModeWAL;
+            options.synchronous = RHSQLiteSynchronousNormal;
+            options.tempStore = RHSQLiteTempStoreMemory;
+            options.cacheSize = [NSNumber numberWithInt:-32 * 1024];                 // 32MB
+            options.mmapSize = [NSNumber numberWithLongLong:64LL * 1024 * 1024];      // 64MB
+            options.walAutocheckpoint = [NSNumber numberWithInt:4000];               // ~16MB of 4K pages
+            options.busyTimeout = 10.0;
+            break;
+            
+        case RHSQLiteDataStoreProfileBulkLoad:
+            options.journalMode = RHSQLiteJournalModeMemory;
+            options.synchronous = RHSQLiteSynchronousOff;
+            options.tempStore = RHSQLiteTempStoreMemory;
+            options.cacheSize = [NSNumber numberWithInt:-256 * 1024];                // 256MB
+            options.pageSize = [NSNumber numberWithInt:8192];
+            options.busyTimeout = 30.0;
+            break;
+            
+        case RHSQLiteDataStoreProfileDurable:
+            options.journalMode = RHSQLiteJournalModeWAL;
+            options.synchronous = RHSQLiteSynchronousFull;
+            options.walAutocheckpoint = [NSNumber numberWithInt:1000];
+            options.busyTimeout = 5.0;
+            break;
+            
+        case RHSQLiteDataStoreProfileImmutable:
+            options.immutable = YES;
+            options.tempStore = RHSQLiteTempStoreMemory;
+            options.cacheSize = [NSNumber numberWithInt:-16 * 1024];                 // 16MB, most reads are served by the mmap
+            break;
+            
+        default:
+            [NSException raise:NSInvalidArgumentException format:@"Error: Unknown RHSQLiteDataStoreProfile %i.", profile];
+            return nil;
+    }
+    
+    return options;
+}
+
+
+#pragma mark - pragmas
+-(NSArray*)pragmaStatements{
+    NSMutableArray *result = [NSMutableArray array];
+    
+    //immutable files are read only, so only the pragmas that affect reads apply
+    if (_immutable){
+        if (_cacheSize) [result addObject:[NSString stringWithFormat:@"PRAGMA cache_size = %lld;", [_cacheSize longLongValue]]];
+        if (_mmapSize) [result addObject:[NSString stringWithFormat:@"PRAGMA mmap_size = %lld;", [_mmapSize longLongValue]]];
+        if (_tempStore == RHSQLiteTempStoreFile) [result addObject:@"PRAGMA temp_store = FILE;"];
+        if (_tempStore == RHSQLiteTempStoreMemory) [result addObject:@"PRAGMA temp_store = MEMORY;"];
+        return [NSArray arrayWithArray:result];
+    }
+    
+    //page_size must come before journal_mode, it can not be changed once a file is in WAL mode
+    if (_pageSize) [result addObject:[NSString stringWithFormat:@"PRAGMA page_size = %lld;", [_pageSize longLongValue]]];
+    
+    //likewise auto_vacuum, which only applies to a file with no tables yet (or at its next VACUUM)
+    NSString *autoVacuum = nil;
+    switch (_autoVacuum) {
+        case RHSQLiteAutoVacuumNone: autoVacuum = @"NONE"; break;
+        case RHSQLiteAutoVacuumFull: autoVacuum = @"FULL"; break;
+        case RHSQLiteAutoVacuumIncremental: autoVacuum = @"INCREMENTAL"; break;
+        default: break;
+    }
+    if (autoVacuum) [result addObject:[NSString stringWithFormat:@"PRAGMA auto_vacuum = %@;", autoVacuum]];
+    
+    NSString *journalMode = nil;
+    switch (_journalMode) {
+        case RHSQLiteJournalModeDelete: journalMode = @"DELETE"; break;
+        case RHSQLiteJournalModeTruncate: journalMode = @"TRUNCATE"; break;
+        case RHSQLiteJournalModePersist: journalMode = @"PERSIST"; break;
+        case RHSQLiteJournalModeMemory: journalMode = @"MEMORY"; break;
+        case RHSQLiteJournalModeWAL: journalMode = @"WAL"; break;
+        case RHSQLiteJournalModeOff: journalMode = @"OFF"; break;
+        default: break;
+    }
+    if (journalMode) [result addObject:[NSString stringWithFormat:@"PRAGMA journal_mode = %@;", journalMode]];
+    
+    NSString *synchronous = nil;
+    switch (_synchronous) {
+        case RHSQLiteSynchronousOff: synchronous = @"OFF"; break;
+        case RHSQLiteSynchronousNormal: synchronous = @"NORMAL"; break;
+        case RHSQLiteSynchronousFull: synchronous = @"FULL"; break;
+        case RHSQLiteSynchronousExtra: synchronous = @"EXTRA"; break;
+        default: break;
+    }
+    if (synchronous) [result addObject:[NSString stringWithFormat:@"PRAGMA synchronous = %@;", synchronous]];
+    
+    if (_cacheSize) [result addObject:[NSString stringWithFormat:@"PRAGMA cache_size = %lld;", [_cacheSize longLongValue]]];
+    if (_mmapSize) [result addObject:[NSString stringWithFormat:@"PRAGMA mmap_size = %lld;", [_mmapSize longLongValue]]];
+    
+    if (_tempStore == RHSQLiteTempStoreFile) [result addObject:@"PRAGMA temp_store = FILE;"];
+    if (_tempStore == RHSQLiteTempStoreMemory) [result addObject:@"PRAGMA temp_store = MEMORY;"];
+    
+    if (_walAutocheckpoint) [result addObject:[NSString stringWithFormat:@"PRAGMA wal_autocheckpoint = %lld;", [_walAutocheckpoint longLongValue]]];
+    
+    return [NSArray arrayWithArray:result];
+}
+
+-(BOOL)applyToDatabase:(FMDatabase*)db{
+    BOOL result = YES;
+    
+    if (_busyTimeout > 0){
+        sqlite3_busy_timeout([db sqliteHandle], (int)(_busyTimeout * 1000));
+    }
+    
+    for (NSString *pragma in [self pragmaStatements]) {
+        //page size only matters for brand new files, changing it later requires a VACUUM
+        if ([pragma hasPrefix:@"PRAGMA page_size"]){
+            FMResultSet *resultSet = [db executeQuery:@"PRAGMA page_count;"];
+            BOOL isEmpty = [resultSet next] && [resultSet longLongIntForColumnIndex:0] == 0;
+            [resultSet close];
+            if (!isEmpty) continue;
+        }
+        
+        if (![self _executePragma:pragma inDatabase:db]) result = NO;
+    }
+    
+    //map the whole of an immutable file, it can't change underneath us
+    if (_immutable && !_mmapSize){
+        int64_t pageCount = 0, pageSize = 0;
+        FMResultSet *resultSet = [db executeQuery:@"PRAGMA page_count;"];
+        if ([resultSet next]) pageCount = [resultSet longLongIntForColumnIndex:0];
+        [resultSet close];
+        resultSet = [db executeQuery:@"PRAGMA page_size;"];
+        if ([resultSet next]) pageSize = [resultSet longLongIntForColumnIndex:0];
+        [resultSet close];
+        
+        int64_t fileSize = pageCount * pageSize;
+        if (fileSize > 0 && ![self _executePragma:[NSString stringWithFormat:@"PRAGMA mmap_size = %lld;", fileSize] inDatabase:db]) result = NO;
+    }
+    
+    return result;
+}
+
+-(BOOL)_executePragma:(NSString*)pragma inDatabase:(FMDatabase*)db{
+    //some pragmas (ie journal_mode) return a row, so always use executeQuery
+    FMResultSet *resultSet = [db executeQuery:pragma];
+    if (!resultSet){
+        RHErrorLog(@"Error: Failed to apply '%@'. Error: %@.", pragma, [db lastError]);
+        return NO;
+    }
+    
+    if ([resultSet next] && [pragma hasPrefix:@"PRAGMA journal_mode"]){
+        //sqlite returns the mode actually in effect, which may differ. (ie in memory databases can't use WAL)
+        NSString *mode = [resultSet stringForColumnIndex:0];
+        if (mode && [pragma rangeOfString:mode options:NSCaseInsensitiveSearch].location == NSNotFound){
+            RHErrorLog(@"Warning: Requested '%@' but the database is using journal_mode %@.", pragma, mode);
+        }
+    }
+    [resultSet close];
+    return YES;
+}
+
+
+#pragma mark - NSCopying
+-(id)copyWithZone:(NSZone *)zone{
+    RHSQLiteDataStoreOptions *copy = [[[self class] allocWithZone:zone] init];
+    copy.profile = _profile;
+    copy.journalMode = _journalMode;
+    copy.synchronous = _synchronous;
+    copy.tempStore = _tempStore;
+    copy.autoVacuum = _autoVacuum;
+    copy.cacheSize = _cacheSize;
+    copy.mmapSize = _mmapSize;
+    copy.pageSize = _pageSize;
+    copy.walAutocheckpoint = _walAutocheckpoint;
+    copy.busyTimeout = _busyTimeout;
+    copy.immutable = _immutable;
+    return copy;
+}
+
+
+#pragma mark - description
+-(NSString*)description{
+    NSArray *profileNames = [NSArray arrayWithObjects:@"default", @"read-heavy", @"write-heavy", @"bulk-load", @"durable", @"immutable", nil];
+    NSString *profileName = (_profile < profileNames.count) ? [profileNames objectAtIndex:_profile] : @"unknown";
+    return [NSString stringWithFormat:@"<%@: %p, profile: %@, immutable: %i, busyTimeout: %.1f, pragmas: %@>", NSStringFromClass([self class]), self, profileName, _immutable, _busyTimeout, [[self pragmaStatements] componentsJoinedByString:@" "]];
+}
+
+@end
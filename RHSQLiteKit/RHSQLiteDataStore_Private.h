@@ -31,6 +31,10 @@
 
 #import "RHSQLiteDataStore.h"
 
+@class RHSQLiteRowLayout;
+@class RHSQLiteWriteBehindQueue;
+@class RHSQLiteReaderPool;
+
 @interface RHSQLiteDataStore () <NSKeyedUnarchiverDelegate, NSKeyedArchiverDelegate>
 
 //metadata (it's like a magic key value store, for storage of tasty morsels)
@@ -38,14 +42,40 @@
 -(void)_metadataSetValue:(id)object forKey:(NSString*)columnName;
 
 
+//timed database access. these record into _metrics (when enabled) under the given kind
+-(void)_accessDatabaseForStatementKind:(RHSQLiteStatementKind)kind block:(void (^)(FMDatabase *db))block;
+-(void)_accessDatabaseForStatementKind:(RHSQLiteStatementKind)kind object:(RHSQLiteObject*)object block:(void (^)(FMDatabase *db))block; //object is making the change, so is left alone when it is delivered. routed to the objects shard
+-(void)_accessDatabaseForStatementKind:(RHSQLiteStatementKind)kind queue:(FMDatabaseQueue*)databaseQueue object:(RHSQLiteObject*)object block:(void (^)(FMDatabase *db))block; //nil queue for our main connection
+-(void)_accessDatabaseWithTransactionForStatementKind:(RHSQLiteStatementKind)kind deferred:(BOOL)deferred block:(void (^)(FMDatabase *db, BOOL *rollback))block;
+-(BOOL)_accessDatabaseWithTransactionForStatementKind:(RHSQLiteStatementKind)kind deferred:(BOOL)deferred queue:(FMDatabaseQueue*)databaseQueue objects:(NSArray*)objects error:(NSError**)errorOut block:(void (^)(FMDatabase *db, BOOL *rollback))block; //YES once committed. errorOut is set if BEGIN or COMMIT failed, not when block asks for a rollback
+-(RHSQLiteDataStoreMetrics*)_metrics; //nil unless enabled
+
+//connections
+-(FMDatabaseQueue*)_databaseQueueForTable:(NSString*)tableName; //the queue of the shard the table is assigned to, otherwise our main queue
+-(RHSQLiteReaderPool*)_readerPool; //read only data stores only
+-(void)_resetReaderPools; //our reader and scan pools. connections opened from now on pick up new shards, the slow query log etc. checked out connections are closed as they are returned
+-(FMDatabase*)_newReaderDatabase NS_RETURNS_RETAINED; //immutable for read only data stores, otherwise an ordinary read only connection alongside our writer
+
+//row layouts
+-(RHSQLiteRowLayout*)_rowLayoutForTable:(NSString*)tableName; //nil for unknown tables. don't call from inside a database block
+
 //cache access
 -(NSMutableDictionary*)_weakObjectCacheForTable:(NSString*)tableName; // these are weak value dictionaries created using CFDictionaryCreate() careful.
 -(RHSQLiteObject*)_cachedObjectForTable:(NSString*)tableName objectID:(RHSQLiteObjectID)objectID;
 
 //cache management
 -(void)_objectCheckIn:(RHSQLiteObject*)object;
+-(RHSQLiteObject*)_objectCheckInUnlessCached:(RHSQLiteObject*)object; //checks object in only if no live object has its ID, returning whichever is now cached
 -(void)_objectCheckOut:(RHSQLiteObject*)object; //careful.. this can be called from inside the objects dealloc method (only use tableName and objectID);
 
+//unit of work
+-(void)_objectDidBecomeDirty:(RHSQLiteObject*)object; //only called once per object, until saveAllChanges hands it back via -_clearDirtyTracking
+-(BOOL)_isPerformingUnitOfWork; //on the current thread
+
+//write behind
+-(RHSQLiteWriteBehindQueue*)_writeBehindQueue; //nil unless enabled
+-(BOOL)_isAccessingWritableDatabase; //YES from inside a block running on our main writable connection, on the current thread
+
 //archiving and unarchiving - See: <NSKeyedUnarchiverDelegate, NSKeyedArchiverDelegate>
 //RHSQLiteObject subclasses are replaced by an instance of the RHSQLiteObjectPlaceholder class by archivers using the dataStore as a delegate
 
@@ -35,6 +35,9 @@
 
 //base
 #import "RHSQLiteDataStore.h"
+#import "RHSQLiteDataStoreOptions.h"
+#import "RHSQLiteDataStoreMetrics.h"
+#import "RHSQLiteChangeSet.h"
 #import "RHSQLiteObject.h"
 #import "RHSQLiteObjectQuery.h"
 
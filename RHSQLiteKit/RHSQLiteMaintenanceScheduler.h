@@ -0,0 +1,84 @@
+//
+//  RHSQLiteMaintenanceScheduler.h
+//  RHSQLiteKit
+//
+//  Created by agent on 18/10/2026.
+//  Copyright (c) 2026 Richard Heard. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions
+//  are met:
+//  1. Redistributions of source code must retain the above copyright
+//  notice, this list of conditions and the following disclaimer.
+//  2. Redistributions in binary form must reproduce the above copyright
+//  notice, this list of conditions and the following disclaimer in the
+//  documentation and/or other materials provided with the distribution.
+//  3. The name of the author may not be used to endorse or promote products
+//  derived from this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+//  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+//  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+//  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+//  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+//  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// INTERNAL CLASS: DO NOT USE UNLESS YOU KNOW WHAT YOU ARE DOING
+
+#import <Foundation/Foundation.h>
+
+#import "RHSQLiteDataStore.h"
+
+@class FMDatabase;
+
+//runs block against each of the data stores writable connections in turn, releasing each before moving on to the next. fileName is main, or the shards schema name.
+typedef void (^RHSQLiteMaintenanceAccessor)(void (^block)(FMDatabase *db, NSString *fileName));
+
+/*!
+ @class RHSQLiteMaintenanceScheduler
+ @abstract RHSQLiteMaintenanceScheduler runs a data stores housekeeping: WAL checkpoints, PRAGMA optimize and incremental vacuuming.
+ @discussion A timer fires every interval seconds, but a run only goes ahead if noteActivity hasn't been called since the previous tick.
+    Checkpoints and optimize are a statement or two per file. Vacuuming is done in steps of vacuumPageBudget pages, releasing the connection between steps, until every free list is empty or timeBudget is spent.
+    Each of those checks timeBudget before it starts, so a run that is out of time leaves the remaining files checkpoints, optimize and vacuum steps to the next one.
+    Whatever is left over is picked up by the next idle run. Everything here is safe to call from any thread, but never from inside a database block.
+ */
+@interface RHSQLiteMaintenanceScheduler : NSObject {
+    RHSQLiteMaintenanceAccessor _accessor;
+    dispatch_queue_t _queue;            //serial, so runs never overlap
+    dispatch_source_t _timer;
+    
+    NSTimeInterval _interval;
+    NSTimeInterval _timeBudget;
+    NSUInteger _vacuumPageBudget;
+    RHSQLiteCheckpointMode _checkpointMode;
+    NSTimeInterval _optimizeInterval;
+    NSUInteger _analysisLimit;
+    
+    volatile int64_t _activityCount;    //bumped atomically from any thread, read atomically on _queue
+    int64_t _lastSeenActivityCount;     //only touched on _queue
+    NSTimeInterval _lastOptimized;      //guarded by @synchronized(self), like the settings it is compared against
+    
+    NSMutableDictionary *_report;       //guarded by @synchronized(_report)
+}
+
+-(id)initWithAccessor:(RHSQLiteMaintenanceAccessor)accessor;
+
+@property (nonatomic, assign) NSTimeInterval interval; //0 stops the timer
+@property (nonatomic, assign) NSTimeInterval timeBudget; //per run, checked before each checkpoint, optimize and vacuum step. a single one may overrun it
+@property (nonatomic, assign) NSUInteger vacuumPageBudget; //per PRAGMA incremental_vacuum step
+@property (nonatomic, assign) RHSQLiteCheckpointMode checkpointMode;
+@property (nonatomic, assign) NSTimeInterval optimizeInterval;
+@property (nonatomic, assign) NSUInteger analysisLimit; //PRAGMA analysis_limit, 0 for no limit
+
+-(void)noteActivity; //called by the data store for every use of a writable connection
+
+-(NSDictionary*)performMaintenance; //runs now, busy or not, with optimize forced. returns the run, as in report's last_run
+-(NSDictionary*)report; //see -[RHSQLiteDataStore maintenanceReport]
+
+-(void)cancel; //stops the timer. a run already in progress is left to finish
+
+@end
@@ -0,0 +1,370 @@
+//
+//  RHSQLiteMaintenanceScheduler.m
+//  RHSQLiteKit
+//
+//  Created by agent on 18/10/2026.
+//  Copyright (c) 2026 Richard Heard. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions
+//  are met:
+//  1. Redistributions of source code must retain the above copyright
+//  notice, this list of conditions and the following disclaimer.
+//  2. Redistributions in binary form must reproduce the above copyright
+//  notice, this list of conditions and the following disclaimer in the
+//  documentation and/or other materials provided with the distribution.
+//  3. The name of the author may not be used to endorse or promote products
+//  derived from this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+//  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+//  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+//  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+//  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+//  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#import "RHSQLiteMaintenanceScheduler.h"
+
+#import "FMDatabase.h"
+#import "FMResultSet.h"
+
+@interface RHSQLiteMaintenanceScheduler ()
+
+//only called on _queue
+-(void)_timerFired;
+-(NSDictionary*)_runForcingOptimize:(BOOL)forceOptimize;
+
+//tasks, each run against a single file while its connection is held
+-(NSDictionary*)_checkpointDatabase:(FMDatabase*)db mode:(RHSQLiteCheckpointMode)mode;
+-(NSDictionary*)_optimizeDatabase:(FMDatabase*)db analysisLimit:(NSUInteger)analysisLimit;
+-(int64_t)_int64ForQuery:(NSString*)sql inDatabase:(FMDatabase*)db; //the first column of the first row, -1 on failure
+-(BOOL)_executePragma:(NSString*)pragma inDatabase:(FMDatabase*)db; //some pragmas return rows, so always use executeQuery
+
+@end
+
+@implementation RHSQLiteMaintenanceScheduler
+@synthesize timeBudget=_timeBudget;
+@synthesize vacuumPageBudget=_vacuumPageBudget;
+@synthesize checkpointMode=_checkpointMode;
+@synthesize optimizeInterval=_optimizeInterval;
+@synthesize analysisLimit=_analysisLimit;
+
+-(id)initWithAccessor:(RHSQLiteMaintenanceAccessor)accessor{
+    self = [super init];
+    if (self){
+        _accessor = [accessor copy];
+        _queue = dispatch_queue_create("com.rheard.RHSQLiteKit.maintenance", DISPATCH_QUEUE_SERIAL);
+        dispatch_set_target_queue(_queue, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_BACKGROUND, 0));
+        _timer = NULL;
+        
+        _interval = 0.0;
+        _timeBudget = 0.1;
+        _vacuumPageBudget = 256;
+        _checkpointMode = RHSQLiteCheckpointModePassive;
+        _optimizeInterval = 60.0 * 60.0;
+        _analysisLimit = 1000;
+        
+        _activityCount = 0;
+        _lastSeenActivityCount = 0;
+        _lastOptimized = 0.0;
+        
+        _report = [[NSMutableDictionary alloc] init];
+    }
+    return self;
+}
+
+-(void)dealloc{
+    [self cancel];
+#if !OS_OBJECT_USE_OBJC
+    dispatch_release(_queue);
+#endif
+    _queue = NULL;
+}
+
+
+#pragma mark - scheduling
+-(NSTimeInterval)interval{
+    @synchronized(self){
+        return _interval;
+    }
+}
+
+-(void)setInterval:(NSTimeInterval)interval{
+    @synchronized(self){
+        [self cancel];
+        _interval = MAX(interval, 0.0);
+        if (_interval <= 0.0) return;
+        
+        //the timer must not keep us alive
+        __weak RHSQLiteMaintenanceScheduler *weakSelf = self;
+        uint64_t nanoseconds = (uint64_t)(_interval * NSEC_PER_SEC);
+        dispatch_source_t timer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, _queue);
+        dispatch_source_set_timer(timer, dispatch_time(DISPATCH_TIME_NOW, (int64_t)nanoseconds), nanoseconds, nanoseconds / 10);
+        dispatch_source_set_event_handler(timer, ^{
+            [weakSelf _timerFired];
+        });
+        dispatch_resume(timer);
+        _timer = timer;
+    }
+}
+
+-(void)cancel{
+    @synchronized(self){
+        if (!_timer) return;
+        dispatch_source_cancel(_timer);
+#if !OS_OBJECT_USE_OBJC
+        dispatch_release(_timer);
+#endif
+        _timer = NULL;
+    }
+}
+
+-(void)noteActivity{
+    //called from every thread that uses the data store
+    __sync_fetch_and_add(&_activityCount, 1);
+}
+
+-(void)_timerFired{
+    //only when nobody has used the data store since the last tick. (an atomic read, a plain one can tear on 32 bit devices)
+    int64_t activityCount = __sync_fetch_and_add(&_activityCount, 0);
+    BOOL idle = (activityCount == _lastSeenActivityCount);
+    _lastSeenActivityCount = activityCount;
+    
+    if (!idle){
+        @synchronized(_report){
+            uint64_t skipped = [[_report objectForKey:@"skipped"] unsignedLongLongValue];
+            [_report setObject:[NSNumber numberWithUnsignedLongLong:skipped + 1] forKey:@"skipped"];
+        }
+        return;
+    }
+    
+    [self _runForcingOptimize:NO];
+    
+    //our own statements don't count as activity
+    _lastSeenActivityCount = __sync_fetch_and_add(&_activityCount, 0);
+}
+
+-(NSDictionary*)performMaintenance{
+    __block NSDictionary *result = nil;
+    dispatch_sync(_queue, ^{
+        result = [self _runForcingOptimize:YES];
+    });
+    return result;
+}
+
+-(NSDictionary*)report{
+    @synchronized(_report){
+        return [NSDictionary dictionaryWithDictionary:_report];
+    }
+}
+
+
+#pragma mark - runs
+-(NSDictionary*)_runForcingOptimize:(BOOL)forceOptimize{
+    NSTimeInterval started = [NSDate timeIntervalSinceReferenceDate];
+    NSTimeInterval deadline;
+    RHSQLiteCheckpointMode checkpointMode;
+    NSUInteger vacuumPageBudget, analysisLimit;
+    BOOL optimize;
+    @synchronized(self){
+        deadline = started + _timeBudget;
+        checkpointMode = _checkpointMode;
+        vacuumPageBudget = MAX(_vacuumPageBudget, (NSUInteger)1);
+        analysisLimit = _analysisLimit;
+        optimize = forceOptimize || (started - _lastOptimized) >= _optimizeInterval;
+    }
+    
+    //file name -> task name -> what it did
+    NSMutableDictionary *files = [NSMutableDictionary dictionary];
+    NSMutableDictionary *(^entryForFile)(NSString *fileName) = ^NSMutableDictionary *(NSString *fileName) {
+        NSMutableDictionary *entry = [files objectForKey:fileName];
+        if (!entry){
+            entry = [NSMutableDictionary dictionary];
+            [files setObject:entry forKey:fileName];
+        }
+        return entry;
+    };
+    
+    //every task checks the deadline before it starts, a file whose turn comes too late is left for the next run. (only a single task can overrun)
+    BOOL (^outOfTime)(void) = ^BOOL{
+        return [NSDate timeIntervalSinceReferenceDate] >= deadline;
+    };
+    
+    //checkpoints first, they are what stop the WAL growing without bound
+    if (checkpointMode != RHSQLiteCheckpointModeNone){
+        _accessor(^(FMDatabase *db, NSString *fileName) {
+            if (outOfTime()) return;
+            [entryForFile(fileName) setObject:[self _checkpointDatabase:db mode:checkpointMode] forKey:@"checkpoint"];
+        });
+    }
+    
+    //a forced optimize (ie performMaintenance) runs whatever the time
+    if (optimize){
+        __block BOOL skipped = NO;
+        _accessor(^(FMDatabase *db, NSString *fileName) {
+            if (!forceOptimize && outOfTime()){
+                skipped = YES;
+                return;
+            }
+            [entryForFile(fileName) setObject:[self _optimizeDatabase:db analysisLimit:analysisLimit] forKey:@"optimize"];
+        });
+        
+        //due again next run unless every file got its turn
+        if (skipped){
+            optimize = NO;
+        } else {
+            @synchronized(self){
+                _lastOptimized = started;
+            }
+        }
+    }
+    
+    //then free pages, a step per file at a time, until none are left or we are out of time
+    NSMutableSet *vacuumedFiles = [NSMutableSet set];
+    __block uint64_t pagesVacuumed = 0;
+    __block BOOL pending = YES;
+    while (pending) {
+        pending = NO;
+        _accessor(^(FMDatabase *db, NSString *fileName) {
+            if ([vacuumedFiles containsObject:fileName]) return;
+            
+            NSMutableDictionary *vacuum = [entryForFile(fileName) objectForKey:@"vacuum"];
+            if (!vacuum){
+                //0 none, 1 full, 2 incremental
+                int64_t autoVacuum = [self _int64ForQuery:@"PRAGMA main.auto_vacuum;" inDatabase:db];
+                NSArray *autoVacuumNames = [NSArray arrayWithObjects:@"none", @"full", @"incremental", nil];
+                vacuum = [NSMutableDictionary dictionary];
+                [vacuum setObject:(autoVacuum >= 0 && autoVacuum < 3) ? [autoVacuumNames objectAtIndex:(NSUInteger)autoVacuum] : @"unknown" forKey:@"auto_vacuum"];
+                [vacuum setObject:[NSNumber numberWithUnsignedLongLong:0] forKey:@"pages_vacuumed"];
+                [vacuum setObject:[NSNumber numberWithUnsignedInteger:0] forKey:@"steps"];
+                [entryForFile(fileName) setObject:vacuum forKey:@"vacuum"];
+            }
+            
+            int64_t freePages = [self _int64ForQuery:@"PRAGMA main.freelist_count;" inDatabase:db];
+            [vacuum setObject:[NSNumber numberWithLongLong:freePages] forKey:@"free_pages"];
+            
+            //files that aren't in incremental mode only report their free pages, they need a VACUUM (and the autoVacuum option) first
+            if (freePages <= 0 || ![[vacuum objectForKey:@"auto_vacuum"] isEqualToString:@"incremental"] || outOfTime()){
+                [vacuumedFiles addObject:fileName];
+                return;
+            }
+            
+            if (![self _executePragma:[NSString stringWithFormat:@"PRAGMA main.incremental_vacuum(%lu);", (unsigned long)vacuumPageBudget] inDatabase:db]){
+                [vacuumedFiles addObject:fileName];
+                return;
+            }
+            
+            int64_t remainingPages = [self _int64ForQuery:@"PRAGMA main.freelist_count;" inDatabase:db];
+            uint64_t freed = (remainingPages >= 0 && remainingPages < freePages) ? (uint64_t)(freePages - remainingPages) : 0;
+            pagesVacuumed += freed;
+            [vacuum setObject:[NSNumber numberWithLongLong:remainingPages] forKey:@"free_pages"];
+            [vacuum setObject:[NSNumber numberWithUnsignedLongLong:[[vacuum objectForKey:@"pages_vacuumed"] unsignedLongLongValue] + freed] forKey:@"pages_vacuumed"];
+            [vacuum setObject:[NSNumber numberWithUnsignedInteger:[[vacuum objectForKey:@"steps"] unsignedIntegerValue] + 1] forKey:@"steps"];
+            
+            if (freed == 0 || remainingPages <= 0){
+                [vacuumedFiles addObject:fileName];
+            } else {
+                pending = YES;
+            }
+        });
+    }
+    
+    NSTimeInterval duration = [NSDate timeIntervalSinceReferenceDate] - started;
+    NSDictionary *run = [NSDictionary dictionaryWithObjectsAndKeys:
+                         [NSDate dateWithTimeIntervalSinceReferenceDate:started], @"date",
+                         [NSNumber numberWithDouble:duration], @"duration",
+                         [NSDictionary dictionaryWithDictionary:files], @"files",
+                         nil];
+    
+    @synchronized(_report){
+        [_report setObject:run forKey:@"last_run"];
+        [_report setObject:[NSNumber numberWithUnsignedLongLong:[[_report objectForKey:@"runs"] unsignedLongLongValue] + 1] forKey:@"runs"];
+        [_report setObject:[NSNumber numberWithUnsignedLongLong:[[_report objectForKey:@"pages_vacuumed"] unsignedLongLongValue] + pagesVacuumed] forKey:@"pages_vacuumed"];
+        if (optimize) [_report setObject:[NSDate dateWithTimeIntervalSinceReferenceDate:started] forKey:@"last_optimize"];
+    }
+    
+    RHLog(@"Maintenance run took %.3fs: %@", duration, files);
+    return run;
+}
+
+
+#pragma mark - tasks
+-(NSDictionary*)_checkpointDatabase:(FMDatabase*)db mode:(RHSQLiteCheckpointMode)mode{
+    NSString *modeName = (mode == RHSQLiteCheckpointModeTruncate) ? @"TRUNCATE" : @"PASSIVE";
+    NSMutableDictionary *result = [NSMutableDictionary dictionaryWithObject:[modeName lowercaseString] forKey:@"mode"];
+    
+    //main. only, our main connection has the shards ATTACHed and they are checkpointed through their own
+    FMResultSet *resultSet = [db executeQuery:[NSString stringWithFormat:@"PRAGMA main.wal_checkpoint(%@);", modeName]];
+    if ([resultSet next]){
+        //both frame counts are -1 when the file isn't in WAL mode
+        [result setObject:[NSNumber numberWithBool:[resultSet intForColumnIndex:0] != 0] forKey:@"busy"];
+        [result setObject:[NSNumber numberWithLongLong:[resultSet longLongIntForColumnIndex:1]] forKey:@"wal_frames"];
+        [result setObject:[NSNumber numberWithLongLong:[resultSet longLongIntForColumnIndex:2]] forKey:@"checkpointed_frames"];
+    } else {
+        RHErrorLog(@"Error: Checkpoint failed. Error: %@.", [db lastError]);
+        [result setObject:[[db lastError] localizedDescription] ?: @"unknown" forKey:@"error"];
+    }
+    [resultSet close];
+    
+    return result;
+}
+
+-(NSDictionary*)_optimizeDatabase:(FMDatabase*)db analysisLimit:(NSUInteger)analysisLimit{
+    NSTimeInterval started = [NSDate timeIntervalSinceReferenceDate];
+    
+    //bounds the rows of each index that ANALYZE samples, so neither statement runs long on large tables. older sqlites ignore it, and return no row (-1) when asked
+    int64_t previousAnalysisLimit = [self _int64ForQuery:@"PRAGMA analysis_limit;" inDatabase:db];
+    [self _executePragma:[NSString stringWithFormat:@"PRAGMA analysis_limit = %lu;", (unsigned long)analysisLimit] inDatabase:db];
+    
+    //optimize only re-analyzes tables it has seen queried on this connection, so files with no statistics at all get a first ANALYZE
+    BOOL analyzed = NO;
+    if ([self _int64ForQuery:@"SELECT count(*) FROM `main`.`sqlite_master` WHERE `name` = 'sqlite_stat1';" inDatabase:db] == 0){
+        analyzed = [db executeUpdate:@"ANALYZE main;"];
+        if (!analyzed) RHErrorLog(@"Error: ANALYZE failed. Error: %@.", [db lastError]);
+    }
+    
+    BOOL optimized = [self _executePragma:@"PRAGMA main.optimize;" inDatabase:db];
+    
+    //back to whatever the connection had, for anyone running their own ANALYZE
+    if (previousAnalysisLimit >= 0){
+        [self _executePragma:[NSString stringWithFormat:@"PRAGMA analysis_limit = %lld;", previousAnalysisLimit] inDatabase:db];
+    }
+    
+    return [NSDictionary dictionaryWithObjectsAndKeys:
+            [NSNumber numberWithBool:optimized], @"optimized",
+            [NSNumber numberWithBool:analyzed], @"analyzed",
+            [NSNumber numberWithDouble:[NSDate timeIntervalSinceReferenceDate] - started], @"duration",
+            nil];
+}
+
+-(int64_t)_int64ForQuery:(NSString*)sql inDatabase:(FMDatabase*)db{
+    int64_t result = -1;
+    FMResultSet *resultSet = [db executeQuery:sql];
+    if ([resultSet next]) result = [resultSet longLongIntForColumnIndex:0];
+    [resultSet close];
+    return result;
+}
+
+-(BOOL)_executePragma:(NSString*)pragma inDatabase:(FMDatabase*)db{
+    FMResultSet *resultSet = [db executeQuery:pragma];
+    if (!resultSet){
+        RHErrorLog(@"Error: Failed to run '%@'. Error: %@.", pragma, [db lastError]);
+        return NO;
+    }
+    while ([resultSet next]) {}
+    [resultSet close];
+    return ![db hadError];
+}
+
+
+#pragma mark - description
+-(NSString*)description{
+    return [NSString stringWithFormat:@"<%@: %p, interval: %.1fs, timeBudget: %.3fs, vacuumPageBudget: %lu, checkpointMode: %i, optimizeInterval: %.0fs, analysisLimit: %lu>", NSStringFromClass([self class]), self, [self interval], _timeBudget, (unsigned long)_vacuumPageBudget, _checkpointMode, _optimizeInterval, (unsigned long)_analysisLimit];
+}
+
+@end
@@ -46,6 +46,8 @@ typedef int64_t RHSQLiteObjectID;
 
 
 @class RHSQLiteDataStore;
+@class RHSQLiteRowLayout;
+struct RHSQLiteRowSlot;
 
 @interface RHSQLiteObject : RHDynamicPropertyObject {
     RHSQLiteDataStore *_dataStore;
@@ -54,9 +56,18 @@ typedef int64_t RHSQLiteObjectID;
     BOOL _loaded;  // true if we have loaded our contents from the db.
     BOOL _deleted; // true if the object does not exist in the db either due to it being deleted, or failing to find a row with a given ID upon load
 
-    NSMutableDictionary *_loadedColumnsAndValues;
+    //column values live in a slot array laid out by the tables shared RHSQLiteRowLayout. unsaved changes are tracked by the dirty bits that follow the slots.
+    RHSQLiteRowLayout *_rowLayout;
+    uint32_t _rowLayoutSerial; //_rowLayout's serial, so column bindings can check it without a message send
+    struct RHSQLiteRowSlot *_slots;
     
-    NSMutableDictionary *_unsavedChanges; //used to store values before we save them to the db
+    NSMutableDictionary *_unsavedChanges; //only used to store changes made before we are associated with a data store (created lazily on the first change)
+    BOOL _trackedAsDirty; //true while our data store has us in its list of objects for saveAllChanges
+    
+    //change tracking runs on other threads, so it never touches _loaded or _deleted itself. it atomically bumps these, and the thread using us applies them on next access
+    volatile int32_t _externalUpdateCount;
+    int32_t _appliedExternalUpdateCount;
+    volatile int32_t _externallyDeleted;
 }
 
 //preferred lookup method
@@ -77,6 +88,8 @@ typedef int64_t RHSQLiteObjectID;
 +(NSString*)primaryKeyName; //defaults to "_ROWID_". Every row in a table in SQLite has a unique row id, which can be accessed using _ROWID_
 -(NSString*)primaryKeyName;
 
++(NSString*)schemaHash; //defaults to nil. generated subclasses return the -[RHSQLiteDataStore schemaHashForTable:] of the table they were generated from, which the data store checks on load
+
 
 @property (nonatomic, readonly) RHSQLiteObjectID objectID;
 
@@ -128,7 +141,8 @@ typedef int64_t RHSQLiteObjectID;
 -(void)setUnsignedInteger:(NSUInteger)value forColumn:(NSString*)columnName;
 
 
-//saving
+//saving (inside -[RHSQLiteDataStore performUnitOfWork:errors:] save only marks the object, it is written by the units single transaction)
+//(write behind data stores queue the changes and return, see -[RHSQLiteDataStore writeBehindInterval])
 -(BOOL)hasUnsavedChanges;
 -(BOOL)save;
 -(BOOL)saveWithError:(NSError**)errorOut;
@@ -168,3 +182,25 @@ typedef int64_t RHSQLiteObjectID;
 
 
 @end
+
+
+//column bindings, used by the typed accessors that rhsqlitegen generates. (see Tools/rhsqlitegen)
+//each generated column has a single static binding, shared by every instance. it remembers the columns slot index in the last row layout it saw,
+//so reads of a loaded object are a comparison and a slot read, rather than a lookup by name. bindings rebind themselves whenever the layout changes.
+typedef struct {
+    __unsafe_unretained NSString *columnName;
+    __unsafe_unretained NSString *propertyName; //for KVO
+    volatile uint64_t bound;                    //layout serial << 32 | slot index, 0 until first used
+} RHSQLiteColumnBinding;
+
+#define RHSQLiteColumnBindingMake(columnName, propertyName) { columnName, propertyName, 0 }
+
+//these behave exactly as their -[RHSQLiteObject ...ForColumn:] counterparts. NULL reads as 0 from the primitive getters, and nil from the object getter
+extern int64_t RHSQLiteObjectGetInt64(RHSQLiteObject *object, RHSQLiteColumnBinding *binding);
+extern double RHSQLiteObjectGetDouble(RHSQLiteObject *object, RHSQLiteColumnBinding *binding);
+extern BOOL RHSQLiteObjectGetBool(RHSQLiteObject *object, RHSQLiteColumnBinding *binding);
+extern id RHSQLiteObjectGetObject(RHSQLiteObject *object, RHSQLiteColumnBinding *binding, Class expectedClass);
+
+extern void RHSQLiteObjectSetInt64(RHSQLiteObject *object, RHSQLiteColumnBinding *binding, int64_t value);
+extern void RHSQLiteObjectSetDouble(RHSQLiteObject *object, RHSQLiteColumnBinding *binding, double value);
+extern void RHSQLiteObjectSetObject(RHSQLiteObject *object, RHSQLiteColumnBinding *binding, id value);
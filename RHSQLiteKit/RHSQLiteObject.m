@@ -31,8 +31,11 @@
 #import "RHSQLiteKit.h"
 
 #import "RHSQLiteObject.h"
+#import "RHSQLiteObject_Private.h"
 #import "RHSQLiteDataStore.h"
 #import "RHSQLiteDataStore_Private.h"
+#import "RHSQLiteRowLayout.h"
+#import "RHSQLiteWriteBehindQueue.h"
 
 #import "FMDatabaseQueue.h"
 #import "FMResultSet.h"
@@ -43,12 +46,24 @@
 
 #define DATA_STORE_REQUIRED() do {if (!_dataStore)[NSException raise:NSInvalidArgumentException format:@"Error: dataStore is required by %@.", NSStringFromSelector(_cmd)]; } while (0)
 #define CLASS_OR_NIL(object, kind) ( kind *)([object isKindOfClass:[kind class]] ? object : nil)
+#define REQUIRE_WRITABLE_DATA_STORE() do {if ([_dataStore isReadOnly])[NSException raise:NSInvalidArgumentException format:@"Error: %@ can not be called on an object from a read only data store.", NSStringFromSelector(_cmd)]; } while (0)
 #define REQUIRE_SUBCLASS_IMPLEMENTATION() do { [NSException raise:NSInternalInconsistencyException format:@"Error: You must implement %@ in your subclass.", NSStringFromSelector(_cmd)];} while (0)
 
+static inline BOOL RHSQLiteObjectIsLoaded(RHSQLiteObject *object); //_loaded, once any update change tracking has seen since our last look has been applied
+
 
 @interface RHSQLiteObject ()
 //private
--(BOOL)_processLoadResultsDictionary:(NSDictionary*)dictionary;
+-(BOOL)_processLoadResultSet:(FMResultSet*)resultSet;
+
+//slots
+-(RHSQLiteRowSlot*)_slotForColumn:(NSString*)columnName; //loads if required, NULL if we have no slots
+-(id)_storedObjectForColumn:(NSString*)columnName; //the raw, still encoded value
+-(int64_t)_int64ForColumn:(NSString*)columnName;
+-(double)_doubleForColumn:(NSString*)columnName;
+-(void)_setInt64:(int64_t)value forColumn:(NSString*)columnName;
+-(void)_setDouble:(double)value forColumn:(NSString*)columnName;
+-(void)_getUnsavedColumnNames:(NSArray**)namesOut values:(NSArray**)valuesOut;
 
 //handle the encoding of non storable database types aka colors and urls etc by using NSKeyedArchiver
 //passes through NSData NSString NSNumber NSNull
@@ -80,8 +95,9 @@ extern id RHSQLiteObjectValueDecode(RHSQLiteDataStore *dataStore, id objectToBeD
         _dataStore = dataStore;
         _objectID = objectID;
         
-        _loadedColumnsAndValues = [[NSMutableDictionary alloc] init];
-        _unsavedChanges = [[NSMutableDictionary alloc] init];
+        _rowLayout = nil; //slots are allocated once we know our tables layout
+        _slots = NULL;
+        _unsavedChanges = nil; //objects that are only ever read never need this
         
         if (_dataStore && _objectID < RHSQLiteObjectIDNotYetAvailable)[_dataStore _objectCheckIn:self];
     }
@@ -90,6 +106,14 @@ extern id RHSQLiteObjectValueDecode(RHSQLiteDataStore *dataStore, id objectToBeD
     return self;
 }
 
+-(id)_initUncachedWithDataStore:(RHSQLiteDataStore*)dataStore objectID:(RHSQLiteObjectID)objectID{
+    self = [self initWithDataStore:nil objectID:objectID];
+    if (self){
+        _dataStore = dataStore;
+    }
+    return self;
+}
+
 -(id)initWithDataStore:(RHSQLiteDataStore*)dataStore{
     return [self initWithDataStore:dataStore objectID:RHSQLiteObjectIDNotYetAvailable];
 }
@@ -104,6 +128,8 @@ extern id RHSQLiteObjectValueDecode(RHSQLiteDataStore *dataStore, id objectToBeD
 
     _dataStore = nil;
 
+    RHSQLiteRowSlotsFree(_slots, _rowLayout.count);
+    _slots = NULL;
 }
 
 
@@ -112,6 +138,7 @@ extern id RHSQLiteObjectValueDecode(RHSQLiteDataStore *dataStore, id objectToBeD
     if (_dataStore == dataStore || !_dataStore){
         _dataStore = dataStore;
         if (_dataStore && _objectID < RHSQLiteObjectIDNotYetAvailable)[_dataStore _objectCheckIn:self];
+        if (_dataStore && [self hasUnsavedChanges])[self _markDirty];
         return YES; //no change
     }
 
@@ -140,6 +167,11 @@ extern id RHSQLiteObjectValueDecode(RHSQLiteDataStore *dataStore, id objectToBeD
 }
 
 
+#pragma mark - schema hash
++(NSString*)schemaHash{
+    return nil;
+}
+
 #pragma mark - object ID
 -(RHSQLiteObjectID)objectID{
     return _objectID;
@@ -147,12 +179,12 @@ extern id RHSQLiteObjectValueDecode(RHSQLiteDataStore *dataStore, id objectToBeD
 
 #pragma mark - loading
 -(BOOL)needsLoading{
-    return !_loaded;
+    return !RHSQLiteObjectIsLoaded(self);
 }
 
 -(BOOL)load{
     DATA_STORE_REQUIRED();
-    if (_loaded) return YES;
+    if (RHSQLiteObjectIsLoaded(self)) return YES;
     
     //invalid id
     if (_objectID == RHSQLiteObjectIDInvalid){
@@ -167,14 +199,20 @@ extern id RHSQLiteObjectValueDecode(RHSQLiteDataStore *dataStore, id objectToBeD
     }
     
     
+    //make sure we have a layout before we enter the database block
+    if (![self _prepareSlots]){
+        RHErrorLog(@"Error: Unable to load RHSQliteObject from unknown table: %@.", [self tableName]);
+        return NO;
+    }
+    
     __block BOOL result = NO;
-    [_dataStore accessDatabase:^(FMDatabase *db) {
+    [_dataStore _accessDatabaseForStatementKind:RHSQLiteStatementKindLoad queue:[_dataStore _databaseQueueForTable:[self tableName]] object:nil block:^(FMDatabase *db) {
         FMResultSet *resultSet = [db executeQuery:[self loadSQL]];
         if ([resultSet next]){
-            result = [self _processLoadResultsDictionary:[resultSet resultDictionary]];
+            result = [self _processLoadResultSet:resultSet];
         } else {
             RHErrorLog(@"Error: Load failed with error: %@.", [db lastError]);
-            result = [self _processLoadResultsDictionary:nil];
+            result = [self _processLoadResultSet:nil];
         }
         [resultSet close];
     } ];
@@ -185,25 +223,253 @@ extern id RHSQLiteObjectValueDecode(RHSQLiteDataStore *dataStore, id objectToBeD
 }
 
 -(BOOL)reload{
-    BOOL previouslyLoaded = _loaded;
+    BOOL previouslyLoaded = RHSQLiteObjectIsLoaded(self);
     _loaded = NO;
     BOOL result = [self load];
     _loaded = previouslyLoaded;
     return result;
 }
 
--(BOOL)_processLoadResultsDictionary:(NSDictionary*)dictionary{
-    [_loadedColumnsAndValues removeAllObjects];
-    if (!dictionary){
+-(BOOL)_loadFromResultSet:(FMResultSet*)resultSet{
+    if (![self _prepareSlots]) return NO;
+    
+    BOOL result = [self _processLoadResultSet:resultSet];
+    _loaded = result;
+    return result;
+}
+
+-(BOOL)_processLoadResultSet:(FMResultSet*)resultSet{
+    if (!resultSet){
         RHErrorLog(@"Error: Failed to load RHSQliteObject with ID: %lli.", _objectID);
         _objectID = RHSQLiteObjectIDInvalid;
         return NO;
     }
     
-    [_loadedColumnsAndValues addEntriesFromDictionary:dictionary];
+    //unsaved changes are left in place
+    uint32_t *dirtyBits = RHSQLiteRowSlotsDirtyBits(_slots, _rowLayout.count);
+    BOOL result = [_rowLayout fillSlots:_slots skippingDirtyBits:dirtyBits fromResultSet:resultSet];
+    if (result) [[_dataStore _metrics] recordRowsHydrated:1];
+    
+    //saved values that the write behind queue has yet to commit are newer than the row
+    NSDictionary *pendingValues = [[_dataStore _writeBehindQueue] pendingValuesForTable:[self tableName] objectID:_objectID];
+    for (NSString *columnName in pendingValues) {
+        NSUInteger index = [_rowLayout slotIndexForColumn:columnName];
+        if (index == NSNotFound || RHSQLiteRowDirtyBitIsSet(dirtyBits, index)) continue;
+        RHSQLiteRowSlotSetObject(&_slots[index], [pendingValues objectForKey:columnName]);
+    }
+    
+    return result;
+}
+
+
+#pragma mark - change tracking
+-(void)_rowWasUpdated{
+    //just flag ourselves, the slots (and _loaded) are only ever touched by the thread using this object
+    __sync_fetch_and_add(&_externalUpdateCount, 1);
+}
+
+-(void)_rowWasDeleted{
+    //same as a local delete, our last loaded values remain readable
+    __sync_lock_test_and_set(&_externallyDeleted, 1);
+}
+
+static inline BOOL RHSQLiteObjectIsLoaded(RHSQLiteObject *object){
+    int32_t updateCount = object->_externalUpdateCount;
+    if (updateCount != object->_appliedExternalUpdateCount){
+        //taken before we reload, so an update that lands mid load is applied on the following access
+        __sync_synchronize();
+        object->_appliedExternalUpdateCount = updateCount;
+        object->_loaded = NO;
+    }
+    return object->_loaded;
+}
+
+
+#pragma mark - unit of work
+-(void)_markDirty{
+    if (_trackedAsDirty || !_dataStore) return;
+    _trackedAsDirty = YES;
+    [_dataStore _objectDidBecomeDirty:self];
+}
+
+-(void)_clearDirtyTracking{
+    _trackedAsDirty = NO;
+}
+
+-(void)_didSaveWithObjectID:(RHSQLiteObjectID)objectID{
+    if (_slots){
+        RHSQLiteRowDirtyBitsClearAll(RHSQLiteRowSlotsDirtyBits(_slots, _rowLayout.count), _rowLayout.count);
+    }
+    
+    //our slots already hold what was written, only new rows need reading back (for their defaults)
+    if (![self hasBeenCreated] && objectID < RHSQLiteObjectIDNotYetAvailable){
+        _objectID = objectID;
+        _loaded = NO;
+        [_dataStore _objectCheckIn:self];
+    }
+}
+
+
+#pragma mark - slots
+-(BOOL)_prepareSlots{
+    if (!_dataStore) return NO;
+    
+    RHSQLiteRowLayout *layout = [_dataStore _rowLayoutForTable:[self tableName]];
+    if (!layout) return NO;
+    if (layout == _rowLayout) return YES;
+    
+    NSUInteger count = layout.count;
+    RHSQLiteRowSlot *slots = RHSQLiteRowSlotsCreate(count);
+    uint32_t *dirtyBits = RHSQLiteRowSlotsDirtyBits(slots, count);
+    
+    //the tables columns have changed since we last loaded, carry over our unsaved changes. loaded values are refetched.
+    if (_slots){
+        NSUInteger oldCount = _rowLayout.count;
+        uint32_t *oldDirtyBits = RHSQLiteRowSlotsDirtyBits(_slots, oldCount);
+        for (NSUInteger i = 0; i < oldCount; i++) {
+            if (!RHSQLiteRowDirtyBitIsSet(oldDirtyBits, i)) continue;
+            
+            NSString *columnName = [_rowLayout columnNameForSlotIndex:i];
+            NSUInteger index = [layout slotIndexForColumn:columnName];
+            if (index == NSNotFound){
+                RHErrorLog(@"Warning: Discarding unsaved change for column: %@ which no longer exists in table: %@.", columnName, [self tableName]);
+                continue;
+            }
+            
+            //move, rather than copy, so that the old slot no longer owns any object value
+            slots[index] = _slots[i];
+            _slots[i].type = RHSQLiteRowSlotTypeUnset;
+            RHSQLiteRowDirtyBitSet(dirtyBits, index);
+        }
+        RHSQLiteRowSlotsFree(_slots, oldCount);
+        _loaded = NO;
+    }
+    
+    //and any changes made before we were associated with a data store
+    for (NSString *columnName in _unsavedChanges) {
+        NSUInteger index = [layout slotIndexForColumn:columnName];
+        if (index == NSNotFound){
+            RHErrorLog(@"Warning: Discarding unsaved change for unknown column: %@ in table: %@.", columnName, [self tableName]);
+            continue;
+        }
+        RHSQLiteRowSlotSetObject(&slots[index], [_unsavedChanges objectForKey:columnName]);
+        RHSQLiteRowDirtyBitSet(dirtyBits, index);
+    }
+    _unsavedChanges = nil;
+    
+    _rowLayout = layout;
+    _rowLayoutSerial = layout.serial;
+    _slots = slots;
     return YES;
 }
 
+-(RHSQLiteRowSlot*)_slotForColumn:(NSString*)columnName{
+    if (![self hasColumn:columnName]){
+        [NSException raise:NSInvalidArgumentException format:@"Error: Unable to get the value for unknown column: %@.", columnName];
+        return NULL;
+    }
+    
+    //adopting a new layout marks us as needing a load, so do that first
+    if (![self _prepareSlots]) return NULL;
+    if ([self needsLoading])[self load];
+    
+    NSUInteger index = [_rowLayout slotIndexForColumn:columnName];
+    return index == NSNotFound ? NULL : &_slots[index];
+}
+
+-(id)_storedObjectForColumn:(NSString*)columnName{
+    if (_slots){
+        NSUInteger index = [_rowLayout slotIndexForColumn:columnName];
+        return index == NSNotFound ? nil : RHSQLiteRowSlotGetObject(&_slots[index]);
+    }
+    return [_unsavedChanges objectForKey:columnName];
+}
+
+-(int64_t)_int64ForColumn:(NSString*)columnName{
+    RHSQLiteRowSlot *slot = [self _slotForColumn:columnName];
+    if (slot && slot->type == RHSQLiteRowSlotTypeInteger) return slot->integerValue;
+    if (slot && slot->type == RHSQLiteRowSlotTypeDouble) return (int64_t)slot->doubleValue;
+    
+    //text, blobs etc. take the long way round
+    return [[self numberForColumn:columnName] longLongValue];
+}
+
+-(double)_doubleForColumn:(NSString*)columnName{
+    RHSQLiteRowSlot *slot = [self _slotForColumn:columnName];
+    if (slot && slot->type == RHSQLiteRowSlotTypeDouble) return slot->doubleValue;
+    if (slot && slot->type == RHSQLiteRowSlotTypeInteger) return (double)slot->integerValue;
+    
+    return [[self numberForColumn:columnName] doubleValue];
+}
+
+-(void)_setInt64:(int64_t)value forColumn:(NSString*)columnName{
+    REQUIRE_WRITABLE_DATA_STORE();
+    if (![self hasColumn:columnName]){
+        [NSException raise:NSInvalidArgumentException format:@"Error: Unable to set the value for unknown column: %@.", columnName];
+        return;
+    }
+    if (![self _prepareSlots]){
+        [self setObject:[NSNumber numberWithLongLong:value] forColumn:columnName];
+        return;
+    }
+    
+    NSUInteger index = [_rowLayout slotIndexForColumn:columnName];
+    NSString *propertyName = [self propertyNameForColumn:columnName];
+    [self willChangeValueForKey:propertyName];
+    RHSQLiteRowSlotClear(&_slots[index]);
+    _slots[index].type = RHSQLiteRowSlotTypeInteger;
+    _slots[index].integerValue = value;
+    RHSQLiteRowDirtyBitSet(RHSQLiteRowSlotsDirtyBits(_slots, _rowLayout.count), index);
+    [self _markDirty];
+    [self didChangeValueForKey:propertyName];
+}
+
+-(void)_setDouble:(double)value forColumn:(NSString*)columnName{
+    REQUIRE_WRITABLE_DATA_STORE();
+    if (![self hasColumn:columnName]){
+        [NSException raise:NSInvalidArgumentException format:@"Error: Unable to set the value for unknown column: %@.", columnName];
+        return;
+    }
+    if (![self _prepareSlots]){
+        [self setObject:[NSNumber numberWithDouble:value] forColumn:columnName];
+        return;
+    }
+    
+    NSUInteger index = [_rowLayout slotIndexForColumn:columnName];
+    NSString *propertyName = [self propertyNameForColumn:columnName];
+    [self willChangeValueForKey:propertyName];
+    RHSQLiteRowSlotClear(&_slots[index]);
+    _slots[index].type = RHSQLiteRowSlotTypeDouble;
+    _slots[index].doubleValue = value;
+    RHSQLiteRowDirtyBitSet(RHSQLiteRowSlotsDirtyBits(_slots, _rowLayout.count), index);
+    [self _markDirty];
+    [self didChangeValueForKey:propertyName];
+}
+
+-(void)_getUnsavedColumnNames:(NSArray**)namesOut values:(NSArray**)valuesOut{
+    NSMutableArray *names = [NSMutableArray array];
+    NSMutableArray *values = [NSMutableArray array];
+    
+    if (_slots){
+        NSUInteger count = _rowLayout.count;
+        uint32_t *dirtyBits = RHSQLiteRowSlotsDirtyBits(_slots, count);
+        for (NSUInteger i = 0; i < count; i++) {
+            if (!RHSQLiteRowDirtyBitIsSet(dirtyBits, i)) continue;
+            id value = RHSQLiteRowSlotGetObject(&_slots[i]);
+            [names addObject:[_rowLayout columnNameForSlotIndex:i]];
+            [values addObject:value ? value : [NSNull null]];
+        }
+    } else {
+        for (NSString *columnName in _unsavedChanges) {
+            [names addObject:columnName];
+            [values addObject:[_unsavedChanges objectForKey:columnName]];
+        }
+    }
+    
+    if (namesOut) *namesOut = names;
+    if (valuesOut) *valuesOut = values;
+}
+
 
 #pragma mark - known column properties support
 -(id)valueForUndefinedKey:(NSString *)key{
@@ -244,19 +510,15 @@ extern id RHSQLiteObjectValueDecode(RHSQLiteDataStore *dataStore, id objectToBeD
         return nil;
     }
 
-    //load
+    //adopting a new layout marks us as needing a load, so do that first
+    [self _prepareSlots];
     if ([self needsLoading])[self load];
     
-    //first check unsaved properties
-    id result = RHSQLiteObjectValueDecode(_dataStore, [_unsavedChanges objectForKey:columnName], [self classForColumn:columnName]);
-    if (result) return result;
-
-    //now loaded values
-    result = RHSQLiteObjectValueDecode(_dataStore, [_loadedColumnsAndValues objectForKey:columnName], [self classForColumn:columnName]);
-    if (result) return result;
+    //unsaved changes and loaded values share the same slot
+    id result = [self _storedObjectForColumn:columnName];
+    if (!result) return nil;
     
-    //RHLog(@"Failed to find value for columnName %@", columnName);
-    return nil;
+    return RHSQLiteObjectValueDecode(_dataStore, result, [self classForColumn:columnName]);
 }
 
 -(id)objectForKeyedSubscript:(NSString *)columnName{
@@ -269,16 +531,28 @@ extern id RHSQLiteObjectValueDecode(RHSQLiteDataStore *dataStore, id objectToBeD
 
 #pragma mark - object setters
 -(void)setObject:(id)obj forColumn:(NSString*)columnName{
+    REQUIRE_WRITABLE_DATA_STORE();
     if (![self hasColumn:columnName]){
         [NSException raise:NSInvalidArgumentException format:@"Error: Unable to set the value for unknown column: %@.", columnName];
         return;
     }
 
-    //always save into unsaved changes
     if (!obj) obj = [NSNull null];
-    [self willChangeValueForKey:[self propertyNameForColumn:columnName]];
-    [_unsavedChanges setObject:RHSQLiteObjectValueEncode(_dataStore, obj) forKey:columnName];
-    [self didChangeValueForKey:[self propertyNameForColumn:columnName]];
+    id value = RHSQLiteObjectValueEncode(_dataStore, obj);
+    NSString *propertyName = [self propertyNameForColumn:columnName];
+    
+    [self willChangeValueForKey:propertyName];
+    if ([self _prepareSlots]){
+        NSUInteger index = [_rowLayout slotIndexForColumn:columnName];
+        RHSQLiteRowSlotSetObject(&_slots[index], value);
+        RHSQLiteRowDirtyBitSet(RHSQLiteRowSlotsDirtyBits(_slots, _rowLayout.count), index);
+    } else {
+        //no data store yet, hold on to it until we have a layout
+        if (!_unsavedChanges) _unsavedChanges = [[NSMutableDictionary alloc] init];
+        [_unsavedChanges setObject:value forKey:columnName];
+    }
+    [self _markDirty];
+    [self didChangeValueForKey:propertyName];
 }
 
 -(void)setObject:(id)obj forKeyedSubscript:(NSString*)columnName{
@@ -314,87 +588,90 @@ extern id RHSQLiteObjectValueDecode(RHSQLiteDataStore *dataStore, id objectToBeD
 }
 
 
-#pragma mark - primitive getters
+#pragma mark - primitive getters (these read straight from our slots, without boxing)
 -(BOOL)boolForColumn:(NSString*)columnName{
+    RHSQLiteRowSlot *slot = [self _slotForColumn:columnName];
+    if (slot && slot->type == RHSQLiteRowSlotTypeInteger) return slot->integerValue != 0;
+    if (slot && slot->type == RHSQLiteRowSlotTypeDouble) return slot->doubleValue != 0.0;
     return [[self numberForColumn:columnName] boolValue];
 }
 
 -(int)intForColumn:(NSString*)columnName{
-    return [[self numberForColumn:columnName] intValue];
+    return (int)[self _int64ForColumn:columnName];
 }
 
 -(long)longForColumn:(NSString*)columnName{
-    return [[self numberForColumn:columnName] longValue];
+    return (long)[self _int64ForColumn:columnName];
 }
 
 -(unsigned long)unsignedLongForColumn:(NSString*)columnName{
-    return [[self numberForColumn:columnName] unsignedLongValue];
+    return (unsigned long)[self _int64ForColumn:columnName];
 }
 
 -(long long)longLongForColumn:(NSString*)columnName{
-    return [[self numberForColumn:columnName] longLongValue];
+    return [self _int64ForColumn:columnName];
 }
 
 -(unsigned long long)unsignedLongLongForColumn:(NSString*)columnName{
-    return [[self numberForColumn:columnName] unsignedLongLongValue];
+    return (unsigned long long)[self _int64ForColumn:columnName];
 }
 
 -(double)doubleForColumn:(NSString*)columnName{
-    return [[self numberForColumn:columnName] doubleValue];
+    return [self _doubleForColumn:columnName];
 }
 
 -(float)floatForColumn:(NSString*)columnName{
-    return [[self numberForColumn:columnName] floatValue];
+    return (float)[self _doubleForColumn:columnName];
 }
 
 -(NSInteger)integerForColumn:(NSString*)columnName{
-    return [[self numberForColumn:columnName] integerValue];
+    return (NSInteger)[self _int64ForColumn:columnName];
 }
 
 -(NSUInteger)unsignedIntegerForColumn:(NSString*)columnName{
-    return [[self numberForColumn:columnName] unsignedIntegerValue];
+    return (NSUInteger)[self _int64ForColumn:columnName];
 }
 
 
-#pragma mark - primitive setters
+#pragma mark - primitive setters (these write straight into our slots, without boxing)
 -(void)setBool:(BOOL)value forColumn:(NSString*)columnName{
-    [self setObject:[NSNumber numberWithBool:value] forColumn:columnName];
+    [self _setInt64:(int64_t)value forColumn:columnName];
 }
 
 -(void)setInt:(int)value forColumn:(NSString*)columnName{
-    [self setObject:[NSNumber numberWithInt:value] forColumn:columnName];
+    [self _setInt64:(int64_t)value forColumn:columnName];
 }
 
 -(void)setLong:(long)value forColumn:(NSString*)columnName{
-    [self setObject:[NSNumber numberWithLong:value] forColumn:columnName];
+    [self _setInt64:(int64_t)value forColumn:columnName];
 }
 
 -(void)setUnsignedLong:(unsigned long)value forColumn:(NSString*)columnName{
-    [self setObject:[NSNumber numberWithUnsignedLong:value] forColumn:columnName];
+    [self _setInt64:(int64_t)value forColumn:columnName];
 }
 
 -(void)setLongLong:(long long)value forColumn:(NSString*)columnName{
-    [self setObject:[NSNumber numberWithLongLong:value] forColumn:columnName];
+    [self _setInt64:(int64_t)value forColumn:columnName];
 }
 
 -(void)setUnsignedLongLong:(unsigned long long)value forColumn:(NSString*)columnName{
-    [self setObject:[NSNumber numberWithUnsignedLongLong:value] forColumn:columnName];
+    [self _setInt64:(int64_t)value forColumn:columnName];
 }
 
 -(void)setDouble:(double)value forColumn:(NSString*)columnName{
-    [self setObject:[NSNumber numberWithDouble:value] forColumn:columnName];
+    [self _setDouble:(double)value forColumn:columnName];
 }
 
 -(void)setFloat:(float)value forColumn:(NSString*)columnName{
-    [self setObject:[NSNumber numberWithFloat:value] forColumn:columnName];
+    [self _setDouble:(double)value forColumn:columnName];
 }
 
 -(void)setInteger:(NSInteger)value forColumn:(NSString*)columnName{
-    [self setObject:[NSNumber numberWithInteger:value] forColumn:columnName];
+    [self _setInt64:(int64_t)value forColumn:columnName];
 }
 
 -(void)setUnsignedInteger:(NSUInteger)value forColumn:(NSString*)columnName{
-    [self setObject:[NSNumber numberWithUnsignedInteger:value] forColumn:columnName];
+    [self _setInt64:(int64_t)value forColumn:columnName];
 }
 
 
@@ -412,7 +689,8 @@ extern id RHSQLiteObjectValueDecode(RHSQLiteDataStore *dataStore, id objectToBeD
         return YES;
     }
     
-    return [[self columnNames] containsObject:columnName];
+    //our own layout is only as current as our last load, so ask the data store
+    return [[_dataStore _rowLayoutForTable:[self tableName]] slotIndexForColumn:columnName] != NSNotFound;
 }
 
 -(NSString*)columnNameForProperty:(NSString*)propertyName{
@@ -453,8 +731,8 @@ extern id RHSQLiteObjectValueDecode(RHSQLiteDataStore *dataStore, id objectToBeD
     Class result = [[self class] classForProperty:propertyName];
     if (result) return result;
     
-    //if that failed, use our current values class
-    result = [[self objectForColumn:columnName] class];
+    //if that failed, use our current (still encoded) values class
+    result = [[self _storedObjectForColumn:columnName] class];
     
     //if its NULL, fall through to the data store column type
     if ([result isKindOfClass:[NSNull class]]){
@@ -476,31 +754,52 @@ extern id RHSQLiteObjectValueDecode(RHSQLiteDataStore *dataStore, id objectToBeD
 
 #pragma mark - saving
 -(BOOL)hasUnsavedChanges{
-    return [[_unsavedChanges allKeys] count] > 0;
+    if (_slots && RHSQLiteRowDirtyBitsAnySet(RHSQLiteRowSlotsDirtyBits(_slots, _rowLayout.count), _rowLayout.count)) return YES;
+    return [_unsavedChanges count] > 0;
 }
 
 -(BOOL)save{
     return [self saveWithError:nil];
 }
 -(BOOL)saveWithError:(NSError**)errorOut{
-    DATA_STORE_REQUIRED();
+    DATA_STORE_REQUIRED(); REQUIRE_WRITABLE_DATA_STORE();
+    
+    //inside a unit of work we are written along with everything else when it ends
+    if ([_dataStore _isPerformingUnitOfWork]){
+        [self _markDirty];
+        return YES;
+    }
     
     if (![self hasBeenCreated]){
         RHLog(@"Note: Object not yet created. Forwarding to createWithError:.");
         return [self createWithError:errorOut];
     }
         
+    //move any changes made before we had a data store into our slots, dropping unknown columns
+    BOOL hasSlots = [self _prepareSlots];
+    
     //if we have no changes. we are already saved...
     if (![self hasUnsavedChanges]) return YES;
     
-    //TODO: When saving, make sure that only valid keys in _unsavedChanges are included in the save query.
-    // Before a datastore is associated we allow stuff to be stored for any column name.
+    //write behind data stores queue our changes, we treat them as saved from here on
+    RHSQLiteWriteBehindQueue *writeBehindQueue = [_dataStore _writeBehindQueue];
+    if (writeBehindQueue && hasSlots){
+        NSArray *names = nil;
+        NSArray *values = nil;
+        [self _getUnsavedColumnNames:&names values:&values];
+        
+        //from inside a database block the writer can't take the connection until we return, so don't wait on it
+        BOOL waitIfFull = ![_dataStore _isAccessingWritableDatabase];
+        if (![writeBehindQueue enqueueValues:values forColumns:names inTable:[self tableName] primaryKeyName:[self primaryKeyName] objectID:_objectID waitIfFull:waitIfFull error:errorOut]) return NO; //our changes stay unsaved
+        RHSQLiteRowDirtyBitsClearAll(RHSQLiteRowSlotsDirtyBits(_slots, _rowLayout.count), _rowLayout.count);
+        return YES;
+    }
 
     __block BOOL result = NO;
     RHLog(@"Saving all unsaved changes.");
         
     //perform the save
-    [_dataStore accessDatabase:^(FMDatabase *db) {
+    [_dataStore _accessDatabaseForStatementKind:RHSQLiteStatementKindSave object:self block:^(FMDatabase *db) {
 
         NSArray *args = nil;
         NSString *sql = [self saveSQLWithArguments:&args];
@@ -515,8 +814,8 @@ extern id RHSQLiteObjectValueDecode(RHSQLiteDataStore *dataStore, id objectToBeD
     }];
     
     //clear out unsaved changes if successful
-    if (result){
-        [_unsavedChanges removeAllObjects];
+    if (result && _slots){
+        RHSQLiteRowDirtyBitsClearAll(RHSQLiteRowSlotsDirtyBits(_slots, _rowLayout.count), _rowLayout.count);
     }
     
     [self reload];
@@ -527,6 +826,19 @@ extern id RHSQLiteObjectValueDecode(RHSQLiteDataStore *dataStore, id objectToBeD
 -(BOOL)revert{
     RHLog(@"Reverting all unsaved changes.");
     [_unsavedChanges removeAllObjects];
+    
+    if (_slots){
+        //dirty slots no longer hold their loaded values, so drop them and reload on next access
+        NSUInteger count = _rowLayout.count;
+        uint32_t *dirtyBits = RHSQLiteRowSlotsDirtyBits(_slots, count);
+        if (RHSQLiteRowDirtyBitsAnySet(dirtyBits, count)){
+            for (NSUInteger i = 0; i < count; i++) {
+                if (RHSQLiteRowDirtyBitIsSet(dirtyBits, i)) RHSQLiteRowSlotClear(&_slots[i]);
+            }
+            RHSQLiteRowDirtyBitsClearAll(dirtyBits, count);
+            _loaded = NO;
+        }
+    }
     return YES;
 }
 
@@ -540,10 +852,10 @@ extern id RHSQLiteObjectValueDecode(RHSQLiteDataStore *dataStore, id objectToBeD
 }
 
 -(BOOL)createWithError:(NSError**)errorOut{
-    DATA_STORE_REQUIRED();
+    DATA_STORE_REQUIRED(); REQUIRE_WRITABLE_DATA_STORE();
     
-    //TODO: When saving, make sure that only valid keys in _unsavedChanges are included in the save query.
-    // Before a datastore is associated we allow stuff to be stored for any column name.
+    //move any changes made before we had a data store into our slots, dropping unknown columns
+    [self _prepareSlots];
     
     __block BOOL result = NO;
     __block RHSQLiteObjectID newID = RHSQLiteObjectIDInvalid;
@@ -554,7 +866,7 @@ extern id RHSQLiteObjectValueDecode(RHSQLiteDataStore *dataStore, id objectToBeD
     }
     
     //perform the creation
-    [_dataStore accessDatabase:^(FMDatabase *db) {
+    [_dataStore _accessDatabaseForStatementKind:RHSQLiteStatementKindCreate object:self block:^(FMDatabase *db) {
         
         NSArray *args = nil;
         NSString *sql = [self createSQLWithArguments:&args];
@@ -571,8 +883,8 @@ extern id RHSQLiteObjectValueDecode(RHSQLiteDataStore *dataStore, id objectToBeD
     _objectID = newID;
 
     //clear out unsaved changes if successful
-    if (result){
-        [_unsavedChanges removeAllObjects];
+    if (result && _slots){
+        RHSQLiteRowDirtyBitsClearAll(RHSQLiteRowSlotsDirtyBits(_slots, _rowLayout.count), _rowLayout.count);
     }
 
     [self reload];
@@ -587,16 +899,17 @@ extern id RHSQLiteObjectValueDecode(RHSQLiteDataStore *dataStore, id objectToBeD
 
 #pragma mark - deletion
 -(BOOL)hasBeenDeleted{
-    return _deleted;
+    return _deleted || _externallyDeleted;
 }
 
 -(BOOL)delete{
-    DATA_STORE_REQUIRED();
+    DATA_STORE_REQUIRED(); REQUIRE_WRITABLE_DATA_STORE();
     if ([self hasBeenDeleted]) return YES;
 
     __block BOOL result = NO;
     if ([self hasBeenCreated]){
-        [_dataStore accessDatabase:^(FMDatabase *db) {
+        [[_dataStore _writeBehindQueue] discardPendingValuesForTable:[self tableName] objectID:_objectID];
+        [_dataStore _accessDatabaseForStatementKind:RHSQLiteStatementKindDelete object:self block:^(FMDatabase *db) {
             result = [db executeUpdate:[self deleteSQL]];
         }];
     } else {
@@ -621,16 +934,28 @@ extern id RHSQLiteObjectValueDecode(RHSQLiteDataStore *dataStore, id objectToBeD
 -(NSDictionary*)dictionaryRepresentation{
     [self load];
     NSMutableDictionary *result = [NSMutableDictionary dictionary];
-    [_loadedColumnsAndValues enumerateKeysAndObjectsUsingBlock:^(id key, id obj, BOOL *stop) {
-        [result setObject:RHSQLiteObjectValueDecode(_dataStore, obj, [self classForColumn:key]) forKey:[self dictionaryKeyForColumn:key]];
-    }];
+    if (!_slots) return result;
+    
+    NSUInteger count = _rowLayout.count;
+    for (NSUInteger i = 0; i < count; i++) {
+        if (_slots[i].type == RHSQLiteRowSlotTypeUnset) continue;
+        
+        NSString *columnName = [_rowLayout columnNameForSlotIndex:i];
+        id value = RHSQLiteObjectValueDecode(_dataStore, RHSQLiteRowSlotGetObject(&_slots[i]), [self classForColumn:columnName]);
+        [result setObject:value ? value : [NSNull null] forKey:[self dictionaryKeyForColumn:columnName]];
+    }
     return [NSDictionary dictionaryWithDictionary:result];
 }
 
 -(NSDictionary*)unsavedDictionaryRepresentation{
+    NSArray *names = nil;
+    NSArray *values = nil;
+    [self _getUnsavedColumnNames:&names values:&values];
+    
     NSMutableDictionary *result = [NSMutableDictionary dictionary];
-    [_unsavedChanges enumerateKeysAndObjectsUsingBlock:^(id key, id obj, BOOL *stop) {
-        [result setObject:RHSQLiteObjectValueDecode(_dataStore, obj, [self classForColumn:key]) forKey:[self dictionaryKeyForColumn:key]];
+    [names enumerateObjectsUsingBlock:^(id columnName, NSUInteger idx, BOOL *stop) {
+        id value = RHSQLiteObjectValueDecode(_dataStore, [values objectAtIndex:idx], [self classForColumn:columnName]);
+        [result setObject:value ? value : [NSNull null] forKey:[self dictionaryKeyForColumn:columnName]];
     }];
     return [NSDictionary dictionaryWithDictionary:result];
 }
@@ -651,20 +976,19 @@ extern id RHSQLiteObjectValueDecode(RHSQLiteDataStore *dataStore, id objectToBeD
 -(NSString*)createSQLWithArguments:(NSArray **)argumentsOut{
     if (argumentsOut) *argumentsOut = nil;
     if ([self hasBeenCreated]) return nil;
-    if ([_unsavedChanges count] < 1){
+    
+    NSArray *names = nil;
+    NSArray *values = nil;
+    [self _getUnsavedColumnNames:&names values:&values];
+    
+    if ([names count] < 1){
         //if we have no current unsaved values, lets try and save with NSNull for our primaryKeyName
         if (argumentsOut) *argumentsOut = [NSArray arrayWithObject:[NSNull null]];
         return [NSString stringWithFormat:@"INSERT INTO %@ (%@) VALUES (?);", [self tableName], [self primaryKeyName]];
     }
     
-    NSMutableArray *names = [NSMutableArray array];
-    NSMutableArray *values = [NSMutableArray array];
     NSMutableString *questions = [NSMutableString string];
-    
-    for (NSString *columnName in [_unsavedChanges allKeys]) {
-        id value = [_unsavedChanges objectForKey:columnName];
-        [names addObject:columnName];
-        [values addObject:value];
+    for (NSUInteger i = 0; i < [names count]; i++) {
         [questions appendString:@"?, "];
     }
 
@@ -684,24 +1008,21 @@ extern id RHSQLiteObjectValueDecode(RHSQLiteDataStore *dataStore, id objectToBeD
 -(NSString*)saveSQLWithArguments:(NSArray **)argumentsOut{
     if (argumentsOut) *argumentsOut = nil;
     if (![self hasBeenCreated]) return nil;
-    if ([_unsavedChanges count] < 1){
+    
+    NSArray *names = nil;
+    NSArray *values = nil;
+    [self _getUnsavedColumnNames:&names values:&values];
+    
+    if ([names count] < 1){
         RHErrorLog(@"Unable to generate save SQL statment because there are no values to save.");
         return nil;
     }
-    NSMutableArray *names = [NSMutableArray array];
-    NSMutableArray *values = [NSMutableArray array];
-    
-    for (NSString *columnName in [_unsavedChanges allKeys]) {
-        id value = [_unsavedChanges objectForKey:columnName];
-        [names addObject:columnName];
-        [values addObject:value];
-    }
     
-    //set our args
-    if (argumentsOut) *argumentsOut = [NSArray arrayWithArray:values];
+    //set our args, our ID is bound too so that every save of the same columns shares one statement
+    if (argumentsOut) *argumentsOut = [values arrayByAddingObject:[NSNumber numberWithLongLong:self.objectID]];
     
     //build our actual sql
-    NSString *sql = [NSString stringWithFormat:@"UPDATE `%@` SET `%@`=? WHERE `%@` = %llu;", [self tableName], [names componentsJoinedByString:@"`=?, `"], [self primaryKeyName], self.objectID];
+    NSString *sql = [NSString stringWithFormat:@"UPDATE `%@` SET `%@`=? WHERE `%@` = ?;", [self tableName], [names componentsJoinedByString:@"`=?, `"], [self primaryKeyName]];
     
     //return
     return sql;
@@ -724,6 +1045,131 @@ extern id RHSQLiteObjectValueDecode(RHSQLiteDataStore *dataStore, id objectToBeD
 }
 
 
+#pragma mark - column bindings
+//the bound slot index, provided the binding was last bound against the layout we are using. NSNotFound otherwise
+static inline NSUInteger RHSQLiteColumnBindingBoundIndex(RHSQLiteObject *object, RHSQLiteColumnBinding *binding){
+    uint64_t bound = binding->bound;
+    if (object->_slots && (uint32_t)(bound >> 32) == object->_rowLayoutSerial) return (NSUInteger)(uint32_t)bound;
+    return NSNotFound;
+}
+
+static inline void RHSQLiteColumnBindingBind(RHSQLiteObject *object, RHSQLiteColumnBinding *binding, NSUInteger index){
+    binding->bound = ((uint64_t)object->_rowLayoutSerial << 32) | (uint64_t)index;
+}
+
+static RHSQLiteRowSlot *RHSQLiteColumnBindingSlotForReading(RHSQLiteObject *object, RHSQLiteColumnBinding *binding){
+    //fast path, loaded and bound against our layout
+    if (RHSQLiteObjectIsLoaded(object)){
+        NSUInteger index = RHSQLiteColumnBindingBoundIndex(object, binding);
+        if (index != NSNotFound) return &object->_slots[index];
+    }
+    
+    //the long way round. validates the column, adopts the current layout and loads as required
+    RHSQLiteRowSlot *slot = [object _slotForColumn:binding->columnName];
+    if (slot) RHSQLiteColumnBindingBind(object, binding, slot - object->_slots);
+    return slot;
+}
+
+static NSUInteger RHSQLiteColumnBindingIndexForWriting(RHSQLiteObject *object, RHSQLiteColumnBinding *binding){
+    //read only data stores and unknown columns are left for the -set...forColumn: methods to raise
+    if (!object->_dataStore || [object->_dataStore isReadOnly]) return NSNotFound;
+    
+    NSUInteger index = RHSQLiteColumnBindingBoundIndex(object, binding);
+    if (index != NSNotFound) return index;
+    
+    if (![object hasColumn:binding->columnName] || ![object _prepareSlots]) return NSNotFound;
+    index = [object->_rowLayout slotIndexForColumn:binding->columnName];
+    if (index != NSNotFound) RHSQLiteColumnBindingBind(object, binding, index);
+    return index;
+}
+
+static inline void RHSQLiteColumnBindingDidWrite(RHSQLiteObject *object, NSUInteger index){
+    RHSQLiteRowDirtyBitSet(RHSQLiteRowSlotsDirtyBits(object->_slots, object->_rowLayout.count), index);
+    [object _markDirty];
+}
+
+int64_t RHSQLiteObjectGetInt64(RHSQLiteObject *object, RHSQLiteColumnBinding *binding){
+    RHSQLiteRowSlot *slot = RHSQLiteColumnBindingSlotForReading(object, binding);
+    if (slot && slot->type == RHSQLiteRowSlotTypeInteger) return slot->integerValue;
+    if (slot && slot->type == RHSQLiteRowSlotTypeDouble) return (int64_t)slot->doubleValue;
+    if (slot && slot->type == RHSQLiteRowSlotTypeNull) return 0;
+    
+    return [[object numberForColumn:binding->columnName] longLongValue];
+}
+
+double RHSQLiteObjectGetDouble(RHSQLiteObject *object, RHSQLiteColumnBinding *binding){
+    RHSQLiteRowSlot *slot = RHSQLiteColumnBindingSlotForReading(object, binding);
+    if (slot && slot->type == RHSQLiteRowSlotTypeDouble) return slot->doubleValue;
+    if (slot && slot->type == RHSQLiteRowSlotTypeInteger) return (double)slot->integerValue;
+    if (slot && slot->type == RHSQLiteRowSlotTypeNull) return 0.0;
+    
+    return [[object numberForColumn:binding->columnName] doubleValue];
+}
+
+BOOL RHSQLiteObjectGetBool(RHSQLiteObject *object, RHSQLiteColumnBinding *binding){
+    RHSQLiteRowSlot *slot = RHSQLiteColumnBindingSlotForReading(object, binding);
+    if (slot && slot->type == RHSQLiteRowSlotTypeInteger) return slot->integerValue != 0;
+    if (slot && slot->type == RHSQLiteRowSlotTypeDouble) return slot->doubleValue != 0.0;
+    if (slot && slot->type == RHSQLiteRowSlotTypeNull) return NO;
+    
+    return [[object numberForColumn:binding->columnName] boolValue];
+}
+
+id RHSQLiteObjectGetObject(RHSQLiteObject *object, RHSQLiteColumnBinding *binding, Class expectedClass){
+    RHSQLiteRowSlot *slot = RHSQLiteColumnBindingSlotForReading(object, binding);
+    id result = slot ? RHSQLiteRowSlotGetObject(slot) : [object _storedObjectForColumn:binding->columnName];
+    if (!result) return nil;
+    
+    return RHSQLiteObjectValueDecode(object->_dataStore, result, expectedClass);
+}
+
+void RHSQLiteObjectSetInt64(RHSQLiteObject *object, RHSQLiteColumnBinding *binding, int64_t value){
+    NSUInteger index = RHSQLiteColumnBindingIndexForWriting(object, binding);
+    if (index == NSNotFound){
+        [object _setInt64:value forColumn:binding->columnName];
+        return;
+    }
+    
+    [object willChangeValueForKey:binding->propertyName];
+    RHSQLiteRowSlot *slot = &object->_slots[index];
+    RHSQLiteRowSlotClear(slot);
+    slot->type = RHSQLiteRowSlotTypeInteger;
+    slot->integerValue = value;
+    RHSQLiteColumnBindingDidWrite(object, index);
+    [object didChangeValueForKey:binding->propertyName];
+}
+
+void RHSQLiteObjectSetDouble(RHSQLiteObject *object, RHSQLiteColumnBinding *binding, double value){
+    NSUInteger index = RHSQLiteColumnBindingIndexForWriting(object, binding);
+    if (index == NSNotFound){
+        [object _setDouble:value forColumn:binding->columnName];
+        return;
+    }
+    
+    [object willChangeValueForKey:binding->propertyName];
+    RHSQLiteRowSlot *slot = &object->_slots[index];
+    RHSQLiteRowSlotClear(slot);
+    slot->type = RHSQLiteRowSlotTypeDouble;
+    slot->doubleValue = value;
+    RHSQLiteColumnBindingDidWrite(object, index);
+    [object didChangeValueForKey:binding->propertyName];
+}
+
+void RHSQLiteObjectSetObject(RHSQLiteObject *object, RHSQLiteColumnBinding *binding, id value){
+    NSUInteger index = RHSQLiteColumnBindingIndexForWriting(object, binding);
+    if (index == NSNotFound){
+        [object setObject:value forColumn:binding->columnName];
+        return;
+    }
+    
+    id encoded = RHSQLiteObjectValueEncode(object->_dataStore, value ? value : [NSNull null]);
+    [object willChangeValueForKey:binding->propertyName];
+    RHSQLiteRowSlotSetObject(&object->_slots[index], encoded);
+    RHSQLiteColumnBindingDidWrite(object, index);
+    [object didChangeValueForKey:binding->propertyName];
+}
+
+
 #pragma mark - value encoding / decoding 
 id RHSQLiteObjectValueEncode(RHSQLiteDataStore *dataStore, id objectToBeEncoded){
     //simple pass throughs
@@ -748,6 +1194,7 @@ id RHSQLiteObjectValueEncode(RHSQLiteDataStore *dataStore, id objectToBeEncoded)
         NSData *data = [NSData dataWithData:mutableData];
         if (data){
             RHLog(@"Encoded %@ -> NSData using NSKeyedArchiver.", NSStringFromClass([objectToBeEncoded class]));
+            [[dataStore _metrics] recordEncodedBytes:[data length]];
             return data;
         }
     }
@@ -783,6 +1230,7 @@ id RHSQLiteObjectValueDecode(RHSQLiteDataStore *dataStore, id objectToBeDecoded,
 
     //nscoding supported objects
     if ([expectedClass instancesRespondToSelector:@selector(initWithCoder:)] || [expectedClass isSubclassOfClass:[RHSQLiteObject class]]){
+        [[dataStore _metrics] recordDecodedBytes:[objectToBeDecoded length]];
         NSKeyedUnarchiver *unarchiver = [[NSKeyedUnarchiver alloc] initForReadingWithData:objectToBeDecoded];
         [unarchiver setDelegate:dataStore];
         id result = [unarchiver decodeObjectForKey:@"root"]; // root == backwards compatible NSKeyedArchiveRootObjectKey
@@ -802,7 +1250,7 @@ id RHSQLiteObjectValueDecode(RHSQLiteDataStore *dataStore, id objectToBeDecoded,
 
 #pragma mark - description
 -(NSString*)description{
-    if (!_loaded)[self load];
+    if ([self needsLoading])[self load];
     NSString *state = [self hasBeenDeleted] ? @"DELETED" : [self hasBeenCreated] ? @"CREATED" : @"NOT-YET-CREATED";        
     return [NSString stringWithFormat:@"<%@: %p, datastore: %p, state: %@, id: %lld, values: %@, unsavedValues: %@>", NSStringFromClass([self class]), self, _dataStore, state, _objectID, [self dictionaryRepresentation], [self unsavedDictionaryRepresentation]];
 }
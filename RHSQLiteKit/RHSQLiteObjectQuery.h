@@ -39,6 +39,8 @@
     Class _objectClass;
     NSString *_where;
     NSString *_orderedBy;
+    NSString *_orderedByColumnName;
+    BOOL _ascending;
     
     NSString *_customSQL;
 }
@@ -92,6 +94,12 @@
  */
 -(void)setCustomSQL:(NSString*)customSQL;
 
+//the parts as set, nil when unset. used by the data store to decide whether a query can be split up, see -[RHSQLiteDataStore objectsMatchingQueryInParallel:]
+-(NSString*)where;
+-(NSString*)orderedByColumnName;
+-(BOOL)isAscending;
+-(NSString*)customSQL;
+
 /*!
  @method sql
  @abstract Access the generated SQL query for the instances specified params, or customSQL.
@@ -57,6 +57,8 @@
 
 -(void)setOrderedBy:(NSString*)columnName ascending:(BOOL)ascending{
     _orderedBy = [NSString stringWithFormat:@" ORDER BY `%@` %@", columnName, ascending ? @"ASC" : @"DESC"];
+    _orderedByColumnName = [columnName copy];
+    _ascending = ascending;
 }
 
 -(void)setCustomSQL:(NSString*)customSQL{
@@ -65,6 +67,22 @@
     _customSQL = [customSQL stringByReplacingOccurrencesOfString:@"SELECT " withString:[NSString stringWithFormat:@"SELECT `%@`.`%@` as '%@', ", tableName, primaryKeyName, primaryKeyName] options:NSCaseInsensitiveSearch|NSAnchoredSearch range:NSMakeRange(0, customSQL.length)];
 }
 
+-(NSString*)where{
+    return _where;
+}
+
+-(NSString*)orderedByColumnName{
+    return _orderedByColumnName;
+}
+
+-(BOOL)isAscending{
+    return _ascending;
+}
+
+-(NSString*)customSQL{
+    return _customSQL;
+}
+
 -(NSString*)sql{
     if (_customSQL) return _customSQL;
     
@@ -0,0 +1,52 @@
+//
+//  RHSQLiteObject_Private.h
+//  RHSQLiteKit
+//
+//  Created by agent on 18/10/2026.
+//  Copyright (c) 2026 Richard Heard. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions
+//  are met:
+//  1. Redistributions of source code must retain the above copyright
+//  notice, this list of conditions and the following disclaimer.
+//  2. Redistributions in binary form must reproduce the above copyright
+//  notice, this list of conditions and the following disclaimer in the
+//  documentation and/or other materials provided with the distribution.
+//  3. The name of the author may not be used to endorse or promote products
+//  derived from this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+//  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+//  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+//  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+//  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+//  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// PRIVATE : DO NOT USE UNLESS YOU KNOW WHAT YOU ARE DOING
+
+#import "RHSQLiteObject.h"
+
+@class FMResultSet;
+
+@interface RHSQLiteObject ()
+
+//change tracking. called by the data store, from any thread, when our row is changed by someone else.
+-(void)_rowWasUpdated; //loaded values are refetched on next access, unsaved changes are kept
+-(void)_rowWasDeleted;
+
+//unit of work
+-(BOOL)_prepareSlots; //adopts the data stores current row layout for our table. returns NO if we have no data store
+-(void)_markDirty; //adds us to our data stores list of objects with unsaved changes, once
+-(void)_clearDirtyTracking; //called by the data store as it removes us from that list
+-(void)_didSaveWithObjectID:(RHSQLiteObjectID)objectID; //our unsaved changes were written by a unit of work. objectID is our new ID if we were inserted
+
+//parallel scans
+-(id)_initUncachedWithDataStore:(RHSQLiteDataStore*)dataStore objectID:(RHSQLiteObjectID)objectID; //not checked in, so that it can be loaded off thread before anyone else can see it. see -[RHSQLiteDataStore _objectCheckInUnlessCached:]
+-(BOOL)_loadFromResultSet:(FMResultSet*)resultSet; //a row of ours (SELECT *) that the data store has already read. callable from inside a database block, so long as our tables row layout is already cached
+
+@end
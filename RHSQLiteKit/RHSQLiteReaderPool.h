@@ -0,0 +1,70 @@
+//
+//  RHSQLiteReaderPool.h
+//  RHSQLiteKit
+//
+//  Created by agent on 18/10/2026.
+//  Copyright (c) 2026 Richard Heard. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions
+//  are met:
+//  1. Redistributions of source code must retain the above copyright
+//  notice, this list of conditions and the following disclaimer.
+//  2. Redistributions in binary form must reproduce the above copyright
+//  notice, this list of conditions and the following disclaimer in the
+//  documentation and/or other materials provided with the distribution.
+//  3. The name of the author may not be used to endorse or promote products
+//  derived from this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+//  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+//  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+//  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+//  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+//  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// INTERNAL CLASS: DO NOT USE UNLESS YOU KNOW WHAT YOU ARE DOING
+
+#import <Foundation/Foundation.h>
+
+@class FMDatabase;
+
+//opens a new read only connection for the pool, with the data stores options applied. return nil on failure.
+typedef FMDatabase * (^RHSQLiteReaderPoolFactory)(void);
+//called just before the pool closes one of its connections, on the thread closing it
+typedef void (^RHSQLiteReaderPoolCloseHandler)(FMDatabase *db);
+
+/*!
+ @class RHSQLiteReaderPool
+ @abstract RHSQLiteReaderPool lends out a bounded number of read only connections, so that several threads can read the same file at once.
+ @discussion Connections are opened lazily, up to maximumCount, and kept open between uses. Once every connection is lent out checkOutDatabase blocks until one is returned.
+    A connection is only ever used by one thread at a time, but may move between threads from one check out to the next.
+    Everything here is safe to call from any thread.
+ */
+@interface RHSQLiteReaderPool : NSObject {
+    RHSQLiteReaderPoolFactory _factory;
+    RHSQLiteReaderPoolCloseHandler _closeHandler;
+    
+    NSCondition *_condition;        //guards everything below, signalled whenever a connection is returned
+    NSMutableArray *_idleDatabases;
+    NSUInteger _openCount;          //idle and checked out
+    NSUInteger _maximumCount;
+    BOOL _closed;
+}
+
+-(id)initWithFactory:(RHSQLiteReaderPoolFactory)factory maximumCount:(NSUInteger)maximumCount;
+
+@property (nonatomic, copy) RHSQLiteReaderPoolCloseHandler closeHandler; //set before the first check out
+
+@property (nonatomic, assign) NSUInteger maximumCount; //lowering it closes surplus connections as they are returned
+
+-(FMDatabase*)checkOutDatabase; //nil if a new connection couldn't be opened, or the pool has been closed
+-(void)checkInDatabase:(FMDatabase*)db;
+
+-(void)close; //closes idle connections now, and checked out ones as they are returned
+
+@end
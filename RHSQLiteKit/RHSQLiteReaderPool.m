@@ -0,0 +1,159 @@
+//
+//  RHSQLiteReaderPool.m
+//  RHSQLiteKit
+//
+//  Created by agent on 18/10/2026.
+//  Copyright (c) 2026 Richard Heard. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions
+//  are met:
+//  1. Redistributions of source code must retain the above copyright
+//  notice, this list of conditions and the following disclaimer.
+//  2. Redistributions in binary form must reproduce the above copyright
+//  notice, this list of conditions and the following disclaimer in the
+//  documentation and/or other materials provided with the distribution.
+//  3. The name of the author may not be used to endorse or promote products
+//  derived from this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+//  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+//  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+//  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+//  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+//  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#import "RHSQLiteReaderPool.h"
+
+#import "FMDatabase.h"
+
+@interface RHSQLiteReaderPool ()
+//private
+-(void)_closeDatabase:(FMDatabase*)db;
+@end
+
+@implementation RHSQLiteReaderPool
+
+@synthesize closeHandler=_closeHandler;
+
+-(id)initWithFactory:(RHSQLiteReaderPoolFactory)factory maximumCount:(NSUInteger)maximumCount{
+    self = [super init];
+    if (self){
+        _factory = [factory copy];
+        _condition = [[NSCondition alloc] init];
+        _idleDatabases = [[NSMutableArray alloc] init];
+        _openCount = 0;
+        _maximumCount = MAX(maximumCount, (NSUInteger)1);
+        _closed = NO;
+    }
+    return self;
+}
+
+-(void)dealloc{
+    [self close];
+}
+
+-(NSUInteger)maximumCount{
+    [_condition lock];
+    NSUInteger result = _maximumCount;
+    [_condition unlock];
+    return result;
+}
+
+-(void)setMaximumCount:(NSUInteger)maximumCount{
+    [_condition lock];
+    _maximumCount = MAX(maximumCount, (NSUInteger)1);
+    
+    //idle surplus can go now, anything checked out is closed on check in
+    while (_openCount > _maximumCount && [_idleDatabases count] > 0) {
+        [self _closeDatabase:[_idleDatabases lastObject]];
+        [_idleDatabases removeLastObject];
+        _openCount--;
+    }
+    [_condition broadcast];
+    [_condition unlock];
+}
+
+
+-(void)_closeDatabase:(FMDatabase*)db{
+    if (_closeHandler) _closeHandler(db);
+    [db close];
+}
+
+
+#pragma mark - lending
+-(FMDatabase*)checkOutDatabase{
+    [_condition lock];
+    while (!_closed && [_idleDatabases count] == 0 && _openCount >= _maximumCount) {
+        [_condition wait];
+    }
+    
+    if (_closed){
+        [_condition unlock];
+        return nil;
+    }
+    
+    FMDatabase *db = [_idleDatabases lastObject];
+    if (db){
+        [_idleDatabases removeLastObject];
+        [_condition unlock];
+        return db;
+    }
+    
+    //reserve the slot, then open outside the lock. opening can be slow and the other threads may have idle connections to hand back
+    _openCount++;
+    [_condition unlock];
+    
+    db = _factory();
+    
+    if (!db){
+        [_condition lock];
+        _openCount--;
+        [_condition broadcast];
+        [_condition unlock];
+    }
+    
+    return db;
+}
+
+-(void)checkInDatabase:(FMDatabase*)db{
+    if (!db) return;
+    
+    [_condition lock];
+    if (_closed || _openCount > _maximumCount){
+        [self _closeDatabase:db];
+        _openCount--;
+    } else {
+        [_idleDatabases addObject:db];
+    }
+    [_condition broadcast];
+    [_condition unlock];
+}
+
+-(void)close{
+    [_condition lock];
+    _closed = YES;
+    for (FMDatabase *db in _idleDatabases) {
+        [self _closeDatabase:db];
+    }
+    _openCount -= [_idleDatabases count];
+    [_idleDatabases removeAllObjects];
+    [_condition broadcast];
+    [_condition unlock];
+}
+
+
+#pragma mark - description
+-(NSString*)description{
+    [_condition lock];
+    NSString *description = [NSString stringWithFormat:@"<%@: %p, open: %lu, idle: %lu, maximum: %lu>", NSStringFromClass([self class]), self, (unsigned long)_openCount, (unsigned long)[_idleDatabases count], (unsigned long)_maximumCount];
+    [_condition unlock];
+    return description;
+}
+
+@end
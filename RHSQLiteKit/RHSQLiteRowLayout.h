@@ -0,0 +1,106 @@
+//
+//  RHSQLiteRowLayout.h
+//  RHSQLiteKit
+//
+//  Created by agent on 18/10/2026.
+//  Copyright (c) 2026 Richard Heard. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions
+//  are met:
+//  1. Redistributions of source code must retain the above copyright
+//  notice, this list of conditions and the following disclaimer.
+//  2. Redistributions in binary form must reproduce the above copyright
+//  notice, this list of conditions and the following disclaimer in the
+//  documentation and/or other materials provided with the distribution.
+//  3. The name of the author may not be used to endorse or promote products
+//  derived from this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+//  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+//  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+//  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+//  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+//  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// INTERNAL CLASS: DO NOT USE UNLESS YOU KNOW WHAT YOU ARE DOING
+
+#import <Foundation/Foundation.h>
+
+@class FMResultSet;
+
+typedef enum {
+    RHSQLiteRowSlotTypeUnset = 0,   //not yet loaded or set
+    RHSQLiteRowSlotTypeNull,
+    RHSQLiteRowSlotTypeInteger,
+    RHSQLiteRowSlotTypeDouble,
+    RHSQLiteRowSlotTypeObject,      //NSString or NSData, retained
+} RHSQLiteRowSlotType;
+
+//a single column value. integers and doubles are stored unboxed.
+typedef struct RHSQLiteRowSlot {
+    RHSQLiteRowSlotType type;
+    union {
+        int64_t integerValue;
+        double doubleValue;
+        CFTypeRef objectValue;
+    };
+} RHSQLiteRowSlot;
+
+/*!
+ @class RHSQLiteRowLayout
+ @abstract RHSQLiteRowLayout maps a tables column names to slot indexes.
+ @discussion A single layout is shared by every RHSQLiteObject loaded from the same table, so each object only needs to store its values.
+    Layouts are immutable, the data store vends a new one whenever the tables columns change.
+ */
+@interface RHSQLiteRowLayout : NSObject {
+    NSArray *_columnNames;
+    NSDictionary *_slotIndexesByColumnName;
+    NSUInteger _count;
+    uint32_t _serial;
+    
+    char **_columnNamesUTF8; //for comparing against sqlite3_column_name() without creating strings
+    __weak FMResultSet *_matchingResultSet; //the last result set whose columns were found to be in slot order. SELECT * usually is
+}
+
+-(id)initWithColumnNames:(NSArray*)columnNames;
+
+@property (nonatomic, readonly) NSArray *columnNames;
+@property (nonatomic, readonly) NSUInteger count;
+@property (nonatomic, readonly) uint32_t serial; //unique to this layout, never 0. lets column bindings tell layouts apart without holding on to them
+
+-(NSUInteger)slotIndexForColumn:(NSString*)columnName; //NSNotFound for unknown columns
+-(NSString*)columnNameForSlotIndex:(NSUInteger)index;
+
+//fills slots from the current row of a result set. slots whose dirty bit is set are left alone. returns NO if the row contained no known columns.
+-(BOOL)fillSlots:(RHSQLiteRowSlot*)slots skippingDirtyBits:(const uint32_t*)dirtyBits fromResultSet:(FMResultSet*)resultSet;
+
+@end
+
+
+//slot storage. slots and their dirty bits are allocated together in a single block.
+extern RHSQLiteRowSlot *RHSQLiteRowSlotsCreate(NSUInteger count);
+extern void RHSQLiteRowSlotsFree(RHSQLiteRowSlot *slots, NSUInteger count);
+extern uint32_t *RHSQLiteRowSlotsDirtyBits(RHSQLiteRowSlot *slots, NSUInteger count);
+
+extern void RHSQLiteRowSlotClear(RHSQLiteRowSlot *slot);
+extern void RHSQLiteRowSlotSetObject(RHSQLiteRowSlot *slot, id value); //unboxes NSNumbers, nil or NSNull become Null
+extern id RHSQLiteRowSlotGetObject(const RHSQLiteRowSlot *slot);      //boxes integers and doubles, nil for Null and Unset
+
+static inline BOOL RHSQLiteRowDirtyBitIsSet(const uint32_t *bits, NSUInteger index){
+    return (bits[index / 32] & (1u << (index % 32))) != 0;
+}
+static inline void RHSQLiteRowDirtyBitSet(uint32_t *bits, NSUInteger index){
+    bits[index / 32] |= (1u << (index % 32));
+}
+static inline void RHSQLiteRowDirtyBitsClearAll(uint32_t *bits, NSUInteger count){
+    memset(bits, 0, sizeof(uint32_t) * ((count + 31) / 32));
+}
+static inline BOOL RHSQLiteRowDirtyBitsAnySet(const uint32_t *bits, NSUInteger count){
+    for (NSUInteger i = 0; i < (count + 31) / 32; i++) if (bits[i]) return YES;
+    return NO;
+}
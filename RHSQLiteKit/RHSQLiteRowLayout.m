@@ -0,0 +1,228 @@
+//
+//  RHSQLiteRowLayout.m
+//  RHSQLiteKit
+//
+//  Created by agent on 18/10/2026.
+//  Copyright (c) 2026 Richard Heard. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions
+//  are met:
+//  1. Redistributions of source code must retain the above copyright
+//  notice, this list of conditions and the following disclaimer.
+//  2. Redistributions in binary form must reproduce the above copyright
+//  notice, this list of conditions and the following disclaimer in the
+//  documentation and/or other materials provided with the distribution.
+//  3. The name of the author may not be used to endorse or promote products
+//  derived from this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+//  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+//  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+//  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+//  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+//  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#import "RHSQLiteRowLayout.h"
+
+#import "FMDatabase.h"
+#import "FMResultSet.h"
+
+@interface RHSQLiteRowLayout ()
+//private
+-(BOOL)_resultSetMatchesLayout:(FMResultSet*)resultSet;
+@end
+
+@implementation RHSQLiteRowLayout
+
+@synthesize columnNames=_columnNames;
+@synthesize count=_count;
+@synthesize serial=_serial;
+
+-(id)initWithColumnNames:(NSArray*)columnNames{
+    self = [super init];
+    if (self){
+        _columnNames = [columnNames copy];
+        _count = _columnNames.count;
+        
+        _columnNamesUTF8 = calloc(MAX(_count, (NSUInteger)1), sizeof(char*));
+        for (NSUInteger i = 0; i < _count; i++) {
+            _columnNamesUTF8[i] = strdup([[_columnNames objectAtIndex:i] UTF8String]);
+        }
+        
+        static uint32_t lastSerial = 0;
+        @synchronized([RHSQLiteRowLayout class]){
+            _serial = ++lastSerial;
+        }
+        
+        NSMutableDictionary *slotIndexes = [NSMutableDictionary dictionaryWithCapacity:_count];
+        [_columnNames enumerateObjectsUsingBlock:^(id columnName, NSUInteger idx, BOOL *stop) {
+            [slotIndexes setObject:[NSNumber numberWithUnsignedInteger:idx] forKey:columnName];
+        }];
+        _slotIndexesByColumnName = [NSDictionary dictionaryWithDictionary:slotIndexes];
+    }
+    return self;
+}
+
+-(void)dealloc{
+    for (NSUInteger i = 0; i < _count; i++) {
+        free(_columnNamesUTF8[i]);
+    }
+    free(_columnNamesUTF8);
+    _columnNamesUTF8 = NULL;
+}
+
+#pragma mark - lookup
+-(NSUInteger)slotIndexForColumn:(NSString*)columnName{
+    if (!columnName) return NSNotFound;
+    NSNumber *index = [_slotIndexesByColumnName objectForKey:columnName];
+    return index ? [index unsignedIntegerValue] : NSNotFound;
+}
+
+-(NSString*)columnNameForSlotIndex:(NSUInteger)index{
+    return index < _count ? [_columnNames objectAtIndex:index] : nil;
+}
+
+#pragma mark - loading
+-(BOOL)_resultSetMatchesLayout:(FMResultSet*)resultSet{
+    //checked once per result set, rows that follow are stepped from the same statement so have the same columns.
+    //never cached beyond that, a later statement may be a subclasses reordered loadSQL, or a SELECT * against a table that has since gained columns
+    if (_matchingResultSet == resultSet) return YES;
+    
+    sqlite3_stmt *statement = (sqlite3_stmt*)[[resultSet statement] statement];
+    if (!statement || (NSUInteger)sqlite3_column_count(statement) != _count) return NO;
+    for (NSUInteger i = 0; i < _count; i++) {
+        const char *name = sqlite3_column_name(statement, (int)i);
+        if (!name || strcmp(name, _columnNamesUTF8[i]) != 0) return NO;
+    }
+    
+    _matchingResultSet = resultSet;
+    return YES;
+}
+
+-(BOOL)fillSlots:(RHSQLiteRowSlot*)slots skippingDirtyBits:(const uint32_t*)dirtyBits fromResultSet:(FMResultSet*)resultSet{
+    sqlite3_stmt *statement = (sqlite3_stmt*)[[resultSet statement] statement];
+    if (!statement) return NO;
+    
+    BOOL inOrder = [self _resultSetMatchesLayout:resultSet];
+    int columnCount = sqlite3_column_count(statement);
+    BOOL foundColumn = NO;
+    
+    for (int i = 0; i < columnCount; i++) {
+        NSUInteger slotIndex = inOrder ? (NSUInteger)i : [self slotIndexForColumn:[resultSet columnNameForIndex:i]];
+        if (slotIndex == NSNotFound || slotIndex >= _count) continue;
+        foundColumn = YES;
+        
+        //don't clobber unsaved changes
+        if (dirtyBits && RHSQLiteRowDirtyBitIsSet(dirtyBits, slotIndex)) continue;
+        
+        RHSQLiteRowSlot *slot = &slots[slotIndex];
+        RHSQLiteRowSlotClear(slot);
+        
+        switch (sqlite3_column_type(statement, i)) {
+            case SQLITE_INTEGER:
+                slot->type = RHSQLiteRowSlotTypeInteger;
+                slot->integerValue = sqlite3_column_int64(statement, i);
+                break;
+                
+            case SQLITE_FLOAT:
+                slot->type = RHSQLiteRowSlotTypeDouble;
+                slot->doubleValue = sqlite3_column_double(statement, i);
+                break;
+                
+            case SQLITE_TEXT: {
+                const char *text = (const char *)sqlite3_column_text(statement, i);
+                NSString *string = text ? [[NSString alloc] initWithBytes:text length:sqlite3_column_bytes(statement, i) encoding:NSUTF8StringEncoding] : nil;
+                RHSQLiteRowSlotSetObject(slot, string);
+                break;
+            }
+                
+            case SQLITE_BLOB: {
+                const void *bytes = sqlite3_column_blob(statement, i);
+                NSData *data = [NSData dataWithBytes:bytes length:sqlite3_column_bytes(statement, i)];
+                RHSQLiteRowSlotSetObject(slot, data);
+                break;
+            }
+                
+            default:
+                slot->type = RHSQLiteRowSlotTypeNull;
+                break;
+        }
+    }
+    
+    return foundColumn;
+}
+
+#pragma mark - description
+-(NSString*)description{
+    return [NSString stringWithFormat:@"<%@: %p, columns: %@>", NSStringFromClass([self class]), self, [_columnNames componentsJoinedByString:@", "]];
+}
+
+@end
+
+
+#pragma mark - slot storage
+static inline size_t RHSQLiteRowDirtyWordCount(NSUInteger count){
+    return (count + 31) / 32;
+}
+
+RHSQLiteRowSlot *RHSQLiteRowSlotsCreate(NSUInteger count){
+    //calloc leaves every slot Unset and every dirty bit clear
+    return calloc(1, sizeof(RHSQLiteRowSlot) * count + sizeof(uint32_t) * RHSQLiteRowDirtyWordCount(count));
+}
+
+void RHSQLiteRowSlotsFree(RHSQLiteRowSlot *slots, NSUInteger count){
+    if (!slots) return;
+    for (NSUInteger i = 0; i < count; i++) {
+        RHSQLiteRowSlotClear(&slots[i]);
+    }
+    free(slots);
+}
+
+uint32_t *RHSQLiteRowSlotsDirtyBits(RHSQLiteRowSlot *slots, NSUInteger count){
+    return (uint32_t*)(slots + count);
+}
+
+void RHSQLiteRowSlotClear(RHSQLiteRowSlot *slot){
+    if (slot->type == RHSQLiteRowSlotTypeObject && slot->objectValue) CFRelease(slot->objectValue);
+    slot->type = RHSQLiteRowSlotTypeUnset;
+    slot->integerValue = 0;
+}
+
+void RHSQLiteRowSlotSetObject(RHSQLiteRowSlot *slot, id value){
+    RHSQLiteRowSlotClear(slot);
+    
+    if (!value || value == [NSNull null]){
+        slot->type = RHSQLiteRowSlotTypeNull;
+        return;
+    }
+    
+    if ([value isKindOfClass:[NSNumber class]]){
+        const char *type = [value objCType];
+        if (strcmp(type, @encode(double)) == 0 || strcmp(type, @encode(float)) == 0){
+            slot->type = RHSQLiteRowSlotTypeDouble;
+            slot->doubleValue = [value doubleValue];
+        } else {
+            slot->type = RHSQLiteRowSlotTypeInteger;
+            slot->integerValue = [value longLongValue];
+        }
+        return;
+    }
+    
+    slot->type = RHSQLiteRowSlotTypeObject;
+    slot->objectValue = CFBridgingRetain(value);
+}
+
+id RHSQLiteRowSlotGetObject(const RHSQLiteRowSlot *slot){
+    switch (slot->type) {
+        case RHSQLiteRowSlotTypeInteger: return [NSNumber numberWithLongLong:slot->integerValue];
+        case RHSQLiteRowSlotTypeDouble: return [NSNumber numberWithDouble:slot->doubleValue];
+        case RHSQLiteRowSlotTypeObject: return (__bridge id)slot->objectValue;
+        default: return nil;
+    }
+}
@@ -0,0 +1,70 @@
+//
+//  RHSQLiteShard.h
+//  RHSQLiteKit
+//
+//  Created by agent on 18/10/2026.
+//  Copyright (c) 2026 Richard Heard. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions
+//  are met:
+//  1. Redistributions of source code must retain the above copyright
+//  notice, this list of conditions and the following disclaimer.
+//  2. Redistributions in binary form must reproduce the above copyright
+//  notice, this list of conditions and the following disclaimer in the
+//  documentation and/or other materials provided with the distribution.
+//  3. The name of the author may not be used to endorse or promote products
+//  derived from this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+//  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+//  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+//  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+//  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+//  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// INTERNAL CLASS: DO NOT USE UNLESS YOU KNOW WHAT YOU ARE DOING
+
+#import <Foundation/Foundation.h>
+
+@class FMDatabase;
+@class FMDatabaseQueue;
+
+/*!
+ @class RHSQLiteShard
+ @abstract RHSQLiteShard is a single extra database file of a sharded RHSQLiteDataStore, holding the tables assigned to it.
+ @discussion Each shard has its own connection (and so its own write lock and WAL), which the data store routes object loads and saves for its tables through.
+    The data stores main connection ATTACHes every shard as schemaName, so queries and raw SQL can still read (and join) every table by its unqualified name.
+    Shards are versioned independently, each file keeps its own schema_version in its own metadata table.
+ */
+@interface RHSQLiteShard : NSObject {
+    NSString *_name;
+    NSString *_path;
+    FMDatabaseQueue *_databaseQueue;        //nil until opened, always nil for read only data stores
+    NSMutableArray *_registeredMigrations;  //NSString paths and RHSQLiteDataStoreMigrationBlock blocks, in order.
+}
+
++(BOOL)isValidShardName:(NSString*)name; //letters, digits and underscores, as it becomes part of schemaName
+
+-(id)initWithName:(NSString*)name path:(NSString*)path;
+
+@property (nonatomic, readonly) NSString *name;
+@property (nonatomic, readonly) NSString *path;
+@property (nonatomic, readonly) NSString *schemaName; //what the shard is ATTACHed as, ie shard_log
+@property (nonatomic, strong) FMDatabaseQueue *databaseQueue;
+@property (nonatomic, readonly) NSMutableArray *registeredMigrations;
+
+//versioning, use the shards own connection
+-(NSUInteger)schemaVersionInDatabase:(FMDatabase*)db;
+-(BOOL)setSchemaVersion:(NSUInteger)version inDatabase:(FMDatabase*)db; //creates the metadata table and column as needed
+
+//attaching, use a connection to the main file. immutable requires the connection to have been opened with SQLITE_OPEN_URI. the attachment shares the connections open flags, so read only connections attach read only.
+-(BOOL)attachToDatabase:(FMDatabase*)db immutable:(BOOL)immutable;
+-(NSArray*)tableNamesInAttachedDatabase:(FMDatabase*)db; //excluding the shards metadata table
+-(int64_t)schemaCookieInAttachedDatabase:(FMDatabase*)db; //PRAGMA schema_version
+
+@end
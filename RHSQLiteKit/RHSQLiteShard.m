@@ -0,0 +1,149 @@
+//
+//  RHSQLiteShard.m
+//  RHSQLiteKit
+//
+//  Created by agent on 18/10/2026.
+//  Copyright (c) 2026 Richard Heard. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions
+//  are met:
+//  1. Redistributions of source code must retain the above copyright
+//  notice, this list of conditions and the following disclaimer.
+//  2. Redistributions in binary form must reproduce the above copyright
+//  notice, this list of conditions and the following disclaimer in the
+//  documentation and/or other materials provided with the distribution.
+//  3. The name of the author may not be used to endorse or promote products
+//  derived from this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+//  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+//  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+//  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+//  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+//  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#import "RHSQLiteShard.h"
+
+#import "FMDatabase.h"
+#import "FMDatabaseQueue.h"
+#import "FMResultSet.h"
+
+//the same table (and shape) that the data store keeps in its main file
+#define RHSQLiteShardMetadataTableName @"metadata"
+#define RHSQLiteShardSchemaVersionKey @"schema_version"
+
+@implementation RHSQLiteShard
+
+@synthesize name=_name;
+@synthesize path=_path;
+@synthesize databaseQueue=_databaseQueue;
+@synthesize registeredMigrations=_registeredMigrations;
+
++(BOOL)isValidShardName:(NSString*)name{
+    if ([name length] < 1) return NO;
+    NSCharacterSet *invalidCharacters = [[NSCharacterSet characterSetWithCharactersInString:@"abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_"] invertedSet];
+    return [name rangeOfCharacterFromSet:invalidCharacters].location == NSNotFound;
+}
+
+-(id)initWithName:(NSString*)name path:(NSString*)path{
+    self = [super init];
+    if (self){
+        _name = [name copy];
+        _path = [path copy];
+        _registeredMigrations = [[NSMutableArray alloc] init];
+    }
+    return self;
+}
+
+-(void)dealloc{
+    [_databaseQueue close];
+    _databaseQueue = nil;
+}
+
+-(NSString*)schemaName{
+    return [NSString stringWithFormat:@"shard_%@", _name];
+}
+
+
+#pragma mark - versioning
+-(NSUInteger)schemaVersionInDatabase:(FMDatabase*)db{
+    NSUInteger version = 0;
+    if (![self _columnExists:RHSQLiteShardSchemaVersionKey inDatabase:db]) return version;
+    
+    NSString *sql = [NSString stringWithFormat:@"SELECT `%@` FROM `%@` WHERE `id` = 1;", RHSQLiteShardSchemaVersionKey, RHSQLiteShardMetadataTableName];
+    FMResultSet *resultSet = [db executeQuery:sql];
+    if ([resultSet next]){
+        version = (NSUInteger)[resultSet longLongIntForColumnIndex:0];
+    }
+    [resultSet close];
+    return version;
+}
+
+-(BOOL)setSchemaVersion:(NSUInteger)version inDatabase:(FMDatabase*)db{
+    if (![self _columnExists:RHSQLiteShardSchemaVersionKey inDatabase:db]){
+        NSString *sql = [NSString stringWithFormat:@"CREATE TABLE IF NOT EXISTS '%@' ( 'id' INTEGER PRIMARY KEY ON CONFLICT REPLACE AUTOINCREMENT);", RHSQLiteShardMetadataTableName];
+        if (![db executeUpdate:sql]) return NO;
+        if (![db executeUpdate:[NSString stringWithFormat:@"INSERT OR IGNORE INTO `%@` (`id`) VALUES(1);", RHSQLiteShardMetadataTableName]]) return NO;
+        if (![db executeUpdate:[NSString stringWithFormat:@"ALTER TABLE `%@` ADD COLUMN '%@' INTEGER;", RHSQLiteShardMetadataTableName, RHSQLiteShardSchemaVersionKey]]) return NO;
+    }
+    
+    NSString *sql = [NSString stringWithFormat:@"UPDATE `%@` SET `%@` = ? WHERE `id` = 1;", RHSQLiteShardMetadataTableName, RHSQLiteShardSchemaVersionKey];
+    BOOL result = [db executeUpdate:sql, [NSNumber numberWithUnsignedInteger:version]];
+    RHLog(@"Setting schema version of shard %@ to %lu. Result:%i.", _name, (unsigned long)version, result);
+    return result;
+}
+
+-(BOOL)_columnExists:(NSString*)columnName inDatabase:(FMDatabase*)db{
+    BOOL result = NO;
+    FMResultSet *resultSet = [db executeQuery:[NSString stringWithFormat:@"PRAGMA table_info(`%@`)", RHSQLiteShardMetadataTableName]];
+    while ([resultSet next]) {
+        if ([[resultSet stringForColumn:@"name"] isEqualToString:columnName]) result = YES;
+    }
+    [resultSet close];
+    return result;
+}
+
+
+#pragma mark - attaching
+-(BOOL)attachToDatabase:(FMDatabase*)db immutable:(BOOL)immutable{
+    //immutable=1 for the same reasons as the data stores own read only connections
+    NSString *file = immutable ? [[[NSURL fileURLWithPath:_path] absoluteString] stringByAppendingString:@"?immutable=1"] : _path;
+    BOOL result = [db executeUpdate:[NSString stringWithFormat:@"ATTACH DATABASE ? AS `%@`;", [self schemaName]], file];
+    if (!result) RHErrorLog(@"Error: Failed to attach shard %@ at path %@. Error: %@.", _name, _path, [db lastError]);
+    return result;
+}
+
+-(NSArray*)tableNamesInAttachedDatabase:(FMDatabase*)db{
+    NSMutableArray *tableNames = [NSMutableArray array];
+    NSString *sql = [NSString stringWithFormat:@"SELECT `name` FROM `%@`.`sqlite_master` WHERE `type` = 'table' AND `name` NOT LIKE 'sqlite_%%' AND `name` != '%@';", [self schemaName], RHSQLiteShardMetadataTableName];
+    FMResultSet *resultSet = [db executeQuery:sql];
+    while ([resultSet next]) {
+        [tableNames addObject:[resultSet stringForColumn:@"name"]];
+    }
+    [resultSet close];
+    return tableNames;
+}
+
+-(int64_t)schemaCookieInAttachedDatabase:(FMDatabase*)db{
+    int64_t result = 0;
+    FMResultSet *resultSet = [db executeQuery:[NSString stringWithFormat:@"PRAGMA `%@`.schema_version;", [self schemaName]]];
+    if ([resultSet next]){
+        result = [resultSet longLongIntForColumnIndex:0];
+    }
+    [resultSet close];
+    return result;
+}
+
+
+#pragma mark - description
+-(NSString*)description{
+    return [NSString stringWithFormat:@"<%@: %p, name: %@, path: %@, migrations: %lu, open: %@>", NSStringFromClass([self class]), self, _name, _path, (unsigned long)[_registeredMigrations count], _databaseQueue ? @"YES" : @"NO"];
+}
+
+@end
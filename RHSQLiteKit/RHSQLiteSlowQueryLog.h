@@ -0,0 +1,82 @@
+//
+//  RHSQLiteSlowQueryLog.h
+//  RHSQLiteKit
+//
+//  Created by agent on 18/10/2026.
+//  Copyright (c) 2026 Richard Heard. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions
+//  are met:
+//  1. Redistributions of source code must retain the above copyright
+//  notice, this list of conditions and the following disclaimer.
+//  2. Redistributions in binary form must reproduce the above copyright
+//  notice, this list of conditions and the following disclaimer in the
+//  documentation and/or other materials provided with the distribution.
+//  3. The name of the author may not be used to endorse or promote products
+//  derived from this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+//  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+//  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+//  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+//  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+//  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// INTERNAL CLASS: DO NOT USE UNLESS YOU KNOW WHAT YOU ARE DOING
+
+#import <Foundation/Foundation.h>
+
+@class FMDatabase;
+
+#define RHSQLiteSlowQueryLogDefaultLargeTableRowCount 10000
+
+/*!
+ @class RHSQLiteSlowQueryLog
+ @abstract RHSQLiteSlowQueryLog times every statement run on the connections it is attached to, and keeps an EXPLAIN QUERY PLAN for the slow ones.
+ @discussion Timing uses sqlite3_trace_v2() with SQLITE_TRACE_PROFILE, or sqlite3_profile() before sqlite 3.14.0. The profile callback can't touch the connection, so slow statements are queued and explained later by 
+    explainPendingStatementsInDatabase:, which the data store calls on the same connection once the current database block has finished.
+    Statements are aggregated by shape, which is their SQL with literals replaced by ? and whitespace collapsed.
+ */
+@interface RHSQLiteSlowQueryLog : NSObject {
+    NSTimeInterval _threshold;
+    int64_t _largeTableRowCount;
+    
+    NSMutableArray *_connections;           //NSMutableData wrapped profile contexts, one per attached connection
+    NSMutableArray *_pendingStatements;     //slow statements that have not yet been explained, with the connection they ran on
+    NSMutableDictionary *_entriesByShape;
+    NSMutableDictionary *_estimatedRowCounts; //table name -> [NSNumber estimate, NSNumber time read], max(_ROWID_) as a cheap row count estimate. re-read once stale
+}
+
+@property (nonatomic, assign) NSTimeInterval threshold;    //statements that take at least this long are logged. 0 disables.
+@property (nonatomic, assign) int64_t largeTableRowCount;  //full table scans are only flagged for tables with at least this many rows
+
+//installs our profile callback. The log must outlive the connection, or be detached before it closes.
+-(void)attachToDatabase:(FMDatabase*)db;
+-(void)detachFromDatabase:(FMDatabase*)db; //removes our profile callback, along with any of its statements still waiting to be explained. call before closing db
+
+//explains any slow statements that ran on db. must be called on the thread that owns db, outside of any statement.
+-(void)explainPendingStatementsInDatabase:(FMDatabase*)db;
+
+/*!
+ @method report
+ @abstract Array of dictionaries, one per query shape, slowest total time first.
+ @discussion Keys:
+    shape               - the normalised SQL
+    sql                 - the most recent slow instance, as run
+    count, total, max   - number of slow executions and their times in seconds
+    plan                - array of EXPLAIN QUERY PLAN detail strings, from the most recent slow execution
+    full_scans          - array of large tables that were scanned without an index
+    temp_btree          - YES if sqlite had to build a temporary b-tree for ORDER BY, DISTINCT or GROUP BY
+    suggested_indexes   - array of CREATE INDEX statements built from the WHERE and ORDER BY columns of scanned tables
+ */
+-(NSArray*)report;
+-(void)reset;
+
++(NSString*)shapeForSQL:(NSString*)sql; //literals replaced by ?, whitespace collapsed
+
+@end
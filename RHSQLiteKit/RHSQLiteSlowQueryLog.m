@@ -0,0 +1,469 @@
+//
+//  RHSQLiteSlowQueryLog.m
+//  RHSQLiteKit
+//
+//  Created by agent on 18/10/2026.
+//  Copyright (c) 2026 Richard Heard. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions
+//  are met:
+//  1. Redistributions of source code must retain the above copyright
+//  notice, this list of conditions and the following disclaimer.
+//  2. Redistributions in binary form must reproduce the above copyright
+//  notice, this list of conditions and the following disclaimer in the
+//  documentation and/or other materials provided with the distribution.
+//  3. The name of the author may not be used to endorse or promote products
+//  derived from this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+//  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+//  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+//  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+//  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+//  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#import "RHSQLiteSlowQueryLog.h"
+
+#import "FMDatabase.h"
+
+#define RHSQLiteSlowQueryLogEstimateLifetime 60.0 //seconds before a tables estimated row count is re-read, so tables that grow are eventually flagged
+#define RHSQLiteSlowQueryLogTraceMinimumVersion 3014000 //sqlite 3.14.0 added sqlite3_trace_v2 and deprecated sqlite3_profile
+
+//one per attached connection. explaining is set while we run our own EXPLAIN statements, so they don't get logged in turn.
+typedef struct {
+    void *log;
+    sqlite3 *handle;
+    BOOL explaining;
+} RHSQLiteSlowQueryLogConnection;
+
+static void RHSQLiteSlowQueryLogSetProfiling(sqlite3 *handle, RHSQLiteSlowQueryLogConnection *connection); //NULL connection to stop
+static void RHSQLiteSlowQueryLogProfile(void *context, const char *sql, sqlite3_uint64 nanoseconds);
+#ifdef SQLITE_TRACE_PROFILE
+static int RHSQLiteSlowQueryLogTrace(unsigned type, void *context, void *statement, void *nanoseconds);
+#endif
+
+
+@interface RHSQLiteSlowQueryLog ()
+//private
+-(RHSQLiteSlowQueryLogConnection*)_connectionForHandle:(sqlite3*)handle;
+-(void)_connection:(RHSQLiteSlowQueryLogConnection*)connection ranStatement:(const char*)sql duration:(NSTimeInterval)duration;
+-(void)_recordStatement:(NSString*)sql duration:(NSTimeInterval)duration handle:(sqlite3*)handle;
+
+-(NSArray*)_planForSQL:(NSString*)sql handle:(sqlite3*)handle;
+-(int64_t)_estimatedRowCountForTable:(NSString*)tableName handle:(sqlite3*)handle;
+-(NSArray*)_columnNamesForTable:(NSString*)tableName handle:(sqlite3*)handle;
+-(NSString*)_suggestedIndexForTable:(NSString*)tableName shape:(NSString*)shape handle:(sqlite3*)handle;
+
++(NSString*)_clauseOfShape:(NSString*)shape startingWith:(NSString*)keyword;
++(NSArray*)_identifiersInSQL:(NSString*)sql;
+@end
+
+
+@implementation RHSQLiteSlowQueryLog
+
+@synthesize threshold=_threshold;
+@synthesize largeTableRowCount=_largeTableRowCount;
+
+-(id)init{
+    self = [super init];
+    if (self){
+        _threshold = 0.0;
+        _largeTableRowCount = RHSQLiteSlowQueryLogDefaultLargeTableRowCount;
+        _connections = [[NSMutableArray alloc] init];
+        _pendingStatements = [[NSMutableArray alloc] init];
+        _entriesByShape = [[NSMutableDictionary alloc] init];
+        _estimatedRowCounts = [[NSMutableDictionary alloc] init];
+    }
+    return self;
+}
+
+#pragma mark - connections
+-(void)attachToDatabase:(FMDatabase*)db{
+    sqlite3 *handle = [db sqliteHandle];
+    if (!handle) return;
+    
+    @synchronized(self){
+        if ([self _connectionForHandle:handle]) return;
+        
+        NSMutableData *data = [NSMutableData dataWithLength:sizeof(RHSQLiteSlowQueryLogConnection)];
+        RHSQLiteSlowQueryLogConnection *connection = [data mutableBytes];
+        connection->log = (__bridge void*)self;
+        connection->handle = handle;
+        [_connections addObject:data];
+        
+        RHSQLiteSlowQueryLogSetProfiling(handle, connection);
+    }
+}
+
+-(void)detachFromDatabase:(FMDatabase*)db{
+    sqlite3 *handle = [db sqliteHandle];
+    if (!handle) return;
+    
+    @synchronized(self){
+        NSMutableData *attached = nil;
+        for (NSMutableData *data in _connections) {
+            if (((RHSQLiteSlowQueryLogConnection*)[data mutableBytes])->handle == handle) attached = data;
+        }
+        if (!attached) return;
+        
+        //a later connection may well reuse the same handle address
+        RHSQLiteSlowQueryLogSetProfiling(handle, NULL);
+        [_connections removeObjectIdenticalTo:attached];
+        
+        NSIndexSet *pending = [_pendingStatements indexesOfObjectsPassingTest:^BOOL(NSArray *statement, NSUInteger idx, BOOL *stop) {
+            return [[statement objectAtIndex:2] pointerValue] == handle;
+        }];
+        [_pendingStatements removeObjectsAtIndexes:pending];
+    }
+}
+
+-(RHSQLiteSlowQueryLogConnection*)_connectionForHandle:(sqlite3*)handle{
+    @synchronized(self){
+        for (NSMutableData *data in _connections) {
+            RHSQLiteSlowQueryLogConnection *connection = [data mutableBytes];
+            if (connection->handle == handle) return connection;
+        }
+    }
+    return NULL;
+}
+
+static void RHSQLiteSlowQueryLogSetProfiling(sqlite3 *handle, RHSQLiteSlowQueryLogConnection *connection){
+    //sqlite3_trace_v2 where the sqlite we are running against has it, sqlite3_profile for older ones. (the header check is for older SDKs)
+#ifdef SQLITE_TRACE_PROFILE
+    if (sqlite3_libversion_number() >= RHSQLiteSlowQueryLogTraceMinimumVersion){
+        sqlite3_trace_v2(handle, connection ? SQLITE_TRACE_PROFILE : 0, connection ? RHSQLiteSlowQueryLogTrace : NULL, connection);
+        return;
+    }
+#endif
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wdeprecated-declarations"
+    sqlite3_profile(handle, connection ? RHSQLiteSlowQueryLogProfile : NULL, connection);
+#pragma clang diagnostic pop
+}
+
+static void RHSQLiteSlowQueryLogProfile(void *context, const char *sql, sqlite3_uint64 nanoseconds){
+    RHSQLiteSlowQueryLogConnection *connection = context;
+    [(__bridge RHSQLiteSlowQueryLog*)connection->log _connection:connection ranStatement:sql duration:(double)nanoseconds / 1000000000.0];
+}
+
+#ifdef SQLITE_TRACE_PROFILE
+static int RHSQLiteSlowQueryLogTrace(unsigned type, void *context, void *statement, void *nanoseconds){
+    //SQLITE_TRACE_PROFILE passes the statement and a pointer to its run time, sqlite3_sql is the same unexpanded text sqlite3_profile gave us
+    if (type == SQLITE_TRACE_PROFILE) RHSQLiteSlowQueryLogProfile(context, sqlite3_sql((sqlite3_stmt*)statement), *(sqlite3_int64*)nanoseconds);
+    return 0;
+}
+#endif
+
+#pragma mark - recording
+-(void)_connection:(RHSQLiteSlowQueryLogConnection*)connection ranStatement:(const char*)sql duration:(NSTimeInterval)duration{
+    //keep the common case cheap, this is called for every statement
+    if (_threshold <= 0.0 || duration < _threshold || connection->explaining || !sql) return;
+    
+    NSString *string = [NSString stringWithUTF8String:sql];
+    if (string) [self _recordStatement:string duration:duration handle:connection->handle];
+}
+
+-(void)_recordStatement:(NSString*)sql duration:(NSTimeInterval)duration handle:(sqlite3*)handle{
+    @synchronized(self){
+        [_pendingStatements addObject:[NSArray arrayWithObjects:sql, [NSNumber numberWithDouble:duration], [NSValue valueWithPointer:handle], nil]];
+    }
+}
+
+-(void)explainPendingStatementsInDatabase:(FMDatabase*)db{
+    sqlite3 *handle = [db sqliteHandle];
+    
+    NSMutableArray *pending = [NSMutableArray array];
+    @synchronized(self){
+        if ([_pendingStatements count] < 1) return;
+        for (NSArray *statement in _pendingStatements) {
+            if ([[statement objectAtIndex:2] pointerValue] == handle) [pending addObject:statement];
+        }
+        [_pendingStatements removeObjectsInArray:pending];
+    }
+    if ([pending count] < 1) return;
+    
+    RHSQLiteSlowQueryLogConnection *connection = [self _connectionForHandle:handle];
+    if (connection) connection->explaining = YES;
+    
+    for (NSArray *statement in pending) {
+        NSString *sql = [statement objectAtIndex:0];
+        NSTimeInterval duration = [[statement objectAtIndex:1] doubleValue];
+        NSString *shape = [[self class] shapeForSQL:sql];
+        
+        NSArray *plan = [self _planForSQL:sql handle:handle];
+        NSMutableArray *fullScans = [NSMutableArray array];
+        NSMutableArray *suggestedIndexes = [NSMutableArray array];
+        NSMutableArray *tables = [NSMutableArray array];
+        BOOL tempBTree = NO;
+        
+        for (NSString *detail in plan) {
+            if ([detail rangeOfString:@"USE TEMP B-TREE"].location != NSNotFound) tempBTree = YES;
+            
+            //"SCAN TABLE x" in older versions of sqlite, "SCAN x" in newer ones. SEARCH means an index was used.
+            NSString *prefix = [detail hasPrefix:@"SCAN TABLE "] ? @"SCAN TABLE " : [detail hasPrefix:@"SEARCH TABLE "] ? @"SEARCH TABLE " : [detail hasPrefix:@"SCAN "] ? @"SCAN " : [detail hasPrefix:@"SEARCH "] ? @"SEARCH " : nil;
+            if (!prefix) continue;
+            
+            NSString *table = [[[detail substringFromIndex:prefix.length] componentsSeparatedByString:@" "] objectAtIndex:0];
+            table = [table stringByTrimmingCharactersInSet:[NSCharacterSet characterSetWithCharactersInString:@"`\"[]"]];
+            if ([table isEqualToString:@"SUBQUERY"] || [table isEqualToString:@"CONSTANT"]) continue;
+            if (![tables containsObject:table]) [tables addObject:table];
+            
+            BOOL scan = [prefix hasPrefix:@"SCAN"] && [detail rangeOfString:@" USING "].location == NSNotFound;
+            if (scan && [self _estimatedRowCountForTable:table handle:handle] >= _largeTableRowCount){
+                if (![fullScans containsObject:table]) [fullScans addObject:table];
+            }
+        }
+        
+        //suggest indexes for the tables behind full scans, or all tables if sqlite had to sort for us
+        for (NSString *table in (tempBTree ? tables : fullScans)) {
+            NSString *index = [self _suggestedIndexForTable:table shape:shape handle:handle];
+            if (index && ![suggestedIndexes containsObject:index]) [suggestedIndexes addObject:index];
+        }
+        
+        @synchronized(self){
+            NSMutableDictionary *entry = [_entriesByShape objectForKey:shape];
+            if (!entry){
+                entry = [NSMutableDictionary dictionaryWithObject:shape forKey:@"shape"];
+                [_entriesByShape setObject:entry forKey:shape];
+                RHErrorLog(@"Warning: Slow query (%.3fs): %@ Plan: %@.", duration, sql, [plan componentsJoinedByString:@"; "]);
+            }
+            
+            NSUInteger count = [[entry objectForKey:@"count"] unsignedIntegerValue] + 1;
+            NSTimeInterval total = [[entry objectForKey:@"total"] doubleValue] + duration;
+            NSTimeInterval max = MAX([[entry objectForKey:@"max"] doubleValue], duration);
+            
+            [entry setObject:sql forKey:@"sql"];
+            [entry setObject:[NSNumber numberWithUnsignedInteger:count] forKey:@"count"];
+            [entry setObject:[NSNumber numberWithDouble:total] forKey:@"total"];
+            [entry setObject:[NSNumber numberWithDouble:max] forKey:@"max"];
+            [entry setObject:plan forKey:@"plan"];
+            [entry setObject:fullScans forKey:@"full_scans"];
+            [entry setObject:[NSNumber numberWithBool:tempBTree] forKey:@"temp_btree"];
+            [entry setObject:suggestedIndexes forKey:@"suggested_indexes"];
+        }
+    }
+    
+    if (connection) connection->explaining = NO;
+}
+
+#pragma mark - report
+-(NSArray*)report{
+    NSMutableArray *entries = [NSMutableArray array];
+    @synchronized(self){
+        for (NSDictionary *entry in [_entriesByShape allValues]) {
+            [entries addObject:[NSDictionary dictionaryWithDictionary:entry]];
+        }
+    }
+    
+    [entries sortUsingComparator:^NSComparisonResult(NSDictionary *a, NSDictionary *b) {
+        return [[b objectForKey:@"total"] compare:[a objectForKey:@"total"]];
+    }];
+    return [NSArray arrayWithArray:entries];
+}
+
+-(void)reset{
+    @synchronized(self){
+        [_pendingStatements removeAllObjects];
+        [_entriesByShape removeAllObjects];
+        [_estimatedRowCounts removeAllObjects];
+    }
+}
+
+#pragma mark - plans
+-(NSArray*)_planForSQL:(NSString*)sql handle:(sqlite3*)handle{
+    NSMutableArray *plan = [NSMutableArray array];
+    if ([sql rangeOfString:@"EXPLAIN" options:NSCaseInsensitiveSearch|NSAnchoredSearch].location != NSNotFound) return plan;
+    
+    sqlite3_stmt *statement = NULL;
+    NSString *explain = [@"EXPLAIN QUERY PLAN " stringByAppendingString:sql];
+    if (sqlite3_prepare_v2(handle, [explain UTF8String], -1, &statement, NULL) != SQLITE_OK){
+        RHLog(@"Unable to explain statement %@: %s", sql, sqlite3_errmsg(handle));
+        sqlite3_finalize(statement);
+        return plan;
+    }
+    
+    //the detail is always the last column, whichever version of sqlite we are running against
+    int detailColumn = sqlite3_column_count(statement) - 1;
+    while (detailColumn >= 0 && sqlite3_step(statement) == SQLITE_ROW) {
+        const char *detail = (const char *)sqlite3_column_text(statement, detailColumn);
+        if (detail) [plan addObject:[NSString stringWithUTF8String:detail]];
+    }
+    sqlite3_finalize(statement);
+    
+    return plan;
+}
+
+-(int64_t)_estimatedRowCountForTable:(NSString*)tableName handle:(sqlite3*)handle{
+    NSTimeInterval now = [NSDate timeIntervalSinceReferenceDate];
+    @synchronized(self){
+        NSArray *cached = [_estimatedRowCounts objectForKey:tableName];
+        if (cached && now - [[cached objectAtIndex:1] doubleValue] < RHSQLiteSlowQueryLogEstimateLifetime) return [[cached objectAtIndex:0] longLongValue];
+    }
+    
+    //max(_ROWID_) is a single b-tree seek, unlike count(*). WITHOUT ROWID tables fall back to count(*)
+    int64_t result = 0;
+    NSArray *queries = [NSArray arrayWithObjects:@"SELECT max(_ROWID_) FROM \"%@\";", @"SELECT count(*) FROM \"%@\";", nil];
+    for (NSString *format in queries) {
+        sqlite3_stmt *statement = NULL;
+        NSString *sql = [NSString stringWithFormat:format, [tableName stringByReplacingOccurrencesOfString:@"\"" withString:@"\"\""]];
+        int rc = sqlite3_prepare_v2(handle, [sql UTF8String], -1, &statement, NULL);
+        if (rc == SQLITE_OK && sqlite3_step(statement) == SQLITE_ROW){
+            result = sqlite3_column_int64(statement, 0);
+            sqlite3_finalize(statement);
+            break;
+        }
+        sqlite3_finalize(statement);
+    }
+    
+    @synchronized(self){
+        [_estimatedRowCounts setObject:[NSArray arrayWithObjects:[NSNumber numberWithLongLong:result], [NSNumber numberWithDouble:now], nil] forKey:tableName];
+    }
+    return result;
+}
+
+-(NSArray*)_columnNamesForTable:(NSString*)tableName handle:(sqlite3*)handle{
+    NSMutableArray *columnNames = [NSMutableArray array];
+    sqlite3_stmt *statement = NULL;
+    NSString *sql = [NSString stringWithFormat:@"PRAGMA table_info(\"%@\");", [tableName stringByReplacingOccurrencesOfString:@"\"" withString:@"\"\""]];
+    if (sqlite3_prepare_v2(handle, [sql UTF8String], -1, &statement, NULL) == SQLITE_OK){
+        while (sqlite3_step(statement) == SQLITE_ROW) {
+            const char *name = (const char *)sqlite3_column_text(statement, 1);
+            if (name) [columnNames addObject:[[NSString stringWithUTF8String:name] lowercaseString]];
+        }
+    }
+    sqlite3_finalize(statement);
+    return columnNames;
+}
+
+-(NSString*)_suggestedIndexForTable:(NSString*)tableName shape:(NSString*)shape handle:(sqlite3*)handle{
+    NSArray *tableColumns = [self _columnNamesForTable:tableName handle:handle];
+    if ([tableColumns count] < 1) return nil;
+    
+    //WHERE columns first, in the order they appear, then ORDER BY columns so the index can also satisfy the sort
+    NSMutableArray *columns = [NSMutableArray array];
+    NSArray *clauses = [NSArray arrayWithObjects:[[self class] _clauseOfShape:shape startingWith:@" WHERE "], [[self class] _clauseOfShape:shape startingWith:@" ORDER BY "], nil];
+    for (NSString *clause in clauses) {
+        for (NSString *identifier in [[self class] _identifiersInSQL:clause]) {
+            NSString *column = [identifier lowercaseString];
+            if ([tableColumns containsObject:column] && ![columns containsObject:column]) [columns addObject:column];
+        }
+    }
+    if ([columns count] < 1) return nil;
+    
+    NSString *indexName = [NSString stringWithFormat:@"%@_%@_index", tableName, [columns componentsJoinedByString:@"_"]];
+    return [NSString stringWithFormat:@"CREATE INDEX IF NOT EXISTS `%@` ON `%@` (`%@`);", indexName, tableName, [columns componentsJoinedByString:@"`, `"]];
+}
+
+#pragma mark - sql parsing
++(NSString*)shapeForSQL:(NSString*)sql{
+    NSUInteger length = [sql length];
+    unichar *characters = malloc(sizeof(unichar) * (length + 1));
+    if (!characters) return sql;
+    [sql getCharacters:characters range:NSMakeRange(0, length)];
+    
+    NSMutableString *shape = [NSMutableString stringWithCapacity:length];
+    NSUInteger i = 0;
+    while (i < length) {
+        unichar c = characters[i];
+        
+        if (c == '\''){
+            //string literal, '' is an escaped quote
+            i++;
+            while (i < length){
+                if (characters[i] == '\'' && (i + 1 >= length || characters[i + 1] != '\'')) break;
+                i += (characters[i] == '\'') ? 2 : 1;
+            }
+            i++;
+            [shape appendString:@"?"];
+            continue;
+        }
+        
+        if (c == '`' || c == '"' || c == '['){
+            //quoted identifier, kept as is
+            unichar close = (c == '[') ? ']' : c;
+            NSUInteger start = i++;
+            while (i < length && characters[i] != close) i++;
+            i = MIN(i + 1, length);
+            [shape appendString:[NSString stringWithCharacters:characters + start length:i - start]];
+            continue;
+        }
+        
+        unichar previous = [shape length] ? [shape characterAtIndex:[shape length] - 1] : ' ';
+        BOOL previousIsWord = [[NSCharacterSet alphanumericCharacterSet] characterIsMember:previous] || previous == '_';
+        if ([[NSCharacterSet decimalDigitCharacterSet] characterIsMember:c] && !previousIsWord){
+            //numeric literal
+            while (i < length && ([[NSCharacterSet alphanumericCharacterSet] characterIsMember:characters[i]] || characters[i] == '.')) i++;
+            [shape appendString:@"?"];
+            continue;
+        }
+        
+        if ([[NSCharacterSet whitespaceAndNewlineCharacterSet] characterIsMember:c]){
+            if (previous != ' ') [shape appendString:@" "];
+            i++;
+            continue;
+        }
+        
+        [shape appendString:[NSString stringWithCharacters:&c length:1]];
+        i++;
+    }
+    free(characters);
+    
+    NSString *result = [shape stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]];
+    if ([result hasSuffix:@";"]) result = [[result substringToIndex:result.length - 1] stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]];
+    return result;
+}
+
++(NSString*)_clauseOfShape:(NSString*)shape startingWith:(NSString*)keyword{
+    NSRange start = [shape rangeOfString:keyword options:NSCaseInsensitiveSearch];
+    if (start.location == NSNotFound) return @"";
+    
+    NSUInteger from = NSMaxRange(start);
+    NSUInteger to = [shape length];
+    for (NSString *terminator in [NSArray arrayWithObjects:@" GROUP BY ", @" ORDER BY ", @" LIMIT ", @" HAVING ", nil]) {
+        NSRange end = [shape rangeOfString:terminator options:NSCaseInsensitiveSearch range:NSMakeRange(from, [shape length] - from)];
+        if (end.location != NSNotFound && end.location < to) to = end.location;
+    }
+    return [shape substringWithRange:NSMakeRange(from, to - from)];
+}
+
++(NSArray*)_identifiersInSQL:(NSString*)sql{
+    NSMutableArray *identifiers = [NSMutableArray array];
+    NSScanner *scanner = [NSScanner scannerWithString:sql];
+    NSMutableCharacterSet *wordCharacters = [NSMutableCharacterSet alphanumericCharacterSet];
+    [wordCharacters addCharactersInString:@"_"];
+    NSCharacterSet *quotes = [NSCharacterSet characterSetWithCharactersInString:@"`\"["];
+    
+    while (![scanner isAtEnd]) {
+        NSString *identifier = nil;
+        NSUInteger location = [scanner scanLocation];
+        unichar c = [sql characterAtIndex:location];
+        
+        if ([quotes characterIsMember:c]){
+            NSString *close = (c == '[') ? @"]" : [NSString stringWithCharacters:&c length:1];
+            [scanner setScanLocation:location + 1];
+            [scanner scanUpToString:close intoString:&identifier];
+            if (![scanner isAtEnd]) [scanner setScanLocation:[scanner scanLocation] + 1];
+        } else if ([wordCharacters characterIsMember:c]){
+            [scanner scanCharactersFromSet:wordCharacters intoString:&identifier];
+        } else {
+            [scanner setScanLocation:location + 1];
+        }
+        
+        //table.column yields both names, callers only keep those that are columns
+        if (identifier) [identifiers addObject:identifier];
+    }
+    return identifiers;
+}
+
+#pragma mark - description
+-(NSString*)description{
+    return [NSString stringWithFormat:@"<%@: %p, threshold: %.3fs, shapes: %lu>", NSStringFromClass([self class]), self, _threshold, (unsigned long)[_entriesByShape count]];
+}
+
+@end
@@ -0,0 +1,105 @@
+//
+//  RHSQLiteWriteBehindQueue.h
+//  RHSQLiteKit
+//
+//  Created by agent on 18/10/2026.
+//  Copyright (c) 2026 Richard Heard. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions
+//  are met:
+//  1. Redistributions of source code must retain the above copyright
+//  notice, this list of conditions and the following disclaimer.
+//  2. Redistributions in binary form must reproduce the above copyright
+//  notice, this list of conditions and the following disclaimer in the
+//  documentation and/or other materials provided with the distribution.
+//  3. The name of the author may not be used to endorse or promote products
+//  derived from this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+//  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+//  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+//  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+//  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+//  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// INTERNAL CLASS: DO NOT USE UNLESS YOU KNOW WHAT YOU ARE DOING
+
+#import <Foundation/Foundation.h>
+
+#import "RHSQLiteObject.h"
+
+@class FMDatabase;
+
+//hands the writer a block to run against the writable connection. (outside of any transaction, the writer manages its own)
+typedef void (^RHSQLiteWriteBehindWriter)(void (^block)(FMDatabase *db));
+
+#define RHSQLiteWriteBehindQueueDefaultCapacityTimeout 10.0
+
+/*!
+ @class RHSQLiteWriteBehindQueue
+ @abstract RHSQLiteWriteBehindQueue holds the column values saved by write behind data stores, committing them in batches from a background queue.
+ @discussion Values are coalesced per row and column, so a batch holds at most one value per column no matter how many times it was saved.
+    A batch is committed every interval seconds, or as soon as batchSize column values are queued. Savers block once capacity values are queued, for up to capacityTimeout.
+    Rows that fail with a constraint, type mismatch or readonly error are dropped and logged, as retrying them can't help. They are kept until the next flush reports them.
+    Any other failure, including a schema error, rolls the batch back and it is merged back beneath newer values and retried after the next interval.
+    Everything here is safe to call from any thread. Savers that hold the writable connection must pass NO for waitIfFull, as the writer needs it.
+    Saves made on the writers own queue (ie from a change observer) commit the queued batch themselves rather than waiting on it.
+ */
+@interface RHSQLiteWriteBehindQueue : NSObject {
+    RHSQLiteWriteBehindWriter _writer;
+    dispatch_queue_t _writerQueue;      //serial, so batches always commit in the order they were taken
+    
+    NSCondition *_condition;            //guards everything below, signalled whenever a batch is taken or finishes
+    NSTimeInterval _interval;
+    NSUInteger _batchSize;
+    NSUInteger _capacity;
+    NSTimeInterval _capacityTimeout;
+    
+    NSMutableDictionary *_pendingRows;  //table name -> NSMutableDictionary of NSNumber rowid -> NSMutableDictionary of column name -> encoded value
+    NSDictionary *_inFlightRows;        //the batch being committed, same shape. still visible to loads until it has been committed
+    NSMutableDictionary *_primaryKeyNames; //table name -> primary key column name
+    NSUInteger _pendingCount;           //column values in _pendingRows
+    
+    uint64_t _enqueuedSequence;         //bumped by every enqueue
+    uint64_t _committedSequence;        //the _enqueuedSequence as of the last batch to commit
+    NSUInteger _failureCount;
+    NSError *_lastError;
+    NSMutableDictionary *_droppedRows;  //table name -> NSMutableArray of NSNumber rowid, dropped since the last flush
+    NSError *_droppedError;             //why the most recent of them was dropped
+    
+    BOOL _commitRequested;              //an immediate commit is queued on _writerQueue
+    BOOL _timerArmed;                   //a delayed commit is queued on _writerQueue
+    BOOL _lastCommitFailed;             //immediate requests wait for the interval instead, so a failing disk isn't hammered
+}
+
+-(id)initWithWriter:(RHSQLiteWriteBehindWriter)writer interval:(NSTimeInterval)interval batchSize:(NSUInteger)batchSize capacity:(NSUInteger)capacity;
+
+@property (nonatomic, assign) NSTimeInterval interval;
+@property (nonatomic, assign) NSUInteger batchSize;
+@property (nonatomic, assign) NSUInteger capacity;
+@property (nonatomic, assign) NSTimeInterval capacityTimeout; //how long a saver waits for room before giving up. defaults to RHSQLiteWriteBehindQueueDefaultCapacityTimeout
+
+//values are the still encoded slot values, as returned by -[RHSQLiteObject saveSQLWithArguments:]. blocks while the queue is at capacity, unless waitIfFull is NO, when they are queued over capacity instead.
+//returns NO, queueing nothing, if there was still no room after capacityTimeout. errorOut is then the writers last error, or a timeout.
+-(BOOL)enqueueValues:(NSArray*)values forColumns:(NSArray*)columnNames inTable:(NSString*)tableName primaryKeyName:(NSString*)primaryKeyName objectID:(RHSQLiteObjectID)objectID waitIfFull:(BOOL)waitIfFull error:(NSError**)errorOut;
+
+//column name -> value for everything queued or being committed for the row, newest wins. nil if nothing is. 
+//call from inside the database block that read the row, so that the writer can't commit in between.
+-(NSDictionary*)pendingValuesForTable:(NSString*)tableName objectID:(RHSQLiteObjectID)objectID;
+-(void)discardPendingValuesForTable:(NSString*)tableName objectID:(RHSQLiteObjectID)objectID; //ie the row is being deleted
+
+-(NSUInteger)numberOfPendingValues; //queued and in flight
+-(NSError*)lastError;
+
+//commits everything queued before the call, returning once it has been committed. NO if any of it failed, or if rows were dropped since the last flush.
+-(BOOL)flushWithError:(NSError**)errorOut;
+
+//waits for the writer to commit everything queued before the call on its usual schedule. NO if a commit failed while waiting.
+-(BOOL)waitUntilCommitted;
+
+@end
@@ -0,0 +1,484 @@
+//
+//  RHSQLiteWriteBehindQueue.m
+//  RHSQLiteKit
+//
+//  Created by agent on 18/10/2026.
+//  Copyright (c) 2026 Richard Heard. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions
+//  are met:
+//  1. Redistributions of source code must retain the above copyright
+//  notice, this list of conditions and the following disclaimer.
+//  2. Redistributions in binary form must reproduce the above copyright
+//  notice, this list of conditions and the following disclaimer in the
+//  documentation and/or other materials provided with the distribution.
+//  3. The name of the author may not be used to endorse or promote products
+//  derived from this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+//  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+//  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+//  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+//  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+//  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#import "RHSQLiteWriteBehindQueue.h"
+#import "RHSQLiteDataStore.h"
+
+#import "FMDatabase.h"
+
+static char RHSQLiteWriteBehindQueueWriterQueueKey; //set on _writerQueue, so we can tell when a save comes from our own writer
+
+@interface RHSQLiteWriteBehindQueue ()
+
+//must be called with _condition locked
+-(void)_requestCommit;
+-(void)_armTimer;
+-(void)_mergeRows:(NSDictionary*)rows beneathRows:(NSMutableDictionary*)newerRows; //keeps the newer value of any column in both
+
+//only called on _writerQueue
+-(void)_commit;
+-(BOOL)_isPermanentError:(int)errorCode;
+
+//must be called with _condition locked. nil if nothing has been dropped since the last call
+-(NSError*)_takeDroppedRowsError;
+
+@end
+
+@implementation RHSQLiteWriteBehindQueue
+
+-(id)initWithWriter:(RHSQLiteWriteBehindWriter)writer interval:(NSTimeInterval)interval batchSize:(NSUInteger)batchSize capacity:(NSUInteger)capacity{
+    self = [super init];
+    if (self){
+        _writer = [writer copy];
+        _writerQueue = dispatch_queue_create("com.rheard.RHSQLiteKit.writeBehind", DISPATCH_QUEUE_SERIAL);
+        dispatch_queue_set_specific(_writerQueue, &RHSQLiteWriteBehindQueueWriterQueueKey, (__bridge void*)self, NULL);
+        _condition = [[NSCondition alloc] init];
+        _interval = interval;
+        _batchSize = MAX(batchSize, (NSUInteger)1);
+        _capacity = MAX(capacity, (NSUInteger)1);
+        _capacityTimeout = RHSQLiteWriteBehindQueueDefaultCapacityTimeout;
+        _pendingRows = [[NSMutableDictionary alloc] init];
+        _primaryKeyNames = [[NSMutableDictionary alloc] init];
+        _droppedRows = [[NSMutableDictionary alloc] init];
+    }
+    return self;
+}
+
+-(void)dealloc{
+#if !OS_OBJECT_USE_OBJC
+    dispatch_release(_writerQueue);
+#endif
+    _writerQueue = NULL;
+}
+
+
+#pragma mark - properties
+-(NSTimeInterval)interval{
+    [_condition lock];
+    NSTimeInterval interval = _interval;
+    [_condition unlock];
+    return interval;
+}
+
+-(void)setInterval:(NSTimeInterval)interval{
+    [_condition lock];
+    _interval = interval;
+    [_condition unlock];
+}
+
+-(NSUInteger)batchSize{
+    [_condition lock];
+    NSUInteger batchSize = _batchSize;
+    [_condition unlock];
+    return batchSize;
+}
+
+-(void)setBatchSize:(NSUInteger)batchSize{
+    [_condition lock];
+    _batchSize = MAX(batchSize, (NSUInteger)1);
+    if (_pendingCount >= _batchSize) [self _requestCommit];
+    [_condition unlock];
+}
+
+-(NSUInteger)capacity{
+    [_condition lock];
+    NSUInteger capacity = _capacity;
+    [_condition unlock];
+    return capacity;
+}
+
+-(void)setCapacity:(NSUInteger)capacity{
+    [_condition lock];
+    _capacity = MAX(capacity, (NSUInteger)1);
+    [_condition broadcast]; //a larger capacity may let waiting savers in
+    [_condition unlock];
+}
+
+-(NSTimeInterval)capacityTimeout{
+    [_condition lock];
+    NSTimeInterval capacityTimeout = _capacityTimeout;
+    [_condition unlock];
+    return capacityTimeout;
+}
+
+-(void)setCapacityTimeout:(NSTimeInterval)capacityTimeout{
+    [_condition lock];
+    _capacityTimeout = MAX(capacityTimeout, 0.0);
+    [_condition unlock];
+}
+
+
+#pragma mark - queueing
+-(BOOL)enqueueValues:(NSArray*)values forColumns:(NSArray*)columnNames inTable:(NSString*)tableName primaryKeyName:(NSString*)primaryKeyName objectID:(RHSQLiteObjectID)objectID waitIfFull:(BOOL)waitIfFull error:(NSError**)errorOut{
+    if ([columnNames count] < 1 || [columnNames count] != [values count]) return YES;
+    
+    //a saver on our writer queue would be waiting on itself, it commits the batch instead
+    BOOL onWriterQueue = (dispatch_get_specific(&RHSQLiteWriteBehindQueueWriterQueueKey) == (__bridge void*)self);
+    
+    [_condition lock];
+    
+    //backpressure, hold the saver until the writer has taken the current batch. a failing writer only retries every interval, so don't hold it forever
+    NSDate *deadline = [NSDate dateWithTimeIntervalSinceNow:_capacityTimeout];
+    while (waitIfFull && _pendingCount >= _capacity){
+        if (onWriterQueue){
+            NSUInteger failureCount = _failureCount;
+            [_condition unlock];
+            [self _commit];
+            [_condition lock];
+            if (_failureCount == failureCount) continue;
+        } else {
+            [self _requestCommit];
+            if ([_condition waitUntilDate:deadline] || _pendingCount < _capacity) continue;
+        }
+        
+        //still full
+        NSError *error = _lastCommitFailed ? _lastError : nil;
+        if (!error) error = [NSError errorWithDomain:NSPOSIXErrorDomain code:ETIMEDOUT userInfo:[NSDictionary dictionaryWithObject:@"Timed out waiting for room in the write behind queue." forKey:NSLocalizedDescriptionKey]];
+        RHErrorLog(@"Error: Write behind queue is still full (%lu values), not queueing changes for %@ %lld. Error: %@.", (unsigned long)_pendingCount, tableName, objectID, error);
+        [_condition unlock];
+        if (errorOut) *errorOut = error;
+        return NO;
+    }
+    
+    NSMutableDictionary *rows = [_pendingRows objectForKey:tableName];
+    if (!rows){
+        rows = [NSMutableDictionary dictionary];
+        [_pendingRows setObject:rows forKey:tableName];
+        [_primaryKeyNames setObject:primaryKeyName forKey:tableName];
+    }
+    
+    NSNumber *rowID = [NSNumber numberWithLongLong:objectID];
+    NSMutableDictionary *columns = [rows objectForKey:rowID];
+    if (!columns){
+        columns = [NSMutableDictionary dictionaryWithCapacity:[columnNames count]];
+        [rows setObject:columns forKey:rowID];
+    }
+    
+    NSUInteger countBefore = [columns count];
+    [columnNames enumerateObjectsUsingBlock:^(NSString *columnName, NSUInteger idx, BOOL *stop) {
+        [columns setObject:[values objectAtIndex:idx] forKey:columnName];
+    }];
+    _pendingCount += [columns count] - countBefore;
+    _enqueuedSequence++;
+    
+    if (_pendingCount >= _batchSize) [self _requestCommit];
+    else [self _armTimer];
+    
+    [_condition unlock];
+    return YES;
+}
+
+-(NSDictionary*)pendingValuesForTable:(NSString*)tableName objectID:(RHSQLiteObjectID)objectID{
+    NSNumber *rowID = [NSNumber numberWithLongLong:objectID];
+    
+    [_condition lock];
+    NSDictionary *inFlight = [[_inFlightRows objectForKey:tableName] objectForKey:rowID];
+    NSDictionary *pending = [[_pendingRows objectForKey:tableName] objectForKey:rowID];
+    NSMutableDictionary *values = nil;
+    if (inFlight || pending){
+        values = [NSMutableDictionary dictionary];
+        if (inFlight) [values addEntriesFromDictionary:inFlight];
+        if (pending) [values addEntriesFromDictionary:pending];
+    }
+    [_condition unlock];
+    
+    return values;
+}
+
+-(void)discardPendingValuesForTable:(NSString*)tableName objectID:(RHSQLiteObjectID)objectID{
+    NSNumber *rowID = [NSNumber numberWithLongLong:objectID];
+    
+    [_condition lock];
+    NSMutableDictionary *rows = [_pendingRows objectForKey:tableName];
+    NSDictionary *columns = [rows objectForKey:rowID];
+    if (columns){
+        _pendingCount -= [columns count];
+        [rows removeObjectForKey:rowID];
+        [_condition broadcast];
+    }
+    [_condition unlock];
+}
+
+-(NSUInteger)numberOfPendingValues{
+    [_condition lock];
+    NSUInteger count = _pendingCount;
+    for (NSDictionary *rows in [_inFlightRows allValues]) {
+        for (NSDictionary *columns in [rows allValues]) {
+            count += [columns count];
+        }
+    }
+    [_condition unlock];
+    return count;
+}
+
+-(NSError*)lastError{
+    [_condition lock];
+    NSError *error = _lastError;
+    [_condition unlock];
+    return error;
+}
+
+
+#pragma mark - barriers
+-(BOOL)flushWithError:(NSError**)errorOut{
+    [_condition lock];
+    uint64_t target = _enqueuedSequence;
+    NSUInteger failureCount = _failureCount;
+    [_condition unlock];
+    
+    //runs after any batch already being committed, so everything queued before us is covered by one or the other
+    dispatch_sync(_writerQueue, ^{
+        [self _commit];
+    });
+    
+    [_condition lock];
+    BOOL result = (_committedSequence >= target && _failureCount == failureCount);
+    NSError *droppedError = [self _takeDroppedRowsError];
+    if (droppedError) result = NO;
+    if (!result && errorOut) *errorOut = droppedError ? droppedError : _lastError;
+    [_condition unlock];
+    return result;
+}
+
+-(BOOL)waitUntilCommitted{
+    [_condition lock];
+    uint64_t target = _enqueuedSequence;
+    NSUInteger failureCount = _failureCount;
+    while (_committedSequence < target && _failureCount == failureCount) {
+        [_condition wait];
+    }
+    BOOL result = (_committedSequence >= target && _failureCount == failureCount);
+    [_condition unlock];
+    return result;
+}
+
+
+#pragma mark - scheduling
+-(void)_requestCommit{
+    if (_lastCommitFailed){
+        [self _armTimer];
+        return;
+    }
+    if (_commitRequested) return;
+    _commitRequested = YES;
+    
+    dispatch_async(_writerQueue, ^{
+        [self _commit];
+    });
+}
+
+-(void)_armTimer{
+    if (_timerArmed) return;
+    _timerArmed = YES;
+    
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(_interval * NSEC_PER_SEC)), _writerQueue, ^{
+        [_condition lock];
+        _timerArmed = NO;
+        [_condition unlock];
+        [self _commit];
+    });
+}
+
+-(void)_mergeRows:(NSDictionary*)rows beneathRows:(NSMutableDictionary*)newerRows{
+    for (NSString *tableName in rows) {
+        NSMutableDictionary *newerTableRows = [newerRows objectForKey:tableName];
+        if (!newerTableRows){
+            newerTableRows = [NSMutableDictionary dictionary];
+            [newerRows setObject:newerTableRows forKey:tableName];
+        }
+        
+        NSDictionary *tableRows = [rows objectForKey:tableName];
+        for (NSNumber *rowID in tableRows) {
+            NSMutableDictionary *newerColumns = [newerTableRows objectForKey:rowID];
+            if (!newerColumns){
+                newerColumns = [NSMutableDictionary dictionary];
+                [newerTableRows setObject:newerColumns forKey:rowID];
+            }
+            
+            NSDictionary *columns = [tableRows objectForKey:rowID];
+            for (NSString *columnName in columns) {
+                if ([newerColumns objectForKey:columnName]) continue;
+                [newerColumns setObject:[columns objectForKey:columnName] forKey:columnName];
+                _pendingCount++;
+            }
+        }
+    }
+}
+
+
+#pragma mark - committing
+-(void)_commit{
+    //take everything queued as our batch, freeing the queue for savers
+    [_condition lock];
+    _commitRequested = NO;
+    if ([_pendingRows count] < 1){
+        [_condition unlock];
+        return;
+    }
+    NSDictionary *batch = _pendingRows;
+    NSDictionary *primaryKeyNames = [NSDictionary dictionaryWithDictionary:_primaryKeyNames];
+    uint64_t batchSequence = _enqueuedSequence;
+    _inFlightRows = batch;
+    _pendingRows = [[NSMutableDictionary alloc] init];
+    _pendingCount = 0;
+    [_condition broadcast];
+    [_condition unlock];
+    
+    //build the statements outside of the database block. sorted column names give every row with the same columns the same sql, so they share a cached statement
+    NSMutableArray *statements = [NSMutableArray array];
+    NSMutableArray *arguments = [NSMutableArray array];
+    NSMutableArray *statementTableNames = [NSMutableArray array];
+    for (NSString *tableName in batch) {
+        NSString *primaryKeyName = [primaryKeyNames objectForKey:tableName];
+        NSDictionary *rows = [batch objectForKey:tableName];
+        for (NSNumber *rowID in rows) {
+            NSDictionary *columns = [rows objectForKey:rowID];
+            if ([columns count] < 1) continue;
+            
+            NSArray *columnNames = [[columns allKeys] sortedArrayUsingSelector:@selector(compare:)];
+            [statements addObject:[NSString stringWithFormat:@"UPDATE `%@` SET `%@`=? WHERE `%@` = ?;", tableName, [columnNames componentsJoinedByString:@"`=?, `"], primaryKeyName]];
+            [arguments addObject:[[columns objectsForKeys:columnNames notFoundMarker:[NSNull null]] arrayByAddingObject:rowID]];
+            [statementTableNames addObject:tableName];
+        }
+    }
+    
+    __block NSError *transactionError = nil;
+    __block NSError *rowError = nil;
+    NSMutableArray *droppedIndexes = [NSMutableArray array];
+    _writer(^(FMDatabase *db) {
+        //we manage the transaction ourselves, FMDatabaseQueue ignores the result of its COMMIT and we need to know
+        if (![db beginTransaction]){
+            transactionError = [db lastError];
+            return;
+        }
+        
+        BOOL shouldCacheStatements = [db shouldCacheStatements];
+        [db setShouldCacheStatements:YES];
+        
+        [statements enumerateObjectsUsingBlock:^(NSString *sql, NSUInteger idx, BOOL *stop) {
+            if ([db executeUpdate:sql withArgumentsInArray:[arguments objectAtIndex:idx]]) return;
+            
+            if ([self _isPermanentError:[db lastErrorCode]]){
+                //this row can never be written, drop it and carry on with the rest
+                rowError = [db lastError];
+                [droppedIndexes addObject:[NSNumber numberWithUnsignedInteger:idx]];
+                RHErrorLog(@"Error: Write behind dropped changes for %@ %@. Error: %@.", sql, [[arguments objectAtIndex:idx] lastObject], rowError);
+                return;
+            }
+            
+            transactionError = [db lastError];
+            *stop = YES;
+        }];
+        
+        [db setShouldCacheStatements:shouldCacheStatements];
+        
+        if (!transactionError && ![db commit]) transactionError = [db lastError];
+        if (transactionError) [db rollback];
+    });
+    
+    [_condition lock];
+    _inFlightRows = nil;
+    
+    if (transactionError){
+        //nothing was written, put the batch back beneath anything saved since and try again later
+        RHErrorLog(@"Error: Write behind commit of %lu statements failed, retrying in %.3fs. Error: %@.", (unsigned long)[statements count], _interval, transactionError);
+        [self _mergeRows:batch beneathRows:_pendingRows];
+        _lastError = transactionError;
+        _failureCount++;
+        _lastCommitFailed = YES;
+        [self _armTimer];
+    } else {
+        _committedSequence = MAX(_committedSequence, batchSequence); //a saver on our queue may have committed a later batch from inside ours
+        _lastCommitFailed = NO;
+        if ([droppedIndexes count] > 0){
+            //kept until the next flush reports them, a rolled back retry would otherwise be the only trace
+            for (NSNumber *index in droppedIndexes) {
+                NSUInteger idx = [index unsignedIntegerValue];
+                NSString *tableName = [statementTableNames objectAtIndex:idx];
+                NSMutableArray *rowIDs = [_droppedRows objectForKey:tableName];
+                if (!rowIDs){
+                    rowIDs = [NSMutableArray array];
+                    [_droppedRows setObject:rowIDs forKey:tableName];
+                }
+                [rowIDs addObject:[[arguments objectAtIndex:idx] lastObject]];
+            }
+            _droppedError = rowError;
+            _lastError = rowError;
+            _failureCount++;
+        }
+        
+        //anything saved while we were committing
+        if (_pendingCount >= _batchSize) [self _requestCommit];
+        else if (_pendingCount > 0) [self _armTimer];
+    }
+    
+    [_condition broadcast];
+    [_condition unlock];
+}
+
+-(BOOL)_isPermanentError:(int)errorCode{
+    //only errors that the same values can never get past. anything else, even a plain SQLITE_ERROR, may be a migration or lock away from succeeding
+    switch (errorCode & 0xff) {
+        case SQLITE_CONSTRAINT:
+        case SQLITE_MISMATCH:
+        case SQLITE_READONLY:
+            return YES;
+        default:
+            return NO;
+    }
+}
+
+-(NSError*)_takeDroppedRowsError{
+    if ([_droppedRows count] < 1) return nil;
+    
+    NSMutableDictionary *droppedRows = [NSMutableDictionary dictionaryWithCapacity:[_droppedRows count]];
+    for (NSString *tableName in _droppedRows) {
+        [droppedRows setObject:[NSArray arrayWithArray:[_droppedRows objectForKey:tableName]] forKey:tableName];
+    }
+    
+    NSMutableDictionary *userInfo = [NSMutableDictionary dictionaryWithDictionary:[_droppedError userInfo]];
+    [userInfo setObject:droppedRows forKey:RHSQLiteDataStoreDroppedRowsKey];
+    NSError *error = [NSError errorWithDomain:[_droppedError domain] code:[_droppedError code] userInfo:userInfo];
+    
+    [_droppedRows removeAllObjects];
+    _droppedError = nil;
+    return error;
+}
+
+
+#pragma mark - description
+-(NSString*)description{
+    [_condition lock];
+    NSString *description = [NSString stringWithFormat:@"<%@: %p, interval: %.3fs, pending: %lu, batchSize: %lu, capacity: %lu, failures: %lu>", NSStringFromClass([self class]), self, _interval, (unsigned long)_pendingCount, (unsigned long)_batchSize, (unsigned long)_capacity, (unsigned long)_failureCount];
+    [_condition unlock];
+    return description;
+}
+
+@end
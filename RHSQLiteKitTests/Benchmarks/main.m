@@ -0,0 +1,107 @@
+//
+//  main.m
+//  rhsqlitekit-bench
+//
+//  Created by agent on 18/10/2026.
+//  Copyright (c) 2026 Richard Heard. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions
+//  are met:
+//  1. Redistributions of source code must retain the above copyright
+//  notice, this list of conditions and the following disclaimer.
+//  2. Redistributions in binary form must reproduce the above copyright
+//  notice, this list of conditions and the following disclaimer in the
+//  documentation and/or other materials provided with the distribution.
+//  3. The name of the author may not be used to endorse or promote products
+//  derived from this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+//  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+//  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+//  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+//  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+//  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+//  usage: rhsqlitekit-bench [-rows 10000,100000,1000000,10000000] [-seed N] [-samples N] [-directory path] [-output results.json] [-baseline baseline.json] [-threshold 0.10]
+//  exits with 1 if any regressions against the baseline were found, 2 if a run failed.
+
+#import <Foundation/Foundation.h>
+#import "RHSQLiteBenchmark.h"
+
+int main(int argc, const char * argv[]){
+    int status = 0;
+    @autoreleasepool {
+        NSUserDefaults *arguments = [NSUserDefaults standardUserDefaults];
+        
+        NSString *rowsArgument = [arguments stringForKey:@"rows"] ?: @"10000";
+        NSString *seedArgument = [arguments stringForKey:@"seed"];
+        uint64_t seed = seedArgument ? strtoull([seedArgument UTF8String], NULL, 10) : RHSQLiteBenchmarkDefaultSeed;
+        NSInteger samples = [arguments integerForKey:@"samples"];
+        NSString *directory = [arguments stringForKey:@"directory"] ?: NSTemporaryDirectory();
+        NSString *outputPath = [arguments stringForKey:@"output"];
+        NSString *baselinePath = [arguments stringForKey:@"baseline"];
+        double threshold = [arguments objectForKey:@"threshold"] ? [arguments doubleForKey:@"threshold"] : RHSQLiteBenchmarkDefaultRegressionThreshold;
+        
+        NSDictionary *baseline = nil;
+        if (baselinePath){
+            NSData *baselineData = [NSData dataWithContentsOfFile:baselinePath];
+            baseline = baselineData ? [NSJSONSerialization JSONObjectWithData:baselineData options:0 error:nil] : nil;
+            if (!baseline){
+                NSLog(@"Error: Failed to read baseline at %@.", baselinePath);
+                return 2;
+            }
+        }
+        
+        NSMutableArray *runs = [NSMutableArray array];
+        NSMutableArray *regressions = [NSMutableArray array];
+        
+        for (NSString *rowCountString in [rowsArgument componentsSeparatedByString:@","]) {
+            NSUInteger rowCount = (NSUInteger)[rowCountString longLongValue];
+            if (rowCount == 0) continue;
+            
+            RHSQLiteBenchmark *benchmark = [[RHSQLiteBenchmark alloc] initWithDirectory:directory rowCount:rowCount seed:seed];
+            if (samples > 0) [benchmark setSampleCount:samples];
+            
+            NSLog(@"Running %@", benchmark);
+            NSDictionary *results = [benchmark run];
+            if (!results){
+                NSLog(@"Error: Benchmark run with %lu rows failed.", (unsigned long)rowCount);
+                status = 2;
+                continue;
+            }
+            [runs addObject:results];
+            
+            //baseline runs are matched up by their row count
+            for (NSDictionary *baselineRun in [baseline objectForKey:@"runs"]) {
+                if ([[baselineRun objectForKey:@"rows"] unsignedIntegerValue] != rowCount) continue;
+                for (NSString *regression in [RHSQLiteBenchmark regressionsInResults:results comparedToBaseline:baselineRun threshold:threshold]) {
+                    [regressions addObject:[NSString stringWithFormat:@"rows %lu: %@", (unsigned long)rowCount, regression]];
+                }
+            }
+        }
+        
+        NSDictionary *output = [NSDictionary dictionaryWithObjectsAndKeys:@"RHSQLiteKit", @"suite", runs, @"runs", nil];
+        NSData *json = [NSJSONSerialization dataWithJSONObject:output options:NSJSONWritingPrettyPrinted error:nil];
+        if (outputPath){
+            if (![json writeToFile:outputPath atomically:YES]){
+                NSLog(@"Error: Failed to write results to %@.", outputPath);
+                status = 2;
+            }
+        } else {
+            fwrite([json bytes], 1, [json length], stdout);
+            fputc('\n', stdout);
+        }
+        
+        if ([regressions count]){
+            for (NSString *regression in regressions) fprintf(stderr, "REGRESSION %s\n", [regression UTF8String]);
+            if (status == 0) status = 1;
+        }
+    }
+    return status;
+}
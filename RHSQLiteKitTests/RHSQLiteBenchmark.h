@@ -0,0 +1,76 @@
+//
+//  RHSQLiteBenchmark.h
+//  RHSQLiteKitTests
+//
+//  Created by agent on 18/10/2026.
+//  Copyright (c) 2026 Richard Heard. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions
+//  are met:
+//  1. Redistributions of source code must retain the above copyright
+//  notice, this list of conditions and the following disclaimer.
+//  2. Redistributions in binary form must reproduce the above copyright
+//  notice, this list of conditions and the following disclaimer in the
+//  documentation and/or other materials provided with the distribution.
+//  3. The name of the author may not be used to endorse or promote products
+//  derived from this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+//  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+//  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+//  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+//  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+//  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#import <Foundation/Foundation.h>
+
+#define RHSQLiteBenchmarkDefaultSeed 20130730ULL
+#define RHSQLiteBenchmarkDefaultSampleCount 10000
+#define RHSQLiteBenchmarkDefaultRegressionThreshold 0.10
+
+/*!
+ @class RHSQLiteBenchmark
+ @abstract RHSQLiteBenchmark runs a fixed set of workloads against a freshly generated data store and reports the results as a JSON friendly dictionary.
+ @discussion Every run with the same row count and seed generates the same rows and performs the same operations, in the same order.
+    Cases (each reports operations, seconds, throughput (ops/s), mean, p50 and p99 latencies in seconds):
+    open_migrate    - opening a new, empty store and running its three migrations
+    insert          - insertObjects: in batches of 1000 until the table holds rowCount rows (latency is per object, averaged over its batch)
+    open_existing   - opening the populated store again
+    fetch_read      - objectFromTable:withID: for a random row, followed by three property reads
+    query           - objectsMatchingQuery: for a random category (~100 rows) ordered by score, reading the first result
+    save            - modifying two columns of a random row and saving it
+    archive_encode  - setting an archived NSArray column and saving it
+    archive_decode  - reading the archived column back from a freshly loaded object
+    delete          - deleting a random row
+    The run also records peak_rss_bytes, the peak resident set size of the process so far.
+ 
+    Used by RHSQLiteKitBenchmarkTests on Apple platforms and by the rhsqlitekit-bench tool (see Benchmarks/) for headless runs on Linux.
+ */
+@interface RHSQLiteBenchmark : NSObject {
+    NSString *_directory;
+    NSUInteger _rowCount;
+    uint64_t _seed;
+    NSUInteger _sampleCount;
+    uint64_t _randomState;
+}
+
+-(id)initWithDirectory:(NSString*)directory rowCount:(NSUInteger)rowCount seed:(uint64_t)seed;
+
+@property (nonatomic, readonly) NSString *directory; //scratch space for the store files, which are removed after the run
+@property (nonatomic, readonly) NSUInteger rowCount;
+@property (nonatomic, readonly) uint64_t seed;
+@property (nonatomic, assign) NSUInteger sampleCount; //operations timed by each of the per row cases, capped at rowCount. defaults to RHSQLiteBenchmarkDefaultSampleCount
+
+//returns nil if the store could not be created or populated
+-(NSDictionary*)run;
+
+//returns an array of human readable regressions. throughput drops, p99 increases and peak rss growth beyond threshold (0.10 == 10%) are regressions.
++(NSArray*)regressionsInResults:(NSDictionary*)results comparedToBaseline:(NSDictionary*)baseline threshold:(double)threshold;
+
+@end
@@ -0,0 +1,515 @@
+//
+//  RHSQLiteBenchmark.m
+//  RHSQLiteKitTests
+//
+//  Created by agent on 18/10/2026.
+//  Copyright (c) 2026 Richard Heard. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions
+//  are met:
+//  1. Redistributions of source code must retain the above copyright
+//  notice, this list of conditions and the following disclaimer.
+//  2. Redistributions in binary form must reproduce the above copyright
+//  notice, this list of conditions and the following disclaimer in the
+//  documentation and/or other materials provided with the distribution.
+//  3. The name of the author may not be used to endorse or promote products
+//  derived from this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+//  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+//  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+//  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+//  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+//  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#import "RHSQLiteBenchmark.h"
+
+#import "RHSQLiteKit.h"
+
+#include <sys/resource.h>
+
+#define RHSQLiteBenchmarkTableName @"bench_items"
+#define RHSQLiteBenchmarkInsertBatchSize 1000
+#define RHSQLiteBenchmarkRowsPerCategory 100
+#define RHSQLiteBenchmarkOpenSampleCount 10
+#define RHSQLiteBenchmarkMaxStoredSamples 100000 //latencies beyond this are reservoir sampled, to keep our own memory use flat
+
+
+#pragma mark - random
+//splitmix64, so that every platform generates the same sequence for a given seed
+static inline uint64_t RHSQLiteBenchmarkRandom(uint64_t *state){
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static uint64_t RHSQLiteBenchmarkPeakRSS(void){
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#if defined(__APPLE__)
+    return (uint64_t)usage.ru_maxrss; //bytes
+#else
+    return (uint64_t)usage.ru_maxrss * 1024; //kilobytes
+#endif
+}
+
+static int RHSQLiteBenchmarkCompareDoubles(const void *a, const void *b){
+    double x = *(const double*)a, y = *(const double*)b;
+    return x < y ? -1 : x > y ? 1 : 0;
+}
+
+
+#pragma mark - benchmark object
+@interface RHSQLiteBenchmarkItem : RHSQLiteObject
+@property (nonatomic, retain) NSString *name;
+@property (nonatomic, retain) NSArray *tags; //archived
+@end
+
+@implementation RHSQLiteBenchmarkItem
+@dynamic name;
+@dynamic tags;
+
++(NSString*)tableName{
+    return RHSQLiteBenchmarkTableName;
+}
+
++(NSString*)primaryKeyName{
+    return @"id";
+}
+
+@end
+
+
+#pragma mark - latency recorder
+@interface RHSQLiteBenchmarkRecorder : NSObject {
+    double *_samples;
+    NSUInteger _storedCount;
+    uint64_t _count;
+    double _total;
+    uint64_t *_randomState;
+}
+-(id)initWithRandomState:(uint64_t*)randomState;
+-(void)recordLatency:(NSTimeInterval)latency operations:(NSUInteger)operations;
+-(NSDictionary*)results;
+@end
+
+@implementation RHSQLiteBenchmarkRecorder
+
+-(id)initWithRandomState:(uint64_t*)randomState{
+    self = [super init];
+    if (self){
+        _samples = malloc(sizeof(double) * RHSQLiteBenchmarkMaxStoredSamples);
+        _randomState = randomState;
+    }
+    return self;
+}
+
+-(void)dealloc{
+    free(_samples);
+}
+
+//latency is the time taken by all operations, each is recorded as the average
+-(void)recordLatency:(NSTimeInterval)latency operations:(NSUInteger)operations{
+    if (operations == 0) return;
+    double each = latency / operations;
+    _total += latency;
+    
+    for (NSUInteger i = 0; i < operations; i++) {
+        _count++;
+        if (_storedCount < RHSQLiteBenchmarkMaxStoredSamples){
+            _samples[_storedCount++] = each;
+        } else {
+            uint64_t slot = RHSQLiteBenchmarkRandom(_randomState) % _count;
+            if (slot < RHSQLiteBenchmarkMaxStoredSamples) _samples[slot] = each;
+        }
+    }
+}
+
+-(NSDictionary*)results{
+    double p50 = 0.0, p99 = 0.0;
+    if (_storedCount > 0){
+        qsort(_samples, _storedCount, sizeof(double), RHSQLiteBenchmarkCompareDoubles);
+        p50 = _samples[(NSUInteger)ceil(_storedCount * 0.50) - 1];
+        p99 = _samples[(NSUInteger)ceil(_storedCount * 0.99) - 1];
+    }
+    
+    return [NSDictionary dictionaryWithObjectsAndKeys:
+            [NSNumber numberWithUnsignedLongLong:_count], @"operations",
+            [NSNumber numberWithDouble:_total], @"seconds",
+            [NSNumber numberWithDouble:_total > 0.0 ? _count / _total : 0.0], @"throughput",
+            [NSNumber numberWithDouble:_count > 0 ? _total / _count : 0.0], @"mean",
+            [NSNumber numberWithDouble:p50], @"p50",
+            [NSNumber numberWithDouble:p99], @"p99",
+            nil];
+}
+
+@end
+
+
+#pragma mark - benchmark
+@interface RHSQLiteBenchmark ()
+//private
+-(NSString*)_storePath:(NSString*)name;
+-(void)_removeStoreAtPath:(NSString*)path;
+-(RHSQLiteDataStore*)_openDataStoreAtPath:(NSString*)path;
+-(RHSQLiteObjectID)_randomObjectID;
+-(RHSQLiteBenchmarkRecorder*)_newRecorder NS_RETURNS_RETAINED;
+
+-(NSDictionary*)_runOpenMigrate;
+-(NSDictionary*)_runInsertIntoDataStore:(RHSQLiteDataStore*)dataStore;
+-(NSDictionary*)_runOpenExistingAtPath:(NSString*)path;
+-(NSDictionary*)_runFetchReadInDataStore:(RHSQLiteDataStore*)dataStore;
+-(NSDictionary*)_runQueryInDataStore:(RHSQLiteDataStore*)dataStore;
+-(NSDictionary*)_runSaveInDataStore:(RHSQLiteDataStore*)dataStore;
+-(void)_runArchiveInDataStore:(RHSQLiteDataStore*)dataStore results:(NSMutableDictionary*)results;
+-(NSDictionary*)_runDeleteInDataStore:(RHSQLiteDataStore*)dataStore;
+@end
+
+@implementation RHSQLiteBenchmark
+
+@synthesize directory=_directory;
+@synthesize rowCount=_rowCount;
+@synthesize seed=_seed;
+@synthesize sampleCount=_sampleCount;
+
+-(id)initWithDirectory:(NSString*)directory rowCount:(NSUInteger)rowCount seed:(uint64_t)seed{
+    self = [super init];
+    if (self){
+        _directory = [directory copy];
+        _rowCount = MAX(rowCount, (NSUInteger)1);
+        _seed = seed;
+        _sampleCount = RHSQLiteBenchmarkDefaultSampleCount;
+    }
+    return self;
+}
+
+#pragma mark - helpers
+-(NSString*)_storePath:(NSString*)name{
+    return [_directory stringByAppendingPathComponent:[NSString stringWithFormat:@"rhsqlitekit-bench-%@-%lu-%llu.sqlite", name, (unsigned long)_rowCount, _seed]];
+}
+
+-(void)_removeStoreAtPath:(NSString*)path{
+    NSFileManager *fileManager = [NSFileManager defaultManager];
+    for (NSString *suffix in [NSArray arrayWithObjects:@"", @"-wal", @"-shm", @"-journal", nil]) {
+        [fileManager removeItemAtPath:[path stringByAppendingString:suffix] error:nil];
+    }
+}
+
+-(RHSQLiteDataStore*)_openDataStoreAtPath:(NSString*)path{
+    RHSQLiteDataStoreOptions *options = [RHSQLiteDataStoreOptions optionsWithProfile:RHSQLiteDataStoreProfileWriteHeavy];
+    RHSQLiteDataStore *dataStore = [[RHSQLiteDataStore alloc] initWithPath:path options:options];
+    [dataStore associateObjectClass:[RHSQLiteBenchmarkItem class]];
+    
+    [dataStore registerMigrationBlock:^BOOL(RHSQLiteDataStore *store, FMDatabase *db) {
+        return [db executeUpdate:@"CREATE TABLE bench_items (id INTEGER PRIMARY KEY, name TEXT, score REAL, quantity INTEGER, category INTEGER, payload BLOB);"];
+    }];
+    [dataStore registerMigrationBlock:^BOOL(RHSQLiteDataStore *store, FMDatabase *db) {
+        return [db executeUpdate:@"ALTER TABLE bench_items ADD COLUMN tags BLOB;"];
+    }];
+    [dataStore registerMigrationBlock:^BOOL(RHSQLiteDataStore *store, FMDatabase *db) {
+        return [db executeUpdate:@"CREATE INDEX bench_items_category_index ON bench_items (category);"];
+    }];
+    
+    if (![dataStore loadAndPerformAnyRequiredMigrations]){
+        NSLog(@"Error: Failed to load benchmark data store at %@.", path);
+        return nil;
+    }
+    return dataStore;
+}
+
+-(RHSQLiteObjectID)_randomObjectID{
+    return (RHSQLiteObjectID)(RHSQLiteBenchmarkRandom(&_randomState) % _rowCount) + 1;
+}
+
+-(RHSQLiteBenchmarkRecorder*)_newRecorder{
+    return [[RHSQLiteBenchmarkRecorder alloc] initWithRandomState:&_randomState];
+}
+
+#pragma mark - run
+-(NSDictionary*)run{
+    _randomState = _seed;
+    NSUInteger samples = MIN(_sampleCount, _rowCount);
+    NSMutableDictionary *cases = [NSMutableDictionary dictionary];
+    
+    [cases setObject:[self _runOpenMigrate] forKey:@"open_migrate"];
+    
+    NSString *path = [self _storePath:@"main"];
+    [self _removeStoreAtPath:path];
+    
+    RHSQLiteDataStore *dataStore = [self _openDataStoreAtPath:path];
+    if (!dataStore) return nil;
+    
+    NSDictionary *insert = [self _runInsertIntoDataStore:dataStore];
+    if ([dataStore numberOfObjectsInTable:RHSQLiteBenchmarkTableName] != (int64_t)_rowCount){
+        NSLog(@"Error: Failed to populate benchmark data store. Expected %lu rows.", (unsigned long)_rowCount);
+        [self _removeStoreAtPath:path];
+        return nil;
+    }
+    [cases setObject:insert forKey:@"insert"];
+    
+    [cases setObject:[self _runOpenExistingAtPath:path] forKey:@"open_existing"];
+    [cases setObject:[self _runFetchReadInDataStore:dataStore] forKey:@"fetch_read"];
+    [cases setObject:[self _runQueryInDataStore:dataStore] forKey:@"query"];
+    [cases setObject:[self _runSaveInDataStore:dataStore] forKey:@"save"];
+    [self _runArchiveInDataStore:dataStore results:cases];
+    [cases setObject:[self _runDeleteInDataStore:dataStore] forKey:@"delete"];
+    
+    dataStore = nil;
+    [self _removeStoreAtPath:path];
+    
+#if defined(__APPLE__)
+    NSString *platform = @"darwin";
+#else
+    NSString *platform = @"linux";
+#endif
+    
+    return [NSDictionary dictionaryWithObjectsAndKeys:
+            @"RHSQLiteKit", @"suite",
+            [NSNumber numberWithUnsignedInteger:_rowCount], @"rows",
+            [NSNumber numberWithUnsignedLongLong:_seed], @"seed",
+            [NSNumber numberWithUnsignedInteger:samples], @"samples",
+            [FMDatabase sqliteLibVersion], @"sqlite_version",
+            platform, @"platform",
+            [NSNumber numberWithUnsignedLongLong:RHSQLiteBenchmarkPeakRSS()], @"peak_rss_bytes",
+            cases, @"cases",
+            nil];
+}
+
+#pragma mark - cases
+-(NSDictionary*)_runOpenMigrate{
+    RHSQLiteBenchmarkRecorder *recorder = [self _newRecorder];
+    NSString *path = [self _storePath:@"migrate"];
+    
+    for (NSUInteger i = 0; i < RHSQLiteBenchmarkOpenSampleCount; i++) {
+        [self _removeStoreAtPath:path];
+        @autoreleasepool {
+            NSTimeInterval start = [NSDate timeIntervalSinceReferenceDate];
+            RHSQLiteDataStore *dataStore = [self _openDataStoreAtPath:path];
+            [recorder recordLatency:[NSDate timeIntervalSinceReferenceDate] - start operations:dataStore ? 1 : 0];
+        }
+    }
+    
+    [self _removeStoreAtPath:path];
+    return [recorder results];
+}
+
+-(NSDictionary*)_runInsertIntoDataStore:(RHSQLiteDataStore*)dataStore{
+    RHSQLiteBenchmarkRecorder *recorder = [self _newRecorder];
+    NSUInteger categories = MAX(_rowCount / RHSQLiteBenchmarkRowsPerCategory, (NSUInteger)1);
+    
+    for (NSUInteger batchStart = 0; batchStart < _rowCount; batchStart += RHSQLiteBenchmarkInsertBatchSize) {
+        @autoreleasepool {
+            NSUInteger batchCount = MIN((NSUInteger)RHSQLiteBenchmarkInsertBatchSize, _rowCount - batchStart);
+            NSMutableArray *objects = [NSMutableArray arrayWithCapacity:batchCount];
+            
+            for (NSUInteger i = 0; i < batchCount; i++) {
+                uint64_t payloadBytes[8];
+                for (NSUInteger j = 0; j < 8; j++) payloadBytes[j] = RHSQLiteBenchmarkRandom(&_randomState);
+                
+                RHSQLiteBenchmarkItem *item = [[RHSQLiteBenchmarkItem alloc] initWithDataStore:dataStore];
+                [item setObject:[NSString stringWithFormat:@"item-%lu-%08llx", (unsigned long)(batchStart + i), RHSQLiteBenchmarkRandom(&_randomState) & 0xffffffffULL] forColumn:@"name"];
+                [item setDouble:(RHSQLiteBenchmarkRandom(&_randomState) % 1000000) / 100.0 forColumn:@"score"];
+                [item setLongLong:(long long)(RHSQLiteBenchmarkRandom(&_randomState) % 10000) forColumn:@"quantity"];
+                [item setLongLong:(long long)(RHSQLiteBenchmarkRandom(&_randomState) % categories) forColumn:@"category"];
+                [item setObject:[NSData dataWithBytes:payloadBytes length:sizeof(payloadBytes)] forColumn:@"payload"];
+                [objects addObject:item];
+            }
+            
+            //one transaction per batch, and new objects aren't read back until they are next accessed
+            NSTimeInterval start = [NSDate timeIntervalSinceReferenceDate];
+            BOOL saved = [dataStore saveAllChanges];
+            [recorder recordLatency:[NSDate timeIntervalSinceReferenceDate] - start operations:saved ? batchCount : 0];
+        }
+    }
+    
+    return [recorder results];
+}
+
+-(NSDictionary*)_runOpenExistingAtPath:(NSString*)path{
+    RHSQLiteBenchmarkRecorder *recorder = [self _newRecorder];
+    for (NSUInteger i = 0; i < RHSQLiteBenchmarkOpenSampleCount; i++) {
+        @autoreleasepool {
+            NSTimeInterval start = [NSDate timeIntervalSinceReferenceDate];
+            RHSQLiteDataStore *dataStore = [self _openDataStoreAtPath:path];
+            [recorder recordLatency:[NSDate timeIntervalSinceReferenceDate] - start operations:dataStore ? 1 : 0];
+        }
+    }
+    return [recorder results];
+}
+
+-(NSDictionary*)_runFetchReadInDataStore:(RHSQLiteDataStore*)dataStore{
+    RHSQLiteBenchmarkRecorder *recorder = [self _newRecorder];
+    NSUInteger samples = MIN(_sampleCount, _rowCount);
+    
+    for (NSUInteger i = 0; i < samples; i++) {
+        RHSQLiteObjectID objectID = [self _randomObjectID];
+        @autoreleasepool {
+            NSTimeInterval start = [NSDate timeIntervalSinceReferenceDate];
+            RHSQLiteBenchmarkItem *item = (RHSQLiteBenchmarkItem*)[dataStore objectFromTable:RHSQLiteBenchmarkTableName withID:objectID];
+            NSString *name = [item name];
+            double score = [item doubleForColumn:@"score"];
+            long long quantity = [item longLongForColumn:@"quantity"];
+            [recorder recordLatency:[NSDate timeIntervalSinceReferenceDate] - start operations:1];
+            
+            if (!name || score < 0.0 || quantity < 0) NSLog(@"Warning: Unexpected values for benchmark row %lld.", objectID);
+        }
+    }
+    return [recorder results];
+}
+
+-(NSDictionary*)_runQueryInDataStore:(RHSQLiteDataStore*)dataStore{
+    RHSQLiteBenchmarkRecorder *recorder = [self _newRecorder];
+    NSUInteger categories = MAX(_rowCount / RHSQLiteBenchmarkRowsPerCategory, (NSUInteger)1);
+    NSUInteger samples = MIN(_sampleCount, _rowCount) / 10 + 1; //each query returns ~100 rows
+    
+    for (NSUInteger i = 0; i < samples; i++) {
+        NSUInteger category = RHSQLiteBenchmarkRandom(&_randomState) % categories;
+        @autoreleasepool {
+            NSString *where = [NSString stringWithFormat:@"category = %lu", (unsigned long)category];
+            NSTimeInterval start = [NSDate timeIntervalSinceReferenceDate];
+            RHSQLiteObjectQuery *query = [RHSQLiteObjectQuery queryForObjectClass:[RHSQLiteBenchmarkItem class] where:where orderedBy:@"score" ascending:YES];
+            NSArray *objects = [dataStore objectsMatchingQuery:query];
+            if ([objects count]) [[objects objectAtIndex:0] doubleForColumn:@"score"];
+            [recorder recordLatency:[NSDate timeIntervalSinceReferenceDate] - start operations:1];
+        }
+    }
+    return [recorder results];
+}
+
+-(NSDictionary*)_runSaveInDataStore:(RHSQLiteDataStore*)dataStore{
+    RHSQLiteBenchmarkRecorder *recorder = [self _newRecorder];
+    NSUInteger samples = MIN(_sampleCount, _rowCount);
+    
+    for (NSUInteger i = 0; i < samples; i++) {
+        RHSQLiteObjectID objectID = [self _randomObjectID];
+        double score = (RHSQLiteBenchmarkRandom(&_randomState) % 1000000) / 100.0;
+        @autoreleasepool {
+            RHSQLiteBenchmarkItem *item = (RHSQLiteBenchmarkItem*)[dataStore objectFromTable:RHSQLiteBenchmarkTableName withID:objectID];
+            
+            NSTimeInterval start = [NSDate timeIntervalSinceReferenceDate];
+            [item setDouble:score forColumn:@"score"];
+            [item setLongLong:(long long)i forColumn:@"quantity"];
+            BOOL saved = [item save];
+            [recorder recordLatency:[NSDate timeIntervalSinceReferenceDate] - start operations:saved ? 1 : 0];
+        }
+    }
+    return [recorder results];
+}
+
+-(void)_runArchiveInDataStore:(RHSQLiteDataStore*)dataStore results:(NSMutableDictionary*)results{
+    RHSQLiteBenchmarkRecorder *encodeRecorder = [self _newRecorder];
+    RHSQLiteBenchmarkRecorder *decodeRecorder = [self _newRecorder];
+    NSUInteger samples = MIN(_sampleCount, _rowCount) / 5 + 1; //archiving is comparatively slow
+    
+    for (NSUInteger i = 0; i < samples; i++) {
+        RHSQLiteObjectID objectID = [self _randomObjectID];
+        NSMutableArray *tags = [NSMutableArray array];
+        for (NSUInteger j = 0; j < 8; j++) {
+            [tags addObject:[NSString stringWithFormat:@"tag-%llu", RHSQLiteBenchmarkRandom(&_randomState) % 1000]];
+        }
+        
+        @autoreleasepool {
+            RHSQLiteBenchmarkItem *item = (RHSQLiteBenchmarkItem*)[dataStore objectFromTable:RHSQLiteBenchmarkTableName withID:objectID];
+            NSTimeInterval start = [NSDate timeIntervalSinceReferenceDate];
+            [item setTags:tags];
+            BOOL saved = [item save];
+            [encodeRecorder recordLatency:[NSDate timeIntervalSinceReferenceDate] - start operations:saved ? 1 : 0];
+        }
+        
+        //the previous object is gone, so this is a fresh load and unarchive
+        @autoreleasepool {
+            NSTimeInterval start = [NSDate timeIntervalSinceReferenceDate];
+            RHSQLiteBenchmarkItem *item = (RHSQLiteBenchmarkItem*)[dataStore objectFromTable:RHSQLiteBenchmarkTableName withID:objectID];
+            NSArray *decoded = [item tags];
+            [decodeRecorder recordLatency:[NSDate timeIntervalSinceReferenceDate] - start operations:1];
+            
+            if (![decoded isEqualToArray:tags]) NSLog(@"Warning: Archived column round trip failed for benchmark row %lld.", objectID);
+        }
+    }
+    
+    [results setObject:[encodeRecorder results] forKey:@"archive_encode"];
+    [results setObject:[decodeRecorder results] forKey:@"archive_decode"];
+}
+
+-(NSDictionary*)_runDeleteInDataStore:(RHSQLiteDataStore*)dataStore{
+    RHSQLiteBenchmarkRecorder *recorder = [self _newRecorder];
+    NSUInteger samples = MIN(_sampleCount, _rowCount);
+    
+    //evenly spaced, so that every delete hits a row that still exists, visited in a seeded random order
+    NSMutableArray *objectIDs = [NSMutableArray arrayWithCapacity:samples];
+    for (NSUInteger i = 0; i < samples; i++) {
+        [objectIDs addObject:[NSNumber numberWithUnsignedLongLong:(i * _rowCount) / samples + 1]];
+    }
+    for (NSUInteger i = samples; i > 1; i--) {
+        [objectIDs exchangeObjectAtIndex:i - 1 withObjectAtIndex:RHSQLiteBenchmarkRandom(&_randomState) % i];
+    }
+    
+    for (NSNumber *objectID in objectIDs) {
+        @autoreleasepool {
+            RHSQLiteObject *item = [dataStore objectFromTable:RHSQLiteBenchmarkTableName withID:[objectID longLongValue]];
+            NSTimeInterval start = [NSDate timeIntervalSinceReferenceDate];
+            BOOL deleted = [dataStore deleteObject:item];
+            [recorder recordLatency:[NSDate timeIntervalSinceReferenceDate] - start operations:deleted ? 1 : 0];
+        }
+    }
+    return [recorder results];
+}
+
+#pragma mark - baseline comparison
++(NSArray*)regressionsInResults:(NSDictionary*)results comparedToBaseline:(NSDictionary*)baseline threshold:(double)threshold{
+    NSMutableArray *regressions = [NSMutableArray array];
+    
+    if (![[results objectForKey:@"rows"] isEqual:[baseline objectForKey:@"rows"]] || ![[results objectForKey:@"seed"] isEqual:[baseline objectForKey:@"seed"]]){
+        [regressions addObject:[NSString stringWithFormat:@"baseline was recorded with %@ rows and seed %@, not %@ rows and seed %@",
+                                [baseline objectForKey:@"rows"], [baseline objectForKey:@"seed"], [results objectForKey:@"rows"], [results objectForKey:@"seed"]]];
+        return regressions;
+    }
+    
+    NSDictionary *cases = [results objectForKey:@"cases"];
+    NSDictionary *baselineCases = [baseline objectForKey:@"cases"];
+    for (NSString *name in [[baselineCases allKeys] sortedArrayUsingSelector:@selector(compare:)]) {
+        NSDictionary *expected = [baselineCases objectForKey:name];
+        NSDictionary *actual = [cases objectForKey:name];
+        if (!actual){
+            [regressions addObject:[NSString stringWithFormat:@"%@: missing from results", name]];
+            continue;
+        }
+        
+        double expectedThroughput = [[expected objectForKey:@"throughput"] doubleValue];
+        double actualThroughput = [[actual objectForKey:@"throughput"] doubleValue];
+        if (expectedThroughput > 0.0 && actualThroughput < expectedThroughput * (1.0 - threshold)){
+            [regressions addObject:[NSString stringWithFormat:@"%@: throughput %.1f ops/s is %.1f%% below the baseline %.1f ops/s",
+                                    name, actualThroughput, (1.0 - actualThroughput / expectedThroughput) * 100.0, expectedThroughput]];
+        }
+        
+        double expectedP99 = [[expected objectForKey:@"p99"] doubleValue];
+        double actualP99 = [[actual objectForKey:@"p99"] doubleValue];
+        if (expectedP99 > 0.0 && actualP99 > expectedP99 * (1.0 + threshold)){
+            [regressions addObject:[NSString stringWithFormat:@"%@: p99 %.6fs is %.1f%% above the baseline %.6fs",
+                                    name, actualP99, (actualP99 / expectedP99 - 1.0) * 100.0, expectedP99]];
+        }
+    }
+    
+    double expectedRSS = [[baseline objectForKey:@"peak_rss_bytes"] doubleValue];
+    double actualRSS = [[results objectForKey:@"peak_rss_bytes"] doubleValue];
+    if (expectedRSS > 0.0 && actualRSS > expectedRSS * (1.0 + threshold)){
+        [regressions addObject:[NSString stringWithFormat:@"peak_rss_bytes: %.0f is %.1f%% above the baseline %.0f",
+                                actualRSS, (actualRSS / expectedRSS - 1.0) * 100.0, expectedRSS]];
+    }
+    
+    return regressions;
+}
+
+#pragma mark - description
+-(NSString*)description{
+    return [NSString stringWithFormat:@"<%@: %p, rows: %lu, seed: %llu, samples: %lu, directory: %@>", NSStringFromClass([self class]), self, (unsigned long)_rowCount, _seed, (unsigned long)_sampleCount, _directory];
+}
+
+@end
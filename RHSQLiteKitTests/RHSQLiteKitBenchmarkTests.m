@@ -0,0 +1,48 @@
+//
+//  RHSQLiteKitBenchmarkTests.m
+//  RHSQLiteKitTests
+//
+//  Created by agent on 18/10/2026.
+//  Copyright (c) 2026 Richard Heard. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import "RHSQLiteBenchmark.h"
+
+//set RHSQLITEKIT_BENCHMARK_BASELINE to the path of a previously written results file to fail on regressions
+#define RHSQLiteKitBenchmarkBaselineEnvironmentKey @"RHSQLITEKIT_BENCHMARK_BASELINE"
+
+@interface RHSQLiteKitBenchmarkTests : XCTestCase
+
+@end
+
+@implementation RHSQLiteKitBenchmarkTests
+
+- (void)testBenchmarkSuite
+{
+    RHSQLiteBenchmark *benchmark = [[RHSQLiteBenchmark alloc] initWithDirectory:NSTemporaryDirectory() rowCount:10000 seed:RHSQLiteBenchmarkDefaultSeed];
+    NSDictionary *results = [benchmark run];
+    XCTAssertNotNil(results, @"Benchmark run failed.");
+    
+    NSDictionary *cases = [results objectForKey:@"cases"];
+    for (NSString *name in [NSArray arrayWithObjects:@"open_migrate", @"insert", @"open_existing", @"fetch_read", @"query", @"save", @"archive_encode", @"archive_decode", @"delete", nil]) {
+        XCTAssertTrue([[[cases objectForKey:name] objectForKey:@"operations"] unsignedLongLongValue] > 0, @"Benchmark case %@ performed no operations.", name);
+    }
+    
+    NSData *json = [NSJSONSerialization dataWithJSONObject:results options:NSJSONWritingPrettyPrinted error:nil];
+    NSString *outputPath = [NSTemporaryDirectory() stringByAppendingPathComponent:@"rhsqlitekit-benchmark.json"];
+    [json writeToFile:outputPath atomically:YES];
+    NSLog(@"Benchmark results written to %@", outputPath);
+    
+    NSString *baselinePath = [[[NSProcessInfo processInfo] environment] objectForKey:RHSQLiteKitBenchmarkBaselineEnvironmentKey];
+    if (baselinePath){
+        NSData *baselineData = [NSData dataWithContentsOfFile:baselinePath];
+        NSDictionary *baseline = baselineData ? [NSJSONSerialization JSONObjectWithData:baselineData options:0 error:nil] : nil;
+        XCTAssertNotNil(baseline, @"Failed to read benchmark baseline at %@.", baselinePath);
+        
+        NSArray *regressions = [RHSQLiteBenchmark regressionsInResults:results comparedToBaseline:baseline threshold:RHSQLiteBenchmarkDefaultRegressionThreshold];
+        XCTAssertTrue([regressions count] == 0, @"Benchmark regressions:\n%@", [regressions componentsJoinedByString:@"\n"]);
+    }
+}
+
+@end
@@ -0,0 +1,121 @@
+//
+//  RHSQLiteKitChangeTrackingTests.m
+//  RHSQLiteKitTests
+//
+//  Created by agent on 18/10/2026.
+//  Copyright (c) 2026 Richard Heard. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions
+//  are met:
+//  1. Redistributions of source code must retain the above copyright
+//  notice, this list of conditions and the following disclaimer.
+//  2. Redistributions in binary form must reproduce the above copyright
+//  notice, this list of conditions and the following disclaimer in the
+//  documentation and/or other materials provided with the distribution.
+//  3. The name of the author may not be used to endorse or promote products
+//  derived from this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+//  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+//  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+//  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+//  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+//  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#import "RHSQLiteKitTests.h"
+
+@interface RHSQLiteKitChangeTrackingTests : RHSQLiteKitTests
+@end
+
+@implementation RHSQLiteKitChangeTrackingTests
+
+- (void)testChangeTrackerNotifiesObservers
+{
+    RHSQLiteDataStore *dataStore = [self _itemsDataStore];
+    NSMutableArray *changeSets = [NSMutableArray array];
+    id observer = [dataStore addObserverForTable:RHSQLiteKitTestsTableName queue:nil usingBlock:^(RHSQLiteChangeSet *changes) {
+        [changeSets addObject:changes];
+    }];
+    XCTAssertTrue([dataStore isChangeTrackingEnabled], @"Adding an observer didn't enable change tracking.");
+    
+    XCTAssertTrue([self _executeStatements:[NSArray arrayWithObject:@"INSERT INTO items (id, name, score) VALUES (1, 'one', 1.0);"] inDataStore:dataStore], @"Insert failed.");
+    XCTAssertEqual([changeSets count], (NSUInteger)1, @"Insert wasn't reported.");
+    XCTAssertEqualObjects([[changeSets lastObject] insertedObjectIDsInTable:RHSQLiteKitTestsTableName], [NSArray arrayWithObject:[NSNumber numberWithLongLong:1]], @"Unexpected inserted IDs.");
+    
+    //live objects pick up the change on their next access
+    RHSQLiteKitTestItem *item = (RHSQLiteKitTestItem*)[dataStore objectFromTable:RHSQLiteKitTestsTableName withID:1];
+    XCTAssertEqualObjects([item stringForColumn:@"name"], @"one", @"Unexpected name.");
+    
+    XCTAssertTrue([self _executeStatements:[NSArray arrayWithObject:@"UPDATE items SET name = 'uno' WHERE id = 1;"] inDataStore:dataStore], @"Update failed.");
+    XCTAssertEqual([changeSets count], (NSUInteger)2, @"Update wasn't reported.");
+    XCTAssertEqualObjects([[changeSets lastObject] updatedObjectIDsInTable:RHSQLiteKitTestsTableName], [NSArray arrayWithObject:[NSNumber numberWithLongLong:1]], @"Unexpected updated IDs.");
+    XCTAssertEqualObjects([item stringForColumn:@"name"], @"uno", @"The live object didn't reload.");
+    
+    XCTAssertTrue([self _executeStatements:[NSArray arrayWithObject:@"DELETE FROM items WHERE id = 1;"] inDataStore:dataStore], @"Delete failed.");
+    XCTAssertEqual([changeSets count], (NSUInteger)3, @"Delete wasn't reported.");
+    XCTAssertEqualObjects([[changeSets lastObject] deletedObjectIDsInTable:RHSQLiteKitTestsTableName], [NSArray arrayWithObject:[NSNumber numberWithLongLong:1]], @"Unexpected deleted IDs.");
+    XCTAssertTrue([item hasBeenDeleted], @"The live object wasn't marked as deleted.");
+    
+    [dataStore removeChangeObserver:observer];
+}
+
+- (void)testChangeTrackerReportsUnqualifiedDelete
+{
+    RHSQLiteDataStore *dataStore = [self _itemsDataStore];
+    XCTAssertTrue([self _executeStatements:[NSArray arrayWithObject:@"INSERT INTO items (id, name, score) VALUES (1, 'one', 1.0), (2, 'two', 2.0), (3, 'three', 3.0);"] inDataStore:dataStore], @"Insert failed.");
+    
+    NSMutableArray *changeSets = [NSMutableArray array];
+    id observer = [dataStore addObserverForTable:RHSQLiteKitTestsTableName queue:nil usingBlock:^(RHSQLiteChangeSet *changes) {
+        [changeSets addObject:changes];
+    }];
+    RHSQLiteKitTestItem *item = (RHSQLiteKitTestItem*)[dataStore objectFromTable:RHSQLiteKitTestsTableName withID:2];
+    [item load];
+    
+    //sqlite's truncate optimisation skips the update hook entirely
+    XCTAssertTrue([self _executeStatements:[NSArray arrayWithObject:@"DELETE FROM items;"] inDataStore:dataStore], @"Delete failed.");
+    NSArray *deletedIDs = [[[changeSets lastObject] deletedObjectIDsInTable:RHSQLiteKitTestsTableName] sortedArrayUsingSelector:@selector(compare:)];
+    NSArray *expectedIDs = [NSArray arrayWithObjects:[NSNumber numberWithLongLong:1], [NSNumber numberWithLongLong:2], [NSNumber numberWithLongLong:3], nil];
+    XCTAssertEqualObjects(deletedIDs, expectedIDs, @"Unqualified DELETE wasn't reported row by row.");
+    XCTAssertTrue([item hasBeenDeleted], @"The live object wasn't marked as deleted.");
+    XCTAssertEqual([dataStore numberOfObjectsInTable:RHSQLiteKitTestsTableName], (int64_t)0, @"Rows remain after the DELETE.");
+    
+    [dataStore removeChangeObserver:observer];
+}
+
+- (void)testExternalChangesReloadObjectsAndTableNames
+{
+    RHSQLiteDataStore *dataStore = [self _itemsDataStore];
+    RHSQLiteKitTestItem *item = [self _insertItemNamed:@"mine" score:1.0 inDataStore:dataStore];
+    
+    NSMutableArray *changeSets = [NSMutableArray array];
+    id observer = [dataStore addObserverForTable:RHSQLiteKitTestsTableName queue:nil usingBlock:^(RHSQLiteChangeSet *changes) {
+        [changeSets addObject:changes];
+    }];
+    XCTAssertEqualObjects([item stringForColumn:@"name"], @"mine", @"Unexpected name.");
+    XCTAssertFalse([dataStore checkForExternalChanges], @"Reported external changes before any were made.");
+    
+    //another connection, so neither write goes through our update hook
+    FMDatabase *db = [FMDatabase databaseWithPath:_path];
+    XCTAssertTrue([db open], @"Failed to open a second connection.");
+    XCTAssertTrue([db executeUpdate:@"UPDATE items SET name = 'theirs' WHERE id = ?;", [NSNumber numberWithLongLong:[item objectID]]], @"External update failed.");
+    XCTAssertTrue([db executeUpdate:@"CREATE TABLE tags (id INTEGER PRIMARY KEY, label TEXT);"], @"External create failed.");
+    [db close];
+    XCTAssertEqual([changeSets count], (NSUInteger)0, @"External writes were reported before checking for them.");
+    
+    XCTAssertTrue([dataStore checkForExternalChanges], @"The external writes weren't noticed.");
+    XCTAssertTrue([[changeSets lastObject] isExternal], @"Observers weren't handed an external change set.");
+    XCTAssertEqualObjects([item stringForColumn:@"name"], @"theirs", @"The live object didn't reload after the external update.");
+    XCTAssertTrue([[dataStore tableNames] containsObject:@"tags"], @"The table created externally isn't known.");
+    XCTAssertNotNil([dataStore objectClassForTable:@"tags"], @"The table created externally can't be used.");
+    XCTAssertFalse([dataStore checkForExternalChanges], @"The same external changes were reported twice.");
+    
+    [dataStore removeChangeObserver:observer];
+}
+
+@end
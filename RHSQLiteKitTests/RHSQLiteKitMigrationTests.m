@@ -0,0 +1,147 @@
+//
+//  RHSQLiteKitMigrationTests.m
+//  RHSQLiteKitTests
+//
+//  Created by agent on 18/10/2026.
+//  Copyright (c) 2026 Richard Heard. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions
+//  are met:
+//  1. Redistributions of source code must retain the above copyright
+//  notice, this list of conditions and the following disclaimer.
+//  2. Redistributions in binary form must reproduce the above copyright
+//  notice, this list of conditions and the following disclaimer in the
+//  documentation and/or other materials provided with the distribution.
+//  3. The name of the author may not be used to endorse or promote products
+//  derived from this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+//  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+//  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+//  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+//  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+//  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#import "RHSQLiteKitTests.h"
+
+@interface RHSQLiteKitMigrationTests : RHSQLiteKitTests
+
+-(NSString*)_migrationsFileWithScript:(NSString*)script;
+-(BOOL)_tableExists:(NSString*)tableName;
+
+@end
+
+@implementation RHSQLiteKitMigrationTests
+
+#pragma mark - helpers
+-(NSString*)_migrationsFileWithScript:(NSString*)script{
+    NSString *path = [_path stringByAppendingString:@"-migration.sql"];
+    [script writeToFile:path atomically:YES encoding:NSUTF8StringEncoding error:nil];
+    return path;
+}
+
+-(BOOL)_tableExists:(NSString*)tableName{
+    //straight to the file, the data store never finished loading
+    FMDatabase *db = [FMDatabase databaseWithPath:_path];
+    if (![db open]) return NO;
+    FMResultSet *resultSet = [db executeQuery:@"SELECT name FROM sqlite_master WHERE type = 'table' AND name = ?;", tableName];
+    BOOL exists = [resultSet next];
+    [resultSet close];
+    [db close];
+    return exists;
+}
+
+
+#pragma mark - scripts
+- (void)testMigrationScriptRejectsBeginAndCommit
+{
+    NSString *script = @"CREATE TABLE items (id INTEGER PRIMARY KEY, name TEXT, score REAL, note TEXT);\nBEGIN;\nINSERT INTO items (name) VALUES ('one');\nCOMMIT;\n";
+    NSString *migrationsPath = [self _migrationsFileWithScript:script];
+    
+    RHSQLiteDataStore *dataStore = [[RHSQLiteDataStore alloc] initWithPath:_path];
+    [dataStore registerMigrationsFile:migrationsPath];
+    XCTAssertFalse([dataStore loadAndPerformAnyRequiredMigrations], @"A script containing BEGIN and COMMIT was run.");
+    dataStore = nil;
+    
+    XCTAssertFalse([self _tableExists:RHSQLiteKitTestsTableName], @"The failed migration wasn't rolled back.");
+    [[NSFileManager defaultManager] removeItemAtPath:migrationsPath error:nil];
+}
+
+- (void)testMigrationScriptRejectsVacuumAndForeignKeys
+{
+    for (NSString *statement in [NSArray arrayWithObjects:@"VACUUM;", @"PRAGMA foreign_keys = OFF;", @"/* comment */ pragma main.foreign_keys=1;", nil]) {
+        NSString *script = [NSString stringWithFormat:@"CREATE TABLE items (id INTEGER PRIMARY KEY, name TEXT);\n%@\n", statement];
+        NSString *migrationsPath = [self _migrationsFileWithScript:script];
+        
+        RHSQLiteDataStore *dataStore = [[RHSQLiteDataStore alloc] initWithPath:_path];
+        [dataStore registerMigrationsFile:migrationsPath];
+        XCTAssertFalse([dataStore loadAndPerformAnyRequiredMigrations], @"A script containing %@ was run.", statement);
+        dataStore = nil;
+        
+        XCTAssertFalse([self _tableExists:RHSQLiteKitTestsTableName], @"The migration containing %@ wasn't rolled back.", statement);
+        [[NSFileManager defaultManager] removeItemAtPath:migrationsPath error:nil];
+    }
+}
+
+- (void)testMigrationScriptAllowsSavepoints
+{
+    NSString *script = @"CREATE TABLE items (id INTEGER PRIMARY KEY, name TEXT, score REAL, note TEXT);\nSAVEPOINT seed;\nINSERT INTO items (name) VALUES ('discarded');\nROLLBACK TO seed;\nINSERT INTO items (name) VALUES ('kept');\nRELEASE seed;\nPRAGMA user_version = 1;\n";
+    NSString *migrationsPath = [self _migrationsFileWithScript:script];
+    
+    RHSQLiteDataStore *dataStore = [[RHSQLiteDataStore alloc] initWithPath:_path];
+    [dataStore associateObjectClass:[RHSQLiteKitTestItem class]];
+    [dataStore registerMigrationsFile:migrationsPath];
+    XCTAssertTrue([dataStore loadAndPerformAnyRequiredMigrations], @"A script using savepoints failed.");
+    XCTAssertEqual([dataStore numberOfObjectsInTable:RHSQLiteKitTestsTableName], (int64_t)1, @"The savepoint wasn't rolled back to.");
+    XCTAssertEqualObjects([self _valueForQuery:@"SELECT name FROM items;" inDataStore:dataStore], @"kept", @"Unexpected row after the savepoint.");
+    [[NSFileManager defaultManager] removeItemAtPath:migrationsPath error:nil];
+}
+
+- (void)testMigrationBlockThatCommitsFails
+{
+    RHSQLiteDataStore *dataStore = [[RHSQLiteDataStore alloc] initWithPath:_path];
+    [dataStore registerMigrationBlock:^BOOL(RHSQLiteDataStore *store, FMDatabase *db) {
+        return [db executeUpdate:RHSQLiteKitTestsCreateTableSQL] && [db executeUpdate:@"COMMIT;"];
+    }];
+    XCTAssertFalse([dataStore loadAndPerformAnyRequiredMigrations], @"A migration block that ended the transaction succeeded.");
+}
+
+
+#pragma mark - rebuilds
+- (void)testRebuildTableWithSparseRowIDs
+{
+    int64_t farRowID = 4611686018427387904LL; //2^62, far more rowids than could ever be stepped through
+    NSArray *create = [NSArray arrayWithObjects:
+                       RHSQLiteKitTestsCreateTableSQL,
+                       [NSString stringWithFormat:@"INSERT INTO items (id, name, score) VALUES (1, 'one', 1.0), (2, 'two', 2.0), (%lld, 'far', 3.0), (%lld, 'farther', 4.0);", farRowID, farRowID + 5],
+                       nil];
+    
+    RHSQLiteDataStore *dataStore = [[RHSQLiteDataStore alloc] initWithPath:_path];
+    [dataStore associateObjectClass:[RHSQLiteKitTestItem class]];
+    [dataStore registerMigrationBlock:^BOOL(RHSQLiteDataStore *store, FMDatabase *db) {
+        for (NSString *sql in create) {
+            if (![db executeUpdate:sql]) return NO;
+        }
+        return YES;
+    }];
+    //drops the note column, in batches smaller than the table so that the gaps fall between batches
+    [dataStore registerMigrationBlock:^BOOL(RHSQLiteDataStore *store, FMDatabase *db) {
+        return [store rebuildTable:RHSQLiteKitTestsTableName withColumnDefinitions:@"id INTEGER PRIMARY KEY, name TEXT, score REAL" columnMapping:nil batchSize:1 inDatabase:db];
+    }];
+    XCTAssertTrue([dataStore loadAndPerformAnyRequiredMigrations], @"Rebuild failed.");
+    
+    XCTAssertEqual([dataStore numberOfObjectsInTable:RHSQLiteKitTestsTableName], (int64_t)4, @"Rows were lost by the rebuild.");
+    XCTAssertFalse([[dataStore columnNamesForTable:RHSQLiteKitTestsTableName] containsObject:@"note"], @"The dropped column is still there.");
+    
+    RHSQLiteKitTestItem *far = (RHSQLiteKitTestItem*)[dataStore objectFromTable:RHSQLiteKitTestsTableName withID:farRowID + 5];
+    XCTAssertEqualObjects([far stringForColumn:@"name"], @"farther", @"The last row wasn't copied.");
+    XCTAssertEqual([far doubleForColumn:@"score"], 4.0, @"The last row wasn't copied.");
+}
+
+@end
@@ -0,0 +1,116 @@
+//
+//  RHSQLiteKitParallelScanTests.m
+//  RHSQLiteKitTests
+//
+//  Created by agent on 18/10/2026.
+//  Copyright (c) 2026 Richard Heard. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions
+//  are met:
+//  1. Redistributions of source code must retain the above copyright
+//  notice, this list of conditions and the following disclaimer.
+//  2. Redistributions in binary form must reproduce the above copyright
+//  notice, this list of conditions and the following disclaimer in the
+//  documentation and/or other materials provided with the distribution.
+//  3. The name of the author may not be used to endorse or promote products
+//  derived from this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+//  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+//  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+//  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+//  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+//  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#import "RHSQLiteKitTests.h"
+
+#define RHSQLiteKitParallelScanTestsRowCount 200
+#define RHSQLiteKitParallelScanTestsPartitionSize 10
+
+@interface RHSQLiteKitParallelScanTests : RHSQLiteKitTests
+
+-(RHSQLiteDataStore*)_populatedDataStoreWithOptions:(RHSQLiteDataStoreOptions*)options;
+-(RHSQLiteObjectQuery*)_scanQuery;
+
+@end
+
+@implementation RHSQLiteKitParallelScanTests
+
+#pragma mark - helpers
+-(RHSQLiteDataStore*)_populatedDataStoreWithOptions:(RHSQLiteDataStoreOptions*)options{
+    @autoreleasepool {
+        NSString *populate = [NSString stringWithFormat:@"WITH RECURSIVE n(i) AS (SELECT 1 UNION ALL SELECT i + 1 FROM n WHERE i < %d) INSERT INTO items (id, name, score) SELECT i, 'item ' || i, i %% 7 FROM n;", RHSQLiteKitParallelScanTestsRowCount];
+        RHSQLiteDataStore *dataStore = [self _dataStoreWithMigrations:[NSArray arrayWithObject:[NSArray arrayWithObjects:RHSQLiteKitTestsCreateTableSQL, populate, nil]]];
+        if (!dataStore) return nil;
+    }
+    
+    RHSQLiteDataStore *dataStore = [[RHSQLiteDataStore alloc] initWithPath:_path options:options];
+    [dataStore associateObjectClass:[RHSQLiteKitTestItem class]];
+    if (![dataStore loadAndPerformAnyRequiredMigrations]) return nil;
+    [dataStore setMaximumScanConcurrency:2];
+    [dataStore setMinimumScanPartitionSize:RHSQLiteKitParallelScanTestsPartitionSize];
+    return dataStore;
+}
+
+-(RHSQLiteObjectQuery*)_scanQuery{
+    return [RHSQLiteObjectQuery queryForObjectClass:[RHSQLiteKitTestItem class] where:@"score >= 3" orderedBy:@"id" ascending:YES];
+}
+
+
+#pragma mark - tests
+- (void)testReadOnlyStoreSplitsScans
+{
+    RHSQLiteDataStore *dataStore = [self _populatedDataStoreWithOptions:[RHSQLiteDataStoreOptions optionsWithProfile:RHSQLiteDataStoreProfileImmutable]];
+    XCTAssertNotNil(dataStore, @"Failed to load the read only data store.");
+    XCTAssertTrue([dataStore isReadOnly], @"The immutable profile didn't open read only.");
+    
+    NSMutableSet *ranges = [NSMutableSet set];
+    __block NSUInteger reportedRangeCount = 0;
+    __block NSUInteger objectCount = 0;
+    BOOL result = [dataStore enumerateObjectsMatchingQuery:[self _scanQuery] inParallelUsingBlock:^(NSArray *objects, NSUInteger range, NSUInteger rangeCount) {
+        @synchronized(ranges){
+            [ranges addObject:[NSNumber numberWithUnsignedInteger:range]];
+            reportedRangeCount = rangeCount;
+            objectCount += [objects count];
+        }
+    }];
+    XCTAssertTrue(result, @"The parallel scan failed.");
+    XCTAssertTrue(reportedRangeCount > 1, @"The read only scan wasn't split.");
+    XCTAssertEqual([ranges count], reportedRangeCount, @"Not every range was read.");
+    
+    NSArray *expected = [dataStore objectsMatchingQuery:[self _scanQuery]];
+    XCTAssertEqual(objectCount, [expected count], @"The ranges didn't add up to the whole query.");
+    XCTAssertEqualObjects([dataStore objectsMatchingQueryInParallel:[self _scanQuery]], expected, @"The parallel results differ from objectsMatchingQuery:.");
+}
+
+- (void)testWritableStoreFallsBackToSingleScan
+{
+    RHSQLiteDataStore *dataStore = [self _populatedDataStoreWithOptions:nil];
+    XCTAssertNotNil(dataStore, @"Failed to load data store.");
+    XCTAssertFalse([dataStore isReadOnly], @"Expected a writable data store.");
+    
+    __block NSUInteger calls = 0;
+    __block NSUInteger objectCount = 0;
+    NSThread *callingThread = [NSThread currentThread];
+    __block BOOL calledOnCallingThread = NO;
+    BOOL result = [dataStore enumerateObjectsMatchingQuery:[self _scanQuery] inParallelUsingBlock:^(NSArray *objects, NSUInteger range, NSUInteger rangeCount) {
+        calls++;
+        objectCount = [objects count];
+        calledOnCallingThread = ([NSThread currentThread] == callingThread && range == 0 && rangeCount == 1);
+    }];
+    XCTAssertTrue(result, @"The fallback scan failed.");
+    XCTAssertEqual(calls, (NSUInteger)1, @"A writable store's scan was split.");
+    XCTAssertTrue(calledOnCallingThread, @"The fallback wasn't passed whole, as range 0 of 1, on the calling thread.");
+    
+    NSArray *expected = [dataStore objectsMatchingQuery:[self _scanQuery]];
+    XCTAssertEqual(objectCount, [expected count], @"The fallback didn't return the whole query.");
+    XCTAssertEqualObjects([dataStore objectsMatchingQueryInParallel:[self _scanQuery]], expected, @"The fallback results differ from objectsMatchingQuery:.");
+}
+
+@end
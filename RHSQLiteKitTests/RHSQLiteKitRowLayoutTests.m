@@ -0,0 +1,115 @@
+//
+//  RHSQLiteKitRowLayoutTests.m
+//  RHSQLiteKitTests
+//
+//  Created by agent on 18/10/2026.
+//  Copyright (c) 2026 Richard Heard. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions
+//  are met:
+//  1. Redistributions of source code must retain the above copyright
+//  notice, this list of conditions and the following disclaimer.
+//  2. Redistributions in binary form must reproduce the above copyright
+//  notice, this list of conditions and the following disclaimer in the
+//  documentation and/or other materials provided with the distribution.
+//  3. The name of the author may not be used to endorse or promote products
+//  derived from this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+//  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+//  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+//  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+//  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+//  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#import "RHSQLiteKitTests.h"
+#import "RHSQLiteRowLayout.h"
+
+@interface RHSQLiteKitRowLayoutTests : RHSQLiteKitTests
+@end
+
+@implementation RHSQLiteKitRowLayoutTests
+
+- (void)testLayoutSlotIndexes
+{
+    NSArray *columnNames = [NSArray arrayWithObjects:@"id", @"name", @"score", nil];
+    RHSQLiteRowLayout *layout = [[RHSQLiteRowLayout alloc] initWithColumnNames:columnNames];
+    RHSQLiteRowLayout *other = [[RHSQLiteRowLayout alloc] initWithColumnNames:columnNames];
+    
+    XCTAssertEqual([layout count], (NSUInteger)3, @"Unexpected slot count.");
+    XCTAssertEqual([layout slotIndexForColumn:@"score"], (NSUInteger)2, @"Unexpected slot index.");
+    XCTAssertEqual([layout slotIndexForColumn:@"missing"], (NSUInteger)NSNotFound, @"An unknown column has a slot.");
+    XCTAssertEqualObjects([layout columnNameForSlotIndex:1], @"name", @"Unexpected column name.");
+    XCTAssertNil([layout columnNameForSlotIndex:3], @"Out of range slot indexes should return nil.");
+    XCTAssertTrue([layout serial] != 0 && [layout serial] != [other serial], @"Layouts must have unique, non zero serials.");
+}
+
+- (void)testRowLayoutFollowsReorderedColumns
+{
+    RHSQLiteDataStore *dataStore = [self _itemsDataStore];
+    XCTAssertNotNil(dataStore, @"Failed to load data store.");
+    
+    RHSQLiteKitTestItem *first = [self _insertItemNamed:@"first" score:1.5 inDataStore:dataStore];
+    XCTAssertEqualObjects([first stringForColumn:@"name"], @"first", @"Unexpected name before the rebuild.");
+    
+    //same columns, different order. the cached layout still has the old order
+    BOOL rebuilt = [self _executeStatements:[NSArray arrayWithObjects:
+                                             @"CREATE TABLE items_new (note TEXT, score REAL, name TEXT, id INTEGER PRIMARY KEY);",
+                                             @"INSERT INTO items_new (note, score, name, id) SELECT note, score, name, id FROM items;",
+                                             @"DROP TABLE items;",
+                                             @"ALTER TABLE items_new RENAME TO items;",
+                                             @"INSERT INTO items (note, score, name) VALUES ('note', 2.5, 'second');",
+                                             nil] inDataStore:dataStore];
+    XCTAssertTrue(rebuilt, @"Failed to reorder the table.");
+    
+    RHSQLiteObjectID secondID = [[self _valueForQuery:@"SELECT id FROM items WHERE name = 'second';" inDataStore:dataStore] longLongValue];
+    RHSQLiteKitTestItem *second = (RHSQLiteKitTestItem*)[dataStore objectFromTable:RHSQLiteKitTestsTableName withID:secondID];
+    XCTAssertEqualObjects([second stringForColumn:@"name"], @"second", @"Columns were read by position rather than by name.");
+    XCTAssertEqual([second doubleForColumn:@"score"], 2.5, @"Columns were read by position rather than by name.");
+    XCTAssertEqualObjects([second stringForColumn:@"note"], @"note", @"Columns were read by position rather than by name.");
+    
+    XCTAssertTrue([first reload], @"Failed to reload after the rebuild.");
+    XCTAssertEqualObjects([first stringForColumn:@"name"], @"first", @"Unexpected name after the rebuild.");
+    XCTAssertEqual([first doubleForColumn:@"score"], 1.5, @"Unexpected score after the rebuild.");
+}
+
+- (void)testRowLayoutAfterAddingColumnInMigration
+{
+    NSArray *migrations = [NSArray arrayWithObject:[NSArray arrayWithObject:RHSQLiteKitTestsCreateTableSQL]];
+    RHSQLiteObjectID objectID = RHSQLiteObjectIDInvalid;
+    @autoreleasepool {
+        RHSQLiteDataStore *dataStore = [self _dataStoreWithMigrations:migrations];
+        XCTAssertNotNil(dataStore, @"Failed to load data store.");
+        objectID = [[self _insertItemNamed:@"before" score:3.0 inDataStore:dataStore] objectID];
+    }
+    
+    migrations = [migrations arrayByAddingObject:[NSArray arrayWithObject:@"ALTER TABLE items ADD COLUMN rank INTEGER DEFAULT 7;"]];
+    RHSQLiteDataStore *dataStore = [self _dataStoreWithMigrations:migrations];
+    XCTAssertNotNil(dataStore, @"Failed to migrate data store.");
+    
+    RHSQLiteKitTestItem *item = (RHSQLiteKitTestItem*)[dataStore objectFromTable:RHSQLiteKitTestsTableName withID:objectID];
+    XCTAssertTrue([item hasColumn:@"rank"], @"The new column is missing from the layout.");
+    XCTAssertEqual([item longLongForColumn:@"rank"], 7LL, @"Unexpected value for the new column.");
+    XCTAssertEqualObjects([item stringForColumn:@"name"], @"before", @"Existing columns changed after adding a column.");
+    XCTAssertEqual([item doubleForColumn:@"score"], 3.0, @"Existing columns changed after adding a column.");
+}
+
+- (void)testDictionaryRepresentationIncludesUnsavedColumns
+{
+    RHSQLiteDataStore *dataStore = [self _itemsDataStore];
+    RHSQLiteKitTestItem *item = [self _insertItemNamed:@"saved" score:1.0 inDataStore:dataStore];
+    [item setObject:@"unsaved" forColumn:@"name"];
+    
+    NSDictionary *dictionary = [item dictionaryRepresentation];
+    XCTAssertEqualObjects([dictionary objectForKey:@"name"], @"unsaved", @"The unsaved column is missing or stale.");
+    XCTAssertEqualObjects([dictionary objectForKey:@"score"], [NSNumber numberWithDouble:1.0], @"The saved double column is missing.");
+    XCTAssertEqualObjects([dictionary objectForKey:@"id"], [NSNumber numberWithLongLong:[item objectID]], @"The primary key is missing.");
+}
+
+@end
@@ -0,0 +1,92 @@
+//
+//  RHSQLiteKitSchemaCacheTests.m
+//  RHSQLiteKitTests
+//
+//  Created by agent on 18/10/2026.
+//  Copyright (c) 2026 Richard Heard. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions
+//  are met:
+//  1. Redistributions of source code must retain the above copyright
+//  notice, this list of conditions and the following disclaimer.
+//  2. Redistributions in binary form must reproduce the above copyright
+//  notice, this list of conditions and the following disclaimer in the
+//  documentation and/or other materials provided with the distribution.
+//  3. The name of the author may not be used to endorse or promote products
+//  derived from this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+//  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+//  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+//  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+//  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+//  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#import "RHSQLiteKitTests.h"
+
+#define RHSQLiteKitSchemaCacheTestsCreateTagsSQL @"CREATE TABLE tags (id INTEGER PRIMARY KEY, label TEXT);"
+
+@interface RHSQLiteKitSchemaCacheTests : RHSQLiteKitTests
+@end
+
+@implementation RHSQLiteKitSchemaCacheTests
+
+- (void)testObjectClassNamesIncludeTablesWithoutGeneratedClasses
+{
+    RHSQLiteDataStore *dataStore = [self _dataStoreWithMigrations:[NSArray arrayWithObject:[NSArray arrayWithObjects:RHSQLiteKitTestsCreateTableSQL, RHSQLiteKitSchemaCacheTestsCreateTagsSQL, nil]]];
+    XCTAssertNotNil(dataStore, @"Failed to load data store.");
+    
+    //tags has no associated class, so its class isn't generated until first used
+    NSArray *classNames = [dataStore objectClassNames];
+    XCTAssertTrue([classNames containsObject:NSStringFromClass([RHSQLiteKitTestItem class])], @"The associated class is missing.");
+    XCTAssertEqual([classNames count], [[dataStore tableNames] count], @"Expected a class name for every table. Got: %@.", classNames);
+    
+    Class tagsClass = [dataStore objectClassForTable:@"tags"];
+    XCTAssertNotNil(tagsClass, @"Failed to generate a class for the tags table.");
+    XCTAssertTrue([classNames containsObject:NSStringFromClass(tagsClass)], @"The name reported before generation doesn't match the generated class.");
+    XCTAssertEqualObjects([NSSet setWithArray:[dataStore objectClassNames]], [NSSet setWithArray:classNames], @"Generating the class changed the reported names.");
+}
+
+- (void)testCachedSchemaNoticesExternalChanges
+{
+    NSArray *migrations = [NSArray arrayWithObject:[NSArray arrayWithObject:RHSQLiteKitTestsCreateTableSQL]];
+    @autoreleasepool {
+        RHSQLiteDataStore *dataStore = [self _dataStoreWithMigrations:migrations];
+        XCTAssertNotNil(dataStore, @"Failed to load data store.");
+        XCTAssertFalse([[dataStore tableNames] containsObject:@"tags"], @"Unexpected tags table.");
+    }
+    
+    //changes the schema cookie behind the data stores back
+    FMDatabase *db = [FMDatabase databaseWithPath:_path];
+    XCTAssertTrue([db open], @"Failed to open the file directly.");
+    XCTAssertTrue([db executeUpdate:RHSQLiteKitSchemaCacheTestsCreateTagsSQL], @"Failed to add the tags table.");
+    XCTAssertTrue([db executeUpdate:@"ALTER TABLE items ADD COLUMN rank INTEGER;"], @"Failed to add a column.");
+    [db close];
+    
+    RHSQLiteDataStore *dataStore = [self _dataStoreWithMigrations:migrations];
+    XCTAssertNotNil(dataStore, @"Failed to reload data store.");
+    XCTAssertTrue([[dataStore tableNames] containsObject:@"tags"], @"The cached table names were used after the schema changed.");
+    XCTAssertTrue([[dataStore columnNamesForTable:RHSQLiteKitTestsTableName] containsObject:@"rank"], @"The cached column names were used after the schema changed.");
+    XCTAssertNotNil([dataStore objectClassForTable:@"tags"], @"The new table can't be used.");
+}
+
+- (void)testLoadWithoutMigrationsLeavesFileUntouched
+{
+    FMDatabase *db = [FMDatabase databaseWithPath:_path];
+    XCTAssertTrue([db open], @"Failed to create the file directly.");
+    XCTAssertTrue([db executeUpdate:RHSQLiteKitTestsCreateTableSQL], @"Failed to create the items table.");
+    [db close];
+    
+    RHSQLiteDataStore *dataStore = [[RHSQLiteDataStore alloc] initWithPath:_path];
+    XCTAssertTrue([dataStore loadAndPerformAnyRequiredMigrations], @"Failed to load data store.");
+    XCTAssertTrue([[dataStore tableNames] containsObject:RHSQLiteKitTestsTableName], @"The items table wasn't found.");
+    XCTAssertEqualObjects([self _valueForQuery:@"SELECT count(*) FROM sqlite_master WHERE type = 'table' AND name = 'metadata';" inDataStore:dataStore], [NSNumber numberWithInt:0], @"Loading without migrations wrote a metadata table.");
+}
+
+@end
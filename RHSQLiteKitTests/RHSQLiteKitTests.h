@@ -0,0 +1,59 @@
+//
+//  RHSQLiteKitTests.h
+//  RHSQLiteKitTests
+//
+//  Created by agent on 18/10/2026.
+//  Copyright (c) 2026 Richard Heard. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions
+//  are met:
+//  1. Redistributions of source code must retain the above copyright
+//  notice, this list of conditions and the following disclaimer.
+//  2. Redistributions in binary form must reproduce the above copyright
+//  notice, this list of conditions and the following disclaimer in the
+//  documentation and/or other materials provided with the distribution.
+//  3. The name of the author may not be used to endorse or promote products
+//  derived from this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+//  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+//  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+//  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+//  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+//  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#import <XCTest/XCTest.h>
+#import "RHSQLiteKit.h"
+
+#define RHSQLiteKitTestsTableName @"items"
+#define RHSQLiteKitTestsCreateTableSQL @"CREATE TABLE items (id INTEGER PRIMARY KEY, name TEXT, score REAL CHECK (score >= 0), note TEXT);"
+
+/*!
+ @class RHSQLiteKitTestItem
+ @abstract RHSQLiteKitTestItem is the object class for the items table created by RHSQLiteKitTestsCreateTableSQL.
+ */
+@interface RHSQLiteKitTestItem : RHSQLiteObject
+@end
+
+/*!
+ @class RHSQLiteKitTests
+ @abstract RHSQLiteKitTests is the shared base class for the data store test cases.
+ @discussion Each test gets its own temporary database path, which is removed (along with any -wal, -shm or -journal files) in tearDown.
+ */
+@interface RHSQLiteKitTests : XCTestCase {
+    NSString *_path;
+}
+
+-(RHSQLiteDataStore*)_dataStoreWithMigrations:(NSArray*)migrations; //one migration per array of sql statements
+-(RHSQLiteDataStore*)_itemsDataStore; //a data store with just the items table
+-(id)_valueForQuery:(NSString*)sql inDataStore:(RHSQLiteDataStore*)dataStore; //first column of the first row, nil if there are no rows
+-(BOOL)_executeStatements:(NSArray*)statements inDataStore:(RHSQLiteDataStore*)dataStore;
+-(RHSQLiteKitTestItem*)_insertItemNamed:(NSString*)name score:(double)score inDataStore:(RHSQLiteDataStore*)dataStore;
+
+@end
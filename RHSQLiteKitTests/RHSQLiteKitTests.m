@@ -6,31 +6,94 @@
 //  Copyright (c) 2013 Richard Heard. All rights reserved.
 //
 
-#import <XCTest/XCTest.h>
+#import "RHSQLiteKitTests.h"
 
-@interface RHSQLiteKitTests : XCTestCase
+
+#pragma mark - test object
+@implementation RHSQLiteKitTestItem
+
++(NSString*)tableName{
+    return RHSQLiteKitTestsTableName;
+}
+
++(NSString*)primaryKeyName{
+    return @"id";
+}
 
 @end
 
+
 @implementation RHSQLiteKitTests
 
 - (void)setUp
 {
     [super setUp];
     
-    // Set-up code here.
+    _path = [NSTemporaryDirectory() stringByAppendingPathComponent:[NSString stringWithFormat:@"rhsqlitekit-tests-%@.sqlite", [[NSProcessInfo processInfo] globallyUniqueString]]];
 }
 
 - (void)tearDown
 {
-    // Tear-down code here.
+    NSFileManager *fileManager = [NSFileManager defaultManager];
+    for (NSString *suffix in [NSArray arrayWithObjects:@"", @"-wal", @"-shm", @"-journal", nil]) {
+        [fileManager removeItemAtPath:[_path stringByAppendingString:suffix] error:nil];
+    }
     
     [super tearDown];
 }
 
-- (void)testExample
-{
-    XCTFail(@"No implementation for \"%s\"", __PRETTY_FUNCTION__);
+
+#pragma mark - helpers
+-(RHSQLiteDataStore*)_dataStoreWithMigrations:(NSArray*)migrations{
+    RHSQLiteDataStore *dataStore = [[RHSQLiteDataStore alloc] initWithPath:_path];
+    [dataStore associateObjectClass:[RHSQLiteKitTestItem class]];
+    
+    for (NSArray *statements in migrations) {
+        [dataStore registerMigrationBlock:^BOOL(RHSQLiteDataStore *store, FMDatabase *db) {
+            for (NSString *sql in statements) {
+                if (![db executeUpdate:sql]) return NO;
+            }
+            return YES;
+        }];
+    }
+    
+    if (![dataStore loadAndPerformAnyRequiredMigrations]) return nil;
+    return dataStore;
+}
+
+-(RHSQLiteDataStore*)_itemsDataStore{
+    return [self _dataStoreWithMigrations:[NSArray arrayWithObject:[NSArray arrayWithObject:RHSQLiteKitTestsCreateTableSQL]]];
+}
+
+-(id)_valueForQuery:(NSString*)sql inDataStore:(RHSQLiteDataStore*)dataStore{
+    __block id result = nil;
+    [dataStore accessDatabase:^(FMDatabase *db) {
+        FMResultSet *resultSet = [db executeQuery:sql];
+        if ([resultSet next]) result = [resultSet objectForColumnIndex:0];
+        [resultSet close];
+    }];
+    return result;
+}
+
+-(BOOL)_executeStatements:(NSArray*)statements inDataStore:(RHSQLiteDataStore*)dataStore{
+    __block BOOL result = YES;
+    [dataStore accessDatabase:^(FMDatabase *db) {
+        for (NSString *sql in statements) {
+            if (![db executeUpdate:sql]){
+                result = NO;
+                return;
+            }
+        }
+    }];
+    return result;
+}
+
+-(RHSQLiteKitTestItem*)_insertItemNamed:(NSString*)name score:(double)score inDataStore:(RHSQLiteDataStore*)dataStore{
+    RHSQLiteKitTestItem *item = [[RHSQLiteKitTestItem alloc] initWithDataStore:dataStore];
+    [item setObject:name forColumn:@"name"];
+    [item setDouble:score forColumn:@"score"];
+    [dataStore insertObject:item];
+    return item;
 }
 
 @end
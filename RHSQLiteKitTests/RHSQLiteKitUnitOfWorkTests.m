@@ -0,0 +1,133 @@
+//
+//  RHSQLiteKitUnitOfWorkTests.m
+//  RHSQLiteKitTests
+//
+//  Created by agent on 18/10/2026.
+//  Copyright (c) 2026 Richard Heard. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions
+//  are met:
+//  1. Redistributions of source code must retain the above copyright
+//  notice, this list of conditions and the following disclaimer.
+//  2. Redistributions in binary form must reproduce the above copyright
+//  notice, this list of conditions and the following disclaimer in the
+//  documentation and/or other materials provided with the distribution.
+//  3. The name of the author may not be used to endorse or promote products
+//  derived from this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+//  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+//  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+//  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+//  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+//  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#import "RHSQLiteKitTests.h"
+
+@interface RHSQLiteKitUnitOfWorkTests : RHSQLiteKitTests
+@end
+
+@implementation RHSQLiteKitUnitOfWorkTests
+
+- (void)testUnitOfWorkRollsBackWhenBlockFails
+{
+    RHSQLiteDataStore *dataStore = [self _itemsDataStore];
+    RHSQLiteKitTestItem *item = [self _insertItemNamed:@"original" score:1.0 inDataStore:dataStore];
+    
+    BOOL result = [dataStore performUnitOfWork:^BOOL{
+        [item setObject:@"changed" forColumn:@"name"];
+        [item save];
+        return NO;
+    } errors:NULL];
+    
+    XCTAssertFalse(result, @"A failed block reported success.");
+    XCTAssertEqualObjects([self _valueForQuery:@"SELECT name FROM items;" inDataStore:dataStore], @"original", @"A failed block still saved.");
+    XCTAssertTrue([item hasUnsavedChanges], @"A failed block discarded the objects changes.");
+}
+
+- (void)testUnitOfWorkRollsBackWhenAnObjectFails
+{
+    RHSQLiteDataStore *dataStore = [self _itemsDataStore];
+    RHSQLiteKitTestItem *valid = [self _insertItemNamed:@"valid" score:1.0 inDataStore:dataStore];
+    RHSQLiteKitTestItem *invalid = [self _insertItemNamed:@"invalid" score:1.0 inDataStore:dataStore];
+    
+    NSArray *errors = nil;
+    BOOL result = [dataStore performUnitOfWork:^BOOL{
+        [valid setDouble:2.0 forColumn:@"score"];
+        [valid save];
+        [invalid setDouble:-1.0 forColumn:@"score"]; //violates the CHECK constraint
+        [invalid save];
+        return YES;
+    } errors:&errors];
+    
+    XCTAssertFalse(result, @"The unit of work saved despite the constraint violation.");
+    XCTAssertEqual([errors count], (NSUInteger)1, @"Expected one error.");
+    XCTAssertTrue([[[errors lastObject] userInfo] objectForKey:RHSQLiteDataStoreFailedObjectKey] == invalid, @"The error doesn't name the failing object.");
+    
+    NSString *validScoreSQL = [NSString stringWithFormat:@"SELECT score FROM items WHERE id = %lld;", [valid objectID]];
+    XCTAssertEqual([[self _valueForQuery:validScoreSQL inDataStore:dataStore] doubleValue], 1.0, @"The other objects change wasn't rolled back.");
+    XCTAssertTrue([valid hasUnsavedChanges], @"The rolled back object lost its changes.");
+    XCTAssertTrue([invalid hasUnsavedChanges], @"The failing object lost its changes.");
+    
+    //fixing the failure lets everything save
+    [invalid setDouble:3.0 forColumn:@"score"];
+    XCTAssertTrue([dataStore saveAllChanges], @"Saving after the fix failed.");
+    XCTAssertEqual([[self _valueForQuery:validScoreSQL inDataStore:dataStore] doubleValue], 2.0, @"The other objects change wasn't saved.");
+}
+
+- (void)testNestedUnitsOfWorkSaveWhenTheOutermostEnds
+{
+    RHSQLiteDataStore *dataStore = [self _itemsDataStore];
+    RHSQLiteKitTestItem *item = [self _insertItemNamed:@"original" score:1.0 inDataStore:dataStore];
+    
+    __block id valueAfterInner = nil;
+    BOOL result = [dataStore performUnitOfWork:^BOOL{
+        BOOL inner = [dataStore performUnitOfWork:^BOOL{
+            [item setObject:@"changed" forColumn:@"name"];
+            return [item save];
+        } errors:NULL];
+        valueAfterInner = [self _valueForQuery:@"SELECT name FROM items;" inDataStore:dataStore];
+        return inner;
+    } errors:NULL];
+    
+    XCTAssertTrue(result, @"The outer unit of work failed.");
+    XCTAssertEqualObjects(valueAfterInner, @"original", @"The inner unit of work saved before the outer one ended.");
+    XCTAssertEqualObjects([self _valueForQuery:@"SELECT name FROM items;" inDataStore:dataStore], @"changed", @"The outer unit of work didn't save.");
+    XCTAssertFalse([item hasUnsavedChanges], @"The saved object still has unsaved changes.");
+}
+
+- (void)testSaveAllChangesReportsFailedCommit
+{
+    NSArray *statements = [NSArray arrayWithObjects:
+                           RHSQLiteKitTestsCreateTableSQL,
+                           @"CREATE TABLE links (id INTEGER PRIMARY KEY, item_id INTEGER REFERENCES items(id) DEFERRABLE INITIALLY DEFERRED);",
+                           @"INSERT INTO items (id, name, score) VALUES (1, 'one', 1.0);",
+                           @"INSERT INTO links (id, item_id) VALUES (1, 1);",
+                           nil];
+    RHSQLiteDataStore *dataStore = [self _dataStoreWithMigrations:[NSArray arrayWithObject:statements]];
+    XCTAssertNotNil(dataStore, @"Failed to load data store.");
+    XCTAssertTrue([self _executeStatements:[NSArray arrayWithObject:@"PRAGMA foreign_keys = ON;"] inDataStore:dataStore], @"Failed to enable foreign keys.");
+    
+    //deferred, so the UPDATE succeeds and only the COMMIT fails
+    RHSQLiteObject *link = [dataStore objectFromTable:@"links" withID:1];
+    [link setObject:[NSNumber numberWithLongLong:999] forColumn:@"item_id"];
+    
+    NSArray *errors = nil;
+    XCTAssertFalse([dataStore saveAllChangesWithErrors:&errors], @"A failed COMMIT reported success.");
+    XCTAssertEqual([errors count], (NSUInteger)1, @"Expected the single transaction error.");
+    XCTAssertNil([[[errors lastObject] userInfo] objectForKey:RHSQLiteDataStoreFailedObjectKey], @"A transaction error shouldn't name an object.");
+    XCTAssertTrue([link hasUnsavedChanges], @"The object lost its changes when the COMMIT failed.");
+    XCTAssertEqual([[self _valueForQuery:@"SELECT item_id FROM links;" inDataStore:dataStore] longLongValue], 1LL, @"The failed transaction wasn't rolled back.");
+    
+    //the connection is usable again, and the change saves once it is valid
+    [link setObject:[NSNumber numberWithLongLong:1] forColumn:@"item_id"];
+    XCTAssertTrue([dataStore saveAllChanges], @"Saving after the fix failed.");
+}
+
+@end
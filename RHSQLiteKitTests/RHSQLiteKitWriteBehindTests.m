@@ -0,0 +1,175 @@
+//
+//  RHSQLiteKitWriteBehindTests.m
+//  RHSQLiteKitTests
+//
+//  Created by agent on 18/10/2026.
+//  Copyright (c) 2026 Richard Heard. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions
+//  are met:
+//  1. Redistributions of source code must retain the above copyright
+//  notice, this list of conditions and the following disclaimer.
+//  2. Redistributions in binary form must reproduce the above copyright
+//  notice, this list of conditions and the following disclaimer in the
+//  documentation and/or other materials provided with the distribution.
+//  3. The name of the author may not be used to endorse or promote products
+//  derived from this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+//  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+//  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+//  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+//  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+//  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#import "RHSQLiteKitTests.h"
+#import "RHSQLiteWriteBehindQueue.h"
+
+@interface RHSQLiteKitWriteBehindTests : RHSQLiteKitTests
+@end
+
+@implementation RHSQLiteKitWriteBehindTests
+
+- (void)testWriteBehindFlush
+{
+    RHSQLiteDataStore *dataStore = [self _itemsDataStore];
+    RHSQLiteKitTestItem *item = [self _insertItemNamed:@"original" score:1.0 inDataStore:dataStore];
+    [dataStore setWriteBehindInterval:60.0];
+    
+    [item setObject:@"queued" forColumn:@"name"];
+    XCTAssertTrue([item save], @"Failed to queue the save.");
+    XCTAssertTrue([dataStore numberOfPendingWrites] > 0, @"Nothing was queued.");
+    XCTAssertEqualObjects([self _valueForQuery:@"SELECT name FROM items;" inDataStore:dataStore], @"original", @"The save was written immediately.");
+    
+    NSError *error = nil;
+    XCTAssertTrue([dataStore flushPendingWritesWithError:&error], @"Flush failed. Error: %@.", error);
+    XCTAssertEqual([dataStore numberOfPendingWrites], (NSUInteger)0, @"Values are still queued after the flush.");
+    XCTAssertEqualObjects([self _valueForQuery:@"SELECT name FROM items;" inDataStore:dataStore], @"queued", @"The flush didn't write the queued value.");
+}
+
+- (void)testWriteBehindReportsDroppedRows
+{
+    RHSQLiteDataStore *dataStore = [self _itemsDataStore];
+    RHSQLiteKitTestItem *item = [self _insertItemNamed:@"item" score:1.0 inDataStore:dataStore];
+    [dataStore setWriteBehindInterval:60.0];
+    
+    //violates the CHECK constraint, retrying can never succeed
+    [item setDouble:-1.0 forColumn:@"score"];
+    XCTAssertTrue([item save], @"Failed to queue the save.");
+    
+    NSError *error = nil;
+    XCTAssertFalse([dataStore flushPendingWritesWithError:&error], @"Flush succeeded despite the constraint violation.");
+    NSArray *droppedIDs = [[[error userInfo] objectForKey:RHSQLiteDataStoreDroppedRowsKey] objectForKey:RHSQLiteKitTestsTableName];
+    XCTAssertEqualObjects(droppedIDs, [NSArray arrayWithObject:[NSNumber numberWithLongLong:[item objectID]]], @"The dropped row wasn't reported.");
+    XCTAssertEqual([dataStore numberOfPendingWrites], (NSUInteger)0, @"The dropped row is still queued.");
+    XCTAssertEqual([[self _valueForQuery:@"SELECT score FROM items;" inDataStore:dataStore] doubleValue], 1.0, @"The invalid value was written.");
+    
+    //reported once
+    error = nil;
+    XCTAssertTrue([dataStore flushPendingWritesWithError:&error], @"The dropped row was reported twice. Error: %@.", error);
+}
+
+- (void)testWriteBehindRetriesSchemaErrors
+{
+    RHSQLiteDataStore *dataStore = [self _itemsDataStore];
+    RHSQLiteKitTestItem *item = [self _insertItemNamed:@"item" score:1.0 inDataStore:dataStore];
+    [dataStore setWriteBehindInterval:60.0];
+    
+    [item setObject:@"kept" forColumn:@"note"];
+    XCTAssertTrue([item save], @"Failed to queue the save.");
+    
+    //the queued column disappears, ie part way through a migration
+    BOOL dropped = [self _executeStatements:[NSArray arrayWithObjects:
+                                             @"CREATE TABLE items_new (id INTEGER PRIMARY KEY, name TEXT, score REAL);",
+                                             @"INSERT INTO items_new (id, name, score) SELECT id, name, score FROM items;",
+                                             @"DROP TABLE items;",
+                                             @"ALTER TABLE items_new RENAME TO items;",
+                                             nil] inDataStore:dataStore];
+    XCTAssertTrue(dropped, @"Failed to drop the column.");
+    
+    NSError *error = nil;
+    XCTAssertFalse([dataStore flushPendingWritesWithError:&error], @"Flush succeeded without the column.");
+    XCTAssertNotNil(error, @"The failed flush returned no error.");
+    XCTAssertNil([[error userInfo] objectForKey:RHSQLiteDataStoreDroppedRowsKey], @"A schema error dropped the row.");
+    XCTAssertTrue([dataStore numberOfPendingWrites] > 0, @"The failed batch wasn't kept for a retry.");
+    XCTAssertNotNil([dataStore lastWriteBehindError], @"The failure wasn't recorded.");
+    
+    //once the column is back, the retry writes it
+    XCTAssertTrue([self _executeStatements:[NSArray arrayWithObject:@"ALTER TABLE items ADD COLUMN note TEXT;"] inDataStore:dataStore], @"Failed to restore the column.");
+    error = nil;
+    XCTAssertTrue([dataStore flushPendingWritesWithError:&error], @"Retry failed. Error: %@.", error);
+    XCTAssertEqualObjects([self _valueForQuery:@"SELECT note FROM items;" inDataStore:dataStore], @"kept", @"The retried value wasn't written.");
+}
+
+- (void)testWriteBehindCapacityTimeout
+{
+    RHSQLiteDataStore *dataStore = [self _itemsDataStore];
+    XCTAssertTrue([self _executeStatements:[NSArray arrayWithObject:@"INSERT INTO items (id, name, score) VALUES (1, 'one', 1.0), (2, 'two', 2.0), (3, 'three', 3.0), (4, 'four', 4.0);"] inDataStore:dataStore], @"Insert failed.");
+    
+    //a writer stuck on its first batch, ie a hung disk
+    dispatch_semaphore_t gate = dispatch_semaphore_create(0);
+    RHSQLiteWriteBehindQueue *queue = [[RHSQLiteWriteBehindQueue alloc] initWithWriter:^(void (^block)(FMDatabase *db)) {
+        dispatch_semaphore_wait(gate, DISPATCH_TIME_FOREVER);
+        [dataStore accessDatabase:block];
+    } interval:60.0 batchSize:1 capacity:1];
+    [queue setCapacityTimeout:0.25];
+    
+    NSArray *columns = [NSArray arrayWithObject:@"name"];
+    NSError *error = nil;
+    XCTAssertTrue([queue enqueueValues:[NSArray arrayWithObject:@"uno"] forColumns:columns inTable:RHSQLiteKitTestsTableName primaryKeyName:@"id" objectID:1 waitIfFull:YES error:&error], @"Failed to queue the first row.");
+    //only queued once the stuck writer has taken the first
+    XCTAssertTrue([queue enqueueValues:[NSArray arrayWithObject:@"dos"] forColumns:columns inTable:RHSQLiteKitTestsTableName primaryKeyName:@"id" objectID:2 waitIfFull:YES error:&error], @"Failed to queue the second row.");
+    
+    NSTimeInterval start = [NSDate timeIntervalSinceReferenceDate];
+    error = nil;
+    BOOL queued = [queue enqueueValues:[NSArray arrayWithObject:@"tres"] forColumns:columns inTable:RHSQLiteKitTestsTableName primaryKeyName:@"id" objectID:3 waitIfFull:YES error:&error];
+    NSTimeInterval waited = [NSDate timeIntervalSinceReferenceDate] - start;
+    XCTAssertFalse(queued, @"Queued a row while the queue was full.");
+    XCTAssertEqual([error code], (NSInteger)ETIMEDOUT, @"Expected a timeout error. Got: %@.", error);
+    XCTAssertTrue(waited >= 0.2 && waited < 5.0, @"Gave up after %.3fs, expected the 0.25s capacity timeout.", waited);
+    
+    //savers that can't wait are queued over capacity instead
+    XCTAssertTrue([queue enqueueValues:[NSArray arrayWithObject:@"cuatro"] forColumns:columns inTable:RHSQLiteKitTestsTableName primaryKeyName:@"id" objectID:4 waitIfFull:NO error:&error], @"A saver that can't wait wasn't queued over capacity.");
+    XCTAssertEqual([queue numberOfPendingValues], (NSUInteger)3, @"Expected the in flight row and two queued rows.");
+    
+    //unstick the writer, the timed out row was never queued
+    for (NSUInteger i = 0; i < 4; i++) dispatch_semaphore_signal(gate);
+    XCTAssertTrue([queue flushWithError:&error], @"Flush failed. Error: %@.", error);
+    XCTAssertEqualObjects([self _valueForQuery:@"SELECT group_concat(name, ',') FROM (SELECT name FROM items ORDER BY id);" inDataStore:dataStore], @"uno,dos,three,cuatro", @"Unexpected rows after the flush.");
+}
+
+- (void)testWriteBehindSaveInsideDatabaseBlock
+{
+    RHSQLiteDataStore *dataStore = [self _itemsDataStore];
+    RHSQLiteKitTestItem *first = [self _insertItemNamed:@"first" score:1.0 inDataStore:dataStore];
+    RHSQLiteKitTestItem *second = [self _insertItemNamed:@"second" score:2.0 inDataStore:dataStore];
+    [dataStore setWriteBehindInterval:60.0];
+    [dataStore setWriteBehindBatchSize:100];
+    [dataStore setWriteBehindCapacity:1];
+    
+    [first setObject:@"first queued" forColumn:@"name"];
+    XCTAssertTrue([first save], @"Failed to queue the first save.");
+    
+    //the queue is full, and the writer would need the connection this block holds
+    [second setObject:@"second queued" forColumn:@"name"];
+    __block BOOL saved = NO;
+    NSTimeInterval start = [NSDate timeIntervalSinceReferenceDate];
+    [dataStore accessDatabase:^(FMDatabase *db) {
+        saved = [second save];
+    }];
+    NSTimeInterval waited = [NSDate timeIntervalSinceReferenceDate] - start;
+    XCTAssertTrue(saved, @"A save from inside a database block failed.");
+    XCTAssertTrue(waited < 5.0, @"A save from inside a database block waited %.3fs on the writer.", waited);
+    
+    NSError *error = nil;
+    XCTAssertTrue([dataStore flushPendingWritesWithError:&error], @"Flush failed. Error: %@.", error);
+    XCTAssertEqualObjects([self _valueForQuery:@"SELECT group_concat(name, ',') FROM (SELECT name FROM items ORDER BY id);" inDataStore:dataStore], @"first queued,second queued", @"Unexpected rows after the flush.");
+}
+
+@end
@@ -0,0 +1,62 @@
+//
+//  RHSQLiteObjectGenerator.h
+//  rhsqlitegen
+//
+//  Created by agent on 18/10/2026.
+//  Copyright (c) 2026 Richard Heard. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions
+//  are met:
+//  1. Redistributions of source code must retain the above copyright
+//  notice, this list of conditions and the following disclaimer.
+//  2. Redistributions in binary form must reproduce the above copyright
+//  notice, this list of conditions and the following disclaimer in the
+//  documentation and/or other materials provided with the distribution.
+//  3. The name of the author may not be used to endorse or promote products
+//  derived from this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+//  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+//  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+//  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+//  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+//  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#import <Foundation/Foundation.h>
+
+@class RHSQLiteDataStore;
+
+/*!
+ @class RHSQLiteObjectGenerator
+ @abstract RHSQLiteObjectGenerator emits RHSQLiteObject subclasses with typed accessors for a data stores tables.
+ @discussion Each generated class implements +tableName, +primaryKeyName and +schemaHash as constants, a concrete getter and setter per column 
+    that reads and writes the objects slots through an RHSQLiteColumnBinding, and a +objectsInDataStore:where<Property>Equals: query per column.
+    Column types map by sqlite affinity: INT => int64_t, BOOL => BOOL, REAL/FLOA/DOUB => double, DATE/TIME => NSDate, CHAR/CLOB/TEXT => NSString, BLOB => NSData, anything else => id.
+    NULL reads as 0 from primitive properties, use -columnHasNullValue: where the difference matters.
+    Columns whose property name is not a valid identifier, or would replace an existing RHSQLiteObject method, are skipped with a warning.
+ */
+@interface RHSQLiteObjectGenerator : NSObject {
+    RHSQLiteDataStore *_dataStore;
+    NSString *_classPrefix;
+}
+
+-(id)initWithDataStore:(RHSQLiteDataStore*)dataStore; //the data store should already be loaded
+
+@property (nonatomic, readonly) RHSQLiteDataStore *dataStore;
+@property (nonatomic, copy) NSString *classPrefix; //defaults to @""
+
+-(NSString*)classNameForTable:(NSString*)tableName; //prefix + camelcased table name, eg. user_accounts => PREFIXUserAccounts
+
+-(NSString*)headerForTable:(NSString*)tableName;         //nil for unknown tables
+-(NSString*)implementationForTable:(NSString*)tableName; //nil for unknown tables
+
+-(BOOL)writeClassForTable:(NSString*)tableName toDirectory:(NSString*)directory error:(NSError**)errorOut; //writes <className>.h and <className>.m
+
+@end
+
@@ -0,0 +1,373 @@
+//
+//  RHSQLiteObjectGenerator.m
+//  rhsqlitegen
+//
+//  Created by agent on 18/10/2026.
+//  Copyright (c) 2026 Richard Heard. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions
+//  are met:
+//  1. Redistributions of source code must retain the above copyright
+//  notice, this list of conditions and the following disclaimer.
+//  2. Redistributions in binary form must reproduce the above copyright
+//  notice, this list of conditions and the following disclaimer in the
+//  documentation and/or other materials provided with the distribution.
+//  3. The name of the author may not be used to endorse or promote products
+//  derived from this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+//  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+//  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+//  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+//  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+//  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#import "RHSQLiteObjectGenerator.h"
+#import "RHSQLiteDataStore.h"
+#import "RHSQLiteObject.h"
+#import "FMDatabase.h"
+#import "FMResultSet.h"
+#import "NSString+RHCaseAdditions.h"
+
+typedef enum {
+    RHSQLiteGeneratedTypeInt64 = 0,
+    RHSQLiteGeneratedTypeBool,
+    RHSQLiteGeneratedTypeDouble,
+    RHSQLiteGeneratedTypeObject,
+} RHSQLiteGeneratedType;
+
+@interface RHSQLiteObjectGenerator ()
+-(NSArray*)_columnsForTable:(NSString*)tableName; //dictionaries of name, type, pk. nil for unknown tables
+-(NSString*)_primaryKeyNameForColumns:(NSArray*)columns;
+-(NSArray*)_accessorsForTable:(NSString*)tableName columns:(NSArray*)columns;
+@end
+
+//what we generate for a single column
+@interface RHSQLiteGeneratedAccessor : NSObject
+@property (nonatomic, copy) NSString *columnName;
+@property (nonatomic, copy) NSString *declaredType;
+@property (nonatomic, copy) NSString *propertyName;
+@property (nonatomic, copy) NSString *bindingName;
+@property (nonatomic, assign) RHSQLiteGeneratedType type;
+@property (nonatomic, copy) NSString *className; //object types only, nil for id
+@end
+
+@implementation RHSQLiteGeneratedAccessor
+@end
+
+
+static NSString * RHSQLiteStringLiteral(NSString *string){
+    NSString *escaped = [string stringByReplacingOccurrencesOfString:@"\\" withString:@"\\\\"];
+    escaped = [escaped stringByReplacingOccurrencesOfString:@"\"" withString:@"\\\""];
+    return [NSString stringWithFormat:@"@\"%@\"", escaped];
+}
+
+static BOOL RHSQLiteIsValidIdentifier(NSString *string){
+    static NSSet *keywords = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        keywords = [[NSSet alloc] initWithObjects:@"auto", @"break", @"case", @"char", @"const", @"continue", @"default", @"do", @"double", @"else", @"enum", @"extern",
+                    @"float", @"for", @"goto", @"if", @"inline", @"int", @"long", @"register", @"restrict", @"return", @"short", @"signed", @"sizeof", @"static",
+                    @"struct", @"switch", @"typedef", @"union", @"unsigned", @"void", @"volatile", @"while", @"id", @"self", @"super", @"nil", @"Nil", @"YES", @"NO",
+                    @"BOOL", @"SEL", @"IMP", @"Class", @"bool", @"true", @"false", @"NULL", nil];
+    });
+    if ([string length] == 0 || [keywords containsObject:string]) return NO;
+    
+    NSCharacterSet *first = [NSCharacterSet characterSetWithCharactersInString:@"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz_"];
+    NSMutableCharacterSet *rest = [first mutableCopy];
+    [rest addCharactersInString:@"0123456789"];
+    if (![first characterIsMember:[string characterAtIndex:0]]) return NO;
+    return [string rangeOfCharacterFromSet:[rest invertedSet]].location == NSNotFound;
+}
+
+
+@implementation RHSQLiteObjectGenerator
+
+@synthesize dataStore=_dataStore;
+@synthesize classPrefix=_classPrefix;
+
+-(id)initWithDataStore:(RHSQLiteDataStore*)dataStore{
+    self = [super init];
+    if (self){
+        _dataStore = dataStore;
+        _classPrefix = @"";
+    }
+    return self;
+}
+
+
+#pragma mark - naming
+-(NSString*)classNameForTable:(NSString*)tableName{
+    return [NSString stringWithFormat:@"%@%@", _classPrefix ? _classPrefix : @"", [[tableName sk_camelcaseString] sk_uppercaseFirstString]];
+}
+
+
+#pragma mark - introspection
+-(NSArray*)_columnsForTable:(NSString*)tableName{
+    NSMutableArray *columns = [NSMutableArray array];
+    [_dataStore accessDatabase:^(FMDatabase *db) {
+        NSString *sql = [NSString stringWithFormat:@"PRAGMA table_info(`%@`)", tableName];
+        FMResultSet *resultSet = [db executeQuery:sql];
+        while ([resultSet next]) {
+            NSString *name = [resultSet stringForColumn:@"name"];
+            NSString *type = [resultSet stringForColumn:@"type"];
+            if (!name) continue;
+            [columns addObject:[NSDictionary dictionaryWithObjectsAndKeys:name, @"name", type ? type : @"", @"type", [NSNumber numberWithInt:[resultSet intForColumn:@"pk"]], @"pk", nil]];
+        }
+        [resultSet close];
+    }];
+    return [columns count] ? columns : nil;
+}
+
+-(NSString*)_primaryKeyNameForColumns:(NSArray*)columns{
+    //only a lone INTEGER PRIMARY KEY aliases the rowid, anything else and we stick with _ROWID_
+    NSDictionary *primaryKeyColumn = nil;
+    for (NSDictionary *column in columns) {
+        if ([[column objectForKey:@"pk"] intValue] == 0) continue;
+        if (primaryKeyColumn) return [RHSQLiteObject primaryKeyName];
+        primaryKeyColumn = column;
+    }
+    if (primaryKeyColumn && [[primaryKeyColumn objectForKey:@"type"] caseInsensitiveCompare:@"INTEGER"] == NSOrderedSame){
+        return [primaryKeyColumn objectForKey:@"name"];
+    }
+    return [RHSQLiteObject primaryKeyName];
+}
+
+-(NSArray*)_accessorsForTable:(NSString*)tableName columns:(NSArray*)columns{
+    NSString *className = [self classNameForTable:tableName];
+    NSString *primaryKeyName = [self _primaryKeyNameForColumns:columns];
+    RHSQLiteObject *namingObject = [[RHSQLiteObject alloc] init]; //without a data store, so it doesn't complain about columns
+    
+    NSMutableArray *accessors = [NSMutableArray array];
+    NSMutableSet *propertyNames = [NSMutableSet set];
+    for (NSDictionary *column in columns) {
+        NSString *columnName = [column objectForKey:@"name"];
+        
+        //the primary key is already available as objectID
+        if ([columnName isEqualToString:primaryKeyName]) continue;
+        
+        NSString *propertyName = [namingObject propertyNameForColumn:columnName];
+        NSString *setterName = [NSString stringWithFormat:@"set%@:", [propertyName sk_uppercaseFirstString]];
+        if (!RHSQLiteIsValidIdentifier(propertyName)){
+            RHErrorLog(@"Warning: Skipping column %@ in table %@, %@ is not a valid property name.", columnName, tableName, propertyName);
+            continue;
+        }
+        if ([RHSQLiteObject instancesRespondToSelector:NSSelectorFromString(propertyName)] || [RHSQLiteObject instancesRespondToSelector:NSSelectorFromString(setterName)]){
+            RHErrorLog(@"Warning: Skipping column %@ in table %@, %@ would replace an existing RHSQLiteObject method. It is still available via objectForColumn:.", columnName, tableName, propertyName);
+            continue;
+        }
+        if ([propertyNames containsObject:propertyName]){
+            RHErrorLog(@"Warning: Skipping column %@ in table %@, its property name %@ is already in use.", columnName, tableName, propertyName);
+            continue;
+        }
+        [propertyNames addObject:propertyName];
+        
+        RHSQLiteGeneratedAccessor *accessor = [[RHSQLiteGeneratedAccessor alloc] init];
+        accessor.columnName = columnName;
+        accessor.declaredType = [column objectForKey:@"type"];
+        accessor.propertyName = propertyName;
+        accessor.bindingName = [NSString stringWithFormat:@"%@%@Binding", className, [propertyName sk_uppercaseFirstString]];
+        
+        //sqlite's affinity rules, in the same order sqlite applies them. (see: https://www.sqlite.org/datatype3.html)
+        NSString *type = [accessor.declaredType uppercaseString];
+        if ([type rangeOfString:@"INT"].location != NSNotFound){
+            accessor.type = RHSQLiteGeneratedTypeInt64;
+        } else if ([type rangeOfString:@"CHAR"].location != NSNotFound || [type rangeOfString:@"CLOB"].location != NSNotFound || [type rangeOfString:@"TEXT"].location != NSNotFound){
+            accessor.type = RHSQLiteGeneratedTypeObject;
+            accessor.className = @"NSString";
+        } else if ([type rangeOfString:@"BLOB"].location != NSNotFound){
+            accessor.type = RHSQLiteGeneratedTypeObject;
+            accessor.className = @"NSData";
+        } else if ([type rangeOfString:@"REAL"].location != NSNotFound || [type rangeOfString:@"FLOA"].location != NSNotFound || [type rangeOfString:@"DOUB"].location != NSNotFound){
+            accessor.type = RHSQLiteGeneratedTypeDouble;
+        } else if ([type rangeOfString:@"BOOL"].location != NSNotFound){
+            //numeric affinity, but more useful as a BOOL
+            accessor.type = RHSQLiteGeneratedTypeBool;
+        } else if ([type rangeOfString:@"DATE"].location != NSNotFound || [type rangeOfString:@"TIME"].location != NSNotFound){
+            //we store NSDates as timeIntervalSince1970
+            accessor.type = RHSQLiteGeneratedTypeObject;
+            accessor.className = @"NSDate";
+        } else {
+            accessor.type = RHSQLiteGeneratedTypeObject;
+        }
+        
+        [accessors addObject:accessor];
+    }
+    return accessors;
+}
+
+
+#pragma mark - generation
+static NSString * RHSQLiteDeclaredType(RHSQLiteGeneratedAccessor *accessor){
+    switch (accessor.type) {
+        case RHSQLiteGeneratedTypeInt64: return @"int64_t";
+        case RHSQLiteGeneratedTypeBool: return @"BOOL";
+        case RHSQLiteGeneratedTypeDouble: return @"double";
+        case RHSQLiteGeneratedTypeObject: return accessor.className ? [NSString stringWithFormat:@"%@ *", accessor.className] : @"id";
+    }
+    return @"id";
+}
+
+static NSString * RHSQLiteBoxedValue(RHSQLiteGeneratedAccessor *accessor){
+    switch (accessor.type) {
+        case RHSQLiteGeneratedTypeInt64: return @"[NSNumber numberWithLongLong:value]";
+        case RHSQLiteGeneratedTypeBool: return @"[NSNumber numberWithBool:value]";
+        case RHSQLiteGeneratedTypeDouble: return @"[NSNumber numberWithDouble:value]";
+        case RHSQLiteGeneratedTypeObject: return @"(value ? (id)value : [NSNull null])";
+    }
+    return @"value";
+}
+
+static NSString * RHSQLiteQuerySelectorPrefix(RHSQLiteGeneratedAccessor *accessor){
+    return [NSString stringWithFormat:@"+(NSArray*)objectsInDataStore:(RHSQLiteDataStore*)dataStore where%@Equals:(%@)value", [accessor.propertyName sk_uppercaseFirstString], RHSQLiteDeclaredType(accessor)];
+}
+
+-(NSString*)headerForTable:(NSString*)tableName{
+    NSArray *columns = [self _columnsForTable:tableName];
+    if (!columns) return nil;
+    
+    NSString *className = [self classNameForTable:tableName];
+    NSArray *accessors = [self _accessorsForTable:tableName columns:columns];
+    
+    NSMutableString *header = [NSMutableString string];
+    [header appendFormat:@"//\n//  %@.h\n//  Generated by rhsqlitegen from table `%@`. Do not edit, regenerate instead.\n//\n\n", className, tableName];
+    [header appendString:@"#import \"RHSQLiteObject.h\"\n\n@class RHSQLiteDataStore;\n\n"];
+    [header appendFormat:@"@interface %@ : RHSQLiteObject\n\n", className];
+    
+    //properties
+    for (RHSQLiteGeneratedAccessor *accessor in accessors) {
+        NSString *attributes = @"nonatomic";
+        if ([accessor.className isEqualToString:@"NSString"] || [accessor.className isEqualToString:@"NSData"]) attributes = @"nonatomic, copy";
+        else if (accessor.type == RHSQLiteGeneratedTypeObject) attributes = @"nonatomic, strong";
+        
+        NSString *declaredType = RHSQLiteDeclaredType(accessor);
+        NSString *separator = [declaredType hasSuffix:@"*"] ? @"" : @" ";
+        NSString *comment = [accessor.declaredType length] ? accessor.declaredType : @"untyped";
+        if (accessor.type != RHSQLiteGeneratedTypeObject) comment = [comment stringByAppendingString:@", NULL reads as 0"];
+        [header appendFormat:@"@property (%@) %@%@%@; //%@ %@\n", attributes, declaredType, separator, accessor.propertyName, accessor.columnName, comment];
+    }
+    
+    //queries
+    if ([accessors count]) [header appendString:@"\n//typed queries, ordered by primary key. these match using IS, so nil finds NULLs\n"];
+    for (RHSQLiteGeneratedAccessor *accessor in accessors) {
+        [header appendFormat:@"%@;\n", RHSQLiteQuerySelectorPrefix(accessor)];
+    }
+    
+    [header appendString:@"\n@end\n"];
+    return header;
+}
+
+-(NSString*)implementationForTable:(NSString*)tableName{
+    NSArray *columns = [self _columnsForTable:tableName];
+    if (!columns) return nil;
+    
+    NSString *className = [self classNameForTable:tableName];
+    NSArray *accessors = [self _accessorsForTable:tableName columns:columns];
+    NSString *schemaHash = [_dataStore schemaHashForTable:tableName];
+    
+    NSMutableString *implementation = [NSMutableString string];
+    [implementation appendFormat:@"//\n//  %@.m\n//  Generated by rhsqlitegen from table `%@`. Do not edit, regenerate instead.\n//\n\n", className, tableName];
+    [implementation appendFormat:@"#import \"%@.h\"\n#import \"RHSQLiteDataStore.h\"\n\n", className];
+    
+    //bindings
+    for (RHSQLiteGeneratedAccessor *accessor in accessors) {
+        [implementation appendFormat:@"static RHSQLiteColumnBinding %@ = RHSQLiteColumnBindingMake(%@, %@);\n", accessor.bindingName, RHSQLiteStringLiteral(accessor.columnName), RHSQLiteStringLiteral(accessor.propertyName)];
+    }
+    if ([accessors count]) [implementation appendString:@"\n"];
+    
+    [implementation appendFormat:@"@implementation %@\n\n", className];
+    
+    //table
+    [implementation appendString:@"#pragma mark - table\n"];
+    [implementation appendFormat:@"+(NSString*)tableName{\n    return %@;\n}\n\n", RHSQLiteStringLiteral(tableName)];
+    [implementation appendFormat:@"+(NSString*)primaryKeyName{\n    return %@;\n}\n\n", RHSQLiteStringLiteral([self _primaryKeyNameForColumns:columns])];
+    [implementation appendFormat:@"+(NSString*)schemaHash{\n    return %@;\n}\n\n", RHSQLiteStringLiteral(schemaHash)];
+    
+    if ([accessors count]){
+        //kvo, our setters post their own notifications
+        NSMutableString *keys = [NSMutableString string];
+        for (RHSQLiteGeneratedAccessor *accessor in accessors) [keys appendFormat:@"%@, ", RHSQLiteStringLiteral(accessor.propertyName)];
+        [implementation appendString:@"#pragma mark - kvo\n"];
+        [implementation appendString:@"+(BOOL)automaticallyNotifiesObserversForKey:(NSString*)key{\n"];
+        [implementation appendString:@"    //our setters post their own change notifications\n"];
+        [implementation appendString:@"    static NSSet *columnKeys = nil;\n    static dispatch_once_t onceToken;\n    dispatch_once(&onceToken, ^{\n"];
+        [implementation appendFormat:@"        columnKeys = [[NSSet alloc] initWithObjects:%@nil];\n    });\n", keys];
+        [implementation appendString:@"    if ([columnKeys containsObject:key]) return NO;\n    return [super automaticallyNotifiesObserversForKey:key];\n}\n\n"];
+        
+        //accessors
+        [implementation appendString:@"#pragma mark - accessors\n"];
+        for (RHSQLiteGeneratedAccessor *accessor in accessors) {
+            NSString *declaredType = RHSQLiteDeclaredType(accessor);
+            NSString *setter = [NSString stringWithFormat:@"set%@", [accessor.propertyName sk_uppercaseFirstString]];
+            NSString *getterBody = nil;
+            NSString *setterBody = nil;
+            switch (accessor.type) {
+                case RHSQLiteGeneratedTypeInt64:
+                    getterBody = [NSString stringWithFormat:@"RHSQLiteObjectGetInt64(self, &%@)", accessor.bindingName];
+                    setterBody = [NSString stringWithFormat:@"RHSQLiteObjectSetInt64(self, &%@, value)", accessor.bindingName];
+                    break;
+                case RHSQLiteGeneratedTypeBool:
+                    getterBody = [NSString stringWithFormat:@"RHSQLiteObjectGetBool(self, &%@)", accessor.bindingName];
+                    setterBody = [NSString stringWithFormat:@"RHSQLiteObjectSetInt64(self, &%@, value ? 1 : 0)", accessor.bindingName];
+                    break;
+                case RHSQLiteGeneratedTypeDouble:
+                    getterBody = [NSString stringWithFormat:@"RHSQLiteObjectGetDouble(self, &%@)", accessor.bindingName];
+                    setterBody = [NSString stringWithFormat:@"RHSQLiteObjectSetDouble(self, &%@, value)", accessor.bindingName];
+                    break;
+                case RHSQLiteGeneratedTypeObject: {
+                    BOOL copies = [accessor.className isEqualToString:@"NSString"] || [accessor.className isEqualToString:@"NSData"];
+                    getterBody = [NSString stringWithFormat:@"RHSQLiteObjectGetObject(self, &%@, [%@ class])", accessor.bindingName, accessor.className ? accessor.className : @"NSObject"];
+                    setterBody = [NSString stringWithFormat:@"RHSQLiteObjectSetObject(self, &%@, %@)", accessor.bindingName, copies ? @"[value copy]" : @"value"];
+                    break;
+                }
+            }
+            [implementation appendFormat:@"-(%@)%@{\n    return %@;\n}\n", declaredType, accessor.propertyName, getterBody];
+            [implementation appendFormat:@"-(void)%@:(%@)value{\n    %@;\n}\n\n", setter, declaredType, setterBody];
+        }
+        
+        //queries
+        [implementation appendString:@"#pragma mark - queries\n"];
+        for (RHSQLiteGeneratedAccessor *accessor in accessors) {
+            NSString *where = RHSQLiteStringLiteral([NSString stringWithFormat:@"`%@` IS ?", accessor.columnName]);
+            [implementation appendFormat:@"%@{\n    return [dataStore objectsFromTable:[self tableName] where:%@ arguments:[NSArray arrayWithObject:%@]];\n}\n\n", RHSQLiteQuerySelectorPrefix(accessor), where, RHSQLiteBoxedValue(accessor)];
+        }
+    }
+    
+    [implementation appendString:@"@end\n"];
+    return implementation;
+}
+
+
+#pragma mark - output
+-(BOOL)writeClassForTable:(NSString*)tableName toDirectory:(NSString*)directory error:(NSError**)errorOut{
+    NSString *className = [self classNameForTable:tableName];
+    if (!RHSQLiteIsValidIdentifier(className)){
+        RHErrorLog(@"Error: Unable to generate a class for table %@, %@ is not a valid class name.", tableName, className);
+        if (errorOut) *errorOut = [NSError errorWithDomain:NSCocoaErrorDomain code:NSFileWriteUnknownError userInfo:[NSDictionary dictionaryWithObject:@"Invalid class name." forKey:NSLocalizedDescriptionKey]];
+        return NO;
+    }
+    
+    NSString *header = [self headerForTable:tableName];
+    NSString *implementation = [self implementationForTable:tableName];
+    if (!header || !implementation){
+        RHErrorLog(@"Error: Unable to generate a class for unknown table %@.", tableName);
+        if (errorOut) *errorOut = [NSError errorWithDomain:NSCocoaErrorDomain code:NSFileWriteUnknownError userInfo:[NSDictionary dictionaryWithObject:@"Unknown table." forKey:NSLocalizedDescriptionKey]];
+        return NO;
+    }
+    
+    NSString *headerPath = [directory stringByAppendingPathComponent:[className stringByAppendingPathExtension:@"h"]];
+    NSString *implementationPath = [directory stringByAppendingPathComponent:[className stringByAppendingPathExtension:@"m"]];
+    if (![header writeToFile:headerPath atomically:YES encoding:NSUTF8StringEncoding error:errorOut]) return NO;
+    if (![implementation writeToFile:implementationPath atomically:YES encoding:NSUTF8StringEncoding error:errorOut]) return NO;
+    
+    RHLog(@"Generated %@ for table %@ in %@.", className, tableName, directory);
+    return YES;
+}
+
+@end
@@ -0,0 +1,115 @@
+//
+//  main.m
+//  rhsqlitegen
+//
+//  Created by agent on 18/10/2026.
+//  Copyright (c) 2026 Richard Heard. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions
+//  are met:
+//  1. Redistributions of source code must retain the above copyright
+//  notice, this list of conditions and the following disclaimer.
+//  2. Redistributions in binary form must reproduce the above copyright
+//  notice, this list of conditions and the following disclaimer in the
+//  documentation and/or other materials provided with the distribution.
+//  3. The name of the author may not be used to endorse or promote products
+//  derived from this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+//  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+//  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+//  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+//  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+//  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+//  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+//  usage: rhsqlitegen (-database store.sqlite | -sql schema.sql) [-tables people,places] [-prefix XY] [-output directory]
+//  writes an RHSQLiteObject subclass (.h and .m) per table. -sql runs the given statements (eg. createTableSQL output) against a scratch store first.
+//  associate the generated classes with your data store before calling loadAndPerformAnyRequiredMigrations, which fails if their tables have since changed.
+
+#import <Foundation/Foundation.h>
+#import <sqlite3.h>
+#import "RHSQLiteDataStore.h"
+#import "RHSQLiteDataStoreOptions.h"
+#import "RHSQLiteObjectGenerator.h"
+
+static NSString * RHSQLiteScratchStoreFromSQLFile(NSString *sqlPath){
+    NSString *sql = [NSString stringWithContentsOfFile:sqlPath encoding:NSUTF8StringEncoding error:nil];
+    if (!sql){
+        NSLog(@"Error: Failed to read %@.", sqlPath);
+        return nil;
+    }
+    
+    NSString *path = [NSTemporaryDirectory() stringByAppendingPathComponent:[NSString stringWithFormat:@"rhsqlitegen-%@.sqlite", [[NSProcessInfo processInfo] globallyUniqueString]]];
+    sqlite3 *db = NULL;
+    char *errorMessage = NULL;
+    BOOL success = sqlite3_open([path fileSystemRepresentation], &db) == SQLITE_OK && sqlite3_exec(db, [sql UTF8String], NULL, NULL, &errorMessage) == SQLITE_OK;
+    if (!success) NSLog(@"Error: Failed to run %@: %s.", sqlPath, errorMessage ? errorMessage : sqlite3_errmsg(db));
+    sqlite3_free(errorMessage);
+    sqlite3_close(db);
+    
+    if (!success){
+        [[NSFileManager defaultManager] removeItemAtPath:path error:nil];
+        return nil;
+    }
+    return path;
+}
+
+int main(int argc, const char * argv[]){
+    int status = 0;
+    @autoreleasepool {
+        NSUserDefaults *arguments = [NSUserDefaults standardUserDefaults];
+        
+        NSString *databasePath = [arguments stringForKey:@"database"];
+        NSString *sqlPath = [arguments stringForKey:@"sql"];
+        NSString *tablesArgument = [arguments stringForKey:@"tables"];
+        NSString *prefix = [arguments stringForKey:@"prefix"] ?: @"";
+        NSString *outputDirectory = [arguments stringForKey:@"output"] ?: [[NSFileManager defaultManager] currentDirectoryPath];
+        
+        if (!databasePath == !sqlPath){
+            fprintf(stderr, "usage: rhsqlitegen (-database store.sqlite | -sql schema.sql) [-tables people,places] [-prefix XY] [-output directory]\n");
+            return 2;
+        }
+        
+        NSString *scratchPath = nil;
+        if (sqlPath){
+            scratchPath = RHSQLiteScratchStoreFromSQLFile(sqlPath);
+            if (!scratchPath) return 2;
+            databasePath = scratchPath;
+        }
+        
+        //immutable, so that generating never touches the store. checkpoint any WAL first
+        RHSQLiteDataStore *dataStore = [[RHSQLiteDataStore alloc] initWithPath:databasePath options:[RHSQLiteDataStoreOptions optionsWithProfile:RHSQLiteDataStoreProfileImmutable]];
+        if (![dataStore loadAndPerformAnyRequiredMigrations]){
+            NSLog(@"Error: Failed to load %@.", databasePath);
+            status = 2;
+        } else {
+            NSArray *tableNames = tablesArgument ? [tablesArgument componentsSeparatedByString:@","] : [dataStore tableNames];
+            
+            RHSQLiteObjectGenerator *generator = [[RHSQLiteObjectGenerator alloc] initWithDataStore:dataStore];
+            [generator setClassPrefix:prefix];
+            
+            for (NSString *tableName in tableNames) {
+                //the data stores own bookkeeping
+                if (!tablesArgument && [tableName isEqualToString:@"metadata"]) continue;
+                
+                NSError *error = nil;
+                if (![generator writeClassForTable:tableName toDirectory:outputDirectory error:&error]){
+                    NSLog(@"Error: Failed to generate a class for table %@: %@.", tableName, [error localizedDescription]);
+                    status = 1;
+                    continue;
+                }
+                printf("%s\n", [[generator classNameForTable:tableName] UTF8String]);
+            }
+        }
+        
+        dataStore = nil; //closes the store before we remove any scratch file
+        if (scratchPath) [[NSFileManager defaultManager] removeItemAtPath:scratchPath error:nil];
+    }
+    return status;
+}